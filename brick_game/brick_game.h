@@ -9,6 +9,24 @@
 #ifndef BRICK_GAME_H
 #define BRICK_GAME_H
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define FIELD_WIDTH 10
+#define FIELD_HEIGHT 20
+#define TETR_SIZE 5
+
+#define MIN_FIELD_WIDTH 4
+#define MAX_FIELD_WIDTH 64
+#define MIN_FIELD_HEIGHT 4
+#define MAX_FIELD_HEIGHT 1024
+
+#define MIN_PREVIEW_DEPTH 1
+#define MAX_PREVIEW_DEPTH 7
+
+#define GARBAGE_CELL 8
+
 /**
  * @brief Enum representing the different user actions in the game.
  *
@@ -30,7 +48,11 @@ typedef enum {
  * @brief Structure containing game-related information.
  *
  * This structure holds data regarding the game state, including the game field,
- * the upcoming tetromino, the score, and the current game settings.
+ * the upcoming tetromino, the score, and the current game settings. The field
+ * has `height` rows of `width` cells. A cell is `0` when empty, the type of
+ * the tetromino that filled it, or `GARBAGE_CELL` for a garbage row received
+ * in a versus match. `preview` lists the types of the `preview_depth`
+ * upcoming tetrominoes, starting with the one in `next`.
  */
 typedef struct {
   int **field;
@@ -40,9 +62,45 @@ typedef struct {
   int level;
   int speed;
   int pause;
+  int width;
+  int height;
+  int preview[MAX_PREVIEW_DEPTH];
+  int preview_depth;
 } GameInfo_t;
 
+/**
+ * @brief Packed view of the game state.
+ *
+ * Cells are stored one byte each in contiguous row-major arrays owned by the
+ * engine: `field` has `height * width` cells and `next` has
+ * `TETR_SIZE * TETR_SIZE` cells. The arrays stay valid until the next update
+ * and must not be freed. `preview` is filled like in `GameInfo_t`.
+ */
+typedef struct {
+  const uint8_t *field;
+  const uint8_t *next;
+  int score;
+  int high_score;
+  int level;
+  int speed;
+  int pause;
+  int width;
+  int height;
+  int preview[MAX_PREVIEW_DEPTH];
+  int preview_depth;
+} PackedGameInfo_t;
+
 GameInfo_t updateCurrentState();
+PackedGameInfo_t updatePackedState();
+bool setBoardSize(int width, int height);
+bool setPreviewDepth(int depth);
+bool useMatrixArena();
+bool setRewindWindow(int seconds);
+bool rewindGame(int pieces);
 void userInput(UserAction_t action, bool hold);
+void userInputAt(UserAction_t action, bool hold, long long int time_us);
+bool isInputPending();
+void frameRendered();
+void dumpStats(FILE *stream);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+/**
+ * @file alloc_stats.c
+ * @brief Allocation counters by call site and their report.
+ */
+#include "alloc_stats.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief Counters of one call site, shared by all threads.
+ */
+typedef struct {
+  atomic_ullong allocations;
+  atomic_ullong frees;
+  atomic_ullong bytes;
+} AllocCounters_t;
+
+atomic_bool alloc_stats_enabled = false;
+
+static const char *site_names[ALLOC_SITE_COUNT] = {"matrix", "model",
+                                                   "snapshot", "frontend"};
+static AllocCounters_t counters[ALLOC_SITE_COUNT];
+static atomic_ullong frames;
+static atomic_ullong pieces;
+
+/**
+ * @brief Clears the counters and enables accounting.
+ *
+ * Should be called before the counted threads start.
+ */
+void alloc_stats_start() {
+  for (int i = 0; i < ALLOC_SITE_COUNT; i++) {
+    atomic_store(&counters[i].allocations, 0);
+    atomic_store(&counters[i].frees, 0);
+    atomic_store(&counters[i].bytes, 0);
+  }
+  atomic_store(&frames, 0);
+  atomic_store(&pieces, 0);
+  atomic_store_explicit(&alloc_stats_enabled, true, memory_order_relaxed);
+}
+
+/**
+ * @brief Enables accounting if the `TETRIS_ALLOC_STATS` environment variable
+ * is set to a non-empty value.
+ *
+ * @return `true` if accounting was enabled.
+ */
+bool alloc_stats_start_from_env() {
+  const char *value = getenv(ALLOC_STATS_ENV);
+  bool is_set = value && *value;
+  if (is_set) alloc_stats_start();
+  return is_set;
+}
+
+/**
+ * @brief Disables accounting; the counters keep their values.
+ */
+void alloc_stats_stop() {
+  atomic_store_explicit(&alloc_stats_enabled, false, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts one allocation.
+ *
+ * @param site The call site.
+ * @param bytes The size of the allocated block.
+ */
+void alloc_stats_count(AllocSite_t site, size_t bytes) {
+  atomic_fetch_add_explicit(&counters[site].allocations, 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&counters[site].bytes, bytes,
+                            memory_order_relaxed);
+}
+
+/**
+ * @brief Counts one freed block.
+ *
+ * @param site The call site that allocated it.
+ */
+void alloc_stats_count_free(AllocSite_t site) {
+  atomic_fetch_add_explicit(&counters[site].frees, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts one rendered frame if accounting is enabled.
+ */
+void alloc_stats_mark_frame() {
+  if (ALLOC_STATS_IS_ENABLED())
+    atomic_fetch_add_explicit(&frames, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Counts one attached tetramino if accounting is enabled.
+ */
+void alloc_stats_mark_piece() {
+  if (ALLOC_STATS_IS_ENABLED())
+    atomic_fetch_add_explicit(&pieces, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Reads the counters.
+ *
+ * @param[out] report The counters since accounting started.
+ */
+void alloc_stats_read(AllocReport_t *report) {
+  for (int i = 0; i < ALLOC_SITE_COUNT; i++) {
+    report->sites[i].allocations = atomic_load_explicit(
+        &counters[i].allocations, memory_order_relaxed);
+    report->sites[i].frees =
+        atomic_load_explicit(&counters[i].frees, memory_order_relaxed);
+    report->sites[i].bytes =
+        atomic_load_explicit(&counters[i].bytes, memory_order_relaxed);
+  }
+  report->frames = atomic_load_explicit(&frames, memory_order_relaxed);
+  report->pieces = atomic_load_explicit(&pieces, memory_order_relaxed);
+}
+
+/**
+ * @brief Sums the allocations of all call sites.
+ *
+ * @param report The report.
+ * @return The number of allocations.
+ */
+unsigned long long alloc_report_total(const AllocReport_t *report) {
+  unsigned long long total = 0;
+  for (int i = 0; i < ALLOC_SITE_COUNT; i++)
+    total += report->sites[i].allocations;
+  return total;
+}
+
+/**
+ * @brief Prints a report in a human-readable form.
+ *
+ * @param stream The output stream.
+ * @param report The report.
+ */
+void alloc_stats_dump(FILE *stream, const AllocReport_t *report) {
+  unsigned long long total = alloc_report_total(report);
+  fprintf(stream, "# Allocations (site allocations frees bytes)\n");
+  for (int i = 0; i < ALLOC_SITE_COUNT; i++)
+    fprintf(stream, "%-10s %llu %llu %llu\n", site_names[i],
+            report->sites[i].allocations, report->sites[i].frees,
+            report->sites[i].bytes);
+  fprintf(stream, "%llu frames, %.3f allocations/frame\n", report->frames,
+          report->frames ? (double)total / report->frames : 0.0);
+  fprintf(stream, "%llu pieces, %.3f allocations/piece\n", report->pieces,
+          report->pieces ? (double)total / report->pieces : 0.0);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file alloc_stats.h
+ * @brief Opt-in accounting of heap allocations by call site.
+ *
+ * Accounting is enabled by the `TETRIS_ALLOC_STATS` environment variable (or
+ * by `alloc_stats_start()`). The matrix functions, the per-frame snapshot of
+ * `updateCurrentState()`, the buffers of the models and the frontend count
+ * every allocation, its size and every free under their call site. Rendered
+ * frames and attached tetraminos are counted too, so a report gives the
+ * allocations per frame and per piece. Once a game runs, both should be zero.
+ */
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define ALLOC_STATS_ENV "TETRIS_ALLOC_STATS"
+
+/**
+ * @brief Call sites of the counted allocations.
+ */
+typedef enum {
+  Matrix_site,
+  Model_site,
+  Snapshot_site,
+  Frontend_site,
+  ALLOC_SITE_COUNT
+} AllocSite_t;
+
+/**
+ * @brief Allocations, freed blocks and allocated bytes of one call site.
+ */
+typedef struct {
+  unsigned long long allocations;
+  unsigned long long frees;
+  unsigned long long bytes;
+} AllocCounts_t;
+
+/**
+ * @brief Counts of every call site since accounting started, with the frames
+ * and pieces over which they were made.
+ */
+typedef struct {
+  AllocCounts_t sites[ALLOC_SITE_COUNT];
+  unsigned long long frames;
+  unsigned long long pieces;
+} AllocReport_t;
+
+extern atomic_bool alloc_stats_enabled;
+
+void alloc_stats_start();
+bool alloc_stats_start_from_env();
+void alloc_stats_stop();
+void alloc_stats_count(AllocSite_t site, size_t bytes);
+void alloc_stats_count_free(AllocSite_t site);
+void alloc_stats_mark_frame();
+void alloc_stats_mark_piece();
+void alloc_stats_read(AllocReport_t *report);
+unsigned long long alloc_report_total(const AllocReport_t *report);
+void alloc_stats_dump(FILE *stream, const AllocReport_t *report);
+
+/**
+ * @brief Tells whether accounting is enabled.
+ */
+#define ALLOC_STATS_IS_ENABLED() \
+  atomic_load_explicit(&alloc_stats_enabled, memory_order_relaxed)
+
+#define ALLOC_COUNT(site, bytes)                                  \
+  do {                                                            \
+    if (ALLOC_STATS_IS_ENABLED()) alloc_stats_count(site, bytes); \
+  } while (0)
+
+#define FREE_COUNT(site)                                        \
+  do {                                                          \
+    if (ALLOC_STATS_IS_ENABLED()) alloc_stats_count_free(site); \
+  } while (0)
+
+#endif
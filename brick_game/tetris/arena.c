@@ -0,0 +1,81 @@
+/**
+ * @file arena.c
+ * @brief Bump arena that holds the buffers of a game model.
+ */
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc_stats.h"
+
+/**
+ * @brief Allocates the block of an arena.
+ *
+ * @param[out] arena The arena to set up.
+ * @param capacity The size of the block in bytes.
+ * @return Error code (`0` on success, the arena is left empty otherwise).
+ */
+int arena_init(MatrixArena_t *arena, size_t capacity) {
+  arena->block = capacity ? calloc(1, capacity) : NULL;
+  arena->capacity = arena->block ? capacity : 0;
+  if (arena->block) ALLOC_COUNT(Model_site, capacity);
+  arena->used = 0;
+  return arena->block ? 0 : 1;
+}
+
+/**
+ * @brief Hands out zeroed memory from an arena.
+ *
+ * @param arena The arena.
+ * @param size The number of bytes.
+ * @return A pointer aligned for any type, or `NULL` if the arena is full.
+ */
+void *arena_alloc(MatrixArena_t *arena, size_t size) {
+  void *pointer = NULL;
+  size = arena_round(size);
+  if (arena->block && size && size <= arena->capacity - arena->used) {
+    pointer = arena->block + arena->used;
+    memset(pointer, 0, size);
+    arena->used += size;
+  }
+  return pointer;
+}
+
+/**
+ * @brief Checks whether memory was handed out by an arena.
+ *
+ * @param arena The arena.
+ * @param pointer The memory to check.
+ * @return `true` if the pointer lies inside the block of the arena.
+ */
+bool arena_owns(const MatrixArena_t *arena, const void *pointer) {
+  uintptr_t address = (uintptr_t)pointer;
+  uintptr_t base = (uintptr_t)arena->block;
+  return arena->block && address >= base && address - base < arena->capacity;
+}
+
+/**
+ * @brief Releases the block of an arena and everything handed out from it.
+ *
+ * @param arena The arena.
+ */
+void arena_free(MatrixArena_t *arena) {
+  if (arena->block) FREE_COUNT(Model_site);
+  free(arena->block);
+  arena->block = NULL;
+  arena->capacity = 0;
+  arena->used = 0;
+}
+
+/**
+ * @brief Rounds a size up to the alignment of the arena.
+ *
+ * @param size The number of bytes.
+ * @return The size rounded up to a multiple of `_Alignof(max_align_t)`.
+ */
+size_t arena_round(size_t size) {
+  size_t alignment = _Alignof(max_align_t);
+  return (size + alignment - 1) / alignment * alignment;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file arena.h
+ * @brief Bump arena that holds the buffers of a game model.
+ *
+ * The field, the tetramino matrices and the frame cells of a model are carved
+ * out of one block, so they sit next to each other in memory and are all
+ * released with a single call when the game ends.
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Arena of `capacity` bytes of which `used` are handed out.
+ *
+ * An arena with no block hands out nothing, so callers fall back to the heap.
+ */
+typedef struct {
+  unsigned char *block;
+  size_t capacity;
+  size_t used;
+} MatrixArena_t;
+
+int arena_init(MatrixArena_t *arena, size_t capacity);
+void *arena_alloc(MatrixArena_t *arena, size_t size);
+bool arena_owns(const MatrixArena_t *arena, const void *pointer);
+void arena_free(MatrixArena_t *arena);
+size_t arena_round(size_t size);
+
+#endif
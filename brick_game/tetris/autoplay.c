@@ -0,0 +1,330 @@
+/**
+ * @file autoplay.c
+ * @brief Greedy autoplay policy.
+ */
+#include "autoplay.h"
+
+#include <float.h>
+#include <limits.h>
+
+#include "bot_plugin.h"
+
+#define HEIGHT_WEIGHT -0.510066
+#define LINES_WEIGHT 0.760666
+#define HOLES_WEIGHT -0.35663
+#define BUMPINESS_WEIGHT -0.184483
+
+#define SEARCH_DEPTH_INDEX(depth) ((uint64_t)1 << 41 | (uint64_t)(depth))
+
+/**
+ * @brief Computes the features of the field of a game.
+ *
+ * @param game A pointer to the game state.
+ * @param[out] features The computed features.
+ */
+void board_features(const GameState_t *game, BoardFeatures_t *features) {
+  int heights[MAX_FIELD_WIDTH] = {0};
+  uint64_t seen = 0;
+  features->holes = 0;
+  for (int y = 0; y < game->height; y++) {
+    uint64_t row = game->rows[y];
+    uint64_t fresh = row & ~seen;
+    while (fresh) {
+      int x = __builtin_ctzll(fresh);
+      heights[x] = game->height - y;
+      fresh &= fresh - 1;
+    }
+    features->holes += __builtin_popcountll(seen & ~row);
+    seen |= row;
+  }
+  features->aggregate_height = 0;
+  features->bumpiness = 0;
+  features->max_height = 0;
+  for (int x = 0; x < game->width; x++) {
+    features->aggregate_height += heights[x];
+    if (heights[x] > features->max_height) features->max_height = heights[x];
+    if (x) features->bumpiness += abs(heights[x] - heights[x - 1]);
+  }
+}
+
+/**
+ * @brief Scores the field after a placement.
+ *
+ * @param game A pointer to the game state after the placement.
+ * @param lines_cleared The number of lines cleared by the placement.
+ * @return The score, higher is better.
+ */
+double evaluate_placement(const GameState_t *game, int lines_cleared) {
+  double score = -DBL_MAX;
+  if (!state_is_over(game)) {
+    BoardFeatures_t features;
+    board_features(game, &features);
+    score = HEIGHT_WEIGHT * features.aggregate_height +
+            LINES_WEIGHT * lines_cleared + HOLES_WEIGHT * features.holes +
+            BUMPINESS_WEIGHT * features.bumpiness;
+  }
+  return score;
+}
+
+/**
+ * @brief Lists every placement of the current tetramino that fits at the
+ * spawn row.
+ *
+ * @param game A pointer to the game state.
+ * @param[out] placements An array of at least `MAX_PLACEMENTS` elements.
+ * @return The number of placements.
+ */
+int enumerate_placements(const GameState_t *game, Placement_t *placements) {
+  int count = 0;
+  if (game->state == Moving) {
+    for (int rotation = 0; rotation < piece_period(game->piece); rotation++) {
+      for (int x = 1 - TETR_SIZE; x < game->width; x++) {
+        if (!state_collides(game, rotation, x, game->y_position)) {
+          placements[count].rotation = rotation;
+          placements[count].x_position = x;
+          count++;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief Chooses the best placement of the current tetramino.
+ *
+ * @param game A pointer to the game state.
+ * @param[out] best The chosen placement.
+ * @return `false` if the tetramino cannot be placed.
+ */
+bool choose_placement(const GameState_t *game, Placement_t *best) {
+  Placement_t placements[MAX_PLACEMENTS];
+  int count = enumerate_placements(game, placements);
+  double best_score = -DBL_MAX;
+  for (int i = 0; i < count; i++) {
+    GameState_t trial;
+    state_clone(&trial, game);
+    state_place(&trial, placements[i].rotation, placements[i].x_position);
+    double score = evaluate_placement(&trial, trial.lines - game->lines);
+    if (i == 0 || score > best_score) {
+      best_score = score;
+      *best = placements[i];
+    }
+  }
+  return count > 0;
+}
+
+/**
+ * @brief Places the current tetramino at the best placement.
+ *
+ * @param game A pointer to the game state.
+ * @return `false` if the game is over.
+ */
+bool autoplay_step(GameState_t *game) {
+  Placement_t best;
+  if (choose_placement(game, &best))
+    state_place(game, best.rotation, best.x_position);
+  else
+    game->state = Game_over;
+  return !state_is_over(game);
+}
+
+/**
+ * @brief Returns the next input that moves a tetramino from one placement
+ * towards another.
+ *
+ * The tetramino is rotated first, then moved sideways and finally dropped, one
+ * input per call, so that a game driven by user input follows the placement.
+ *
+ * @param current The placement of the tetramino now.
+ * @param target The placement to reach.
+ * @return `Action`, `Left`, `Right` or `Down`.
+ */
+UserAction_t placement_action(const Placement_t *current,
+                              const Placement_t *target) {
+  UserAction_t action = Down;
+  if (current->rotation != target->rotation)
+    action = Action;
+  else if (current->x_position > target->x_position)
+    action = Left;
+  else if (current->x_position < target->x_position)
+    action = Right;
+  return action;
+}
+
+/**
+ * @brief Returns the next input that moves the current tetramino of a state
+ * towards a placement.
+ *
+ * @param game A pointer to the game state.
+ * @param target The placement to reach.
+ * @return `Action`, `Left`, `Right` or `Down`.
+ */
+UserAction_t autoplay_action(const GameState_t *game,
+                             const Placement_t *target) {
+  Placement_t current = {game->rotation, game->x_position};
+  return placement_action(&current, target);
+}
+
+/**
+ * @brief Prepares a driver using the greedy policy.
+ *
+ * @param[out] driver The driver.
+ */
+void driver_init(ModelDriver_t *driver) {
+  driver->bot = NULL;
+  driver_reset(driver);
+}
+
+/**
+ * @brief Forgets the placement of the previous game, keeping the policy.
+ *
+ * @param driver The driver.
+ */
+void driver_reset(ModelDriver_t *driver) {
+  driver->planned = false;
+  driver->last_y = INT_MIN;
+  driver->moves = 0;
+}
+
+/**
+ * @brief Gives the input of the autoplay policy for the next tick of a model.
+ *
+ * The placement is chosen when the tetramino appears and the tetramino is
+ * rotated, moved and pushed down towards it. When the bot forfeits the move
+ * the tetramino is pushed straight down. Nothing is done unless a tetramino
+ * is falling.
+ *
+ * A compact state is built from the model only to choose the placement; on
+ * the other ticks the tetramino is followed on the model itself.
+ *
+ * @param driver The driver.
+ * @param model The game model.
+ */
+void driver_input(ModelDriver_t *driver, ModelInfo_t *model) {
+  bool is_falling = model->state == Moving;
+  if (is_falling && model->y_position < driver->last_y)
+    driver->planned = false;
+  if (is_falling && !driver->planned) {
+    GameState_t state;
+    is_falling = !state_from_model(&state, model);
+    if (is_falling && driver->bot) {
+      if (!bot_choose(driver->bot, &state, &driver->target))
+        driver->target = (Placement_t){state.rotation, state.x_position};
+      driver->planned = true;
+    } else if (is_falling) {
+      driver->planned = choose_placement(&state, &driver->target);
+    }
+    driver->moves = 0;
+  }
+  if (is_falling) {
+    driver->last_y = model->y_position;
+    Placement_t current = {
+        find_rotation(model->current_type, model->current_tetramino),
+        model->x_position};
+    UserAction_t action = Down;
+    if (driver->planned && driver->moves < MAX_MOVES_PER_PIECE)
+      action = placement_action(&current, &driver->target);
+    if (action != Down) driver->moves++;
+    model->user_action = action;
+    model->hold = true;
+  }
+}
+
+/**
+ * @brief Returns the transposition table key of a position searched to the
+ * given depth.
+ *
+ * Besides `state_hash()` the key covers the generator, which decides the
+ * tetraminos after the next one.
+ *
+ * @param game A pointer to the game state.
+ * @param depth The search depth.
+ * @return The 64-bit key.
+ */
+uint64_t search_key(const GameState_t *game, int depth) {
+  return state_hash(game) ^ zobrist_key(game->rng) ^
+         zobrist_key(SEARCH_DEPTH_INDEX(depth));
+}
+
+/**
+ * @brief Returns the value of a placement followed by `depth - 1` searched
+ * tetraminos.
+ *
+ * @param game A pointer to the game state before the placement.
+ * @param placement The placement of the current tetramino.
+ * @param depth The number of tetraminos to place, this one included.
+ * @param table The transposition table or `NULL`.
+ * @return The value of the placement.
+ */
+static double placement_value(const GameState_t *game,
+                              const Placement_t *placement, int depth,
+                              TranspositionTable_t *table) {
+  GameState_t trial;
+  state_clone(&trial, game);
+  state_place(&trial, placement->rotation, placement->x_position);
+  int lines_cleared = trial.lines - game->lines;
+  return depth <= 1 || state_is_over(&trial)
+             ? evaluate_placement(&trial, lines_cleared)
+             : LINES_WEIGHT * lines_cleared +
+                   search_value(&trial, depth - 1, table);
+}
+
+/**
+ * @brief Returns the value of a position searched through the given number
+ * of tetraminos.
+ *
+ * The value is the best, over every placement of the current tetramino, of
+ * `evaluate_placement()` at depth 1 and otherwise of the cleared lines plus
+ * the value of the resulting position one level shallower. Searched
+ * positions are cached in the table, which may be `NULL`.
+ *
+ * @param game A pointer to the game state.
+ * @param depth The number of tetraminos to place (1 to `MAX_SEARCH_DEPTH`).
+ * @param table The transposition table or `NULL`.
+ * @return The value, `-DBL_MAX` if the current tetramino cannot be placed.
+ */
+double search_value(const GameState_t *game, int depth,
+                    TranspositionTable_t *table) {
+  double best_score = -DBL_MAX;
+  uint64_t key = table ? search_key(game, depth) : 0;
+  if (!table || !table_probe(table, key, &best_score)) {
+    Placement_t placements[MAX_PLACEMENTS];
+    int count = enumerate_placements(game, placements);
+    for (int i = 0; i < count; i++) {
+      double score = placement_value(game, &placements[i], depth, table);
+      if (score > best_score) best_score = score;
+    }
+    if (table) table_store(table, key, best_score);
+  }
+  return best_score;
+}
+
+/**
+ * @brief Chooses the placement of the current tetramino with the best value
+ * when the following tetraminos are placed too.
+ *
+ * With a depth of 1 this is `choose_placement()`.
+ *
+ * @param game A pointer to the game state.
+ * @param depth The number of tetraminos to look through (1 to
+ * `MAX_SEARCH_DEPTH`).
+ * @param table The transposition table or `NULL`.
+ * @param[out] best The chosen placement.
+ * @return `false` if the tetramino cannot be placed.
+ */
+bool search_placement(const GameState_t *game, int depth,
+                      TranspositionTable_t *table, Placement_t *best) {
+  Placement_t placements[MAX_PLACEMENTS];
+  int count = enumerate_placements(game, placements);
+  if (depth > MAX_SEARCH_DEPTH) depth = MAX_SEARCH_DEPTH;
+  double best_score = -DBL_MAX;
+  for (int i = 0; i < count; i++) {
+    double score = placement_value(game, &placements[i], depth, table);
+    if (i == 0 || score > best_score) {
+      best_score = score;
+      *best = placements[i];
+    }
+  }
+  return count > 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file autoplay.h
+ * @brief Greedy autoplay policy on the compact game state.
+ *
+ * Every placement of the current tetramino (orientation and column, dropped
+ * straight down) is tried on a clone of the state and scored by a weighted
+ * sum of board features. `search_placement()` looks further ahead through the
+ * following tetraminos and caches the positions it visits in a transposition
+ * table.
+ */
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include "game_state.h"
+#include "transposition.h"
+
+#define MAX_PLACEMENTS (PIECE_ROTATIONS * (MAX_FIELD_WIDTH + TETR_SIZE))
+#define MAX_SEARCH_DEPTH 4
+#define MAX_MOVES_PER_PIECE 16
+
+/**
+ * @brief Placement of a tetramino: its orientation and the column of its
+ * matrix.
+ */
+typedef struct {
+  int rotation;
+  int x_position;
+} Placement_t;
+
+struct BotPlugin_t;
+
+/**
+ * @brief Autoplay policy driving a game model through user input.
+ *
+ * `planned` is cleared whenever a new tetramino appears, then `target` is
+ * chosen for it by `bot`, or by the greedy policy when `bot` is `NULL`.
+ */
+typedef struct {
+  Placement_t target;
+  bool planned;
+  int last_y;
+  int moves;
+  struct BotPlugin_t *bot;
+} ModelDriver_t;
+
+/**
+ * @brief Features of a field used to score placements.
+ */
+typedef struct {
+  int aggregate_height;
+  int holes;
+  int bumpiness;
+  int max_height;
+} BoardFeatures_t;
+
+void board_features(const GameState_t *game, BoardFeatures_t *features);
+double evaluate_placement(const GameState_t *game, int lines_cleared);
+int enumerate_placements(const GameState_t *game, Placement_t *placements);
+bool choose_placement(const GameState_t *game, Placement_t *best);
+bool autoplay_step(GameState_t *game);
+UserAction_t placement_action(const Placement_t *current,
+                              const Placement_t *target);
+UserAction_t autoplay_action(const GameState_t *game,
+                             const Placement_t *target);
+void driver_init(ModelDriver_t *driver);
+void driver_reset(ModelDriver_t *driver);
+void driver_input(ModelDriver_t *driver, ModelInfo_t *model);
+uint64_t search_key(const GameState_t *game, int depth);
+double search_value(const GameState_t *game, int depth,
+                    TranspositionTable_t *table);
+bool search_placement(const GameState_t *game, int depth,
+                      TranspositionTable_t *table, Placement_t *best);
+
+#endif
@@ -3,23 +3,46 @@
  * @brief Main game logic for Tetris.
  */
 #include "backend.h"
+#include "game_state.h"
+#include "kernels.h"
+#include "metrics.h"
+#include "rewind.h"
+
+DEFINE_ROW_MASKS_KERNEL(row_masks_standard, FIELD_WIDTH)
+DEFINE_ROW_MASKS_KERNEL(row_masks_wide, MAX_FIELD_WIDTH)
+DEFINE_ROW_MASKS_KERNEL(row_masks_generic, width)
+
+static atomic_ullong matrix_allocation_count = 0;
+
+static const char *handler_names[STATE_COUNT] = {
+    "initialize_game",  "spawn_tetramino",   "move_tetramino",
+    "shift_tetramino",  "attach_tetramino",  "game_over_actions",
+    "pause_actions",    "run_terminate_actions"};
 
 /**
  * @brief This function collects all the data related to the current game state
  * (only the information needed for rendering in the frontend)
  *
+ * Before collecting the data the simulation is advanced by as many fixed
+ * logical ticks as the wall-clock time since the previous call requires.
+ *
  * @return GameInfo_t containing the updated game information.
  */
 GameInfo_t updateCurrentState() {
+  TRACE_BEGIN("updateCurrentState");
   ModelInfo_t *actual_info = get_info();
-  GameInfo_t result = {NULL, NULL, 0, 0, 1, 0, 0};
+  GameInfo_t result = {NULL, NULL, 0, 0, 1, 0, 0, actual_info->width,
+                       actual_info->height, {0}, 0};
   int errors = 0;
   if (!result.field)
-    errors += create_matrix(&result.field, FIELD_HEIGHT, FIELD_WIDTH);
-  if (!result.next) errors += create_matrix(&result.next, TETR_SIZE, TETR_SIZE);
+    errors += create_matrix_at(&result.field, result.height, result.width,
+                               Snapshot_site);
+  if (!result.next)
+    errors +=
+        create_matrix_at(&result.next, TETR_SIZE, TETR_SIZE, Snapshot_site);
 
   if (!errors)
-    run_actions_by_state(actual_info);
+    scheduler_advance(&actual_info->scheduler, actual_info, update_timer());
   else {
     run_terminate_actions(actual_info);
     free_result(&result);
@@ -27,19 +50,69 @@ GameInfo_t updateCurrentState() {
   result.pause = actual_info->pause;
 
   if (actual_info->pause != EXIT_GAME) {
-    copy_matrix(result.field, actual_info->field_base, FIELD_HEIGHT,
-                FIELD_WIDTH);
+    pack_frame(actual_info);
+    for (int y = 0; y < result.height; y++)
+      for (int x = 0; x < result.width; x++)
+        result.field[y][x] = actual_info->frame_cells[y * result.width + x];
     copy_matrix(result.next, actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
-    set_tetramino_on_field(result.field, actual_info);
 
     result.score = actual_info->score;
     result.high_score = actual_info->high_score;
     result.level = actual_info->level;
     result.speed = actual_info->speed;
+    result.preview_depth = fill_preview(actual_info, result.preview);
   } else {
     free_result(&result);
   }
 
+  TRACE_END("updateCurrentState");
+  return result;
+}
+
+/**
+ * @brief Collects the current game state into a packed view without any
+ * allocation.
+ *
+ * The simulation is advanced like in `updateCurrentState()`, then the field
+ * with the current tetramino and the next tetramino are packed into the
+ * byte arrays owned by the engine.
+ *
+ * @return PackedGameInfo_t pointing to the packed cells (`NULL` once the game
+ * exits).
+ */
+PackedGameInfo_t updatePackedState() {
+  TRACE_BEGIN("updatePackedState");
+  ModelInfo_t *actual_info = get_info();
+  if (actual_info->pause != EXIT_GAME)
+    scheduler_advance(&actual_info->scheduler, actual_info, update_timer());
+  PackedGameInfo_t result = pack_model(actual_info);
+  TRACE_END("updatePackedState");
+  return result;
+}
+
+/**
+ * @brief Packs the field with the current tetramino and the next tetramino of
+ * a model into the byte arrays owned by the model.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @return PackedGameInfo_t pointing to the packed cells (`NULL` once the game
+ * exits).
+ */
+PackedGameInfo_t pack_model(ModelInfo_t *actual_info) {
+  PackedGameInfo_t result = {NULL, NULL, 0, 0, 1, 0, 0, actual_info->width,
+                             actual_info->height, {0}, 0};
+  result.pause = actual_info->pause;
+  if (actual_info->pause != EXIT_GAME) {
+    pack_frame(actual_info);
+    result.field = actual_info->frame_cells;
+    result.next =
+        actual_info->frame_cells + actual_info->width * actual_info->height;
+    result.score = actual_info->score;
+    result.high_score = actual_info->high_score;
+    result.level = actual_info->level;
+    result.speed = actual_info->speed;
+    result.preview_depth = fill_preview(actual_info, result.preview);
+  }
   return result;
 }
 
@@ -51,16 +124,73 @@ GameInfo_t updateCurrentState() {
  * (true) or was just pressed (false).
  */
 void userInput(UserAction_t action, bool hold) {
+  userInputAt(action, hold, monotonic_us());
+}
+
+/**
+ * @brief Updates the user action and the hold state of a key read at the
+ * given time.
+ *
+ * The time is used to measure the latency from the key to the frame showing
+ * it.
+ *
+ * @param action The key which was pressed.
+ * @param hold A boolean flag indicating whether the key is being held down
+ * (true) or was just pressed (false).
+ * @param time_us The monotonic time the key was read at, in microseconds.
+ */
+void userInputAt(UserAction_t action, bool hold, long long int time_us) {
   ModelInfo_t *actual_info = get_info();
   actual_info->user_action = action;
   actual_info->hold = hold;
+  if (hold) stats_mark_input(&actual_info->stats, time_us);
+}
+
+/**
+ * @brief Tells whether the last key given to the engine is still waiting for
+ * a tick.
+ *
+ * A tick takes the key, so a frontend holding more keys should pass the next
+ * one only once this returns `false`.
+ *
+ * @return `true` if a key is still waiting.
+ */
+bool isInputPending() { return get_info()->hold; }
+
+/**
+ * @brief Notifies the engine that the frontend has shown a new frame.
+ *
+ * Used to measure the latency between user input and the frame showing it.
+ */
+void frameRendered() {
+  ModelInfo_t *actual_info = get_info();
+  stats_mark_frame(&actual_info->stats, monotonic_us());
+  alloc_stats_mark_frame();
+  if (actual_info->metrics) METRIC_ADD(actual_info->metrics->frames, 1);
+}
+
+/**
+ * @brief Prints the statistics collected by the engine.
+ *
+ * @param stream The output stream.
+ */
+void dumpStats(FILE *stream) { stats_dump(stream, &get_info()->stats); }
+
+/**
+ * @brief Returns the statistics collected by the engine.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @return A pointer to the read-only statistics of the engine.
+ */
+const EngineStats_t *get_engine_stats(const ModelInfo_t *actual_info) {
+  return &actual_info->stats;
 }
 
 /**
  * @brief Gets and initializes the game state information.
  *
- * This function initializes the game state if it's the first time being called.
- * It allocates memory for game data structures and sets the initial state.
+ * This function initializes the game state with the standard field size if
+ * it's the first time being called.
  *
  * @return A pointer to the ModelInfo_t structure holding the game state.
  */
@@ -68,44 +198,310 @@ ModelInfo_t *get_info() {
   static ModelInfo_t actual_info;
   static bool is_initialized = false;
   if (!is_initialized) {
-    int error = 0;
-    actual_info.state = Start_state;
-    actual_info.user_action = Up;
-    actual_info.hold = false;
-    error += create_matrix(&actual_info.field_base, FIELD_HEIGHT, FIELD_WIDTH);
-    error += create_matrix(&actual_info.next_tetramino, TETR_SIZE, TETR_SIZE);
-    actual_info.next_type = generate_next_tetramino(actual_info.next_tetramino);
-    error +=
-        create_matrix(&actual_info.current_tetramino, TETR_SIZE, TETR_SIZE);
-    error += create_matrix(&actual_info.collision_test_tetramino, TETR_SIZE,
-                           TETR_SIZE);
-    actual_info.current_type = 0;
-    actual_info.x_position = SPAWN_X_POSITION;
-    actual_info.y_position = SPAWN_Y_POSITION;
-    actual_info.score = 0;
+    init_model(&actual_info, FIELD_WIDTH, FIELD_HEIGHT);
     actual_info.high_score = read_score();
-    actual_info.level = 1;
-    actual_info.speed = 0;
-    // exit game if memory alloc error occur:
-    actual_info.pause = error ? EXIT_GAME : 0;
-    actual_info.timer = update_timer();
-
-    srand(time(NULL));
-
     is_initialized = true;
   }
 
   return &actual_info;
 }
 
+/**
+ * @brief Initializes a game model with a field of the given size.
+ *
+ * It allocates memory for game data structures and sets the initial state.
+ * If the memory allocation fails the model is marked to exit the game. The
+ * tetramino sequence gets a fresh seed, which `seed_model()` replaces.
+ *
+ * @param actual_info A pointer to the model to initialize.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @return Error code (`0` on success).
+ */
+int init_model(ModelInfo_t *actual_info, int width, int height) {
+  int error = is_valid_board_size(width, height) ? 0 : 1;
+  actual_info->state = Start_state;
+  actual_info->user_action = Up;
+  actual_info->hold = false;
+  actual_info->width = width;
+  actual_info->height = height;
+  actual_info->field_base = NULL;
+  actual_info->frame_cells = NULL;
+  actual_info->arena = (MatrixArena_t){0};
+  if (!error)
+    error += create_byte_matrix_at(&actual_info->field_base, height, width,
+                                   Model_site);
+  if (!error) {
+    size_t size = (size_t)width * height + TETR_SIZE * TETR_SIZE;
+    actual_info->frame_cells = calloc(size, sizeof(uint8_t));
+    if (!actual_info->frame_cells) error++;
+    if (!error) ALLOC_COUNT(Model_site, size);
+  }
+  error += create_matrix_at(&actual_info->next_tetramino, TETR_SIZE,
+                            TETR_SIZE, Model_site);
+  actual_info->queue = (PieceQueue_t){0};
+  actual_info->preview_depth = MIN_PREVIEW_DEPTH;
+  if (!error) seed_model(actual_info, fresh_seed());
+  error += create_matrix_at(&actual_info->current_tetramino, TETR_SIZE,
+                            TETR_SIZE, Model_site);
+  error += create_matrix_at(&actual_info->collision_test_tetramino, TETR_SIZE,
+                            TETR_SIZE, Model_site);
+  actual_info->current_type = 0;
+  actual_info->x_position = spawn_x_position(width);
+  actual_info->y_position = SPAWN_Y_POSITION;
+  actual_info->score = 0;
+  actual_info->high_score = 0;
+  actual_info->no_persist = false;
+  actual_info->level = 1;
+  actual_info->speed = 0;
+  // exit game if memory alloc error occur:
+  actual_info->pause = error ? EXIT_GAME : 0;
+  actual_info->fixed_step = true;
+  actual_info->sim_time = 0;
+  scheduler_init(&actual_info->scheduler, TICK_MS);
+  actual_info->timer = model_time(actual_info);
+  actual_info->stats = (EngineStats_t){0};
+  actual_info->garbage_in = NULL;
+  actual_info->garbage_out = NULL;
+  actual_info->garbage_rng = 0;
+  actual_info->garbage_sent = 0;
+  actual_info->garbage_received = 0;
+  actual_info->rewind = NULL;
+  actual_info->metrics = NULL;
+  return error;
+}
+
+/**
+ * @brief Restarts the tetramino sequence of a model from a seed.
+ *
+ * The queue is emptied and the next tetramino is drawn again, so two models
+ * seeded alike get the same tetraminos in the same order.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param seed The seed of the tetramino generator.
+ */
+void seed_model(ModelInfo_t *actual_info, uint64_t seed) {
+  actual_info->queue = (PieceQueue_t){0};
+  actual_info->queue.rng = seed;
+  actual_info->next_type =
+      queue_pop(&actual_info->queue, actual_info->next_tetramino);
+}
+
+/**
+ * @brief Changes the field size of a model and clears the field.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param width The new number of columns.
+ * @param height The new number of rows.
+ * @return Error code (`0` on success, the model is left unchanged if the size
+ * is invalid).
+ */
+int resize_model(ModelInfo_t *actual_info, int width, int height) {
+  int error = is_valid_board_size(width, height) ? 0 : 1;
+  if (!error && actual_info->arena.block) {
+    error = move_model_to_arena(actual_info, width, height);
+  } else if (!error) {
+    uint8_t **field = NULL;
+    size_t size = (size_t)width * height + TETR_SIZE * TETR_SIZE;
+    uint8_t *frame_cells = calloc(size, sizeof(uint8_t));
+    error = frame_cells
+                ? create_byte_matrix_at(&field, height, width, Model_site)
+                : 1;
+    if (error) {
+      free(frame_cells);
+    } else {
+      ALLOC_COUNT(Model_site, size);
+      remove_byte_matrix_at(&actual_info->field_base, Model_site);
+      if (actual_info->frame_cells) FREE_COUNT(Model_site);
+      free(actual_info->frame_cells);
+      actual_info->field_base = field;
+      actual_info->frame_cells = frame_cells;
+    }
+  }
+  if (!error) {
+    actual_info->width = width;
+    actual_info->height = height;
+    actual_info->x_position = spawn_x_position(width);
+    actual_info->y_position = SPAWN_Y_POSITION;
+  }
+  return error;
+}
+
+/**
+ * @brief Moves the buffers of a model into a new arena sized for a field.
+ *
+ * The tetramino matrices are copied. The field is copied if its size does not
+ * change and cleared otherwise. The old buffers, and the old arena if there
+ * was one, are released.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @return Error code (`0` on success, the model is left unchanged otherwise).
+ */
+int move_model_to_arena(ModelInfo_t *actual_info, int width, int height) {
+  MatrixArena_t arena;
+  uint8_t **field = NULL;
+  int **next = NULL, **current = NULL, **collision = NULL;
+  uint8_t *frame_cells = NULL;
+  int error = is_valid_board_size(width, height)
+                  ? arena_init(&arena, model_arena_size(width, height))
+                  : 1;
+  if (!error) {
+    error += arena_byte_matrix(&arena, &field, height, width);
+    error += arena_matrix(&arena, &next, TETR_SIZE, TETR_SIZE);
+    error += arena_matrix(&arena, &current, TETR_SIZE, TETR_SIZE);
+    error += arena_matrix(&arena, &collision, TETR_SIZE, TETR_SIZE);
+    frame_cells =
+        arena_alloc(&arena, (size_t)width * height + TETR_SIZE * TETR_SIZE);
+    if (!frame_cells) error++;
+    // a matrix that did not fit went to the heap; the model keeps its
+    // buffers unless every new one is in the arena:
+    if (field && !arena_owns(&arena, field)) {
+      remove_byte_matrix(&field);
+      error++;
+    }
+    if (next && !arena_owns(&arena, next)) {
+      remove_matrix(&next, TETR_SIZE);
+      error++;
+    }
+    if (current && !arena_owns(&arena, current)) {
+      remove_matrix(&current, TETR_SIZE);
+      error++;
+    }
+    if (collision && !arena_owns(&arena, collision)) {
+      remove_matrix(&collision, TETR_SIZE);
+      error++;
+    }
+    if (error) arena_free(&arena);
+  }
+  if (!error) {
+    if (actual_info->field_base && width == actual_info->width &&
+        height == actual_info->height)
+      memcpy(field[0], actual_info->field_base[0], (size_t)width * height);
+    if (actual_info->next_tetramino)
+      copy_matrix(next, actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
+    if (actual_info->current_tetramino)
+      copy_matrix(current, actual_info->current_tetramino, TETR_SIZE,
+                  TETR_SIZE);
+    if (actual_info->collision_test_tetramino)
+      copy_matrix(collision, actual_info->collision_test_tetramino, TETR_SIZE,
+                  TETR_SIZE);
+    release_model_buffers(actual_info);
+    actual_info->field_base = field;
+    actual_info->next_tetramino = next;
+    actual_info->current_tetramino = current;
+    actual_info->collision_test_tetramino = collision;
+    actual_info->frame_cells = frame_cells;
+    actual_info->arena = arena;
+  }
+  return error;
+}
+
+/**
+ * @brief Moves the buffers of the game into one arena, which is released in a
+ * single call when the game is terminated.
+ *
+ * @return `true` if the buffers were moved.
+ */
+bool useMatrixArena() {
+  ModelInfo_t *actual_info = get_info();
+  return move_model_to_arena(actual_info, actual_info->width,
+                             actual_info->height) == 0;
+}
+
+/**
+ * @brief Sets the field size of the game.
+ *
+ * @param width The number of columns (`MIN_FIELD_WIDTH` to `MAX_FIELD_WIDTH`).
+ * @param height The number of rows (`MIN_FIELD_HEIGHT` to `MAX_FIELD_HEIGHT`).
+ * @return `true` if the size was applied.
+ */
+bool setBoardSize(int width, int height) {
+  return resize_model(get_info(), width, height) == 0;
+}
+
+/**
+ * @brief Sets the number of upcoming tetraminos listed in the game info.
+ *
+ * @param depth The preview depth (`MIN_PREVIEW_DEPTH` to `MAX_PREVIEW_DEPTH`).
+ * @return `true` if the depth was applied.
+ */
+bool setPreviewDepth(int depth) {
+  return set_preview_depth(get_info(), depth) == 0;
+}
+
+/**
+ * @brief Turns practice mode on: the game keeps snapshots of the last
+ * seconds of play and can be rewound with `rewindGame()`.
+ *
+ * Call it after `setBoardSize()`; the snapshots are for that size only.
+ *
+ * @param seconds How far back the game can be rewound, in seconds of game
+ * time.
+ * @return `true` if practice mode is on.
+ */
+bool setRewindWindow(int seconds) {
+  ModelInfo_t *actual_info = get_info();
+  RewindRing_t *ring = NULL;
+  bool is_ok = seconds > 0 &&
+               !rewind_create(&ring, actual_info->width, actual_info->height,
+                              seconds * 1000LL);
+  if (is_ok) {
+    if (actual_info->rewind) rewind_destroy(&actual_info->rewind);
+    actual_info->rewind = ring;
+  }
+  return is_ok;
+}
+
+/**
+ * @brief Takes back the last attached tetraminos in practice mode.
+ *
+ * @param pieces The number of tetraminos to take back (`0` restarts the
+ * falling one).
+ * @return `true` if the game was rewound.
+ */
+bool rewindGame(int pieces) {
+  ModelInfo_t *actual_info = get_info();
+  return actual_info->rewind &&
+         rewind_restore(actual_info->rewind, actual_info, pieces) == 0;
+}
+
+/**
+ * @brief Checks whether the field size is supported.
+ *
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @return `true` if the size is supported.
+ */
+bool is_valid_board_size(int width, int height) {
+  return width >= MIN_FIELD_WIDTH && width <= MAX_FIELD_WIDTH &&
+         height >= MIN_FIELD_HEIGHT && height <= MAX_FIELD_HEIGHT;
+}
+
+/**
+ * @brief Returns the spawn column keeping new tetraminos centered.
+ *
+ * @param width The number of columns of the field.
+ * @return The x position of the tetramino matrix at spawn.
+ */
+int spawn_x_position(int width) {
+  return SPAWN_X_POSITION + (width - FIELD_WIDTH) / 2;
+}
+
 /**
  * @brief Function checks the current game state and runs the corresponding
  * action.
  *
+ * Every step is recorded in the statistics of the engine at the time the
+ * handler returned, so transient states are measured by their own work.
+ *
  * @param actual_info A pointer to the ModelInfo_t structure holding the game
  * state.
  */
 void run_actions_by_state(ModelInfo_t *actual_info) {
+  FiniteState_t previous = actual_info->state;
+  TRACE_BEGIN(handler_names[previous]);
   switch (actual_info->state) {
     case Start_state:
       initialize_game(actual_info);
@@ -132,6 +528,11 @@ void run_actions_by_state(ModelInfo_t *actual_info) {
       run_terminate_actions(actual_info);
       break;
   }
+  TRACE_END(handler_names[previous]);
+  stats_record_step(&actual_info->stats, previous, actual_info->state,
+                    monotonic_us());
+  if (actual_info->metrics)
+    METRIC_ADD(actual_info->metrics->state_steps[previous], 1);
 }
 
 /**
@@ -145,13 +546,18 @@ void initialize_game(ModelInfo_t *actual_info) {
   if (actual_info->hold) {
     switch (actual_info->user_action) {
       case Start:
-        reset_matrix(actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
+        memset(actual_info->field_base[0], 0,
+               (size_t)actual_info->width * actual_info->height);
         actual_info->score = 0;
         actual_info->level = 1;
         actual_info->speed = 0;
         actual_info->pause = 0;
-        actual_info->high_score = read_score();
+        if (!actual_info->no_persist) actual_info->high_score = read_score();
         actual_info->state = Spawn;
+        if (actual_info->rewind) {
+          rewind_clear(actual_info->rewind);
+          rewind_push(actual_info->rewind, actual_info);
+        }
         break;
       case Terminate:
         actual_info->state = Exit_state;
@@ -166,7 +572,8 @@ void initialize_game(ModelInfo_t *actual_info) {
  * @brief Spawns a new tetramino and initializes its state.
  *
  * This function copies the next tetramino into the current tetramino and sets
- * its initial position. It also generates the next tetramino.
+ * its initial position. The new next tetramino is taken from the preview
+ * queue.
  *
  * @* @param actual_info A pointer to the ModelInfo_t structure holding the game
  * state.
@@ -176,14 +583,15 @@ void spawn_tetramino(ModelInfo_t *actual_info) {
               TETR_SIZE, TETR_SIZE);
 
   actual_info->current_type = actual_info->next_type;
-  reset_matrix(actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
+  actual_info->next_type =
+      queue_pop(&actual_info->queue, actual_info->next_tetramino);
 
-  actual_info->next_type = generate_next_tetramino(actual_info->next_tetramino);
-
-  actual_info->x_position = SPAWN_X_POSITION;
+  actual_info->x_position = spawn_x_position(actual_info->width);
   actual_info->y_position = SPAWN_Y_POSITION;
 
-  if (is_move_collision(actual_info)) {
+  bool is_topped_out =
+      actual_info->garbage_in && receive_garbage(actual_info);
+  if (is_topped_out || is_move_collision(actual_info)) {
     actual_info->state = Game_over;
   } else {
     actual_info->state = Moving;
@@ -194,41 +602,101 @@ void spawn_tetramino(ModelInfo_t *actual_info) {
  * @brief Checks for full lines on the game field and clears them.
  *        Updates score and level based on the number of cleared lines.
  *
+ * The lines are found by `field_clear_lines()` on the row masks of the field,
+ * which moves the cells along with them.
+ *
  * @param actual_info A pointer to the game model information.
  */
 void calculate_lines(ModelInfo_t *actual_info) {
-  int lines_cleared = 0;
-  for (int y = 0; y < FIELD_HEIGHT; y++) {
-    bool is_line_full = true;
-    for (int x = 0; x < FIELD_WIDTH; x++) {
-      if (actual_info->field_base[y][x] == 0) {
-        is_line_full = false;
-      }
-    }
-    if (is_line_full) {
-      clear_line(actual_info->field_base, y);
-      lines_cleared++;
-    }
-  }
+  uint64_t rows[MAX_FIELD_HEIGHT];
+  field_row_masks(actual_info, 0, actual_info->height, rows);
+  int lines_cleared = field_clear_lines(rows, actual_info->width,
+                                        actual_info->height,
+                                        actual_info->field_base);
   if (lines_cleared) {
     update_score(&(actual_info)->score, lines_cleared);
     update_speed_and_level(actual_info);
+    if (actual_info->garbage_out) send_garbage(actual_info, lines_cleared);
+    if (actual_info->metrics) {
+      int size = lines_cleared < MAX_LINES_AT_ONCE ? lines_cleared
+                                                   : MAX_LINES_AT_ONCE;
+      METRIC_ADD(actual_info->metrics->line_clears[size], 1);
+    }
   }
 }
 
+/**
+ * @brief Reads rows of the field as row masks.
+ *
+ * Bit `x` of a mask is set when the cell in column `x` is occupied; rows
+ * outside the field read as empty. The standard field size and the widest
+ * fields use kernels specialized at compile time.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param first The first row to read, may be above the field.
+ * @param count The number of rows to read.
+ * @param[out] rows The `count` row masks.
+ */
+void field_row_masks(const ModelInfo_t *actual_info, int first, int count,
+                     uint64_t *rows) {
+  if (IS_STANDARD_BOARD(actual_info))
+    row_masks_standard(actual_info->field_base, FIELD_WIDTH, FIELD_HEIGHT,
+                       first, count, rows);
+  else if (IS_WIDE_BOARD(actual_info))
+    row_masks_wide(actual_info->field_base, MAX_FIELD_WIDTH,
+                   actual_info->height, first, count, rows);
+  else
+    row_masks_generic(actual_info->field_base, actual_info->width,
+                      actual_info->height, first, count, rows);
+}
+
+/**
+ * @brief Sends the garbage rows earned by a line clear to the opponent.
+ *
+ * All rows of an attack share one hole, picked by the sender.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param lines_cleared The number of lines cleared at once.
+ */
+void send_garbage(ModelInfo_t *actual_info, int lines_cleared) {
+  int rows = garbage_for_lines(lines_cleared);
+  if (rows) {
+    uint64_t random = random_next(&actual_info->garbage_rng);
+    int hole = (int)(random % (uint64_t)actual_info->width);
+    if (garbage_send(actual_info->garbage_out, rows, hole))
+      actual_info->garbage_sent += rows;
+  }
+}
+
+/**
+ * @brief Inserts the garbage rows received from the opponent into the field.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @return `true` if occupied cells were pushed out at the top.
+ */
+bool receive_garbage(ModelInfo_t *actual_info) {
+  int rows, hole, lost = 0;
+  while (garbage_receive(actual_info->garbage_in, &rows, &hole)) {
+    lost += insert_garbage(actual_info->field_base, actual_info->width,
+                           actual_info->height, rows, hole);
+    actual_info->garbage_received += rows;
+  }
+  return lost > 0;
+}
+
 /**
  * @brief Clears a line by shifting all lines above it down.
  *
+ * The rows of the field are contiguous, so they move with one `memmove()`.
+ * Row `0` comes in empty, so no cell of the top row is left behind.
+ *
  * @param field_base A 2D array representing the game field.
  * @param line The index of the line to clear.
+ * @param width The number of columns of the field.
  */
-void clear_line(int **field_base, int line) {
-  while (line) {
-    for (int i = 0; i < FIELD_WIDTH; i++) {
-      field_base[line][i] = field_base[line - 1][i];
-    }
-    line--;
-  }
+void clear_line(uint8_t **field_base, int line, int width) {
+  memmove(field_base[1], field_base[0], (size_t)line * width);
+  memset(field_base[0], 0, (size_t)width);
 }
 
 /**
@@ -250,14 +718,33 @@ void update_score(int *score, int lines_cleared) {
  */
 void update_speed_and_level(ModelInfo_t *actual_info) {
   if (actual_info->level <= 10) {
-    actual_info->level = (actual_info->score / 600) + 1;
-    if (actual_info->level > 10) {  // if 10 was skipped
-      actual_info->level = 10;
-    }
+    actual_info->level = level_for_score(actual_info->score);
     actual_info->speed = actual_info->level - 1;
   }
 }
 
+/**
+ * @brief Returns the level reached with the given score.
+ *
+ * @param score The player's score.
+ * @return The level from 1 to 10.
+ */
+int level_for_score(int score) {
+  int level = (score / 600) + 1;
+  if (level > 10) {  // if 10 was skipped
+    level = 10;
+  }
+  return level;
+}
+
+/**
+ * @brief Returns the time between two gravity shifts.
+ *
+ * @param speed The game speed (level - 1).
+ * @return The gravity interval in milliseconds.
+ */
+int gravity_interval(int speed) { return 700 - (speed * 52); }
+
 /**
  * @brief Pauses or terminates the game based on user actions.
  *
@@ -273,60 +760,45 @@ void pause_actions(ModelInfo_t *actual_info) {
 }
 
 /**
- * @brief Executes actions when the game is over.
+ * @brief Queues the score of a game for the score file if it beats the high
+ * score.
+ *
+ * The score is checked against the score file rather than `high_score`, which
+ * is only read when a game starts. Nothing is done for a model with
+ * `no_persist` set.
  *
  * @param actual_info A pointer to the game model information.
  */
-void game_over_actions(ModelInfo_t *actual_info) {
-  if (actual_info->score > actual_info->high_score) {
+static void save_high_score(const ModelInfo_t *actual_info) {
+  if (!actual_info->no_persist && actual_info->score > read_score())
     write_score(actual_info->score);
-  }
-  actual_info->pause = 2;
-  actual_info->state = Start_state;
 }
 
 /**
- * @brief Executes actions when the game is terminated.
+ * @brief Executes actions when the game is over.
  *
  * @param actual_info A pointer to the game model information.
  */
-void run_terminate_actions(ModelInfo_t *actual_info) {
-  if (actual_info->score > actual_info->high_score) {
-    write_score(actual_info->score);
-  }
-  if (actual_info->field_base)
-    remove_matrix(&(actual_info)->field_base, FIELD_HEIGHT);
-  if (actual_info->current_tetramino)
-    remove_matrix(&(actual_info)->current_tetramino, TETR_SIZE);
-  if (actual_info->next_tetramino)
-    remove_matrix(&(actual_info)->next_tetramino, TETR_SIZE);
-  if (actual_info->collision_test_tetramino)
-    remove_matrix(&(actual_info)->collision_test_tetramino, TETR_SIZE);
-  actual_info->pause = EXIT_GAME;
+void game_over_actions(ModelInfo_t *actual_info) {
+  save_high_score(actual_info);
+  if (actual_info->metrics) METRIC_ADD(actual_info->metrics->games, 1);
+  actual_info->pause = 2;
+  actual_info->state = Start_state;
 }
 
 /**
- * @brief Generates the next Tetris figure, fills the `next` array
- * to display its shape, and applies a random number of rotations if
- * the figure is not a square.
+ * @brief Executes actions when the game is terminated.
  *
- * @param[out] next A two-dimensional array representing the shape of the
- * generated tetramino. This array will be filled within the function.
- * Memory for the 5x5 array must be allocated before calling the function.
- * @return The type of the generated tetramino (a value from the TetraminoType_t
- * enumeration).
+ * The score store keeps running for the other models of the process and
+ * writes the queued scores when the process exits.
  *
- * @note It is recommended to call `srand(time(NULL))` before calling this
- * function.
+ * @param actual_info A pointer to the game model information.
  */
-TetraminoType_t generate_next_tetramino(int **next) {
-  TetraminoType_t random = 1 + (rand() % 7);
-  fill_tetramino(next, random);
-  if (random != O_tetramino) {
-    int random_rotation = rand() % 4;
-    while (random_rotation--) rotate(random, &next);
-  }
-  return random;
+void run_terminate_actions(ModelInfo_t *actual_info) {
+  save_high_score(actual_info);
+  release_model_buffers(actual_info);
+  if (actual_info->rewind) rewind_destroy(&actual_info->rewind);
+  actual_info->pause = EXIT_GAME;
 }
 
 // -----------------------------------------------------------------
@@ -342,6 +814,33 @@ TetraminoType_t generate_next_tetramino(int **next) {
 // | .  . [] []  . | .  .  .  .  . | .  .  .  .  . |
 // | .  .  .  .  . | .  .  .  .  . | .  .  .  .  . |
 // -------------------------------------------------
+/**
+ * @brief Returns the next value of a per-game random generator (splitmix64).
+ *
+ * @param state A pointer to the state of the generator.
+ * @return A uniformly distributed 64-bit value.
+ */
+uint64_t random_next(uint64_t *state) {
+  uint64_t z = (*state += RANDOM_STEP);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns a seed for a game that was not given one.
+ *
+ * Seeds differ between calls, threads and runs of the program.
+ *
+ * @return The seed.
+ */
+uint64_t fresh_seed() {
+  static atomic_ullong counter = 0;
+  uint64_t state = (uint64_t)time(NULL) << 32 ^ (uint64_t)monotonic_us() ^
+                   atomic_fetch_add(&counter, 1) * 0xD1B54A32D192ED03ULL;
+  return random_next(&state);
+}
+
 /**
  * @brief Fills the provided matrix with the shape of a tetramino.
  *
@@ -392,11 +891,25 @@ long long int update_timer() {
          current_time.tv_usec / 1000;
 }
 
+/**
+ * @brief Returns the current time of the given game model in milliseconds.
+ *
+ * Models driven by the fixed-timestep scheduler use their simulated clock,
+ * all others fall back to the wall clock.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @return The model time in milliseconds.
+ */
+long long int model_time(const ModelInfo_t *actual_info) {
+  return actual_info->fixed_step ? actual_info->sim_time : update_timer();
+}
+
 /**
  * @brief Creates a 2D matrix with the given size.
  *
  * This function allocates memory for a 2D matrix of size `rows x columns` and
- * initializes all elements to 0.
+ * initializes all elements to 0. The row pointers and the rows share one
+ * contiguous block, so the whole matrix is a single allocation.
  *
  * @param matrix Pointer to the pointer of the matrix.
  * @param rows Number of rows in the matrix.
@@ -407,47 +920,276 @@ long long int update_timer() {
  * columns are invalid).
  */
 int create_matrix(int ***matrix, int rows, int columns) {
+  return create_matrix_at(matrix, rows, columns, Matrix_site);
+}
+
+/**
+ * @brief Allocates a 2D matrix and counts it under a call site.
+ *
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @param site The call site the allocation is counted under.
+ * @return Error code (`0` on success).
+ */
+int create_matrix_at(int ***matrix, int rows, int columns, AllocSite_t site) {
   *matrix = NULL;
   int error = 0;
   if (rows <= 0 || columns <= 0) error++;
   if (!error) {
-    (*matrix) = calloc(rows, sizeof(int *));
-    if (!(*matrix)) error++;
-
-    for (int i = 0; !error && i < rows; i++) {
-      (*matrix)[i] = calloc(columns, sizeof(int));
-      if (!(*matrix)[i]) {
-        error++;
-        for (int j = 0; j < i; j++) {
-          free((*matrix)[j]);
-          (*matrix)[j] = NULL;
-        }
-        free((*matrix));
-        (*matrix) = NULL;
-      }
+    void *block = calloc(1, matrix_size(rows, columns));
+    if (!block) error++;
+    if (!error) {
+      atomic_fetch_add_explicit(&matrix_allocation_count, 1,
+                                memory_order_relaxed);
+      ALLOC_COUNT(site, matrix_size(rows, columns));
+      layout_matrix(matrix, block, rows, columns);
     }
   }
 
   return error;
 }
 
+/**
+ * @brief Returns the number of matrices allocated by `create_matrix()` in
+ * the whole process.
+ *
+ * @return The number of allocations.
+ */
+unsigned long long matrix_allocations() {
+  return atomic_load_explicit(&matrix_allocation_count, memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the size of the block holding a matrix.
+ *
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @return The size in bytes of the row pointers followed by the rows.
+ */
+size_t matrix_size(int rows, int columns) {
+  return (size_t)rows * sizeof(int *) + (size_t)rows * columns * sizeof(int);
+}
+
+/**
+ * @brief Points the rows of a matrix into its block.
+ *
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param block A block of `matrix_size(rows, columns)` bytes.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ */
+void layout_matrix(int ***matrix, void *block, int rows, int columns) {
+  int **row_pointers = block;
+  int *cells = (int *)(row_pointers + rows);
+  for (int i = 0; i < rows; i++) row_pointers[i] = cells + (size_t)i * columns;
+  *matrix = row_pointers;
+}
+
+/**
+ * @brief Creates a 2D matrix in an arena, or on the heap if the arena has no
+ * room for it.
+ *
+ * @param arena The arena to draw from.
+ * @param matrix Pointer to the pointer of the matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @return Error code (`0` on success).
+ */
+int arena_matrix(MatrixArena_t *arena, int ***matrix, int rows, int columns) {
+  int error = 0;
+  void *block = rows > 0 && columns > 0
+                    ? arena_alloc(arena, matrix_size(rows, columns))
+                    : NULL;
+  if (block)
+    layout_matrix(matrix, block, rows, columns);
+  else
+    error = create_matrix(matrix, rows, columns);
+  return error;
+}
+
+/**
+ * @brief Returns the arena size that holds every buffer of a model.
+ *
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @return The size in bytes of the field, the three tetramino matrices and
+ * the frame cells.
+ */
+size_t model_arena_size(int width, int height) {
+  return arena_round(byte_matrix_size(height, width)) +
+         3 * arena_round(matrix_size(TETR_SIZE, TETR_SIZE)) +
+         arena_round((size_t)width * height + TETR_SIZE * TETR_SIZE);
+}
+
+/**
+ * @brief Releases the field, the tetramino matrices and the frame cells of a
+ * model.
+ *
+ * Buffers of an arena are released at once by freeing the arena, the others
+ * one by one.
+ *
+ * @param actual_info A pointer to the game model information.
+ */
+void release_model_buffers(ModelInfo_t *actual_info) {
+  if (actual_info->arena.block) {
+    arena_free(&actual_info->arena);
+    actual_info->field_base = NULL;
+    actual_info->current_tetramino = NULL;
+    actual_info->next_tetramino = NULL;
+    actual_info->collision_test_tetramino = NULL;
+    actual_info->frame_cells = NULL;
+  }
+  remove_byte_matrix_at(&(actual_info)->field_base, Model_site);
+  remove_matrix_at(&(actual_info)->current_tetramino, Model_site);
+  remove_matrix_at(&(actual_info)->next_tetramino, Model_site);
+  remove_matrix_at(&(actual_info)->collision_test_tetramino, Model_site);
+  if (actual_info->frame_cells) FREE_COUNT(Model_site);
+  free(actual_info->frame_cells);
+  actual_info->frame_cells = NULL;
+}
+
 /**
  * @brief Removes a 2D matrix and frees its memory.
  *
- * This function frees the memory allocated for a 2D matrix and sets its pointer
+ * This function frees the block allocated for a 2D matrix and sets its pointer
  * to `NULL`.
  *
  * @param matrix Pointer to the pointer of the matrix.
- * @param rows Number of rows in the matrix.
+ * @param rows Number of rows in the matrix (unused, the matrix is one block).
  */
 void remove_matrix(int ***matrix, int rows) {
+  (void)rows;
+  remove_matrix_at(matrix, Matrix_site);
+}
+
+/**
+ * @brief Frees a 2D matrix allocated by `create_matrix_at()` and sets its
+ * pointer to `NULL`.
+ *
+ * @param matrix Pointer to the pointer of the matrix.
+ * @param site The call site the matrix was counted under.
+ */
+void remove_matrix_at(int ***matrix, AllocSite_t site) {
   if (matrix && *matrix) {
-    for (int i = 0; i < rows; i++) {
-      if ((*matrix)[i]) {
-        free((*matrix)[i]);
-        (*matrix)[i] = NULL;
-      }
+    FREE_COUNT(site);
+    free(*matrix);
+    *matrix = NULL;
+  }
+}
+
+/**
+ * @brief Allocates a byte matrix with all cells set to 0.
+ *
+ * Like `create_matrix()`, with one byte per cell. The rows are contiguous, so
+ * `(*matrix)[0]` holds all cells in row-major order.
+ *
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @return Error code (`0` on success).
+ */
+int create_byte_matrix(uint8_t ***matrix, int rows, int columns) {
+  return create_byte_matrix_at(matrix, rows, columns, Matrix_site);
+}
+
+/**
+ * @brief Allocates a byte matrix and counts it under a call site.
+ *
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @param site The call site the allocation is counted under.
+ * @return Error code (`0` on success).
+ */
+int create_byte_matrix_at(uint8_t ***matrix, int rows, int columns,
+                          AllocSite_t site) {
+  *matrix = NULL;
+  int error = 0;
+  if (rows <= 0 || columns <= 0) error++;
+  if (!error) {
+    void *block = calloc(1, byte_matrix_size(rows, columns));
+    if (!block) error++;
+    if (!error) {
+      atomic_fetch_add_explicit(&matrix_allocation_count, 1,
+                                memory_order_relaxed);
+      ALLOC_COUNT(site, byte_matrix_size(rows, columns));
+      layout_byte_matrix(matrix, block, rows, columns);
     }
+  }
+  return error;
+}
+
+/**
+ * @brief Returns the size of the block holding a byte matrix.
+ *
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @return The size in bytes of the row pointers followed by the rows.
+ */
+size_t byte_matrix_size(int rows, int columns) {
+  return (size_t)rows * sizeof(uint8_t *) + (size_t)rows * columns;
+}
+
+/**
+ * @brief Points the rows of a byte matrix into its block.
+ *
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param block A block of `byte_matrix_size(rows, columns)` bytes.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ */
+void layout_byte_matrix(uint8_t ***matrix, void *block, int rows,
+                        int columns) {
+  uint8_t **row_pointers = block;
+  uint8_t *cells = (uint8_t *)(row_pointers + rows);
+  for (int i = 0; i < rows; i++) row_pointers[i] = cells + (size_t)i * columns;
+  *matrix = row_pointers;
+}
+
+/**
+ * @brief Creates a byte matrix in an arena, or on the heap if the arena has
+ * no room for it.
+ *
+ * @param arena The arena to draw from.
+ * @param[out] matrix Pointer to the pointer of the matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
+ * @return Error code (`0` on success).
+ */
+int arena_byte_matrix(MatrixArena_t *arena, uint8_t ***matrix, int rows,
+                      int columns) {
+  int error = 0;
+  void *block = rows > 0 && columns > 0
+                    ? arena_alloc(arena, byte_matrix_size(rows, columns))
+                    : NULL;
+  if (block)
+    layout_byte_matrix(matrix, block, rows, columns);
+  else
+    error = create_byte_matrix(matrix, rows, columns);
+  return error;
+}
+
+/**
+ * @brief Frees a byte matrix allocated by `create_byte_matrix()` and sets its
+ * pointer to `NULL`.
+ *
+ * @param matrix Pointer to the pointer of the matrix.
+ */
+void remove_byte_matrix(uint8_t ***matrix) {
+  remove_byte_matrix_at(matrix, Matrix_site);
+}
+
+/**
+ * @brief Frees a byte matrix allocated by `create_byte_matrix_at()` and sets
+ * its pointer to `NULL`.
+ *
+ * @param matrix Pointer to the pointer of the matrix.
+ * @param site The call site the matrix was counted under.
+ */
+void remove_byte_matrix_at(uint8_t ***matrix, AllocSite_t site) {
+  if (matrix && *matrix) {
+    FREE_COUNT(site);
     free(*matrix);
     *matrix = NULL;
   }
@@ -463,8 +1205,8 @@ void remove_matrix(int ***matrix, int rows) {
  * data to free.
  */
 void free_result(GameInfo_t *result) {
-  if (result->field) remove_matrix(&result->field, FIELD_HEIGHT);
-  if (result->next) remove_matrix(&result->next, TETR_SIZE);
+  remove_matrix_at(&result->field, Snapshot_site);
+  remove_matrix_at(&result->next, Snapshot_site);
 }
 
 /**
@@ -479,11 +1221,13 @@ void free_result(GameInfo_t *result) {
  * @param columns Number of columns in the matrix.
  */
 void copy_matrix(int **dest, int **src, int rows, int columns) {
+  TRACE_BEGIN("copy_matrix");
   for (int i = 0; i < rows; i++) {
     for (int j = 0; j < columns; j++) {
       dest[i][j] = src[i][j];
     }
   }
+  TRACE_END("copy_matrix");
 }
 
 /**
@@ -515,51 +1259,67 @@ void reset_matrix(int **src, int rows, int columns) {
  * @param actual_info Pointer to the structure with the current tetramino
  * information.
  */
-void set_tetramino_on_field(int **field, ModelInfo_t *actual_info) {
+void set_tetramino_on_field(uint8_t **field, ModelInfo_t *actual_info) {
+  TRACE_BEGIN("set_tetramino_on_field");
   for (int y = 0; y < TETR_SIZE; y++) {
     for (int x = 0; x < TETR_SIZE; x++) {
       int offset_y = actual_info->y_position + y;
       int offset_x = actual_info->x_position + x;
 
-      if (offset_y >= 0 && offset_y < FIELD_HEIGHT && offset_x >= 0 &&
-          offset_x < FIELD_WIDTH) {
+      if (offset_y >= 0 && offset_y < actual_info->height && offset_x >= 0 &&
+          offset_x < actual_info->width) {
         if (actual_info->current_tetramino[y][x] != 0) {
-          field[offset_y][offset_x] = actual_info->current_tetramino[y][x];
+          field[offset_y][offset_x] =
+              (uint8_t)actual_info->current_tetramino[y][x];
         }
       }
     }
   }
+  TRACE_END("set_tetramino_on_field");
 }
 
 /**
- * @brief Writes the new high score to a file.
- *
- * This function writes the current high score to the `score.txt` file.
+ * @brief Packs a matrix into a contiguous array of bytes.
  *
- * @param high_score The new high score to be written to the file.
+ * @param dest The destination array of `rows * columns` bytes.
+ * @param src The source matrix.
+ * @param rows Number of rows in the matrix.
+ * @param columns Number of columns in the matrix.
  */
-void write_score(int high_score) {
-  FILE *file = fopen("score.txt", "w");
-  if (file) {
-    fprintf(file, "%d", high_score);
-    fclose(file);
+void pack_matrix(uint8_t *dest, int **src, int rows, int columns) {
+  for (int i = 0; i < rows; i++) {
+    for (int j = 0; j < columns; j++) {
+      dest[i * columns + j] = (uint8_t)src[i][j];
+    }
   }
 }
 
 /**
- * @brief Reads the current high score from the file.
+ * @brief Packs the field with the current tetramino and the next tetramino
+ * into the frame cells of the model.
  *
- * This function reads the high score value from the `score.txt` file and
- * returns it.
+ * The field is already stored as contiguous bytes and is copied as is.
  *
- * @return The current high score.
+ * @param actual_info A pointer to the game model information.
  */
-int read_score() {
-  int high_score = 0;
-  FILE *file = fopen("score.txt", "r");
-  if (file) {
-    fscanf(file, "%d", &high_score);
-    fclose(file);
+void pack_frame(ModelInfo_t *actual_info) {
+  TRACE_BEGIN("pack_frame");
+  int width = actual_info->width;
+  int height = actual_info->height;
+  uint8_t *field = actual_info->frame_cells;
+  memcpy(field, actual_info->field_base[0], (size_t)width * height);
+  pack_matrix(field + width * height, actual_info->next_tetramino, TETR_SIZE,
+              TETR_SIZE);
+  for (int y = 0; y < TETR_SIZE; y++) {
+    int offset_y = actual_info->y_position + y;
+    for (int x = 0; x < TETR_SIZE; x++) {
+      int offset_x = actual_info->x_position + x;
+      if (actual_info->current_tetramino[y][x] && offset_y >= 0 &&
+          offset_y < height && offset_x >= 0 && offset_x < width)
+        field[offset_y * width + offset_x] =
+            (uint8_t)actual_info->current_tetramino[y][x];
+    }
   }
-  return high_score;
+  TRACE_END("pack_frame");
 }
+
@@ -10,16 +10,20 @@
 #define BACKEND_H
 
 #include <ncurses.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <time.h>
 
 #include "../brick_game.h"
-
-#define FIELD_WIDTH 10
-#define FIELD_HEIGHT 20
-#define TETR_SIZE 5
+#include "alloc_stats.h"
+#include "arena.h"
+#include "garbage.h"
+#include "score_store.h"
+#include "stats.h"
+#include "trace.h"
 
 #define EXIT_GAME -1
 
@@ -34,6 +38,14 @@
 #define LEFT_BASE_COLLISION 5
 #define RIGHT_BASE_COLLISION 6
 
+#define TICK_MS 5
+#define MAX_TICKS_PER_ADVANCE 200
+#define MAX_STEPS_PER_TICK 8
+
+#define PIECE_QUEUE_SIZE 16
+#define PIECE_QUEUE_BATCH 8
+#define RANDOM_STEP 0x9E3779B97F4A7C15ULL
+
 /**
  * @brief Enum representing the different types of tetraminos.
  */
@@ -65,61 +77,162 @@ typedef enum {
   Exit_state
 } FiniteState_t;
 
+/**
+ * @brief Fixed-timestep scheduler state.
+ *
+ * Wall-clock time is collected in the accumulator and spent in whole logical
+ * ticks of `tick_ms` milliseconds, so the simulation speed does not depend on
+ * how often the frontend renders.
+ */
+typedef struct {
+  long long int last_time;
+  long long int accumulator;
+  int tick_ms;
+  bool started;
+} Scheduler_t;
+
+/**
+ * @brief Ring buffer of the tetraminos that follow the next one.
+ *
+ * Holds `count` pieces starting at `head` as a type and a number of
+ * rotations. `PIECE_QUEUE_SIZE` must be a power of two and at least twice
+ * `PIECE_QUEUE_BATCH`, which must exceed `MAX_PREVIEW_DEPTH`. `rng` is the
+ * state of the generator of the game, so the sequence depends on its seed
+ * only.
+ */
+typedef struct {
+  uint8_t types[PIECE_QUEUE_SIZE];
+  uint8_t rotations[PIECE_QUEUE_SIZE];
+  int head;
+  int count;
+  uint64_t rng;
+} PieceQueue_t;
+
+struct RewindRing_t;
+struct MetricsShard_t;
+
 /**
  * @brief Structure containing all necessary information about the current game
  * model.
  *
  * This structure holds information about the game state, including the current
- * tetramino, game field, score, level, and more.
+ * tetramino, game field, score, level, and more. The size of the field is set
+ * when the model is created. The field stores one byte per cell and its rows
+ * are contiguous, so `field_base[0]` is the whole field in row-major order.
+ * The field, the tetramino matrices and the frame cells live either on the
+ * heap or, after `move_model_to_arena()`, together in `arena`. In a versus
+ * match `garbage_out` is the queue of the opponent and `garbage_in` the queue
+ * of this model; both are `NULL` otherwise. In practice mode `rewind` keeps a
+ * snapshot of every attach, `NULL` otherwise. `metrics`, if set, is the
+ * counter shard of the thread running the model. A model with `no_persist`
+ * set, such as a simulated game, neither reads nor writes the score file.
  */
 typedef struct {
   FiniteState_t state;
   UserAction_t user_action;
   bool hold;
-  int **field_base;
+  int width;
+  int height;
+  uint8_t **field_base;
   int **next_tetramino;
   TetraminoType_t next_type;
+  PieceQueue_t queue;
+  int preview_depth;
   int **current_tetramino;
   int **collision_test_tetramino;
+  uint8_t *frame_cells;
   TetraminoType_t current_type;
   int x_position;
   int y_position;
   int score;
   int high_score;
+  bool no_persist;
   int level;
   int speed;
   int pause;
   long long int timer;
+  bool fixed_step;
+  long long int sim_time;
+  Scheduler_t scheduler;
+  EngineStats_t stats;
+  MatrixArena_t arena;
+  GarbageQueue_t *garbage_in;
+  GarbageQueue_t *garbage_out;
+  uint64_t garbage_rng;
+  int garbage_sent;
+  int garbage_received;
+  struct RewindRing_t *rewind;
+  struct MetricsShard_t *metrics;
 } ModelInfo_t;
 
 ModelInfo_t *get_info();
+int init_model(ModelInfo_t *actual_info, int width, int height);
+void seed_model(ModelInfo_t *actual_info, uint64_t seed);
+int resize_model(ModelInfo_t *actual_info, int width, int height);
+int move_model_to_arena(ModelInfo_t *actual_info, int width, int height);
+PackedGameInfo_t pack_model(ModelInfo_t *actual_info);
+bool is_valid_board_size(int width, int height);
+int spawn_x_position(int width);
 void run_actions_by_state(ModelInfo_t *actual_info);
 void initialize_game(ModelInfo_t *actual_info);
 void spawn_tetramino(ModelInfo_t *actual_info);
 void calculate_lines(ModelInfo_t *actual_info);
-void clear_line(int **field_base, int line);
+void field_row_masks(const ModelInfo_t *actual_info, int first, int count,
+                     uint64_t *rows);
+void send_garbage(ModelInfo_t *actual_info, int lines_cleared);
+bool receive_garbage(ModelInfo_t *actual_info);
+void clear_line(uint8_t **field_base, int line, int width);
 void update_score(int *score, int lines_cleared);
 void update_speed_and_level(ModelInfo_t *actual_info);
+int level_for_score(int score);
+int gravity_interval(int speed);
 void pause_actions(ModelInfo_t *actual_info);
 void game_over_actions(ModelInfo_t *actual_info);
 void run_terminate_actions(ModelInfo_t *actual_info);
-TetraminoType_t generate_next_tetramino(int **next);
+void queue_refill(PieceQueue_t *queue);
+TetraminoType_t queue_pop(PieceQueue_t *queue, int **next);
+int queue_peek(const PieceQueue_t *queue, int index);
+uint64_t queue_origin(const PieceQueue_t *queue);
+int set_preview_depth(ModelInfo_t *actual_info, int depth);
+int fill_preview(ModelInfo_t *actual_info, int *preview);
 void fill_tetramino(int **filled, TetraminoType_t num);
+uint64_t random_next(uint64_t *state);
+uint64_t fresh_seed();
 long long int update_timer();
+long long int model_time(const ModelInfo_t *actual_info);
+const EngineStats_t *get_engine_stats(const ModelInfo_t *actual_info);
 
 int create_matrix(int ***matrix, int rows, int columns);
+int create_matrix_at(int ***matrix, int rows, int columns, AllocSite_t site);
+size_t matrix_size(int rows, int columns);
+unsigned long long matrix_allocations();
+int arena_matrix(MatrixArena_t *arena, int ***matrix, int rows, int columns);
+size_t model_arena_size(int width, int height);
+void layout_matrix(int ***matrix, void *block, int rows, int columns);
+int create_byte_matrix(uint8_t ***matrix, int rows, int columns);
+int create_byte_matrix_at(uint8_t ***matrix, int rows, int columns,
+                          AllocSite_t site);
+size_t byte_matrix_size(int rows, int columns);
+void layout_byte_matrix(uint8_t ***matrix, void *block, int rows,
+                        int columns);
+int arena_byte_matrix(MatrixArena_t *arena, uint8_t ***matrix, int rows,
+                      int columns);
+void remove_byte_matrix(uint8_t ***matrix);
+void remove_byte_matrix_at(uint8_t ***matrix, AllocSite_t site);
+void release_model_buffers(ModelInfo_t *actual_info);
 void remove_matrix(int ***matrix, int rows);
+void remove_matrix_at(int ***matrix, AllocSite_t site);
 void free_result(GameInfo_t *result);
 void copy_matrix(int **dest, int **src, int rows, int columns);
 void reset_matrix(int **src, int rows, int columns);
-void set_tetramino_on_field(int **field, ModelInfo_t *actual_info);
-void write_score(int high_score);
-int read_score();
+void set_tetramino_on_field(uint8_t **field, ModelInfo_t *actual_info);
+void pack_matrix(uint8_t *dest, int **src, int rows, int columns);
+void pack_frame(ModelInfo_t *actual_info);
 
 void move_tetramino(ModelInfo_t *actual_info);
 void move_left(ModelInfo_t *actual_info);
 void move_right(ModelInfo_t *actual_info);
-int is_rotation_blocked();
+int is_rotation_blocked(ModelInfo_t *actual_info);
 void rotate(TetraminoType_t type, int ***straight);
 void rotate_left(int ***straight);
 void rotate_right(int ***straight);
@@ -128,4 +241,11 @@ void attach_tetramino(ModelInfo_t *actual_info);
 int is_move_collision(const ModelInfo_t *actual_info);
 int check_rotate_collision(const ModelInfo_t *actual_info);
 
+void scheduler_init(Scheduler_t *scheduler, int tick_ms);
+int scheduler_advance(Scheduler_t *scheduler, ModelInfo_t *actual_info,
+                      long long int now);
+void run_tick(ModelInfo_t *actual_info, int tick_ms);
+long long int run_headless(ModelInfo_t *actual_info, long long int ticks);
+bool is_transient_state(FiniteState_t state);
+
 #endif
\ No newline at end of file
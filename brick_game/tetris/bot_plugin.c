@@ -0,0 +1,193 @@
+/**
+ * @file bot_plugin.c
+ * @brief Loading and timing of bot plugins.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "bot_plugin.h"
+
+#include <dlfcn.h>
+
+_Static_assert(TETRIS_BOT_MAX_ROWS >= STATE_MAX_HEIGHT,
+               "bot state must hold every row of the compact state");
+_Static_assert(TETRIS_BOT_SHAPE_ROWS == TETR_SIZE,
+               "bot shapes must match the tetramino matrix");
+
+static void fill_shapes(int piece, uint8_t shapes[][TETRIS_BOT_SHAPE_ROWS]);
+
+/**
+ * @brief Opens a plugin and creates its bot.
+ *
+ * @param[out] plugin The plugin.
+ * @param path The path of the shared library.
+ * @param budget_us The time per move in microseconds.
+ * @param seed The seed passed to the bot.
+ * @return Error code (`0` on success).
+ */
+int bot_load(BotPlugin_t *plugin, const char *path, long long int budget_us,
+             uint64_t seed) {
+  plugin->library = NULL;
+  plugin->api = NULL;
+  plugin->bot = NULL;
+  void *library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  TetrisBotEntry_t entry = NULL;
+  // POSIX guarantees that a function pointer survives the round trip:
+  if (library) *(void **)&entry = dlsym(library, TETRIS_BOT_ENTRY);
+  int error = entry ? bot_attach(plugin, entry(), budget_us, seed) : 1;
+  if (!error)
+    plugin->library = library;
+  else if (library)
+    dlclose(library);
+  return error;
+}
+
+/**
+ * @brief Creates a bot from a set of plugin functions.
+ *
+ * @param[out] plugin The plugin.
+ * @param api The functions of the plugin.
+ * @param budget_us The time per move in microseconds.
+ * @param seed The seed passed to the bot.
+ * @return Error code (`0` on success), `1` if the ABI version does not match
+ * or the bot cannot be created.
+ */
+int bot_attach(BotPlugin_t *plugin, const TetrisBotApi_t *api,
+               long long int budget_us, uint64_t seed) {
+  plugin->library = NULL;
+  plugin->api = NULL;
+  plugin->bot = NULL;
+  plugin->budget_us = budget_us;
+  plugin->calls = 0;
+  plugin->forfeits = 0;
+  plugin->total_us = 0;
+  plugin->max_us = 0;
+  int error = api && api->abi_version == TETRIS_BOT_ABI_VERSION &&
+                      api->create && api->choose && api->destroy &&
+                      budget_us > 0
+                  ? 0
+                  : 1;
+  if (!error) {
+    plugin->bot = api->create(seed);
+    if (plugin->bot)
+      plugin->api = api;
+    else
+      error++;
+  }
+  return error;
+}
+
+/**
+ * @brief Replaces the bot of a plugin by a new one for another game.
+ *
+ * The plugin stays open and its timing statistics are kept. If the new bot
+ * cannot be created the plugin is left without a bot.
+ *
+ * @param plugin The plugin.
+ * @param seed The seed passed to the new bot.
+ * @return Error code (`0` on success).
+ */
+int bot_reseed(BotPlugin_t *plugin, uint64_t seed) {
+  int error = plugin->api ? 0 : 1;
+  if (!error) {
+    plugin->api->destroy(plugin->bot);
+    plugin->bot = plugin->api->create(seed);
+    if (!plugin->bot) {
+      plugin->api = NULL;
+      error++;
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Destroys the bot and closes its plugin.
+ *
+ * @param plugin The plugin.
+ */
+void bot_unload(BotPlugin_t *plugin) {
+  if (plugin->api) plugin->api->destroy(plugin->bot);
+  if (plugin->library) dlclose(plugin->library);
+  plugin->library = NULL;
+  plugin->api = NULL;
+  plugin->bot = NULL;
+}
+
+/**
+ * @brief Copies a game into the state given to a bot.
+ *
+ * @param game A pointer to the game state.
+ * @param deadline_us The deadline of the move.
+ * @param[out] state The state of the bot.
+ */
+void bot_fill_state(const GameState_t *game, long long int deadline_us,
+                    TetrisBotState_t *state) {
+  memset(state, 0, sizeof(TetrisBotState_t));
+  state->width = game->width;
+  state->height = game->height;
+  memcpy(state->rows, game->rows, sizeof(uint64_t) * game->height);
+  state->piece = game->piece;
+  state->rotation = game->rotation;
+  state->x_position = game->x_position;
+  state->y_position = game->y_position;
+  state->rotations = piece_period(game->piece);
+  fill_shapes(game->piece, state->shapes);
+  state->next_piece = game->next_piece;
+  state->next_rotations = piece_period(game->next_piece);
+  fill_shapes(game->next_piece, state->next_shapes);
+  state->score = game->score;
+  state->lines = game->lines;
+  state->level = game->level;
+  state->deadline_us = deadline_us;
+  state->now_us = monotonic_us;
+}
+
+/**
+ * @brief Asks the bot for the placement of the current tetramino.
+ *
+ * The call is timed with the monotonic clock. The move is forfeited when the
+ * bot fails, answers after the budget of the move or chooses a placement
+ * that does not fit at the spawn row.
+ *
+ * @param plugin The plugin.
+ * @param game A pointer to the game state.
+ * @param[out] move The chosen placement.
+ * @return `false` if the move is forfeited.
+ */
+bool bot_choose(BotPlugin_t *plugin, const GameState_t *game,
+                Placement_t *move) {
+  TetrisBotState_t state;
+  TetrisBotMove_t answer = {0, 0};
+  long long int start_us = monotonic_us();
+  bot_fill_state(game, start_us + plugin->budget_us, &state);
+  int error = plugin->api->choose(plugin->bot, &state, &answer);
+  long long int elapsed_us = monotonic_us() - start_us;
+  plugin->calls++;
+  plugin->total_us += elapsed_us;
+  if (elapsed_us > plugin->max_us) plugin->max_us = elapsed_us;
+  bool is_valid = !error && elapsed_us <= plugin->budget_us &&
+                  answer.rotation >= 0 &&
+                  answer.rotation < piece_period(game->piece) &&
+                  answer.x_position > -TETR_SIZE &&
+                  answer.x_position < game->width &&
+                  !state_collides(game, answer.rotation, answer.x_position,
+                                  game->y_position);
+  if (is_valid) {
+    move->rotation = answer.rotation;
+    move->x_position = answer.x_position;
+  } else {
+    plugin->forfeits++;
+  }
+  return is_valid;
+}
+
+/**
+ * @brief Copies the four orientations of a tetramino.
+ *
+ * @param piece The type of the tetramino (1 to `PIECE_TYPES`).
+ * @param[out] shapes The row masks of every orientation.
+ */
+static void fill_shapes(int piece, uint8_t shapes[][TETRIS_BOT_SHAPE_ROWS]) {
+  if (piece >= 1 && piece <= PIECE_TYPES)
+    memcpy(shapes, piece_shapes[piece - 1],
+           sizeof(uint8_t) * TETRIS_BOT_ROTATIONS * TETRIS_BOT_SHAPE_ROWS);
+}
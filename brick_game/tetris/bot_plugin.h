@@ -0,0 +1,45 @@
+/**
+ * @file bot_plugin.h
+ * @brief Host side of the bot plugins of `tetris_bot.h`.
+ *
+ * A plugin is opened with `dlopen()` and gets one bot per game. Every call of
+ * the bot is timed with the monotonic clock against the per-move budget; a
+ * late, failed or invalid answer forfeits the move and is counted.
+ */
+#ifndef BOT_PLUGIN_H
+#define BOT_PLUGIN_H
+
+#include "../tetris_bot.h"
+#include "autoplay.h"
+
+#define DEFAULT_BOT_BUDGET_US 20000
+
+/**
+ * @brief Loaded bot with its timing statistics.
+ *
+ * `library` is `NULL` for a bot whose functions are linked into the host.
+ * `total_us` and `max_us` are the summed and the longest call times.
+ */
+typedef struct BotPlugin_t {
+  void *library;
+  const TetrisBotApi_t *api;
+  void *bot;
+  long long int budget_us;
+  long long int calls;
+  long long int forfeits;
+  long long int total_us;
+  long long int max_us;
+} BotPlugin_t;
+
+int bot_load(BotPlugin_t *plugin, const char *path, long long int budget_us,
+             uint64_t seed);
+int bot_attach(BotPlugin_t *plugin, const TetrisBotApi_t *api,
+               long long int budget_us, uint64_t seed);
+int bot_reseed(BotPlugin_t *plugin, uint64_t seed);
+void bot_unload(BotPlugin_t *plugin);
+void bot_fill_state(const GameState_t *game, long long int deadline_us,
+                    TetrisBotState_t *state);
+bool bot_choose(BotPlugin_t *plugin, const GameState_t *game,
+                Placement_t *move);
+
+#endif
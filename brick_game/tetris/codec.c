@@ -0,0 +1,251 @@
+/**
+ * @file codec.c
+ * @brief Varint, fixed-width and LZ77 encodings.
+ */
+#include "codec.h"
+
+#include <string.h>
+
+static uint32_t lz_hash(const uint8_t *in);
+static size_t lz_put_sequence(uint8_t *out, size_t capacity, size_t length,
+                              const uint8_t *literals, size_t literal_count,
+                              size_t match, size_t distance);
+
+/**
+ * @brief Writes an unsigned varint.
+ *
+ * @param[out] out At least `VARINT_MAX_BYTES` bytes.
+ * @param value The value.
+ * @return The number of bytes written.
+ */
+size_t varint_put(uint8_t *out, uint64_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+/**
+ * @brief Reads an unsigned varint.
+ *
+ * @param in The encoded bytes.
+ * @param size The number of bytes available.
+ * @param[out] value The value.
+ * @return The number of bytes read, `0` if the varint is truncated or too
+ * long.
+ */
+size_t varint_get(const uint8_t *in, size_t size, uint64_t *value) {
+  size_t length = 0;
+  bool is_done = false;
+  *value = 0;
+  while (!is_done && length < size && length < VARINT_MAX_BYTES) {
+    *value |= (uint64_t)(in[length] & 0x7f) << (7 * length);
+    is_done = !(in[length] & 0x80);
+    length++;
+  }
+  return is_done ? length : 0;
+}
+
+/**
+ * @brief Maps a signed value to an unsigned one with small magnitudes first.
+ *
+ * @param value The signed value.
+ * @return `0, -1, 1, -2, ...` as `0, 1, 2, 3, ...`.
+ */
+uint64_t zigzag_encode(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/**
+ * @brief Inverts `zigzag_encode()`.
+ *
+ * @param value The unsigned value.
+ * @return The signed value.
+ */
+int64_t zigzag_decode(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * @brief Writes a 32-bit value in little-endian order.
+ *
+ * @param[out] out Four bytes.
+ * @param value The value.
+ */
+void put_u32(uint8_t *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+/**
+ * @brief Writes a 64-bit value in little-endian order.
+ *
+ * @param[out] out Eight bytes.
+ * @param value The value.
+ */
+void put_u64(uint8_t *out, uint64_t value) {
+  for (int i = 0; i < 8; i++) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value.
+ *
+ * @param in Four bytes.
+ * @return The value.
+ */
+uint32_t get_u32(const uint8_t *in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) value |= (uint32_t)in[i] << (8 * i);
+  return value;
+}
+
+/**
+ * @brief Reads a little-endian 64-bit value.
+ *
+ * @param in Eight bytes.
+ * @return The value.
+ */
+uint64_t get_u64(const uint8_t *in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value |= (uint64_t)in[i] << (8 * i);
+  return value;
+}
+
+/**
+ * @brief Compresses a block with the LZ77 coder.
+ *
+ * Matches are found through a table of the last position of every hashed
+ * `LZ_MIN_MATCH`-byte string, so each input byte is looked at a bounded
+ * number of times.
+ *
+ * @param in The block.
+ * @param size The size of the block.
+ * @param[out] out The compressed block.
+ * @param capacity The size of `out`.
+ * @return The compressed size, `0` if it would exceed `capacity`.
+ */
+size_t lz_compress(const uint8_t *in, size_t size, uint8_t *out,
+                   size_t capacity) {
+  size_t table[1 << LZ_HASH_BITS] = {0};
+  size_t length = 0, anchor = 0, position = 0;
+  bool is_full = false;
+  while (!is_full && position + LZ_MIN_MATCH <= size) {
+    uint32_t hash = lz_hash(in + position);
+    size_t candidate = table[hash];
+    table[hash] = position + 1;
+    if (candidate &&
+        !memcmp(in + candidate - 1, in + position, LZ_MIN_MATCH)) {
+      size_t match = LZ_MIN_MATCH;
+      while (position + match < size &&
+             in[candidate - 1 + match] == in[position + match])
+        match++;
+      size_t written = lz_put_sequence(
+          out, capacity, length, in + anchor, position - anchor, match,
+          position - (candidate - 1));
+      is_full = !written;
+      length += written;
+      position += match;
+      anchor = position;
+    } else {
+      position++;
+    }
+  }
+  if (!is_full) {
+    size_t written = lz_put_sequence(out, capacity, length, in + anchor,
+                                     size - anchor, 0, 0);
+    is_full = !written;
+    length += written;
+  }
+  return is_full ? 0 : length;
+}
+
+/**
+ * @brief Decompresses a block of the LZ77 coder.
+ *
+ * @param in The compressed block.
+ * @param size The size of the compressed block.
+ * @param[out] out The block.
+ * @param capacity The size of `out`.
+ * @param[out] length The size of the block.
+ * @return Error code (`0` on success, `1` if the block is corrupt or does not
+ * fit).
+ */
+int lz_decompress(const uint8_t *in, size_t size, uint8_t *out,
+                  size_t capacity, size_t *length) {
+  int error = 0;
+  size_t position = 0;
+  *length = 0;
+  while (!error && position < size) {
+    uint64_t literals, match, distance;
+    size_t read = varint_get(in + position, size - position, &literals);
+    position += read;
+    error = !read || literals > size - position ||
+            literals > capacity - *length;
+    if (!error) {
+      memcpy(out + *length, in + position, literals);
+      position += literals;
+      *length += literals;
+    }
+    if (!error && position < size) {
+      read = varint_get(in + position, size - position, &match);
+      position += read;
+      size_t read_distance =
+          read ? varint_get(in + position, size - position, &distance) : 0;
+      position += read_distance;
+      match += LZ_MIN_MATCH;
+      error = !read || !read_distance || !distance || distance > *length ||
+              match > capacity - *length;
+      // copy byte by byte, a match may overlap its own output:
+      for (size_t i = 0; !error && i < match; i++, (*length)++)
+        out[*length] = out[*length - distance];
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Hashes the first `LZ_MIN_MATCH` bytes of a string.
+ *
+ * @param in The string.
+ * @return The index in the match table.
+ */
+static uint32_t lz_hash(const uint8_t *in) {
+  uint32_t word = get_u32(in);
+  return (word * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * @brief Appends one sequence to a compressed block.
+ *
+ * @param[out] out The compressed block.
+ * @param capacity The size of `out`.
+ * @param length The bytes already in `out`.
+ * @param literals The literals of the sequence.
+ * @param literal_count The number of literals.
+ * @param match The match length, `0` for the last sequence.
+ * @param distance The distance of the match.
+ * @return The number of bytes written, `0` if they do not fit.
+ */
+static size_t lz_put_sequence(uint8_t *out, size_t capacity, size_t length,
+                              const uint8_t *literals, size_t literal_count,
+                              size_t match, size_t distance) {
+  uint8_t header[3 * VARINT_MAX_BYTES];
+  size_t written = 0;
+  size_t header_size = varint_put(header, literal_count);
+  size_t trailer_size = 0;
+  if (match) {
+    trailer_size = varint_put(header + header_size, match - LZ_MIN_MATCH);
+    trailer_size += varint_put(header + header_size + trailer_size, distance);
+  }
+  size_t total = header_size + literal_count + trailer_size;
+  if (total <= capacity - length) {
+    memcpy(out + length, header, header_size);
+    memcpy(out + length + header_size, literals, literal_count);
+    memcpy(out + length + header_size + literal_count, header + header_size,
+           trailer_size);
+    written = total;
+  }
+  return written;
+}
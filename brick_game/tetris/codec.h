@@ -0,0 +1,36 @@
+/**
+ * @file codec.h
+ * @brief Byte-level encodings of the game-log archive.
+ *
+ * Integers are stored as LEB128 varints (7 bits per byte, low bits first),
+ * signed ones after zigzag mapping, and fixed-size fields in little-endian
+ * order. Blocks are compressed with a small LZ77 coder: a block is a list of
+ * sequences, each a varint literal count, the literals, then a varint match
+ * length (minus `LZ_MIN_MATCH`) and a varint distance back into the output;
+ * the last sequence stops after its literals.
+ */
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define VARINT_MAX_BYTES 10
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+size_t varint_put(uint8_t *out, uint64_t value);
+size_t varint_get(const uint8_t *in, size_t size, uint64_t *value);
+uint64_t zigzag_encode(int64_t value);
+int64_t zigzag_decode(uint64_t value);
+void put_u32(uint8_t *out, uint32_t value);
+void put_u64(uint8_t *out, uint64_t value);
+uint32_t get_u32(const uint8_t *in);
+uint64_t get_u64(const uint8_t *in);
+size_t lz_compress(const uint8_t *in, size_t size, uint8_t *out,
+                   size_t capacity);
+int lz_decompress(const uint8_t *in, size_t size, uint8_t *out,
+                  size_t capacity, size_t *length);
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * @file env.c
+ * @brief Batched C ABI stepping many games in one call.
+ */
+#include "../tetris_env.h"
+
+#include "game_state.h"
+
+#define OBSERVATION_EXTRA 2
+#define FALLING_CELL 2
+
+/**
+ * @brief Batch of games of `libtetris.so`.
+ */
+struct TetrisEnv_t {
+  GameState_t *games;
+  uint64_t seed;
+  int count;
+  int width;
+  int height;
+};
+
+/**
+ * @brief Expands the low byte of a row mask into eight cells of 0 and 1.
+ *
+ * The multiplication moves bit `k` of the low seven bits to bit 0 of byte
+ * `k` without carries, the top bit is moved separately.
+ *
+ * @param byte The byte of the row mask.
+ * @return The cells, cell `k` in byte `k` of the number.
+ */
+static uint64_t expand_byte(uint64_t byte) {
+  return ((byte & 0x7f) * 0x0002040810204081ULL & 0x0101010101010101ULL) |
+         (byte >> 7 & 1) << 56;
+}
+
+/**
+ * @brief Writes the observation of one game.
+ *
+ * On little-endian hosts row masks are expanded eight cells at a time, then
+ * the cells of the falling tetramino are marked.
+ *
+ * @param game A pointer to the game state.
+ * @param[out] observation The observation block of the game.
+ */
+static void write_observation(const GameState_t *game, uint8_t *observation) {
+  int width = game->width;
+  for (int y = 0; y < game->height; y++) {
+    uint8_t *cells = observation + y * width;
+    uint64_t row = game->rows[y];
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (int x = 0; x < width; x += 8) {
+      uint64_t expanded = expand_byte(row >> x & 0xff);
+      memcpy(cells + x, &expanded, width - x < 8 ? width - x : 8);
+    }
+#else
+    for (int x = 0; x < width; x++) cells[x] = row >> x & 1;
+#endif
+  }
+  if (game->state == Moving) {
+    const uint8_t *shape = piece_shapes[game->piece - 1][game->rotation];
+    for (int i = 0; i < TETR_SIZE; i++) {
+      int y = game->y_position + i;
+      for (int j = 0; shape[i] && y >= 0 && j < TETR_SIZE; j++) {
+        int x = game->x_position + j;
+        if (shape[i] >> j & 1 && x >= 0 && x < width)
+          observation[y * width + x] = FALLING_CELL;
+      }
+    }
+  }
+  observation[width * game->height] = game->piece;
+  observation[width * game->height + 1] = game->next_piece;
+}
+
+/**
+ * @brief Restarts a finished game with the next seed of the environment.
+ *
+ * @param env The environment.
+ * @param game A pointer to the game state.
+ */
+static void restart_game(TetrisEnv_t *env, GameState_t *game) {
+  state_init(game, env->width, env->height, random_next(&env->seed));
+}
+
+/**
+ * @brief Creates a batch of games.
+ *
+ * @param count The number of games.
+ * @param width The number of columns of each field.
+ * @param height The number of rows of each field, at most `STATE_MAX_HEIGHT`.
+ * @param seed The seed the seeds of the games are derived from.
+ * @return The environment, `NULL` if the size is not supported or the memory
+ * could not be allocated.
+ */
+TetrisEnv_t *tetrisEnvCreate(int count, int width, int height, uint64_t seed) {
+  TetrisEnv_t *env = NULL;
+  if (count > 0 && is_valid_board_size(width, height) &&
+      height <= STATE_MAX_HEIGHT)
+    env = calloc(1, sizeof(TetrisEnv_t));
+  if (env) {
+    env->games = aligned_alloc(_Alignof(GameState_t),
+                               sizeof(GameState_t) * (size_t)count);
+    env->count = count;
+    env->width = width;
+    env->height = height;
+    env->seed = seed;
+    if (!env->games) {
+      free(env);
+      env = NULL;
+    }
+  }
+  if (env) {
+    for (int i = 0; i < count; i++) restart_game(env, &env->games[i]);
+  }
+  return env;
+}
+
+/**
+ * @brief Frees a batch of games.
+ *
+ * @param env The environment, may be `NULL`.
+ */
+void tetrisEnvDestroy(TetrisEnv_t *env) {
+  if (env) {
+    free(env->games);
+    free(env);
+  }
+}
+
+/**
+ * @brief Returns the number of bytes of the observation of one game.
+ *
+ * @param env The environment.
+ * @return `width * height + 2`.
+ */
+int tetrisEnvObservationSize(const TetrisEnv_t *env) {
+  return env->width * env->height + OBSERVATION_EXTRA;
+}
+
+/**
+ * @brief Returns the number of placement actions of one game.
+ *
+ * Placement `p` puts the tetramino in orientation `p / (width + 4)` with its
+ * matrix at column `p % (width + 4) - 4`.
+ *
+ * @param env The environment.
+ * @return `4 * (width + 4)`.
+ */
+int tetrisEnvPlacementCount(const TetrisEnv_t *env) {
+  return PIECE_ROTATIONS * (env->width + TETR_SIZE - 1);
+}
+
+/**
+ * @brief Restarts every game and writes the first observations.
+ *
+ * @param env The environment.
+ * @param[out] observations The observation blocks of all games.
+ */
+void tetrisEnvReset(TetrisEnv_t *env, uint8_t *observations) {
+  int size = tetrisEnvObservationSize(env);
+  for (int i = 0; i < env->count; i++) {
+    restart_game(env, &env->games[i]);
+    write_observation(&env->games[i], observations + (size_t)i * size);
+  }
+}
+
+/**
+ * @brief Advances every game by one logical tick.
+ *
+ * The actions are `UserAction_t` values: `Left`, `Right`, `Down` (one row)
+ * and `Action` (rotate) move the falling tetramino, others only let gravity
+ * act.
+ *
+ * @param env The environment.
+ * @param actions The action of every game.
+ * @param[out] observations The observation blocks of all games.
+ * @param[out] rewards The score gained by every game.
+ * @param[out] dones The flags of the games that ended.
+ * @return The number of games that ended.
+ */
+int tetrisEnvStep(TetrisEnv_t *env, const int32_t *actions,
+                  uint8_t *observations, float *rewards, uint8_t *dones) {
+  int size = tetrisEnvObservationSize(env);
+  int finished = 0;
+  for (int i = 0; i < env->count; i++) {
+    GameState_t *game = &env->games[i];
+    int score = game->score;
+    state_step(game, (UserAction_t)actions[i]);
+    rewards[i] = (float)(game->score - score);
+    dones[i] = state_is_over(game);
+    if (dones[i]) {
+      restart_game(env, game);
+      finished++;
+    }
+    write_observation(game, observations + (size_t)i * size);
+  }
+  return finished;
+}
+
+/**
+ * @brief Drops the falling tetramino of every game at a placement.
+ *
+ * A placement that does not fit drops the tetramino where it is.
+ *
+ * @param env The environment.
+ * @param placements The placement of every game, see
+ * `tetrisEnvPlacementCount()`.
+ * @param[out] observations The observation blocks of all games.
+ * @param[out] rewards The score gained by every game.
+ * @param[out] dones The flags of the games that ended.
+ * @return The number of games that ended.
+ */
+int tetrisEnvStepPlacements(TetrisEnv_t *env, const int32_t *placements,
+                            uint8_t *observations, float *rewards,
+                            uint8_t *dones) {
+  int size = tetrisEnvObservationSize(env);
+  int columns = env->width + TETR_SIZE - 1;
+  int finished = 0;
+  for (int i = 0; i < env->count; i++) {
+    GameState_t *game = &env->games[i];
+    int score = game->score;
+    int placement = placements[i];
+    if (placement < 0 ||
+        !state_place(game, placement / columns % PIECE_ROTATIONS,
+                     placement % columns + 1 - TETR_SIZE))
+      state_drop(game);
+    rewards[i] = (float)(game->score - score);
+    dones[i] = state_is_over(game);
+    if (dones[i]) {
+      restart_game(env, game);
+      finished++;
+    }
+    write_observation(game, observations + (size_t)i * size);
+  }
+  return finished;
+}
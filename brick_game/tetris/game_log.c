@@ -0,0 +1,705 @@
+/**
+ * @file game_log.c
+ * @brief Compressed game-log archive.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "game_log.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool read_field(const uint8_t *in, size_t size, size_t *position,
+                       uint64_t *value);
+static int reserve_raw(LogWriter_t *writer, size_t capacity);
+static int push_block(LogWriter_t *writer, const LogBlock_t *block);
+static void begin_block(LogWriter_t *writer);
+static int flush_block(LogWriter_t *writer);
+static int write_index(LogWriter_t *writer);
+static int load_index(LogWriter_t *writer);
+static int decode_block(LogReader_t *reader, int block);
+
+/**
+ * @brief Prepares an empty record.
+ *
+ * @param[out] record The record.
+ */
+void record_init(GameRecord_t *record) {
+  *record = (GameRecord_t){0};
+  record->level = 1;
+}
+
+/**
+ * @brief Starts logging a new game, keeping the buffer of the runs.
+ *
+ * @param record The record.
+ * @param seed The seed of the tetraminos.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @param policy The bot playing the game.
+ */
+void record_start(GameRecord_t *record, uint64_t seed, int width, int height,
+                  int policy) {
+  record->seed = seed;
+  record->width = width;
+  record->height = height;
+  record->policy = policy;
+  record->score = 0;
+  record->level = 1;
+  record->ticks = 0;
+  record->run_count = 0;
+}
+
+/**
+ * @brief Logs the input given before a tick.
+ *
+ * The input extends the last run if it repeats its action on the next tick.
+ *
+ * @param record The record.
+ * @param tick The tick, not earlier than the end of the last run.
+ * @param action The input.
+ * @return Error code (`0` on success).
+ */
+int record_input(GameRecord_t *record, long long int tick,
+                 UserAction_t action) {
+  int error = 0;
+  InputRun_t *last =
+      record->run_count ? &record->runs[record->run_count - 1] : NULL;
+  if (last && last->action == action && last->tick + last->length == tick) {
+    last->length++;
+  } else {
+    if (record->run_count == record->run_capacity) {
+      int capacity = record->run_capacity ? record->run_capacity * 2 : 64;
+      InputRun_t *runs = realloc(record->runs, sizeof(InputRun_t) * capacity);
+      if (runs) {
+        record->runs = runs;
+        record->run_capacity = capacity;
+      } else {
+        error++;
+      }
+    }
+    if (!error)
+      record->runs[record->run_count++] = (InputRun_t){tick, 1, action};
+  }
+  return error;
+}
+
+/**
+ * @brief Frees the runs of a record.
+ *
+ * @param record The record.
+ */
+void record_free(GameRecord_t *record) {
+  free(record->runs);
+  record_init(record);
+}
+
+/**
+ * @brief Returns the most bytes `record_encode()` can write for a record.
+ *
+ * @param record The record.
+ * @return The size in bytes.
+ */
+size_t record_bound(const GameRecord_t *record) {
+  return (LOG_RECORD_FIELDS + 2 * (size_t)record->run_count) *
+         VARINT_MAX_BYTES;
+}
+
+/**
+ * @brief Encodes a record as varints.
+ *
+ * The fields are the seed, the field size, the policy, the score (zigzag),
+ * the level, the ticks and the number of runs; every run follows as the gap
+ * since the end of the previous run and `length << 3 | action`.
+ *
+ * @param record The record.
+ * @param[out] out At least `record_bound()` bytes.
+ * @return The number of bytes written.
+ */
+size_t record_encode(const GameRecord_t *record, uint8_t *out) {
+  size_t length = varint_put(out, record->seed);
+  length += varint_put(out + length, (uint64_t)record->width);
+  length += varint_put(out + length, (uint64_t)record->height);
+  length += varint_put(out + length, zigzag_encode(record->policy));
+  length += varint_put(out + length, zigzag_encode(record->score));
+  length += varint_put(out + length, (uint64_t)record->level);
+  length += varint_put(out + length, (uint64_t)record->ticks);
+  length += varint_put(out + length, (uint64_t)record->run_count);
+  long long int end = 0;
+  for (int i = 0; i < record->run_count; i++) {
+    const InputRun_t *run = &record->runs[i];
+    length += varint_put(out + length, (uint64_t)(run->tick - end));
+    length += varint_put(out + length,
+                         (uint64_t)run->length << 3 | (uint64_t)run->action);
+    end = run->tick + run->length;
+  }
+  return length;
+}
+
+/**
+ * @brief Decodes a record written by `record_encode()`.
+ *
+ * @param in The encoded bytes.
+ * @param size The number of bytes available.
+ * @param[out] record The record; its run buffer grows as needed.
+ * @param[out] length The number of bytes read.
+ * @return Error code (`0` on success, `1` if the record is corrupt).
+ */
+int record_decode(const uint8_t *in, size_t size, GameRecord_t *record,
+                  size_t *length) {
+  uint64_t fields[LOG_RECORD_FIELDS];
+  size_t position = 0;
+  int error = 0;
+  for (int i = 0; !error && i < LOG_RECORD_FIELDS; i++)
+    error = !read_field(in, size, &position, &fields[i]);
+  // every run takes at least two bytes:
+  if (!error) error = fields[7] > (size - position) / 2;
+  if (!error && fields[7] > (uint64_t)record->run_capacity) {
+    InputRun_t *runs = realloc(record->runs, sizeof(InputRun_t) * fields[7]);
+    if (runs) {
+      record->runs = runs;
+      record->run_capacity = (int)fields[7];
+    } else {
+      error++;
+    }
+  }
+  if (!error) {
+    record->seed = fields[0];
+    record->width = (int)fields[1];
+    record->height = (int)fields[2];
+    record->policy = (int)zigzag_decode(fields[3]);
+    record->score = (int)zigzag_decode(fields[4]);
+    record->level = (int)fields[5];
+    record->ticks = (long long int)fields[6];
+    record->run_count = (int)fields[7];
+  }
+  long long int end = 0;
+  for (int i = 0; !error && i < record->run_count; i++) {
+    uint64_t gap, packed;
+    error = !read_field(in, size, &position, &gap) ||
+            !read_field(in, size, &position, &packed);
+    if (!error) {
+      record->runs[i].tick = end + (long long int)gap;
+      record->runs[i].length = (int)(packed >> 3);
+      record->runs[i].action = (UserAction_t)(packed & 7);
+      end = record->runs[i].tick + record->runs[i].length;
+    }
+  }
+  *length = position;
+  return error;
+}
+
+/**
+ * @brief Plays a logged game again from its seed and inputs.
+ *
+ * The game starts as in `play_seeded_game()`; on a tick outside every run no
+ * key is held.
+ *
+ * @param record The record.
+ * @param[out] score The final score of the replay, equal to the logged one
+ * when the engine behaves as it did.
+ * @return Error code (`0` on success).
+ */
+int replay_record(const GameRecord_t *record, int *score) {
+  ModelInfo_t model;
+  int error = init_model(&model, record->width, record->height);
+  *score = 0;
+  if (!error) {
+    seed_model(&model, record->seed);
+    model.no_persist = true;
+    model.state = Start_state;
+    model.pause = 2;
+    model.user_action = Start;
+    model.hold = true;
+    run_tick(&model, TICK_MS);
+    int run = 0;
+    for (long long int tick = 0; tick < record->ticks && model.pause == 0;
+         tick++) {
+      while (run < record->run_count &&
+             record->runs[run].tick + record->runs[run].length <= tick)
+        run++;
+      if (run < record->run_count && record->runs[run].tick <= tick) {
+        model.user_action = record->runs[run].action;
+        model.hold = true;
+      } else {
+        model.hold = false;
+      }
+      run_tick(&model, TICK_MS);
+    }
+    *score = model.score;
+  }
+  release_model_buffers(&model);
+  return error;
+}
+
+/**
+ * @brief Opens an archive for appending, creating it if it does not exist.
+ *
+ * The index of an existing archive is loaded and new blocks are written over
+ * it; the index is written again on close.
+ *
+ * @param[out] writer The writer.
+ * @param path The path of the archive.
+ * @return Error code (`0` on success, `1` if the file cannot be created or is
+ * not an archive).
+ */
+int log_writer_open(LogWriter_t *writer, const char *path) {
+  *writer = (LogWriter_t){0};
+  int error = reserve_raw(writer, 2 * LOG_BLOCK_BYTES);
+  if (!error) writer->file = fopen(path, "r+b");
+  if (!error && writer->file) {
+    error = load_index(writer);
+  } else if (!error) {
+    uint8_t header[LOG_HEADER_SIZE];
+    put_u32(header, LOG_MAGIC);
+    put_u32(header + 4, LOG_VERSION);
+    writer->file = fopen(path, "w+b");
+    error = !writer->file ||
+            fwrite(header, 1, LOG_HEADER_SIZE, writer->file) != LOG_HEADER_SIZE;
+    writer->offset = LOG_HEADER_SIZE;
+  }
+  begin_block(writer);
+  if (error) {
+    if (writer->file) fclose(writer->file);
+    writer->file = NULL;
+    log_writer_close(writer);
+  }
+  return error;
+}
+
+/**
+ * @brief Appends a game to the archive.
+ *
+ * @param writer The writer.
+ * @param record The game.
+ * @return Error code (`0` on success).
+ */
+int log_writer_append(LogWriter_t *writer, const GameRecord_t *record) {
+  int error = reserve_raw(writer, writer->raw_size + record_bound(record));
+  if (!error) {
+    writer->raw_size += record_encode(record, writer->raw + writer->raw_size);
+    if (record->score < writer->current.min_score)
+      writer->current.min_score = record->score;
+    if (record->score > writer->current.max_score)
+      writer->current.max_score = record->score;
+    writer->current.games++;
+    writer->games++;
+    if (writer->raw_size >= LOG_BLOCK_BYTES ||
+        writer->current.games >= LOG_BLOCK_GAMES)
+      error = flush_block(writer);
+  }
+  return error;
+}
+
+/**
+ * @brief Writes the last block and the index, then closes the archive.
+ *
+ * @param writer The writer.
+ * @return Error code (`0` on success).
+ */
+int log_writer_close(LogWriter_t *writer) {
+  int error = writer->file ? flush_block(writer) : 1;
+  if (!error) error = write_index(writer);
+  if (!error)
+    error = fflush(writer->file) != 0 ||
+            ftruncate(fileno(writer->file), (off_t)writer->offset) != 0;
+  if (writer->file && fclose(writer->file)) error = 1;
+  free(writer->raw);
+  free(writer->packed);
+  free(writer->blocks);
+  *writer = (LogWriter_t){0};
+  return error;
+}
+
+/**
+ * @brief Maps an archive into memory and checks its index.
+ *
+ * @param[out] reader The reader.
+ * @param path The path of the archive.
+ * @return Error code (`0` on success, `1` if the file cannot be read or is
+ * not a closed archive).
+ */
+int log_reader_open(LogReader_t *reader, const char *path) {
+  *reader = (LogReader_t){0};
+  reader->cached = -1;
+  struct stat info;
+  int fd = open(path, O_RDONLY);
+  int error = fd < 0 || fstat(fd, &info) != 0 ||
+              info.st_size < LOG_HEADER_SIZE + LOG_TRAILER_SIZE;
+  if (!error) {
+    void *data =
+        mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    error = data == MAP_FAILED;
+    if (!error) {
+      reader->data = data;
+      reader->size = (size_t)info.st_size;
+    }
+  }
+  if (fd >= 0) close(fd);
+  if (!error) {
+    const uint8_t *trailer = reader->data + reader->size - LOG_TRAILER_SIZE;
+    uint64_t index_offset = get_u64(trailer);
+    uint64_t blocks = get_u32(trailer + 8);
+    error = get_u32(reader->data) != LOG_MAGIC ||
+            get_u32(reader->data + 4) != LOG_VERSION ||
+            get_u32(trailer + 12) != LOG_INDEX_MAGIC ||
+            index_offset < LOG_HEADER_SIZE ||
+            index_offset > reader->size - LOG_TRAILER_SIZE ||
+            reader->size - LOG_TRAILER_SIZE - index_offset !=
+                blocks * LOG_INDEX_ENTRY_SIZE;
+    if (!error) {
+      reader->index = reader->data + index_offset;
+      reader->block_count = (int)blocks;
+    }
+  }
+  if (!error && reader->block_count) {
+    LogBlock_t last;
+    log_reader_block(reader, reader->block_count - 1, &last);
+    reader->games = last.first_game + last.games;
+  }
+  if (error) log_reader_close(reader);
+  return error;
+}
+
+/**
+ * @brief Unmaps an archive and frees the block buffer.
+ *
+ * @param reader The reader.
+ */
+void log_reader_close(LogReader_t *reader) {
+  if (reader->data) munmap((void *)reader->data, reader->size);
+  free(reader->block);
+  *reader = (LogReader_t){0};
+  reader->cached = -1;
+}
+
+/**
+ * @brief Reads the index entry of a block.
+ *
+ * @param reader The reader.
+ * @param block The index of the block.
+ * @param[out] entry The entry.
+ */
+void log_reader_block(const LogReader_t *reader, int block,
+                      LogBlock_t *entry) {
+  const uint8_t *in = reader->index + (size_t)block * LOG_INDEX_ENTRY_SIZE;
+  entry->offset = get_u64(in);
+  entry->first_game = get_u64(in + 8);
+  entry->games = get_u32(in + 16);
+  entry->min_score = (int32_t)get_u32(in + 20);
+  entry->max_score = (int32_t)get_u32(in + 24);
+}
+
+/**
+ * @brief Reads one game.
+ *
+ * The block holding it is found by a binary search of the index, and only
+ * that block is decompressed.
+ *
+ * @param reader The reader.
+ * @param game The number of the game (from `0`).
+ * @param[out] record The game.
+ * @return Error code (`0` on success, `1` if there is no such game or the
+ * block is corrupt).
+ */
+int log_reader_game(LogReader_t *reader, uint64_t game, GameRecord_t *record) {
+  int error = game < reader->games ? 0 : 1;
+  int low = 0, high = reader->block_count - 1;
+  LogBlock_t entry;
+  while (!error && low < high) {
+    int middle = (low + high + 1) / 2;
+    log_reader_block(reader, middle, &entry);
+    if (entry.first_game <= game)
+      low = middle;
+    else
+      high = middle - 1;
+  }
+  if (!error) {
+    log_reader_block(reader, low, &entry);
+    error = decode_block(reader, low);
+  }
+  size_t position = 0, length = 0;
+  for (uint64_t i = entry.first_game; !error && i <= game; i++) {
+    error = record_decode(reader->block + position,
+                          reader->block_size - position, record, &length);
+    position += length;
+  }
+  return error;
+}
+
+/**
+ * @brief Visits the games whose score lies in a range.
+ *
+ * Blocks whose score range does not meet the filter are skipped without
+ * being decompressed.
+ *
+ * @param reader The reader.
+ * @param min_score The lowest score to visit.
+ * @param max_score The highest score to visit.
+ * @param visit The function called for every matching game, or `NULL` to
+ * only count them.
+ * @param context The context passed to `visit`.
+ * @return The number of games visited, `-1` if a block is corrupt.
+ */
+long long int log_reader_filter(LogReader_t *reader, int min_score,
+                                int max_score, LogVisitor_t visit,
+                                void *context) {
+  GameRecord_t record;
+  record_init(&record);
+  long long int count = 0;
+  bool is_running = true;
+  int error = 0;
+  for (int b = 0; !error && is_running && b < reader->block_count; b++) {
+    LogBlock_t entry;
+    log_reader_block(reader, b, &entry);
+    if (entry.max_score < min_score || entry.min_score > max_score) continue;
+    error = decode_block(reader, b);
+    size_t position = 0, length = 0;
+    for (uint32_t i = 0; !error && is_running && i < entry.games; i++) {
+      error = record_decode(reader->block + position,
+                            reader->block_size - position, &record, &length);
+      position += length;
+      if (!error && record.score >= min_score && record.score <= max_score) {
+        count++;
+        if (visit) is_running = visit(context, entry.first_game + i, &record);
+      }
+    }
+  }
+  record_free(&record);
+  return error ? -1 : count;
+}
+
+/**
+ * @brief Reads one varint of a record.
+ *
+ * @param in The encoded bytes.
+ * @param size The number of bytes available.
+ * @param position The read position, advanced past the varint.
+ * @param[out] value The value.
+ * @return `false` if the varint is truncated.
+ */
+static bool read_field(const uint8_t *in, size_t size, size_t *position,
+                       uint64_t *value) {
+  size_t read = varint_get(in + *position, size - *position, value);
+  *position += read;
+  return read > 0;
+}
+
+/**
+ * @brief Grows the block buffers of a writer.
+ *
+ * @param writer The writer.
+ * @param capacity The number of bytes needed.
+ * @return Error code (`0` on success).
+ */
+static int reserve_raw(LogWriter_t *writer, size_t capacity) {
+  int error = 0;
+  if (capacity > writer->raw_capacity) {
+    size_t grown = writer->raw_capacity * 2 > capacity
+                       ? writer->raw_capacity * 2
+                       : capacity;
+    uint8_t *raw = realloc(writer->raw, grown);
+    if (raw) writer->raw = raw;
+    uint8_t *packed = raw ? realloc(writer->packed, grown) : NULL;
+    if (packed) writer->packed = packed;
+    if (raw && packed)
+      writer->raw_capacity = grown;
+    else
+      error++;
+  }
+  return error;
+}
+
+/**
+ * @brief Adds an entry to the index of a writer.
+ *
+ * @param writer The writer.
+ * @param block The entry.
+ * @return Error code (`0` on success).
+ */
+static int push_block(LogWriter_t *writer, const LogBlock_t *block) {
+  int error = 0;
+  if (writer->block_count == writer->block_capacity) {
+    int capacity = writer->block_capacity ? writer->block_capacity * 2 : 64;
+    LogBlock_t *blocks =
+        realloc(writer->blocks, sizeof(LogBlock_t) * capacity);
+    if (blocks) {
+      writer->blocks = blocks;
+      writer->block_capacity = capacity;
+    } else {
+      error++;
+    }
+  }
+  if (!error) writer->blocks[writer->block_count++] = *block;
+  return error;
+}
+
+/**
+ * @brief Starts an empty block at the write position.
+ *
+ * @param writer The writer.
+ */
+static void begin_block(LogWriter_t *writer) {
+  writer->current =
+      (LogBlock_t){writer->offset, writer->games, 0, INT32_MAX, INT32_MIN};
+  writer->raw_size = 0;
+}
+
+/**
+ * @brief Compresses the current block and appends it to the file.
+ *
+ * A block that does not shrink is stored as it is.
+ *
+ * @param writer The writer.
+ * @return Error code (`0` on success).
+ */
+static int flush_block(LogWriter_t *writer) {
+  int error = 0;
+  if (writer->current.games) {
+    size_t stored = lz_compress(writer->raw, writer->raw_size, writer->packed,
+                                writer->raw_size);
+    uint32_t method = stored ? LOG_METHOD_LZ : LOG_METHOD_STORED;
+    const uint8_t *data = stored ? writer->packed : writer->raw;
+    if (!stored) stored = writer->raw_size;
+    uint8_t header[LOG_BLOCK_HEADER_SIZE];
+    put_u32(header, (uint32_t)writer->raw_size);
+    put_u32(header + 4, (uint32_t)stored);
+    put_u32(header + 8, writer->current.games);
+    put_u32(header + 12, method);
+    error = fwrite(header, 1, LOG_BLOCK_HEADER_SIZE, writer->file) !=
+                LOG_BLOCK_HEADER_SIZE ||
+            fwrite(data, 1, stored, writer->file) != stored;
+    if (!error) error = push_block(writer, &writer->current);
+    writer->offset += LOG_BLOCK_HEADER_SIZE + stored;
+    begin_block(writer);
+  }
+  return error;
+}
+
+/**
+ * @brief Appends the index and the trailer at the write position.
+ *
+ * @param writer The writer.
+ * @return Error code (`0` on success).
+ */
+static int write_index(LogWriter_t *writer) {
+  int error = 0;
+  uint64_t index_offset = writer->offset;
+  for (int b = 0; !error && b < writer->block_count; b++) {
+    const LogBlock_t *block = &writer->blocks[b];
+    uint8_t entry[LOG_INDEX_ENTRY_SIZE];
+    put_u64(entry, block->offset);
+    put_u64(entry + 8, block->first_game);
+    put_u32(entry + 16, block->games);
+    put_u32(entry + 20, (uint32_t)block->min_score);
+    put_u32(entry + 24, (uint32_t)block->max_score);
+    error = fwrite(entry, 1, LOG_INDEX_ENTRY_SIZE, writer->file) !=
+            LOG_INDEX_ENTRY_SIZE;
+    writer->offset += LOG_INDEX_ENTRY_SIZE;
+  }
+  uint8_t trailer[LOG_TRAILER_SIZE];
+  put_u64(trailer, index_offset);
+  put_u32(trailer + 8, (uint32_t)writer->block_count);
+  put_u32(trailer + 12, LOG_INDEX_MAGIC);
+  if (!error)
+    error = fwrite(trailer, 1, LOG_TRAILER_SIZE, writer->file) !=
+            LOG_TRAILER_SIZE;
+  writer->offset += LOG_TRAILER_SIZE;
+  return error;
+}
+
+/**
+ * @brief Loads the index of an existing archive and moves the write
+ * position to it.
+ *
+ * @param writer The writer with the archive open.
+ * @return Error code (`0` on success, `1` if the file is not a closed
+ * archive).
+ */
+static int load_index(LogWriter_t *writer) {
+  uint8_t header[LOG_HEADER_SIZE], trailer[LOG_TRAILER_SIZE];
+  int error = fseek(writer->file, 0, SEEK_END) != 0;
+  long size = error ? 0 : ftell(writer->file);
+  error = error || size < LOG_HEADER_SIZE + LOG_TRAILER_SIZE ||
+          fseek(writer->file, 0, SEEK_SET) != 0 ||
+          fread(header, 1, LOG_HEADER_SIZE, writer->file) != LOG_HEADER_SIZE ||
+          fseek(writer->file, size - LOG_TRAILER_SIZE, SEEK_SET) != 0 ||
+          fread(trailer, 1, LOG_TRAILER_SIZE, writer->file) !=
+              LOG_TRAILER_SIZE;
+  uint64_t index_offset = error ? 0 : get_u64(trailer);
+  uint64_t blocks = error ? 0 : get_u32(trailer + 8);
+  if (!error)
+    error = get_u32(header) != LOG_MAGIC ||
+            get_u32(header + 4) != LOG_VERSION ||
+            get_u32(trailer + 12) != LOG_INDEX_MAGIC ||
+            index_offset < LOG_HEADER_SIZE ||
+            index_offset + blocks * LOG_INDEX_ENTRY_SIZE + LOG_TRAILER_SIZE !=
+                (uint64_t)size ||
+            fseek(writer->file, (long)index_offset, SEEK_SET) != 0;
+  for (uint64_t b = 0; !error && b < blocks; b++) {
+    uint8_t in[LOG_INDEX_ENTRY_SIZE];
+    error = fread(in, 1, LOG_INDEX_ENTRY_SIZE, writer->file) !=
+            LOG_INDEX_ENTRY_SIZE;
+    if (!error) {
+      LogBlock_t block = {get_u64(in), get_u64(in + 8), get_u32(in + 16),
+                          (int32_t)get_u32(in + 20),
+                          (int32_t)get_u32(in + 24)};
+      error = push_block(writer, &block);
+      writer->games = block.first_game + block.games;
+    }
+  }
+  writer->offset = index_offset;
+  if (!error) error = fseek(writer->file, (long)index_offset, SEEK_SET) != 0;
+  return error;
+}
+
+/**
+ * @brief Decompresses a block into the buffer of the reader, unless it is
+ * already there.
+ *
+ * @param reader The reader.
+ * @param block The index of the block.
+ * @return Error code (`0` on success, `1` if the block is corrupt).
+ */
+static int decode_block(LogReader_t *reader, int block) {
+  int error = 0;
+  if (reader->cached != block) {
+    LogBlock_t entry;
+    log_reader_block(reader, block, &entry);
+    size_t limit = (size_t)(reader->index - reader->data);
+    error = entry.offset > limit - LOG_BLOCK_HEADER_SIZE;
+    const uint8_t *header = reader->data + (error ? 0 : entry.offset);
+    size_t raw_size = error ? 0 : get_u32(header);
+    size_t stored = error ? 0 : get_u32(header + 4);
+    uint32_t method = error ? 0 : get_u32(header + 12);
+    if (!error)
+      error = stored > limit - LOG_BLOCK_HEADER_SIZE - entry.offset ||
+              get_u32(header + 8) != entry.games;
+    if (!error && raw_size > reader->block_capacity) {
+      uint8_t *buffer = realloc(reader->block, raw_size);
+      if (buffer) {
+        reader->block = buffer;
+        reader->block_capacity = raw_size;
+      } else {
+        error++;
+      }
+    }
+    size_t length = 0;
+    if (!error && method == LOG_METHOD_LZ) {
+      error = lz_decompress(header + LOG_BLOCK_HEADER_SIZE, stored,
+                            reader->block, raw_size, &length) ||
+              length != raw_size;
+    } else if (!error && method == LOG_METHOD_STORED && stored == raw_size) {
+      memcpy(reader->block, header + LOG_BLOCK_HEADER_SIZE, stored);
+    } else {
+      error = 1;
+    }
+    reader->cached = error ? -1 : block;
+    reader->block_size = error ? 0 : raw_size;
+    if (!error) reader->blocks_decoded++;
+  }
+  return error;
+}
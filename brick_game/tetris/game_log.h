@@ -0,0 +1,156 @@
+/**
+ * @file game_log.h
+ * @brief Compressed archive of finished games with a random-access index.
+ *
+ * A game is logged as its seed, its final statistics and the inputs given
+ * before each tick, which is enough to replay it exactly. Inputs are stored
+ * as runs of the same action on consecutive ticks, with the gap to the
+ * previous run delta-encoded as a varint.
+ *
+ * The writer appends records to a block and, once the block holds
+ * `LOG_BLOCK_BYTES` or `LOG_BLOCK_GAMES`, compresses it and appends it to the
+ * file. Closing the writer appends an index with the offset, the first game
+ * and the score range of every block, and a fixed-size trailer pointing at
+ * the index. Opening an existing archive for writing continues it in place
+ * of its old index.
+ *
+ * The reader maps the file into memory and only decompresses the block
+ * holding the requested game, or the blocks whose score range meets a
+ * filter. Integers in the headers are little-endian.
+ */
+#ifndef GAME_LOG_H
+#define GAME_LOG_H
+
+#include <stdio.h>
+
+#include "backend.h"
+#include "codec.h"
+
+#define LOG_MAGIC 0x314C4742u
+#define LOG_INDEX_MAGIC 0x58444E49u
+#define LOG_VERSION 1
+#define LOG_HEADER_SIZE 8
+#define LOG_BLOCK_HEADER_SIZE 16
+#define LOG_INDEX_ENTRY_SIZE 28
+#define LOG_TRAILER_SIZE 16
+#define LOG_BLOCK_BYTES (64 * 1024)
+#define LOG_BLOCK_GAMES 1024
+#define LOG_METHOD_STORED 0
+#define LOG_METHOD_LZ 1
+#define LOG_RECORD_FIELDS 8
+
+/**
+ * @brief Run of the same input on `length` consecutive ticks from `tick`.
+ */
+typedef struct {
+  long long int tick;
+  int length;
+  UserAction_t action;
+} InputRun_t;
+
+/**
+ * @brief Logged game.
+ *
+ * `policy` identifies the bot that played it (for example its index in a
+ * tournament). The ticks count from the first tick after the game started.
+ */
+typedef struct {
+  uint64_t seed;
+  int width;
+  int height;
+  int policy;
+  int score;
+  int level;
+  long long int ticks;
+  InputRun_t *runs;
+  int run_count;
+  int run_capacity;
+} GameRecord_t;
+
+/**
+ * @brief Index entry of a block.
+ */
+typedef struct {
+  uint64_t offset;
+  uint64_t first_game;
+  uint32_t games;
+  int32_t min_score;
+  int32_t max_score;
+} LogBlock_t;
+
+/**
+ * @brief Writer appending games to an archive.
+ *
+ * `raw` holds the encoded records of the current block, `current` its index
+ * entry; `blocks` are the entries of the blocks already written.
+ */
+typedef struct {
+  FILE *file;
+  uint8_t *raw;
+  uint8_t *packed;
+  size_t raw_size;
+  size_t raw_capacity;
+  LogBlock_t current;
+  LogBlock_t *blocks;
+  int block_count;
+  int block_capacity;
+  uint64_t games;
+  uint64_t offset;
+} LogWriter_t;
+
+/**
+ * @brief Reader of a memory-mapped archive.
+ *
+ * `block` holds the decompressed block `cached` (`-1` for none).
+ * `blocks_decoded` counts the blocks decompressed since the reader was
+ * opened.
+ */
+typedef struct {
+  const uint8_t *data;
+  size_t size;
+  const uint8_t *index;
+  int block_count;
+  uint64_t games;
+  uint8_t *block;
+  size_t block_size;
+  size_t block_capacity;
+  int cached;
+  long long int blocks_decoded;
+} LogReader_t;
+
+/**
+ * @brief Function called for every game matching a filter.
+ *
+ * @param context The context of the filter.
+ * @param game The number of the game in the archive.
+ * @param record The game; its runs are only valid during the call.
+ * @return `false` to stop the filter.
+ */
+typedef bool (*LogVisitor_t)(void *context, uint64_t game,
+                             const GameRecord_t *record);
+
+void record_init(GameRecord_t *record);
+void record_start(GameRecord_t *record, uint64_t seed, int width, int height,
+                  int policy);
+int record_input(GameRecord_t *record, long long int tick,
+                 UserAction_t action);
+void record_free(GameRecord_t *record);
+size_t record_encode(const GameRecord_t *record, uint8_t *out);
+size_t record_bound(const GameRecord_t *record);
+int record_decode(const uint8_t *in, size_t size, GameRecord_t *record,
+                  size_t *length);
+int replay_record(const GameRecord_t *record, int *score);
+
+int log_writer_open(LogWriter_t *writer, const char *path);
+int log_writer_append(LogWriter_t *writer, const GameRecord_t *record);
+int log_writer_close(LogWriter_t *writer);
+
+int log_reader_open(LogReader_t *reader, const char *path);
+void log_reader_close(LogReader_t *reader);
+void log_reader_block(const LogReader_t *reader, int block, LogBlock_t *entry);
+int log_reader_game(LogReader_t *reader, uint64_t game, GameRecord_t *record);
+long long int log_reader_filter(LogReader_t *reader, int min_score,
+                                int max_score, LogVisitor_t visit,
+                                void *context);
+
+#endif
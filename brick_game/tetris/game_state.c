@@ -0,0 +1,674 @@
+/**
+ * @file game_state.c
+ * @brief Rules of the game on row masks and the compact game state.
+ */
+#include "game_state.h"
+
+/**
+ * @brief Row masks of every tetramino in every orientation.
+ *
+ * Orientation `k` is the spawn shape of `fill_tetramino()` rotated `k` times
+ * by `rotate()`, bit `j` of a row is column `j` of the 5x5 matrix.
+ */
+const uint8_t piece_shapes[PIECE_TYPES][PIECE_ROTATIONS][TETR_SIZE] = {
+    {{0x00, 0x06, 0x06, 0x00, 0x00},
+     {0x00, 0x06, 0x06, 0x00, 0x00},
+     {0x00, 0x06, 0x06, 0x00, 0x00},
+     {0x00, 0x06, 0x06, 0x00, 0x00}},
+    {{0x00, 0x00, 0x0f, 0x00, 0x00},
+     {0x04, 0x04, 0x04, 0x04, 0x00},
+     {0x00, 0x00, 0x0f, 0x00, 0x00},
+     {0x04, 0x04, 0x04, 0x04, 0x00}},
+    {{0x00, 0x04, 0x0e, 0x00, 0x00},
+     {0x00, 0x04, 0x0c, 0x04, 0x00},
+     {0x00, 0x00, 0x0e, 0x04, 0x00},
+     {0x00, 0x04, 0x06, 0x04, 0x00}},
+    {{0x00, 0x02, 0x06, 0x04, 0x00},
+     {0x00, 0x0c, 0x06, 0x00, 0x00},
+     {0x00, 0x02, 0x06, 0x04, 0x00},
+     {0x00, 0x0c, 0x06, 0x00, 0x00}},
+    {{0x00, 0x00, 0x06, 0x0c, 0x00},
+     {0x00, 0x04, 0x06, 0x02, 0x00},
+     {0x00, 0x00, 0x06, 0x0c, 0x00},
+     {0x00, 0x04, 0x06, 0x02, 0x00}},
+    {{0x00, 0x02, 0x0e, 0x00, 0x00},
+     {0x00, 0x0c, 0x04, 0x04, 0x00},
+     {0x00, 0x00, 0x0e, 0x08, 0x00},
+     {0x00, 0x04, 0x04, 0x06, 0x00}},
+    {{0x00, 0x08, 0x0e, 0x00, 0x00},
+     {0x00, 0x04, 0x04, 0x0c, 0x00},
+     {0x00, 0x00, 0x0e, 0x02, 0x00},
+     {0x00, 0x06, 0x04, 0x04, 0x00}}};
+
+/**
+ * @brief Returns the row masks of a tetramino in an orientation.
+ *
+ * @param piece The tetramino type.
+ * @param rotation The orientation.
+ * @return The `TETR_SIZE` row masks of the 5x5 matrix of the tetramino.
+ */
+const uint8_t *piece_shape(int piece, int rotation) {
+  return piece_shapes[piece - 1][rotation];
+}
+
+/**
+ * @brief Checks whether a tetramino collides at the given place.
+ *
+ * The rows of the tetramino are tested top down, each with one mask test
+ * against the walls and one against the field row, and the first collision is
+ * reported.
+ *
+ * @param rows The row masks of the field.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param shape The row masks of the tetramino, see `piece_shape()`.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ * @return `NO_COLLISION`, `FLOOR_COLLISION` if a row of the tetramino is
+ * below the field, or `BASE_COLLISION` for a wall or an occupied cell.
+ */
+int field_collision(const uint64_t *rows, int width, int height,
+                    const uint8_t *shape, int x, int y) {
+  int error = NO_COLLISION;
+  int room = width - x;
+  for (int i = 0; !error && i < TETR_SIZE; i++) {
+    uint64_t mask = shape[i];
+    int row = y + i;
+    if (!mask) {
+    } else if (row >= height) {
+      error = FLOOR_COLLISION;
+    } else if (x < 0) {
+      if (-x >= TETR_SIZE || (mask & (((uint64_t)1 << -x) - 1)) ||
+          (row >= 0 && (rows[row] & (mask >> -x))))
+        error = BASE_COLLISION;
+    } else if (room < TETR_SIZE && (room <= 0 || (mask >> room))) {
+      error = BASE_COLLISION;
+    } else if (row >= 0 && (rows[row] & (mask << x))) {
+      error = BASE_COLLISION;
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Checks where a rotated tetramino collides.
+ *
+ * The collision of the last block in row-major order is reported: within a
+ * row the blocks past the right wall come last, then those on occupied cells,
+ * then those past the left wall.
+ *
+ * @param rows The row masks of the field.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param shape The row masks of the rotated tetramino.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ * @return `NO_COLLISION`, `FLOOR_COLLISION`, `LEFT_COLLISION`,
+ * `RIGHT_COLLISION` or `BASE_COLLISION`.
+ */
+int field_rotate_collision(const uint64_t *rows, int width, int height,
+                           const uint8_t *shape, int x, int y) {
+  int error = NO_COLLISION;
+  int room = width - x;
+  for (int i = 0; i < TETR_SIZE; i++) {
+    uint64_t mask = shape[i];
+    int row = y + i;
+    uint64_t cells = x < 0 ? (-x < TETR_SIZE ? mask >> -x : 0) : mask << x;
+    if (!mask) {
+    } else if (row >= height) {
+      error = FLOOR_COLLISION;
+    } else if (room <= 0 || (room < TETR_SIZE && (mask >> room))) {
+      error = RIGHT_COLLISION;
+    } else if (row >= 0 && (rows[row] & cells)) {
+      error = BASE_COLLISION;
+    } else if (x < 0 &&
+               (-x >= TETR_SIZE || (mask & (((uint64_t)1 << -x) - 1)))) {
+      error = LEFT_COLLISION;
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Finds the column a rotated tetramino fits in with the wall kicks.
+ *
+ * Off a wall the tetramino is pushed back by up to two columns; blocked by
+ * the base it tries one column to the right, one to the left and two to the
+ * right of where it is.
+ *
+ * @param rows The row masks of the field.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param shape The row masks of the rotated tetramino.
+ * @param[in,out] x The column of the tetramino matrix, moved if the rotation
+ * fits.
+ * @param y The row of the tetramino matrix.
+ * @return `NO_COLLISION` if the rotation fits, the collision code otherwise.
+ */
+int field_rotation_kick(const uint64_t *rows, int width, int height,
+                        const uint8_t *shape, int *x, int y) {
+  int column = *x;
+  int error = field_rotate_collision(rows, width, height, shape, column, y);
+
+  if (error == RIGHT_COLLISION) {
+    column--;
+    error = field_rotate_collision(rows, width, height, shape, column, y);
+  }
+  for (int counter = 2; error == LEFT_COLLISION && counter > 0; counter--) {
+    column++;
+    error = field_rotate_collision(rows, width, height, shape, column, y);
+  }
+
+  if (error == BASE_COLLISION) column++;
+  error = field_rotate_collision(rows, width, height, shape, column, y);
+  if (error == BASE_COLLISION) column -= 2;
+  error = field_rotate_collision(rows, width, height, shape, column, y);
+  if (error == BASE_COLLISION) column += 3;
+  error = field_rotate_collision(rows, width, height, shape, column, y);
+
+  if (!error) *x = column;
+  return error;
+}
+
+/**
+ * @brief Marks the cells of a tetramino as occupied.
+ *
+ * Rows of the tetramino above the field are left out.
+ *
+ * @param rows The row masks of the field.
+ * @param height The number of rows.
+ * @param shape The row masks of the tetramino.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ */
+void field_place(uint64_t *rows, int height, const uint8_t *shape, int x,
+                 int y) {
+  for (int i = 0; i < TETR_SIZE; i++) {
+    int row = y + i;
+    if (shape[i] && row >= 0 && row < height)
+      rows[row] |= x >= 0 ? (uint64_t)shape[i] << x
+                          : (uint64_t)shape[i] >> -x;
+  }
+}
+
+/**
+ * @brief Clears all full rows, moving the rows above them down.
+ *
+ * The rows are cleared top down and an empty row comes in at the top for
+ * each of them. When `cells` is given, its rows are moved along with the
+ * masks by `clear_line()`.
+ *
+ * @param rows The row masks of the field.
+ * @param width The number of columns.
+ * @param height The number of rows to look at, from the top.
+ * @param cells The cells of the field, or `NULL`.
+ * @return The number of cleared rows.
+ */
+int field_clear_lines(uint64_t *rows, int width, int height,
+                      uint8_t **cells) {
+  uint64_t full = FULL_ROW_MASK(width);
+  int lines_cleared = 0;
+  for (int y = 0; y < height; y++) {
+    if (rows[y] == full) {
+      memmove(&rows[1], &rows[0], y * sizeof(uint64_t));
+      rows[0] = 0;
+      if (cells) clear_line(cells, y, width);
+      lines_cleared++;
+    }
+  }
+  return lines_cleared;
+}
+
+/**
+ * @brief Draws the next tetramino and its orientation from the generator.
+ *
+ * Mirrors `queue_refill()`: a random type and, unless it is a
+ * square, a random number of rotations.
+ *
+ * @param game A pointer to the game state.
+ */
+static void generate_next_piece(GameState_t *game) {
+  uint64_t random = random_next(&game->rng);
+  game->next_piece = (uint8_t)(1 + random % PIECE_TYPES);
+  game->next_rotation =
+      (uint8_t)((random >> 32) % 4 % piece_period(game->next_piece));
+}
+
+/**
+ * @brief Moves the next tetramino to the spawn position.
+ *
+ * @param game A pointer to the game state.
+ */
+static void spawn_piece(GameState_t *game) {
+  game->piece = game->next_piece;
+  game->rotation = game->next_rotation;
+  generate_next_piece(game);
+  game->x_position = (int8_t)spawn_x_position(game->width);
+  game->y_position = SPAWN_Y_POSITION;
+  game->state = state_collides(game, game->rotation, game->x_position,
+                               game->y_position)
+                    ? Game_over
+                    : Moving;
+}
+
+/**
+ * @brief Places the current tetramino on the field, clears full lines and
+ * spawns the next tetramino.
+ *
+ * @param game A pointer to the game state.
+ * @return The number of cleared lines.
+ */
+static int lock_piece(GameState_t *game) {
+  uint64_t before[TETR_SIZE];
+  for (int i = 0; i < TETR_SIZE; i++) {
+    int y = game->y_position + i;
+    before[i] = y >= 0 && y < game->height ? game->rows[y] : 0;
+  }
+  field_place(game->rows, game->height,
+              piece_shape(game->piece, game->rotation), game->x_position,
+              game->y_position);
+  for (int i = 0; i < TETR_SIZE; i++) {
+    int y = game->y_position + i;
+    if (y >= 0 && y < game->height)
+      for (uint64_t cells = game->rows[y] ^ before[i]; cells;
+           cells &= cells - 1)
+        game->hash ^= zobrist_key(ZOBRIST_CELL(__builtin_ctzll(cells), y));
+  }
+  uint64_t full = FULL_ROW_MASK(game->width);
+  int lowest = game->height - 1;
+  while (lowest >= 0 && game->rows[lowest] != full) lowest--;
+  int lines_cleared = 0;
+  if (lowest >= 0) {
+    game->hash ^= rows_hash(game, 0, lowest);
+    lines_cleared = field_clear_lines(game->rows, game->width, lowest + 1,
+                                      NULL);
+    game->hash ^= rows_hash(game, 0, lowest);
+  }
+  if (lines_cleared) {
+    int score = game->score;
+    update_score(&score, lines_cleared);
+    game->score = score;
+    game->lines += lines_cleared;
+    game->level = (uint8_t)level_for_score(game->score);
+    game->speed = (uint8_t)(game->level - 1);
+  }
+  game->pieces++;
+  spawn_piece(game);
+  return lines_cleared;
+}
+
+/**
+ * @brief Initializes a new game.
+ *
+ * @param game A pointer to the game state.
+ * @param width The number of columns (up to 64).
+ * @param height The number of rows (up to `STATE_MAX_HEIGHT`).
+ * @param seed The seed of the tetramino sequence.
+ * @return Error code (`0` on success).
+ */
+int state_init(GameState_t *game, int width, int height, uint64_t seed) {
+  int error = 0;
+  if (!is_valid_board_size(width, height) || height > STATE_MAX_HEIGHT)
+    error++;
+  if (!error) {
+    memset(game, 0, sizeof(GameState_t));
+    game->width = (uint8_t)width;
+    game->height = (uint8_t)height;
+    game->rng = seed;
+    game->level = 1;
+    generate_next_piece(game);
+    spawn_piece(game);
+  }
+  return error;
+}
+
+/**
+ * @brief Copies a game state.
+ *
+ * @param dest The destination state.
+ * @param src The source state.
+ */
+void state_clone(GameState_t *dest, const GameState_t *src) {
+  memcpy(dest, src, sizeof(GameState_t));
+}
+
+/**
+ * @brief Builds a compact state from a game model.
+ *
+ * Cell colors are reduced to occupancy. The generator is rewound to the
+ * start of the preview queue of the model, so the state draws the same
+ * tetraminos after the next one as the model will.
+ *
+ * @param game A pointer to the compact state to fill.
+ * @param actual_info A pointer to the game model information.
+ * @return Error code (`0` on success).
+ */
+int state_from_model(GameState_t *game, const ModelInfo_t *actual_info) {
+  int error = 0;
+  if (!actual_info->field_base || actual_info->height > STATE_MAX_HEIGHT ||
+      !is_valid_board_size(actual_info->width, actual_info->height))
+    error++;
+  if (!error) {
+    memset(game, 0, sizeof(GameState_t));
+    game->width = (uint8_t)actual_info->width;
+    game->height = (uint8_t)actual_info->height;
+    for (int y = 0; y < actual_info->height; y++)
+      for (int x = 0; x < actual_info->width; x++)
+        if (actual_info->field_base[y][x]) game->rows[y] |= (uint64_t)1 << x;
+    state_rehash(game);
+    game->rng = queue_origin(&actual_info->queue);
+    game->timer = actual_info->timer;
+    game->sim_time = model_time(actual_info);
+    game->score = actual_info->score;
+    game->level = (uint8_t)actual_info->level;
+    game->speed = (uint8_t)actual_info->speed;
+    game->piece = (uint8_t)actual_info->current_type;
+    game->next_piece = (uint8_t)actual_info->next_type;
+    game->next_rotation =
+        (uint8_t)find_rotation(game->next_piece, actual_info->next_tetramino);
+    game->x_position = (int8_t)actual_info->x_position;
+    game->y_position = (int8_t)actual_info->y_position;
+    if (game->piece) {
+      game->rotation = (uint8_t)find_rotation(game->piece,
+                                              actual_info->current_tetramino);
+      game->state = Moving;
+    } else {
+      spawn_piece(game);
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Returns the number of distinct orientations of a tetramino.
+ *
+ * @param piece The tetramino type.
+ * @return `1` for O, `2` for I, S and Z and `4` for the others.
+ */
+int piece_period(int piece) {
+  int period = 4;
+  if (piece == O_tetramino)
+    period = 1;
+  else if (piece == I_tetramino || piece == S_tetramino ||
+           piece == Z_tetramino)
+    period = 2;
+  return period;
+}
+
+/**
+ * @brief Finds the orientation of a tetramino stored as a matrix.
+ *
+ * @param piece The tetramino type.
+ * @param tetramino The 5x5 matrix of the tetramino.
+ * @return The orientation index, `0` if the matrix matches none.
+ */
+int find_rotation(int piece, int **tetramino) {
+  int found = 0;
+  if (piece >= O_tetramino && piece <= L_tetramino && tetramino) {
+    for (int rotation = piece_period(piece) - 1; rotation >= 0; rotation--) {
+      bool is_equal = true;
+      for (int i = 0; is_equal && i < TETR_SIZE; i++) {
+        int mask = 0;
+        for (int j = 0; j < TETR_SIZE; j++)
+          if (tetramino[i][j]) mask |= 1 << j;
+        is_equal = mask == piece_shapes[piece - 1][rotation][i];
+      }
+      if (is_equal) found = rotation;
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief Checks whether the current tetramino collides at the given place.
+ *
+ * @param game A pointer to the game state.
+ * @param rotation The orientation of the tetramino.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ * @return `true` on collision with a wall, the floor or the base.
+ */
+bool state_collides(const GameState_t *game, int rotation, int x, int y) {
+  return field_collision(game->rows, game->width, game->height,
+                         piece_shape(game->piece, rotation), x,
+                         y) != NO_COLLISION;
+}
+
+/**
+ * @brief Checks where the rotated tetramino collides.
+ *
+ * @param game A pointer to the game state.
+ * @param rotation The orientation to check.
+ * @param x The column of the tetramino matrix.
+ * @return One of the collision codes.
+ */
+int state_rotate_collision(const GameState_t *game, int rotation, int x) {
+  return field_rotate_collision(game->rows, game->width, game->height,
+                                piece_shape(game->piece, rotation), x,
+                                game->y_position);
+}
+
+/**
+ * @brief Moves the current tetramino one column to the left if possible.
+ *
+ * @param game A pointer to the game state.
+ * @return `true` if the tetramino moved.
+ */
+bool state_move_left(GameState_t *game) {
+  bool moved = !state_collides(game, game->rotation, game->x_position - 1,
+                               game->y_position);
+  if (moved) game->x_position--;
+  return moved;
+}
+
+/**
+ * @brief Moves the current tetramino one column to the right if possible.
+ *
+ * @param game A pointer to the game state.
+ * @return `true` if the tetramino moved.
+ */
+bool state_move_right(GameState_t *game) {
+  bool moved = !state_collides(game, game->rotation, game->x_position + 1,
+                               game->y_position);
+  if (moved) game->x_position++;
+  return moved;
+}
+
+/**
+ * @brief Rotates the current tetramino with the wall kicks of
+ * `field_rotation_kick()`.
+ *
+ * @param game A pointer to the game state.
+ * @return `true` if the tetramino rotated.
+ */
+bool state_rotate(GameState_t *game) {
+  int rotation = (game->rotation + 1) % piece_period(game->piece);
+  int x = game->x_position;
+  int error =
+      field_rotation_kick(game->rows, game->width, game->height,
+                          piece_shape(game->piece, rotation), &x,
+                          game->y_position);
+  if (!error) {
+    game->rotation = (uint8_t)rotation;
+    game->x_position = (int8_t)x;
+  }
+  return !error;
+}
+
+/**
+ * @brief Moves the current tetramino one row down, or attaches it if it
+ * cannot move.
+ *
+ * @param game A pointer to the game state.
+ * @return `true` if the tetramino was attached.
+ */
+bool state_shift(GameState_t *game) {
+  bool attached = state_collides(game, game->rotation, game->x_position,
+                                 game->y_position + 1);
+  if (attached)
+    lock_piece(game);
+  else
+    game->y_position++;
+  return attached;
+}
+
+/**
+ * @brief Runs one logical tick of the game with the given user action.
+ *
+ * Follows `run_tick()` on a model in the Moving state: the action is applied,
+ * gravity is checked against the simulated clock and the tetramino is shifted
+ * at most once.
+ *
+ * @param game A pointer to the game state.
+ * @param action The user action of this tick (`Up` for none).
+ */
+void state_step(GameState_t *game, UserAction_t action) {
+  if (game->state == Moving) {
+    bool shift = false;
+    game->sim_time += TICK_MS;
+    switch (action) {
+      case Left:
+        state_move_left(game);
+        break;
+      case Right:
+        state_move_right(game);
+        break;
+      case Down:
+        shift = true;
+        break;
+      case Action:
+        state_rotate(game);
+        break;
+      default:
+        break;
+    }
+    if (game->sim_time - game->timer >= gravity_interval(game->speed)) {
+      game->timer = game->sim_time;
+      shift = true;
+    }
+    if (shift) state_shift(game);
+  }
+}
+
+/**
+ * @brief Drops the current tetramino down and attaches it.
+ *
+ * @param game A pointer to the game state.
+ * @return The number of cleared lines.
+ */
+int state_drop(GameState_t *game) {
+  int lines = game->lines;
+  if (game->state == Moving) {
+    while (!state_shift(game)) {
+    }
+  }
+  return game->lines - lines;
+}
+
+/**
+ * @brief Places the current tetramino with the given orientation and column
+ * by dropping it straight down from the spawn row.
+ *
+ * @param game A pointer to the game state.
+ * @param rotation The orientation of the tetramino.
+ * @param x The column of the tetramino matrix.
+ * @return `true` if the placement was possible.
+ */
+bool state_place(GameState_t *game, int rotation, int x) {
+  bool is_ok = game->state == Moving &&
+               rotation < piece_period(game->piece) &&
+               !state_collides(game, rotation, x, game->y_position);
+  if (is_ok) {
+    game->rotation = (uint8_t)rotation;
+    game->x_position = (int8_t)x;
+    state_drop(game);
+  }
+  return is_ok;
+}
+
+/**
+ * @brief Checks whether the game is over.
+ *
+ * @param game A pointer to the game state.
+ * @return `true` if the last spawned tetramino did not fit.
+ */
+bool state_is_over(const GameState_t *game) {
+  return game->state == Game_over;
+}
+
+/**
+ * @brief Returns the occupancy of a field cell.
+ *
+ * @param game A pointer to the game state.
+ * @param x The column.
+ * @param y The row.
+ * @return `1` if the cell is occupied, `0` otherwise.
+ */
+int state_cell(const GameState_t *game, int x, int y) {
+  return (int)(game->rows[y] >> x & 1);
+}
+
+/**
+ * @brief Replaces the tetraminos that are not visible yet with a sequence
+ * drawn from another seed.
+ *
+ * The current tetramino is kept, the next one is drawn again.
+ *
+ * @param game A pointer to the game state.
+ * @param seed The seed of the new sequence.
+ */
+void state_reseed(GameState_t *game, uint64_t seed) {
+  game->rng = seed;
+  generate_next_piece(game);
+}
+
+/**
+ * @brief Returns the Zobrist key of a feature of the game.
+ *
+ * Keys are derived from the index of the feature by the splitmix64
+ * generator, so there is no table to initialize or to share between threads.
+ *
+ * @param index The index of the feature, see `ZOBRIST_CELL()` and
+ * `ZOBRIST_PIECE()`.
+ * @return The 64-bit key.
+ */
+uint64_t zobrist_key(uint64_t index) { return random_next(&index); }
+
+/**
+ * @brief Computes the Zobrist hash of the occupied cells of a range of rows.
+ *
+ * @param game A pointer to the game state.
+ * @param first The first row.
+ * @param last The last row (inclusive).
+ * @return The XOR of the keys of the occupied cells.
+ */
+uint64_t rows_hash(const GameState_t *game, int first, int last) {
+  uint64_t hash = 0;
+  for (int y = first; y <= last; y++)
+    for (uint64_t cells = game->rows[y]; cells; cells &= cells - 1)
+      hash ^= zobrist_key(ZOBRIST_CELL(__builtin_ctzll(cells), y));
+  return hash;
+}
+
+/**
+ * @brief Recomputes the hash of the field after `rows` was edited directly.
+ *
+ * @param game A pointer to the game state.
+ */
+void state_rehash(GameState_t *game) {
+  game->hash = rows_hash(game, 0, game->height - 1);
+}
+
+/**
+ * @brief Returns the Zobrist hash of a position: the field, the current
+ * tetramino with its orientation and position, and the next tetramino.
+ *
+ * @param game A pointer to the game state.
+ * @return The 64-bit hash.
+ */
+uint64_t state_hash(const GameState_t *game) {
+  return game->hash ^
+         zobrist_key(ZOBRIST_PIECE(game->piece, game->rotation,
+                                   game->x_position, game->y_position,
+                                   game->next_piece, game->next_rotation));
+}
@@ -0,0 +1,113 @@
+/**
+ * @file game_state.h
+ * @brief Compact, pointer-free game state for search and rollouts.
+ *
+ * `GameState_t` holds a whole game in a fixed-size, cache-line-aligned block:
+ * the field as 64-bit row masks, the current and next tetramino as type and
+ * orientation, the position, the random generator, score and timer. A state is
+ * cloned and restored with a single `memcpy`.
+ *
+ * The rules of the game live here once, as the `field_*()` functions on row
+ * masks of any height: collisions, rotations with their wall kicks, placing a
+ * tetramino and clearing lines. The `state_*()` functions step a `GameState_t`
+ * through them, and the finite state machine of `ModelInfo_t` reads the rows
+ * of its field it needs as masks (`field_row_masks()`) and runs the same
+ * functions. Only the storage differs: a state holds up to `STATE_MAX_HEIGHT`
+ * rows inline, a model up to `MAX_FIELD_HEIGHT` on the heap.
+ *
+ * The field also carries a Zobrist hash, which is updated when a tetramino is
+ * attached and when lines are cleared.
+ */
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "backend.h"
+
+#define STATE_MAX_HEIGHT 24
+#define PIECE_TYPES 7
+#define PIECE_ROTATIONS 4
+
+/** @brief Mask of the cells of a full row. */
+#define FULL_ROW_MASK(width) \
+  ((width) >= 64 ? UINT64_MAX : ((uint64_t)1 << (width)) - 1)
+
+/** @brief Zobrist index of the cell in column `x` of row `y`. */
+#define ZOBRIST_CELL(x, y) ((uint64_t)(y) * MAX_FIELD_WIDTH + (uint64_t)(x))
+/** @brief Zobrist index of the current and the next tetramino. */
+#define ZOBRIST_PIECE(piece, rotation, x, y, next, next_rotation)            \
+  ((uint64_t)1 << 40 | (uint64_t)(piece) << 32 | (uint64_t)(rotation) << 24 | \
+   (uint64_t)((x) + TETR_SIZE) << 16 | (uint64_t)((y) + TETR_SIZE) << 8 |    \
+   (uint64_t)(next) << 4 | (uint64_t)(next_rotation))
+
+/**
+ * @brief Compact state of one game.
+ *
+ * Bit `x` of `rows[y]` is set when the cell in column `x` of row `y` is
+ * occupied and `hash` is the Zobrist hash of the occupied cells. Code that
+ * edits `rows` directly must call `state_rehash()`. Arrays of states must be
+ * allocated with `aligned_alloc()`.
+ */
+typedef struct {
+  _Alignas(64) uint64_t rows[STATE_MAX_HEIGHT];
+  uint64_t rng;
+  uint64_t hash;
+  long long int timer;
+  long long int sim_time;
+  int32_t score;
+  int32_t lines;
+  int32_t pieces;
+  int8_t x_position;
+  int8_t y_position;
+  uint8_t width;
+  uint8_t height;
+  uint8_t piece;
+  uint8_t rotation;
+  uint8_t next_piece;
+  uint8_t next_rotation;
+  uint8_t level;
+  uint8_t speed;
+  uint8_t state;
+} GameState_t;
+
+_Static_assert(sizeof(GameState_t) <= 256, "GameState_t must stay compact");
+
+extern const uint8_t piece_shapes[PIECE_TYPES][PIECE_ROTATIONS][TETR_SIZE];
+
+const uint8_t *piece_shape(int piece, int rotation);
+int field_collision(const uint64_t *rows, int width, int height,
+                    const uint8_t *shape, int x, int y);
+int field_rotate_collision(const uint64_t *rows, int width, int height,
+                           const uint8_t *shape, int x, int y);
+int field_rotation_kick(const uint64_t *rows, int width, int height,
+                        const uint8_t *shape, int *x, int y);
+void field_place(uint64_t *rows, int height, const uint8_t *shape, int x,
+                 int y);
+int field_clear_lines(uint64_t *rows, int width, int height,
+                      uint8_t **cells);
+
+int state_init(GameState_t *game, int width, int height, uint64_t seed);
+void state_clone(GameState_t *dest, const GameState_t *src);
+int state_from_model(GameState_t *game, const ModelInfo_t *actual_info);
+int piece_period(int piece);
+int find_rotation(int piece, int **tetramino);
+bool state_collides(const GameState_t *game, int rotation, int x, int y);
+int state_rotate_collision(const GameState_t *game, int rotation, int x);
+bool state_move_left(GameState_t *game);
+bool state_move_right(GameState_t *game);
+bool state_rotate(GameState_t *game);
+bool state_shift(GameState_t *game);
+void state_step(GameState_t *game, UserAction_t action);
+int state_drop(GameState_t *game);
+bool state_place(GameState_t *game, int rotation, int x);
+bool state_is_over(const GameState_t *game);
+int state_cell(const GameState_t *game, int x, int y);
+void state_reseed(GameState_t *game, uint64_t seed);
+uint64_t zobrist_key(uint64_t index);
+uint64_t rows_hash(const GameState_t *game, int first, int last);
+void state_rehash(GameState_t *game);
+uint64_t state_hash(const GameState_t *game);
+
+#endif
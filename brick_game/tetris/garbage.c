@@ -0,0 +1,99 @@
+/**
+ * @file garbage.c
+ * @brief Lock-free queue of garbage attacks and their insertion into a field.
+ */
+#include "garbage.h"
+
+#include <string.h>
+
+/**
+ * @brief Empties a garbage queue.
+ *
+ * Must not run concurrently with `garbage_send()` or `garbage_receive()`.
+ *
+ * @param[out] queue The queue.
+ */
+void garbage_init(GarbageQueue_t *queue) {
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+}
+
+/**
+ * @brief Queues an attack; called by the producer only.
+ *
+ * @param queue The queue of the opponent.
+ * @param rows The number of garbage rows (1 to `MAX_GARBAGE_ROWS`).
+ * @param hole The empty column of the rows.
+ * @return `false` if the queue is full and the attack was dropped.
+ */
+bool garbage_send(GarbageQueue_t *queue, int rows, int hole) {
+  unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  bool is_sent = tail - head < GARBAGE_QUEUE_SIZE;
+  if (is_sent) {
+    queue->attacks[tail % GARBAGE_QUEUE_SIZE] =
+        (uint16_t)((rows & 0xff) | (hole & 0xff) << 8);
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+  }
+  return is_sent;
+}
+
+/**
+ * @brief Takes the oldest attack; called by the consumer only.
+ *
+ * @param queue The queue of the engine.
+ * @param[out] rows The number of garbage rows.
+ * @param[out] hole The empty column of the rows.
+ * @return `false` if the queue is empty.
+ */
+bool garbage_receive(GarbageQueue_t *queue, int *rows, int *hole) {
+  unsigned int head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  bool is_received = head != tail;
+  if (is_received) {
+    uint16_t attack = queue->attacks[head % GARBAGE_QUEUE_SIZE];
+    *rows = attack & 0xff;
+    *hole = attack >> 8;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+  }
+  return is_received;
+}
+
+/**
+ * @brief Returns the number of garbage rows sent for a line clear.
+ *
+ * @param lines_cleared The number of lines cleared at once.
+ * @return 0 for a single, 1 for a double, 2 for a triple and 4 for a tetris.
+ */
+int garbage_for_lines(int lines_cleared) {
+  static const int rows[] = {0, 0, 1, 2, MAX_GARBAGE_ROWS};
+  return lines_cleared >= 0 && lines_cleared <= 4 ? rows[lines_cleared]
+                                                  : MAX_GARBAGE_ROWS;
+}
+
+/**
+ * @brief Pushes the field up and fills the bottom rows with garbage.
+ *
+ * The garbage rows are filled with `GARBAGE_CELL` except for the hole.
+ *
+ * @param field The field, one byte per cell with contiguous rows.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param rows The number of garbage rows.
+ * @param hole The empty column of the rows.
+ * @return The number of occupied cells pushed out at the top; any means the
+ * player topped out.
+ */
+int insert_garbage(uint8_t **field, int width, int height, int rows,
+                   int hole) {
+  int lost = 0;
+  if (rows > height) rows = height;
+  for (int y = 0; y < rows; y++)
+    for (int x = 0; x < width; x++) lost += field[y][x] != 0;
+  // field[rows] is past the row pointers when the whole field is replaced:
+  memmove(field[0], field[0] + (size_t)rows * width,
+          (size_t)(height - rows) * width);
+  for (int y = height - rows; y < height; y++)
+    for (int x = 0; x < width; x++) field[y][x] = x == hole ? 0 : GARBAGE_CELL;
+  return lost;
+}
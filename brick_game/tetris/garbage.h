@@ -0,0 +1,42 @@
+/**
+ * @file garbage.h
+ * @brief Garbage rows exchanged between the engines of a versus match.
+ *
+ * Each engine owns the queue of the attacks sent to it. The opponent is the
+ * only producer and the engine itself the only consumer, so the queue is a
+ * single-producer single-consumer ring with one atomic index per side and
+ * needs no lock. Attacks that do not fit into a full queue are dropped.
+ */
+#ifndef GARBAGE_H
+#define GARBAGE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../brick_game.h"
+
+#define GARBAGE_QUEUE_SIZE 64
+#define MAX_GARBAGE_ROWS 4
+
+/**
+ * @brief Ring of attacks, each packed as `rows | hole << 8`.
+ *
+ * `head` is written by the consumer and `tail` by the producer; they sit on
+ * separate cache lines so the two threads do not invalidate each other's line
+ * on every access.
+ */
+typedef struct {
+  _Alignas(64) atomic_uint head;
+  _Alignas(64) atomic_uint tail;
+  _Alignas(64) uint16_t attacks[GARBAGE_QUEUE_SIZE];
+} GarbageQueue_t;
+
+void garbage_init(GarbageQueue_t *queue);
+bool garbage_send(GarbageQueue_t *queue, int rows, int hole);
+bool garbage_receive(GarbageQueue_t *queue, int *rows, int *hole);
+int garbage_for_lines(int lines_cleared);
+int insert_garbage(uint8_t **field, int width, int height, int rows,
+                   int hole);
+
+#endif
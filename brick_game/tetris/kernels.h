@@ -0,0 +1,42 @@
+/**
+ * @file kernels.h
+ * @brief Macro-generated board kernels specialized by field size.
+ *
+ * The rules of the game run on 64-bit row masks (see `field_collision()`).
+ * The kernels here scan rows of the byte cells of a model into such masks.
+ * Every kernel is instantiated with the standard width and with the widest
+ * width of 64 columns as compile-time constants, so loops are fully unrolled
+ * and bounds are folded, and once with the runtime width of the model.
+ */
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdint.h>
+
+#include "backend.h"
+
+#define IS_STANDARD_BOARD(actual_info)   \
+  ((actual_info)->width == FIELD_WIDTH && \
+   (actual_info)->height == FIELD_HEIGHT)
+
+#define IS_WIDE_BOARD(actual_info) ((actual_info)->width == MAX_FIELD_WIDTH)
+
+/**
+ * @brief Defines a kernel reading `count` rows of the field from row `first`
+ * as row masks (see `field_row_masks()`).
+ */
+#define DEFINE_ROW_MASKS_KERNEL(name, WIDTH)                             \
+  static void name(uint8_t **field_base, int width, int height,          \
+                   int first, int count, uint64_t *rows) {               \
+    (void)width;                                                         \
+    for (int i = 0; i < count; i++) {                                    \
+      int y = first + i;                                                 \
+      uint64_t mask = 0;                                                 \
+      if (y >= 0 && y < height)                                          \
+        for (int x = 0; x < (WIDTH); x++)                                \
+          mask |= (uint64_t)(field_base[y][x] != 0) << x;                \
+      rows[i] = mask;                                                    \
+    }                                                                    \
+  }
+
+#endif
@@ -0,0 +1,346 @@
+/**
+ * @file metrics.c
+ * @brief Per-thread engine counters and their Prometheus exporter.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "backend.h"
+
+static void *metrics_exporter(void *data);
+static void wait_interval(MetricsRegistry_t *registry);
+static void write_counter(FILE *stream, const char *name, const char *help,
+                          unsigned long long value);
+static void write_rate(FILE *stream, const char *name, const char *help,
+                       unsigned long long now, unsigned long long before,
+                       double seconds);
+
+/**
+ * @brief Allocates a registry with every shard zeroed and no exporter.
+ *
+ * @param[out] registry The registry.
+ * @return Error code (`0` on success).
+ */
+int metrics_create(MetricsRegistry_t **registry) {
+  *registry = aligned_alloc(_Alignof(MetricsRegistry_t),
+                            sizeof(MetricsRegistry_t));
+  int error = *registry ? 0 : 1;
+  if (!error) {
+    memset(*registry, 0, sizeof(MetricsRegistry_t));
+    (*registry)->interval_ms = DEFAULT_METRICS_INTERVAL_MS;
+    (*registry)->started_us = monotonic_us();
+    (*registry)->last_us = (*registry)->started_us;
+    pthread_mutex_init(&(*registry)->lock, NULL);
+    pthread_cond_init(&(*registry)->wake, NULL);
+  }
+  return error;
+}
+
+/**
+ * @brief Stops the exporter of a registry, frees it and sets its pointer to
+ * `NULL`.
+ *
+ * @param registry The pointer to the registry.
+ */
+void metrics_destroy(MetricsRegistry_t **registry) {
+  if (*registry) {
+    metrics_stop(*registry);
+    pthread_mutex_destroy(&(*registry)->lock);
+    pthread_cond_destroy(&(*registry)->wake);
+    free(*registry);
+    *registry = NULL;
+  }
+}
+
+/**
+ * @brief Returns the shard of a thread.
+ *
+ * @param registry The registry.
+ * @param thread The index of the thread; threads beyond
+ * `MAX_METRICS_SHARDS` would share a shard, so they get none.
+ * @return The shard, or `NULL`.
+ */
+MetricsShard_t *metrics_shard(MetricsRegistry_t *registry, int thread) {
+  return registry && thread >= 0 && thread < MAX_METRICS_SHARDS
+             ? &registry->shards[thread]
+             : NULL;
+}
+
+/**
+ * @brief Counts one logical tick and its wall-clock time.
+ *
+ * @param shard The shard of the calling thread.
+ * @param us The time the tick took in microseconds.
+ */
+void metrics_record_tick(MetricsShard_t *shard, long long int us) {
+  METRIC_ADD(shard->ticks, 1);
+  METRIC_ADD(shard->step_latency[histogram_bucket(us)], 1);
+  METRIC_ADD(shard->step_latency_us, us > 0 ? us : 0);
+}
+
+/**
+ * @brief Sums the shards of a registry.
+ *
+ * The shards are read while their threads keep counting, so the sum is not
+ * taken at one instant; every counter is still exact when it is read.
+ *
+ * @param registry The registry.
+ * @param[out] snapshot The sum.
+ */
+void metrics_collect(MetricsRegistry_t *registry,
+                     MetricsSnapshot_t *snapshot) {
+  *snapshot = (MetricsSnapshot_t){0};
+  for (int s = 0; s < MAX_METRICS_SHARDS; s++) {
+    MetricsShard_t *shard = &registry->shards[s];
+    snapshot->games += atomic_load_explicit(&shard->games,
+                                            memory_order_relaxed);
+    snapshot->pieces += atomic_load_explicit(&shard->pieces,
+                                             memory_order_relaxed);
+    snapshot->ticks += atomic_load_explicit(&shard->ticks,
+                                            memory_order_relaxed);
+    snapshot->frames += atomic_load_explicit(&shard->frames,
+                                             memory_order_relaxed);
+    for (int i = 0; i <= MAX_LINES_AT_ONCE; i++)
+      snapshot->line_clears[i] += atomic_load_explicit(
+          &shard->line_clears[i], memory_order_relaxed);
+    for (int i = 0; i < STATE_COUNT; i++)
+      snapshot->state_steps[i] += atomic_load_explicit(
+          &shard->state_steps[i], memory_order_relaxed);
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+      snapshot->step_latency[i] += atomic_load_explicit(
+          &shard->step_latency[i], memory_order_relaxed);
+    snapshot->step_latency_us += atomic_load_explicit(
+        &shard->step_latency_us, memory_order_relaxed);
+  }
+  snapshot->allocations = matrix_allocations();
+}
+
+/**
+ * @brief Writes a snapshot in the Prometheus text exposition format.
+ *
+ * Totals are counters; the rates are gauges over the time since the previous
+ * snapshot. The step latency is a summary whose quantiles are the upper
+ * bounds of their log2 buckets.
+ *
+ * @param stream The output stream.
+ * @param now The snapshot to write.
+ * @param before The previous snapshot, for the rates.
+ * @param seconds The time between the two snapshots.
+ * @param uptime The time since the registry was created, in seconds.
+ * @return Error code (`0` on success).
+ */
+int metrics_write(FILE *stream, const MetricsSnapshot_t *now,
+                  const MetricsSnapshot_t *before, double seconds,
+                  double uptime) {
+  write_counter(stream, "tetris_games_total", "Games completed.",
+                now->games);
+  write_counter(stream, "tetris_pieces_total", "Tetraminos attached.",
+                now->pieces);
+  write_counter(stream, "tetris_ticks_total", "Logical ticks run.",
+                now->ticks);
+  write_counter(stream, "tetris_frames_total", "Frames rendered.",
+                now->frames);
+  write_rate(stream, "tetris_pieces_per_second",
+             "Tetraminos attached per second since the previous export.",
+             now->pieces, before->pieces, seconds);
+  write_rate(stream, "tetris_frames_per_second",
+             "Frames rendered per second since the previous export.",
+             now->frames, before->frames, seconds);
+  write_rate(stream, "tetris_ticks_per_second",
+             "Logical ticks per second since the previous export.",
+             now->ticks, before->ticks, seconds);
+
+  fprintf(stream,
+          "# HELP tetris_lines_cleared_total Line clears by the number of "
+          "lines cleared at once.\n"
+          "# TYPE tetris_lines_cleared_total counter\n");
+  for (int i = 1; i <= MAX_LINES_AT_ONCE; i++)
+    fprintf(stream, "tetris_lines_cleared_total{size=\"%d\"} %llu\n", i,
+            now->line_clears[i]);
+  fprintf(stream,
+          "# HELP tetris_state_steps_total Steps of the finite state "
+          "machine by the state stepped.\n"
+          "# TYPE tetris_state_steps_total counter\n");
+  for (int i = 0; i < STATE_COUNT; i++)
+    fprintf(stream, "tetris_state_steps_total{state=\"%s\"} %llu\n",
+            state_name(i), now->state_steps[i]);
+
+  fprintf(stream,
+          "# HELP tetris_step_latency_seconds Wall-clock time of one logical "
+          "tick.\n"
+          "# TYPE tetris_step_latency_seconds summary\n");
+  const double quantiles[] = {0.5, 0.99};
+  for (int i = 0; i < 2; i++)
+    fprintf(stream, "tetris_step_latency_seconds{quantile=\"%g\"} %g\n",
+            quantiles[i],
+            histogram_percentile(now->step_latency, quantiles[i]) / 1e6);
+  fprintf(stream, "tetris_step_latency_seconds_sum %g\n",
+          now->step_latency_us / 1e6);
+  fprintf(stream, "tetris_step_latency_seconds_count %llu\n",
+          histogram_total(now->step_latency));
+
+  write_counter(stream, "tetris_matrix_allocations_total",
+                "Matrices allocated by the engine.", now->allocations);
+  fprintf(stream,
+          "# HELP tetris_uptime_seconds Time since the metrics started.\n"
+          "# TYPE tetris_uptime_seconds gauge\n"
+          "tetris_uptime_seconds %.3f\n",
+          uptime);
+  return ferror(stream) ? 1 : 0;
+}
+
+/**
+ * @brief Collects the shards and replaces the metrics file.
+ *
+ * The file is written and synced under a temporary name which is then
+ * renamed over it, so a scraper never reads a partial file.
+ *
+ * @param registry The registry, with its path set.
+ * @return Error code (`0` on success).
+ */
+int metrics_export(MetricsRegistry_t *registry) {
+  char temporary[METRICS_PATH_SIZE + 4];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", registry->path);
+  MetricsSnapshot_t snapshot;
+  long long int now = monotonic_us();
+  metrics_collect(registry, &snapshot);
+  int error = 0;
+  FILE *file = fopen(temporary, "w");
+  if (!file) error++;
+  if (!error)
+    error += metrics_write(file, &snapshot, &registry->last,
+                           (now - registry->last_us) / 1e6,
+                           (now - registry->started_us) / 1e6);
+  if (!error && (fflush(file) || fsync(fileno(file)))) error++;
+  if (file && fclose(file)) error++;
+  if (!error && rename(temporary, registry->path)) error++;
+  if (error) remove(temporary);
+  registry->last = snapshot;
+  registry->last_us = now;
+  registry->exports++;
+  registry->errors += error;
+  return error;
+}
+
+/**
+ * @brief Starts the thread exporting a registry at a fixed interval.
+ *
+ * @param registry The registry, without a running exporter.
+ * @param path The path of the metrics file.
+ * @param interval_ms The time between two exports in milliseconds.
+ * @return Error code (`0` on success, `1` if the path is too long, the
+ * interval is not positive or the thread cannot be started).
+ */
+int metrics_start(MetricsRegistry_t *registry, const char *path,
+                  long long int interval_ms) {
+  int error = !registry->is_running && strlen(path) < METRICS_PATH_SIZE &&
+                      interval_ms > 0
+                  ? 0
+                  : 1;
+  if (!error) {
+    strcpy(registry->path, path);
+    registry->interval_ms = interval_ms;
+    registry->is_stopping = false;
+    if (pthread_create(&registry->thread, NULL, metrics_exporter, registry))
+      error++;
+    else
+      registry->is_running = true;
+  }
+  return error;
+}
+
+/**
+ * @brief Stops the exporter of a registry after a last export.
+ *
+ * @param registry The registry.
+ */
+void metrics_stop(MetricsRegistry_t *registry) {
+  if (registry->is_running) {
+    pthread_mutex_lock(&registry->lock);
+    registry->is_stopping = true;
+    pthread_cond_signal(&registry->wake);
+    pthread_mutex_unlock(&registry->lock);
+    pthread_join(registry->thread, NULL);
+    registry->is_running = false;
+  }
+}
+
+/**
+ * @brief Exports a registry every interval until it stops, and once more
+ * when it does.
+ *
+ * @param data The registry.
+ * @return `NULL`.
+ */
+static void *metrics_exporter(void *data) {
+  MetricsRegistry_t *registry = data;
+  bool is_stopping = false;
+  pthread_mutex_lock(&registry->lock);
+  while (!is_stopping) {
+    wait_interval(registry);
+    is_stopping = registry->is_stopping;
+    pthread_mutex_unlock(&registry->lock);
+    metrics_export(registry);
+    pthread_mutex_lock(&registry->lock);
+  }
+  pthread_mutex_unlock(&registry->lock);
+  return NULL;
+}
+
+/**
+ * @brief Waits one export interval unless the registry is stopped.
+ *
+ * Must be called with the registry locked.
+ *
+ * @param registry The registry.
+ */
+static void wait_interval(MetricsRegistry_t *registry) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += (registry->interval_ms % 1000) * 1000000L;
+  deadline.tv_sec +=
+      registry->interval_ms / 1000 + deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+  int timeout = 0;
+  while (!registry->is_stopping && !timeout)
+    timeout =
+        pthread_cond_timedwait(&registry->wake, &registry->lock, &deadline);
+}
+
+/**
+ * @brief Writes one counter with its help and type lines.
+ *
+ * @param stream The output stream.
+ * @param name The name of the metric.
+ * @param help The description of the metric.
+ * @param value The value.
+ */
+static void write_counter(FILE *stream, const char *name, const char *help,
+                          unsigned long long value) {
+  fprintf(stream, "# HELP %s %s\n# TYPE %s counter\n%s %llu\n", name, help,
+          name, name, value);
+}
+
+/**
+ * @brief Writes the rate of a counter between two snapshots as a gauge.
+ *
+ * @param stream The output stream.
+ * @param name The name of the metric.
+ * @param help The description of the metric.
+ * @param now The counter in the newer snapshot.
+ * @param before The counter in the older snapshot.
+ * @param seconds The time between the snapshots; the rate is `0` if it is
+ * not positive.
+ */
+static void write_rate(FILE *stream, const char *name, const char *help,
+                       unsigned long long now, unsigned long long before,
+                       double seconds) {
+  fprintf(stream, "# HELP %s %s\n# TYPE %s gauge\n%s %.3f\n", name, help,
+          name, name, seconds > 0 ? (now - before) / seconds : 0.0);
+}
@@ -0,0 +1,107 @@
+/**
+ * @file metrics.h
+ * @brief Engine counters exported as a Prometheus text file.
+ *
+ * Every thread running games owns one shard of counters and is its only
+ * writer: a counter is bumped with a relaxed load and store, never with a
+ * locked read-modify-write, and the shards are aligned to cache lines so two
+ * threads never share one. An exporter thread sums the shards with relaxed
+ * loads at a fixed interval and replaces the metrics file atomically
+ * (written to `PATH.tmp`, then renamed), in the text exposition format read
+ * by the node exporter textfile collector.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "stats.h"
+
+#define MAX_METRICS_SHARDS 64
+#define METRICS_PATH_SIZE 256
+#define DEFAULT_METRICS_INTERVAL_MS 1000
+#define MAX_LINES_AT_ONCE 4
+
+/**
+ * @brief Adds to a counter of a shard owned by the calling thread.
+ */
+#define METRIC_ADD(counter, n)                                          \
+  atomic_store_explicit(                                                \
+      &(counter),                                                       \
+      atomic_load_explicit(&(counter), memory_order_relaxed) + (n),     \
+      memory_order_relaxed)
+
+/**
+ * @brief Counters of the games run by one thread.
+ *
+ * `line_clears[n]` counts the clears of `n` lines at once. `step_latency`
+ * is the log2 histogram of the wall-clock time of one logical tick, as in
+ * `EngineStats_t`; `step_latency_us` is its sum.
+ */
+typedef struct MetricsShard_t {
+  _Alignas(64) atomic_ullong games;
+  atomic_ullong pieces;
+  atomic_ullong ticks;
+  atomic_ullong frames;
+  atomic_ullong line_clears[MAX_LINES_AT_ONCE + 1];
+  atomic_ullong state_steps[STATE_COUNT];
+  atomic_ullong step_latency[HISTOGRAM_BUCKETS];
+  atomic_ullong step_latency_us;
+} MetricsShard_t;
+
+/**
+ * @brief Sum of all shards at one moment, with the matrix allocations of
+ * the process.
+ */
+typedef struct {
+  unsigned long long games;
+  unsigned long long pieces;
+  unsigned long long ticks;
+  unsigned long long frames;
+  unsigned long long line_clears[MAX_LINES_AT_ONCE + 1];
+  unsigned long long state_steps[STATE_COUNT];
+  unsigned long long step_latency[HISTOGRAM_BUCKETS];
+  unsigned long long step_latency_us;
+  unsigned long long allocations;
+} MetricsSnapshot_t;
+
+/**
+ * @brief Shards and their exporter.
+ *
+ * `last` is the snapshot of the previous export, taken at `last_us`; the
+ * rates of the next export are computed from it.
+ */
+typedef struct {
+  MetricsShard_t shards[MAX_METRICS_SHARDS];
+  char path[METRICS_PATH_SIZE];
+  long long int interval_ms;
+  long long int started_us;
+  long long int last_us;
+  MetricsSnapshot_t last;
+  long long int exports;
+  int errors;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool is_running;
+  bool is_stopping;
+} MetricsRegistry_t;
+
+int metrics_create(MetricsRegistry_t **registry);
+void metrics_destroy(MetricsRegistry_t **registry);
+MetricsShard_t *metrics_shard(MetricsRegistry_t *registry, int thread);
+void metrics_record_tick(MetricsShard_t *shard, long long int us);
+void metrics_collect(MetricsRegistry_t *registry,
+                     MetricsSnapshot_t *snapshot);
+int metrics_write(FILE *stream, const MetricsSnapshot_t *now,
+                  const MetricsSnapshot_t *before, double seconds,
+                  double uptime);
+int metrics_export(MetricsRegistry_t *registry);
+int metrics_start(MetricsRegistry_t *registry, const char *path,
+                  long long int interval_ms);
+void metrics_stop(MetricsRegistry_t *registry);
+
+#endif
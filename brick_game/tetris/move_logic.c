@@ -2,7 +2,26 @@
  * @file move_logic.c
  * @brief Move logic for Tetris.
  */
+#include <string.h>
+
 #include "backend.h"
+#include "game_state.h"
+#include "metrics.h"
+#include "rewind.h"
+
+/**
+ * @brief Reads a tetramino matrix as row masks.
+ *
+ * @param tetramino The 5x5 matrix of the tetramino.
+ * @param[out] shape The `TETR_SIZE` row masks, as in `piece_shape()`.
+ */
+static void tetramino_shape(int **tetramino, uint8_t *shape) {
+  for (int i = 0; i < TETR_SIZE; i++) {
+    shape[i] = 0;
+    for (int j = 0; j < TETR_SIZE; j++)
+      if (tetramino[i][j]) shape[i] |= (uint8_t)(1u << j);
+  }
+}
 
 /**
  * @brief Moves the current tetramino based on the user input.
@@ -26,7 +45,7 @@ void move_tetramino(ModelInfo_t *actual_info) {
         actual_info->state = Shifting;
         break;
       case Action:
-        if (!is_rotation_blocked()) {
+        if (!is_rotation_blocked(actual_info)) {
           copy_matrix(actual_info->current_tetramino,
                       actual_info->collision_test_tetramino, TETR_SIZE,
                       TETR_SIZE);
@@ -41,9 +60,9 @@ void move_tetramino(ModelInfo_t *actual_info) {
         break;
     }
   }
-  if ((update_timer() - actual_info->timer) >=
-      (700 - (actual_info->speed * 52))) {
-    actual_info->timer = update_timer();
+  long long int now = model_time(actual_info);
+  if ((now - actual_info->timer) >= gravity_interval(actual_info->speed)) {
+    actual_info->timer = now;
     actual_info->state = Shifting;
   }
 }
@@ -80,48 +99,35 @@ void move_right(ModelInfo_t *actual_info) {
  * @brief Checks if a rotation is blocked for the current tetramino.
  *
  * This function checks if rotating the current tetramino will cause a collision
- * and returns an appropriate error code.
+ * and returns an appropriate error code. The rotated tetramino is left in
+ * `collision_test_tetramino` and the wall kicks of `field_rotation_kick()`
+ * move the tetramino if the rotation fits.
  *
+ * @param actual_info A pointer to the ModelInfo_t structure holding the game
+ * state.
  * @return Returns the error code indicating whether rotation is blocked or not.
  */
-int is_rotation_blocked() {
-  ModelInfo_t *actual_info = get_info();
-  int error = NO_COLLISION;
+int is_rotation_blocked(ModelInfo_t *actual_info) {
   copy_matrix(actual_info->collision_test_tetramino,
               actual_info->current_tetramino, TETR_SIZE, TETR_SIZE);
   rotate(actual_info->current_type, &(actual_info->collision_test_tetramino));
-  error = check_rotate_collision(actual_info);
-
-  int origin_x_position = actual_info->x_position;
-
-  if (error == RIGHT_COLLISION && error != BASE_COLLISION) {
-    actual_info->x_position--;
-    error = check_rotate_collision(actual_info);
-  }
-
-  for (int counter = 2; error == LEFT_COLLISION && counter > 0; counter--) {
-    if (error != BASE_COLLISION) {
-      actual_info->x_position++;
-      error = check_rotate_collision(actual_info);
-    }
-  }
-
-  if (error == BASE_COLLISION) actual_info->x_position++;
-  error = check_rotate_collision(actual_info);
-  if (error == BASE_COLLISION) actual_info->x_position -= 2;
-  error = check_rotate_collision(actual_info);
-  if (error == BASE_COLLISION) actual_info->x_position += 3;
-  error = check_rotate_collision(actual_info);
-
-  if (error) actual_info->x_position = origin_x_position;
 
-  return error;
+  uint8_t shape[TETR_SIZE];
+  uint64_t rows[TETR_SIZE];
+  tetramino_shape(actual_info->collision_test_tetramino, shape);
+  field_row_masks(actual_info, actual_info->y_position, TETR_SIZE, rows);
+  return field_rotation_kick(rows, actual_info->width,
+                             actual_info->height - actual_info->y_position,
+                             shape, &actual_info->x_position, 0);
 }
 
 /**
  * @brief Rotates the current tetramino based on its type.
  *        Uses either a left or right rotation depending on the type.
  *
+ * The rotated cells go through a scratch matrix on the stack, so rotating
+ * never allocates.
+ *
  * @param type The type of tetramino to rotate.
  * @param straight A pointer to the current tetramino's matrix.
  */
@@ -148,17 +154,14 @@ void rotate(TetraminoType_t type, int ***straight) {
  * @param straight A pointer to the matrix representing the current tetramino.
  */
 void rotate_left(int ***straight) {
-  int **rotated = NULL;
-  int error = create_matrix(&rotated, TETR_SIZE, TETR_SIZE);
-  if (!error) {
-    for (int i = 0; i < TETR_SIZE; i++) {
-      for (int j = 0; j < TETR_SIZE; j++) {
-        rotated[TETR_SIZE - 1 - j][i] = (*straight)[i][j];
-      }
+  int rotated[TETR_SIZE][TETR_SIZE];
+  for (int i = 0; i < TETR_SIZE; i++) {
+    for (int j = 0; j < TETR_SIZE; j++) {
+      rotated[TETR_SIZE - 1 - j][i] = (*straight)[i][j];
     }
-    copy_matrix(*straight, rotated, TETR_SIZE, TETR_SIZE);
-    remove_matrix(&rotated, TETR_SIZE);
   }
+  for (int i = 0; i < TETR_SIZE; i++)
+    memcpy((*straight)[i], rotated[i], sizeof(rotated[i]));
 }
 
 /**
@@ -167,17 +170,14 @@ void rotate_left(int ***straight) {
  * @param straight A pointer to the matrix representing the current tetramino.
  */
 void rotate_right(int ***straight) {
-  int **rotated = NULL;
-  int error = create_matrix(&rotated, TETR_SIZE, TETR_SIZE);
-  if (!error) {
-    for (int i = 0; i < TETR_SIZE; i++) {
-      for (int j = 0; j < TETR_SIZE; j++) {
-        rotated[j][TETR_SIZE - 1 - i] = (*straight)[i][j];
-      }
+  int rotated[TETR_SIZE][TETR_SIZE];
+  for (int i = 0; i < TETR_SIZE; i++) {
+    for (int j = 0; j < TETR_SIZE; j++) {
+      rotated[j][TETR_SIZE - 1 - i] = (*straight)[i][j];
     }
-    copy_matrix(*straight, rotated, TETR_SIZE, TETR_SIZE);
-    remove_matrix(&rotated, TETR_SIZE);
   }
+  for (int i = 0; i < TETR_SIZE; i++)
+    memcpy((*straight)[i], rotated[i], sizeof(rotated[i]));
 }
 
 /**
@@ -199,12 +199,17 @@ void shift_tetramino(ModelInfo_t *actual_info) {
  * @brief Attaches the current tetramino to the game field and checks for full
  * lines.
  *
+ * In practice mode the game is then snapshotted for rewinding.
+ *
  * @param actual_info A pointer to the game model information.
  */
 void attach_tetramino(ModelInfo_t *actual_info) {
   set_tetramino_on_field(actual_info->field_base, actual_info);
   calculate_lines(actual_info);
   actual_info->state = Spawn;
+  if (actual_info->metrics) METRIC_ADD(actual_info->metrics->pieces, 1);
+  alloc_stats_mark_piece();
+  if (actual_info->rewind) rewind_push(actual_info->rewind, actual_info);
 }
 
 /**
@@ -213,33 +218,21 @@ void attach_tetramino(ModelInfo_t *actual_info) {
  *
  * This function checks if the current tetramino can be moved by
  * analyzing possible collisions with the game field boundaries and other
- * tetraminos. Each block of the tetramino is checked for movement.
+ * tetraminos. The rows of the field under the tetramino are read as row masks
+ * and tested by `field_collision()`, the rules of `GameState_t`.
  *
  * @param actual_info Pointer to the structure containing the current tetramino
  * and game field information.
  * @return Error code
  */
 int is_move_collision(const ModelInfo_t *actual_info) {
-  int error = NO_COLLISION;
-
-  for (int i = 0; i < TETR_SIZE; i++) {
-    for (int j = 0; j < TETR_SIZE; j++) {
-      int x_offset = actual_info->x_position + j;
-      int y_offset = actual_info->y_position + i;
-
-      if (actual_info->current_tetramino[i][j] != 0 && !error) {
-        if (y_offset >= FIELD_HEIGHT) {
-          error = FLOOR_COLLISION;
-        } else if (x_offset < 0) {
-          error = BASE_COLLISION;
-        } else if (y_offset >= 0 &&
-                   actual_info->field_base[y_offset][x_offset] != 0) {
-          error = BASE_COLLISION;
-        }
-      }
-    }
-  }
-  return error;
+  uint8_t shape[TETR_SIZE];
+  uint64_t rows[TETR_SIZE];
+  tetramino_shape(actual_info->current_tetramino, shape);
+  field_row_masks(actual_info, actual_info->y_position, TETR_SIZE, rows);
+  return field_collision(rows, actual_info->width,
+                         actual_info->height - actual_info->y_position, shape,
+                         actual_info->x_position, 0);
 }
 
 /**
@@ -247,7 +240,7 @@ int is_move_collision(const ModelInfo_t *actual_info) {
  *
  * This function checks if the tetramino can be rotated by analyzing possible
  * collisions with other blocks or field boundaries. All blocks of the rotated
- * tetramino are checked for collision.
+ * tetramino are checked for collision by `field_rotate_collision()`.
  *
  * @param actual_info Pointer to the structure containing the current tetramino
  * and game field information.
@@ -258,25 +251,11 @@ int is_move_collision(const ModelInfo_t *actual_info) {
  *         - `RIGHT_COLLISION` — collision with the right boundary.
  */
 int check_rotate_collision(const ModelInfo_t *actual_info) {
-  int error = NO_COLLISION;
-  for (int i = 0; i < TETR_SIZE; i++) {
-    for (int j = 0; j < TETR_SIZE; j++) {
-      int x_offset = actual_info->x_position + j;
-      int y_offset = actual_info->y_position + i;
-
-      if (y_offset >= FIELD_HEIGHT &&
-          actual_info->collision_test_tetramino[i][j] != 0) {
-        error = FLOOR_COLLISION;
-      } else if (actual_info->collision_test_tetramino[i][j] != 0) {
-        if (x_offset < 0) {
-          error = LEFT_COLLISION;
-        } else if (x_offset >= FIELD_WIDTH) {
-          error = RIGHT_COLLISION;
-        } else if (y_offset >= 0 &&
-                   actual_info->field_base[y_offset][x_offset] != 0)
-          error = BASE_COLLISION;
-      }
-    }
-  }
-  return error;
+  uint8_t shape[TETR_SIZE];
+  uint64_t rows[TETR_SIZE];
+  tetramino_shape(actual_info->collision_test_tetramino, shape);
+  field_row_masks(actual_info, actual_info->y_position, TETR_SIZE, rows);
+  return field_rotate_collision(rows, actual_info->width,
+                                actual_info->height - actual_info->y_position,
+                                shape, actual_info->x_position, 0);
 }
@@ -0,0 +1,429 @@
+/**
+ * @file perft.c
+ * @brief Parallel perft counter on the engine's movement rules.
+ */
+#include "perft.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "game_state.h"
+
+/**
+ * @brief Resting position of a tetramino: orientation and matrix position.
+ */
+typedef struct {
+  int rotation;
+  int x_position;
+  int y_position;
+} PerftMove_t;
+
+/**
+ * @brief Parameters and work queue shared by the threads of a run.
+ */
+typedef struct {
+  int width;
+  int height;
+  int depth;
+  TetraminoType_t types[MAX_PERFT_DEPTH];
+  int spawn_rotations[MAX_PERFT_DEPTH];
+  atomic_int next_root;
+} PerftSetup_t;
+
+/**
+ * @brief Private state of a counting thread.
+ *
+ * `boards[level]` is the field before the tetramino of that level is placed
+ * and `moves[level]` its resting positions. The model is a scratch game used
+ * to run the engine's moves.
+ */
+typedef struct {
+  PerftSetup_t *setup;
+  ModelInfo_t model;
+  int **orientations[MAX_PERFT_DEPTH][PIECE_ROTATIONS];
+  uint8_t **boards[MAX_PERFT_DEPTH + 1];
+  PerftMove_t *moves[MAX_PERFT_DEPTH];
+  uint64_t *hashes[MAX_PERFT_DEPTH];
+  uint8_t *visited;
+  int *queue;
+  int states;
+  uint64_t *leaf_hashes;
+  long long int leaf_count;
+  long long int leaf_capacity;
+  long long int leaf_limit;
+  bool leaf_overflow;
+  long long int leaves;
+  long long int nodes;
+} PerftWorker_t;
+
+static int perft_worker_init(PerftWorker_t *worker, PerftSetup_t *setup,
+                             long long int leaf_limit);
+static void perft_worker_free(PerftWorker_t *worker);
+static void *perft_thread(void *data);
+static void perft_node(PerftWorker_t *worker, int level);
+static int perft_expand(PerftWorker_t *worker, int level);
+static void perft_push(PerftWorker_t *worker, int rotation, int x, int y,
+                       int *tail);
+static uint64_t perft_attach(PerftWorker_t *worker, int level, int index);
+static void perft_leaf(PerftWorker_t *worker, uint64_t hash);
+static uint64_t field_hash(uint8_t **field, int width, int height);
+static int compare_hashes(const void *a, const void *b);
+
+/**
+ * @brief Counts the positions reachable by placing `depth` tetraminos of a
+ * seeded sequence on an empty field.
+ *
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @param seed The seed of the tetramino sequence.
+ * @param depth The number of tetraminos to place (1 to `MAX_PERFT_DEPTH`).
+ * @param threads The number of counting threads (1 to `MAX_PERFT_THREADS`).
+ * @param[out] result The counts and the elapsed time.
+ * @return Error code (`0` on success).
+ */
+int perft_run(int width, int height, uint64_t seed, int depth, int threads,
+              PerftResult_t *result) {
+  int error = is_valid_board_size(width, height) && depth >= 1 &&
+                      depth <= MAX_PERFT_DEPTH && threads >= 1 &&
+                      threads <= MAX_PERFT_THREADS
+                  ? 0
+                  : 1;
+  *result = (PerftResult_t){0, 0, 0, 0.0};
+  PerftSetup_t setup = {width, height, depth, {0}, {0}, 0};
+  for (int i = 0; i < depth && i < MAX_PERFT_DEPTH; i++) {
+    uint64_t random = random_next(&seed);
+    setup.types[i] = (TetraminoType_t)(1 + random % PIECE_TYPES);
+    setup.spawn_rotations[i] = (int)((random >> 32) % PIECE_ROTATIONS);
+  }
+  atomic_init(&setup.next_root, 0);
+
+  PerftWorker_t workers[MAX_PERFT_THREADS];
+  pthread_t ids[MAX_PERFT_THREADS];
+  int started = 0;
+  long long int start = monotonic_us();
+  for (int i = 0; !error && i < threads; i++) {
+    error = perft_worker_init(&workers[i], &setup,
+                              PERFT_MAX_LEAF_HASHES / threads);
+    if (!error && pthread_create(&ids[i], NULL, perft_thread, &workers[i]))
+      error = 1;
+    if (error)
+      perft_worker_free(&workers[i]);
+    else
+      started++;
+  }
+  for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+  result->seconds = (double)(monotonic_us() - start) / 1e6;
+
+  long long int total = 0;
+  bool is_overflow = false;
+  for (int i = 0; i < started; i++) {
+    result->leaves += workers[i].leaves;
+    result->nodes += workers[i].nodes;
+    total += workers[i].leaf_count;
+    is_overflow = is_overflow || workers[i].leaf_overflow;
+  }
+  uint64_t *hashes =
+      is_overflow ? NULL : malloc(sizeof(uint64_t) * (size_t)(total + 1));
+  if (hashes) {
+    long long int count = 0;
+    for (int i = 0; i < started; i++) {
+      memcpy(hashes + count, workers[i].leaf_hashes,
+             sizeof(uint64_t) * workers[i].leaf_count);
+      count += workers[i].leaf_count;
+    }
+    qsort(hashes, (size_t)count, sizeof(uint64_t), compare_hashes);
+    for (long long int i = 0; i < count; i++)
+      if (!i || hashes[i] != hashes[i - 1]) result->distinct++;
+    free(hashes);
+  } else {
+    result->distinct = -1;
+  }
+  for (int i = 0; i < started; i++) perft_worker_free(&workers[i]);
+  return error;
+}
+
+/**
+ * @brief Allocates the buffers of a counting thread.
+ *
+ * @param[out] worker The thread state to set up.
+ * @param setup The parameters of the run.
+ * @param leaf_limit The number of leaf hashes the thread may keep.
+ * @return Error code (`0` on success).
+ */
+static int perft_worker_init(PerftWorker_t *worker, PerftSetup_t *setup,
+                             long long int leaf_limit) {
+  memset(worker, 0, sizeof(PerftWorker_t));
+  worker->setup = setup;
+  worker->leaf_limit = leaf_limit;
+  worker->states = PIECE_ROTATIONS * (setup->width + 2 * TETR_SIZE) *
+                   (setup->height - SPAWN_Y_POSITION + 1);
+  ModelInfo_t *model = &worker->model;
+  model->width = setup->width;
+  model->height = setup->height;
+  model->level = 1;
+  int error = create_matrix(&model->collision_test_tetramino, TETR_SIZE,
+                            TETR_SIZE);
+  worker->visited = calloc(worker->states, sizeof(uint8_t));
+  worker->queue = malloc(sizeof(int) * worker->states);
+  if (!worker->visited || !worker->queue) error++;
+  for (int level = 0; level <= setup->depth; level++)
+    error += create_byte_matrix(&worker->boards[level], setup->height,
+                                setup->width);
+  for (int level = 0; level < setup->depth; level++) {
+    worker->moves[level] = malloc(sizeof(PerftMove_t) * worker->states);
+    worker->hashes[level] = malloc(sizeof(uint64_t) * worker->states);
+    if (!worker->moves[level] || !worker->hashes[level]) error++;
+    TetraminoType_t type = setup->types[level];
+    for (int r = 0; !error && r < PIECE_ROTATIONS; r++) {
+      int ***orientation = &worker->orientations[level][r];
+      error += create_matrix(orientation, TETR_SIZE, TETR_SIZE);
+      if (!error) {
+        fill_tetramino(*orientation, type);
+        for (int i = 0; i < setup->spawn_rotations[level] + r; i++)
+          rotate(type, orientation);
+      }
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Frees the buffers of a counting thread.
+ *
+ * @param worker The thread state.
+ */
+static void perft_worker_free(PerftWorker_t *worker) {
+  PerftSetup_t *setup = worker->setup;
+  remove_matrix(&worker->model.collision_test_tetramino, TETR_SIZE);
+  for (int level = 0; level <= setup->depth; level++)
+    remove_byte_matrix(&worker->boards[level]);
+  for (int level = 0; level < setup->depth; level++) {
+    free(worker->moves[level]);
+    free(worker->hashes[level]);
+    for (int r = 0; r < PIECE_ROTATIONS; r++)
+      remove_matrix(&worker->orientations[level][r], TETR_SIZE);
+  }
+  free(worker->visited);
+  free(worker->queue);
+  free(worker->leaf_hashes);
+  memset(worker, 0, sizeof(PerftWorker_t));
+}
+
+/**
+ * @brief Counts the subtrees of the first tetramino taken from the shared
+ * queue.
+ *
+ * Every thread finds the same resting positions of the first tetramino and
+ * skips those that lead to a field seen earlier, then the positions are
+ * handed out one at a time.
+ *
+ * @param data A pointer to the `PerftWorker_t` of the thread.
+ * @return `NULL`.
+ */
+static void *perft_thread(void *data) {
+  PerftWorker_t *worker = data;
+  PerftSetup_t *setup = worker->setup;
+  int count = perft_expand(worker, 0);
+  int distinct = 0;
+  for (int i = 0; i < count; i++) {
+    uint64_t hash = perft_attach(worker, 0, i);
+    bool is_seen = false;
+    for (int j = 0; !is_seen && j < distinct; j++)
+      is_seen = worker->hashes[0][j] == hash;
+    worker->hashes[0][distinct] = hash;
+    if (!is_seen) worker->moves[0][distinct++] = worker->moves[0][i];
+  }
+  int index;
+  while ((index = atomic_fetch_add(&setup->next_root, 1)) < distinct) {
+    uint64_t hash = perft_attach(worker, 0, index);
+    worker->nodes++;
+    if (setup->depth == 1)
+      perft_leaf(worker, hash);
+    else
+      perft_node(worker, 1);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Counts the subtree below a field.
+ *
+ * @param worker The thread state.
+ * @param level The depth of the field in `boards`.
+ */
+static void perft_node(PerftWorker_t *worker, int level) {
+  int count = perft_expand(worker, level);
+  int distinct = 0;
+  for (int i = 0; i < count; i++) {
+    uint64_t hash = perft_attach(worker, level, i);
+    bool is_seen = false;
+    for (int j = 0; !is_seen && j < distinct; j++)
+      is_seen = worker->hashes[level][j] == hash;
+    if (!is_seen) {
+      worker->hashes[level][distinct++] = hash;
+      worker->nodes++;
+      if (level + 1 == worker->setup->depth)
+        perft_leaf(worker, hash);
+      else
+        perft_node(worker, level + 1);
+    }
+  }
+}
+
+/**
+ * @brief Finds every resting position of the tetramino of a level.
+ *
+ * The positions reachable from the spawn position with left and right moves,
+ * rotations and shifts are searched breadth first. A position is resting when
+ * `shift_tetramino()` attaches the tetramino there.
+ *
+ * @param worker The thread state.
+ * @param level The level of the tetramino.
+ * @return The number of resting positions stored in `moves[level]`.
+ */
+static int perft_expand(PerftWorker_t *worker, int level) {
+  ModelInfo_t *model = &worker->model;
+  PerftSetup_t *setup = worker->setup;
+  int columns = setup->width + 2 * TETR_SIZE;
+  int rows = setup->height - SPAWN_Y_POSITION + 1;
+  int period = piece_period(setup->types[level]);
+  int head = 0;
+  int tail = 0;
+  int count = 0;
+  model->field_base = worker->boards[level];
+  model->current_type = setup->types[level];
+  model->current_tetramino = worker->orientations[level][0];
+  model->x_position = spawn_x_position(setup->width);
+  model->y_position = SPAWN_Y_POSITION;
+  memset(worker->visited, 0, worker->states);
+  if (!is_move_collision(model))
+    perft_push(worker, 0, model->x_position, model->y_position, &tail);
+  while (head < tail) {
+    int state = worker->queue[head++];
+    int r = state / rows / columns;
+    int x = state / rows % columns - TETR_SIZE;
+    int y = state % rows + SPAWN_Y_POSITION;
+    model->current_tetramino = worker->orientations[level][r];
+    model->y_position = y;
+    model->x_position = x;
+    move_left(model);
+    if (model->x_position != x)
+      perft_push(worker, r, model->x_position, y, &tail);
+    model->x_position = x;
+    move_right(model);
+    if (model->x_position != x)
+      perft_push(worker, r, model->x_position, y, &tail);
+    model->x_position = x;
+    if (!is_rotation_blocked(model))
+      perft_push(worker, (r + 1) % period, model->x_position, y, &tail);
+    model->x_position = x;
+    shift_tetramino(model);
+    if (model->state == Attaching)
+      worker->moves[level][count++] = (PerftMove_t){r, x, y};
+    else
+      perft_push(worker, r, x, y + 1, &tail);
+  }
+  return count;
+}
+
+/**
+ * @brief Queues a position of the falling tetramino unless it was visited.
+ *
+ * @param worker The thread state.
+ * @param rotation The orientation of the tetramino.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ * @param[in,out] tail The end of the queue.
+ */
+static void perft_push(PerftWorker_t *worker, int rotation, int x, int y,
+                       int *tail) {
+  int columns = worker->setup->width + 2 * TETR_SIZE;
+  int rows = worker->setup->height - SPAWN_Y_POSITION + 1;
+  int column = x + TETR_SIZE;
+  int row = y - SPAWN_Y_POSITION;
+  if (column >= 0 && column < columns && row >= 0 && row < rows) {
+    int state = (rotation * columns + column) * rows + row;
+    if (!worker->visited[state]) {
+      worker->visited[state] = 1;
+      worker->queue[(*tail)++] = state;
+    }
+  }
+}
+
+/**
+ * @brief Attaches the tetramino of a level at one of its resting positions.
+ *
+ * The result is written to `boards[level + 1]`.
+ *
+ * @param worker The thread state.
+ * @param level The level of the tetramino.
+ * @param index The index of the resting position in `moves[level]`.
+ * @return The hash of the resulting field.
+ */
+static uint64_t perft_attach(PerftWorker_t *worker, int level, int index) {
+  ModelInfo_t *model = &worker->model;
+  const PerftMove_t *move = &worker->moves[level][index];
+  memcpy(worker->boards[level + 1][0], worker->boards[level][0],
+         (size_t)model->width * model->height);
+  model->field_base = worker->boards[level + 1];
+  model->current_type = worker->setup->types[level];
+  model->current_tetramino = worker->orientations[level][move->rotation];
+  model->x_position = move->x_position;
+  model->y_position = move->y_position;
+  attach_tetramino(model);
+  return field_hash(model->field_base, model->width, model->height);
+}
+
+/**
+ * @brief Counts a leaf and keeps its hash for the distinct count.
+ *
+ * @param worker The thread state.
+ * @param hash The hash of the leaf field.
+ */
+static void perft_leaf(PerftWorker_t *worker, uint64_t hash) {
+  worker->leaves++;
+  if (worker->leaf_count == worker->leaf_capacity && !worker->leaf_overflow) {
+    long long int capacity =
+        worker->leaf_capacity ? worker->leaf_capacity * 2 : 4096;
+    uint64_t *hashes =
+        capacity <= worker->leaf_limit
+            ? realloc(worker->leaf_hashes, sizeof(uint64_t) * capacity)
+            : NULL;
+    if (hashes) {
+      worker->leaf_hashes = hashes;
+      worker->leaf_capacity = capacity;
+    } else {
+      worker->leaf_overflow = true;
+    }
+  }
+  if (!worker->leaf_overflow) worker->leaf_hashes[worker->leaf_count++] = hash;
+}
+
+/**
+ * @brief Computes the Zobrist hash of the occupied cells of a field.
+ *
+ * @param field The field.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @return The hash, equal to `GameState_t.hash` for the same cells.
+ */
+static uint64_t field_hash(uint8_t **field, int width, int height) {
+  uint64_t hash = 0;
+  for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+      if (field[y][x]) hash ^= zobrist_key(ZOBRIST_CELL(x, y));
+  return hash;
+}
+
+/**
+ * @brief Orders two hashes for `qsort()`.
+ *
+ * @param a A pointer to the first hash.
+ * @param b A pointer to the second hash.
+ * @return A negative, zero or positive value.
+ */
+static int compare_hashes(const void *a, const void *b) {
+  uint64_t first = *(const uint64_t *)a;
+  uint64_t second = *(const uint64_t *)b;
+  return (first > second) - (first < second);
+}
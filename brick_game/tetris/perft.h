@@ -0,0 +1,39 @@
+/**
+ * @file perft.h
+ * @brief Perft-style counter of the positions reachable by placing pieces.
+ *
+ * Starting from an empty field and a seeded tetramino sequence, every
+ * position where a tetramino can come to rest is found by searching the
+ * moves of the engine (`move_left()`, `move_right()`, `is_rotation_blocked()`
+ * and `shift_tetramino()`) from the spawn position. Each distinct field after
+ * attaching is expanded with the next tetramino, down to the requested depth.
+ * Subtrees of the first tetramino are counted in parallel.
+ */
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "backend.h"
+
+#define MAX_PERFT_DEPTH 8
+#define MAX_PERFT_THREADS 64
+#define PERFT_MAX_LEAF_HASHES (1 << 25)
+
+/**
+ * @brief Counts of a perft run.
+ *
+ * `leaves` is the perft count: the fields after `depth` placements, where
+ * every field expands into its distinct successors. `distinct` counts the
+ * different fields among the leaves, or is `-1` if there were more than
+ * `PERFT_MAX_LEAF_HASHES` of them. `nodes` counts the fields at all depths.
+ */
+typedef struct {
+  long long int leaves;
+  long long int distinct;
+  long long int nodes;
+  double seconds;
+} PerftResult_t;
+
+int perft_run(int width, int height, uint64_t seed, int depth, int threads,
+              PerftResult_t *result);
+
+#endif
@@ -0,0 +1,114 @@
+/**
+ * @file piece_queue.c
+ * @brief Preview queue of upcoming tetraminos for Tetris.
+ *
+ * The queue is a fixed ring buffer of piece ids and orientations. It is
+ * refilled from the generator `PIECE_QUEUE_BATCH` pieces at a time and only
+ * the piece that becomes the next tetramino is drawn into a matrix.
+ */
+#include "backend.h"
+
+/**
+ * @brief Appends a batch of random tetraminos to the queue if it runs low.
+ *
+ * Like the original generator, every piece gets a random type and, unless it
+ * is a square, a random number of rotations. Both are drawn from the
+ * generator of the queue.
+ *
+ * @param queue A pointer to the preview queue.
+ */
+void queue_refill(PieceQueue_t *queue) {
+  if (queue->count < PIECE_QUEUE_BATCH) {
+    for (int i = 0; i < PIECE_QUEUE_BATCH; i++) {
+      int tail = (queue->head + queue->count) & (PIECE_QUEUE_SIZE - 1);
+      uint64_t random = random_next(&queue->rng);
+      TetraminoType_t type = 1 + (TetraminoType_t)(random % 7);
+      queue->types[tail] = (uint8_t)type;
+      queue->rotations[tail] =
+          (uint8_t)(type != O_tetramino ? (random >> 32) % 4 : 0);
+      queue->count++;
+    }
+  }
+}
+
+/**
+ * @brief Takes the first tetramino out of the queue and draws it into a
+ * matrix.
+ *
+ * @param queue A pointer to the preview queue.
+ * @param[out] next A 5x5 matrix receiving the shape of the tetramino.
+ * @return The type of the tetramino.
+ */
+TetraminoType_t queue_pop(PieceQueue_t *queue, int **next) {
+  queue_refill(queue);
+  TetraminoType_t type = queue->types[queue->head];
+  int rotations = queue->rotations[queue->head];
+  queue->head = (queue->head + 1) & (PIECE_QUEUE_SIZE - 1);
+  queue->count--;
+  reset_matrix(next, TETR_SIZE, TETR_SIZE);
+  fill_tetramino(next, type);
+  while (rotations--) rotate(type, &next);
+  return type;
+}
+
+/**
+ * @brief Returns the type of a queued tetramino without taking it out.
+ *
+ * @param queue A pointer to the preview queue.
+ * @param index The position in the queue (`0` is the first one).
+ * @return The type of the tetramino, or `0` if the queue is shorter.
+ */
+int queue_peek(const PieceQueue_t *queue, int index) {
+  return index < queue->count
+             ? queue->types[(queue->head + index) & (PIECE_QUEUE_SIZE - 1)]
+             : 0;
+}
+
+/**
+ * @brief Returns the generator state the queued tetraminos were drawn from.
+ *
+ * `random_next()` advances its state by `RANDOM_STEP`, so stepping back once
+ * per queued tetramino gives a state whose draws are the queued tetraminos
+ * followed by the ones the queue will draw later.
+ *
+ * @param queue A pointer to the preview queue.
+ * @return The state of the generator.
+ */
+uint64_t queue_origin(const PieceQueue_t *queue) {
+  return queue->rng - (uint64_t)queue->count * RANDOM_STEP;
+}
+
+/**
+ * @brief Sets the number of upcoming tetraminos shown to the frontend.
+ *
+ * The depth does not change the order of the pieces, only how many of them
+ * are exposed.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param depth The preview depth (`MIN_PREVIEW_DEPTH` to `MAX_PREVIEW_DEPTH`).
+ * @return Error code (`0` on success, the depth is left unchanged if it is
+ * invalid).
+ */
+int set_preview_depth(ModelInfo_t *actual_info, int depth) {
+  int error =
+      depth >= MIN_PREVIEW_DEPTH && depth <= MAX_PREVIEW_DEPTH ? 0 : 1;
+  if (!error) actual_info->preview_depth = depth;
+  return error;
+}
+
+/**
+ * @brief Copies the ids of the upcoming tetraminos, starting with the next
+ * one.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param[out] preview An array of `MAX_PREVIEW_DEPTH` ids; the entries past
+ * the preview depth are set to `0`.
+ * @return The preview depth.
+ */
+int fill_preview(ModelInfo_t *actual_info, int *preview) {
+  for (int i = 0; i < MAX_PREVIEW_DEPTH; i++)
+    preview[i] = i >= actual_info->preview_depth ? 0
+                 : i ? queue_peek(&actual_info->queue, i - 1)
+                     : (int)actual_info->next_type;
+  return actual_info->preview_depth;
+}
@@ -0,0 +1,136 @@
+/**
+ * @file planner.c
+ * @brief Monte Carlo rollout planner.
+ */
+#include "planner.h"
+
+static void rollout_task(void *context, int task, int worker);
+
+/**
+ * @brief Sets up a planner and starts its threads.
+ *
+ * @param[out] planner The planner to set up.
+ * @param config The settings; the number of threads counts the caller.
+ * @return Error code (`0` on success).
+ */
+int planner_init(Planner_t *planner, const PlannerConfig_t *config) {
+  int error = config->horizon >= 1 && config->horizon <= MAX_ROLLOUT_HORIZON &&
+                      config->rollouts_per_task >= 1 &&
+                      config->budget_us >= 0
+                  ? 0
+                  : 1;
+  planner->config = *config;
+  planner->count = 0;
+  planner->rollouts = 0;
+  planner->candidates = NULL;
+  planner->pool.threads = 0;
+  if (!error) {
+    planner->candidates = aligned_alloc(_Alignof(GameState_t),
+                                        sizeof(GameState_t) * MAX_PLACEMENTS);
+    if (!planner->candidates) error++;
+  }
+  if (!error) error = pool_init(&planner->pool, config->threads);
+  if (error) planner_free(planner);
+  return error;
+}
+
+/**
+ * @brief Stops the threads of a planner and frees its buffers.
+ *
+ * @param planner The planner.
+ */
+void planner_free(Planner_t *planner) {
+  pool_free(&planner->pool);
+  free(planner->candidates);
+  planner->candidates = NULL;
+}
+
+/**
+ * @brief Chooses the placement of the current tetramino with the best mean
+ * rollout outcome.
+ *
+ * Rounds of rollouts, one task per candidate placement, run until the time
+ * budget is spent; the last round may overrun it by the length of a round.
+ * Every candidate of a round is played against the same random sequences,
+ * so the candidates are compared on equal terms.
+ *
+ * @param planner The planner.
+ * @param game A pointer to the game state.
+ * @param[out] best The chosen placement.
+ * @return `false` if the tetramino cannot be placed.
+ */
+bool planner_choose(Planner_t *planner, const GameState_t *game,
+                    Placement_t *best) {
+  planner->count = enumerate_placements(game, planner->placements);
+  planner->base_lines = game->lines;
+  for (int i = 0; i < planner->count; i++) {
+    state_clone(&planner->candidates[i], game);
+    state_place(&planner->candidates[i], planner->placements[i].rotation,
+                planner->placements[i].x_position);
+    planner->sums[i] = 0;
+    planner->counts[i] = 0;
+  }
+  planner->deadline_us = monotonic_us() + planner->config.budget_us;
+  bool is_running = planner->count > 0;
+  while (is_running) {
+    planner->round_seed = random_next(&planner->config.seed);
+    pool_run(&planner->pool, rollout_task, planner, planner->count);
+    for (int i = 0; i < planner->count; i++) {
+      planner->sums[i] += planner->task_sums[i];
+      planner->counts[i] += planner->task_counts[i];
+      planner->rollouts += planner->task_counts[i];
+    }
+    is_running = planner->config.budget_us > 0 &&
+                 monotonic_us() < planner->deadline_us;
+  }
+  double best_score = 0;
+  for (int i = 0; i < planner->count; i++) {
+    double score = planner->sums[i] / (double)planner->counts[i];
+    if (i == 0 || score > best_score) {
+      best_score = score;
+      *best = planner->placements[i];
+    }
+  }
+  return planner->count > 0;
+}
+
+/**
+ * @brief Plays a few tetraminos of a random sequence with the greedy policy.
+ *
+ * @param start The state after the candidate placement.
+ * @param horizon The number of tetraminos to play.
+ * @param seed The seed of the tetraminos that are not visible yet.
+ * @param base_lines The cleared lines before the candidate placement.
+ * @return The lines cleared since `base_lines` and the features of the
+ * final field, weighted like in `evaluate_placement()`, or
+ * `GAME_OVER_OUTCOME`.
+ */
+double rollout(const GameState_t *start, int horizon, uint64_t seed,
+               int base_lines) {
+  GameState_t game;
+  state_clone(&game, start);
+  if (!state_is_over(&game)) state_reseed(&game, seed);
+  for (int i = 0; i < horizon && !state_is_over(&game); i++)
+    autoplay_step(&game);
+  return state_is_over(&game)
+             ? GAME_OVER_OUTCOME
+             : evaluate_placement(&game, game.lines - base_lines);
+}
+
+/**
+ * @brief Runs the rollouts of one candidate placement in a round.
+ *
+ * @param context A pointer to the planner.
+ * @param task The index of the candidate.
+ * @param worker The index of the thread (unused).
+ */
+static void rollout_task(void *context, int task, int worker) {
+  (void)worker;
+  Planner_t *planner = context;
+  double sum = 0;
+  for (int i = 0; i < planner->config.rollouts_per_task; i++)
+    sum += rollout(&planner->candidates[task], planner->config.horizon,
+                   planner->round_seed + (uint64_t)i, planner->base_lines);
+  planner->task_sums[task] = sum;
+  planner->task_counts[task] = planner->config.rollouts_per_task;
+}
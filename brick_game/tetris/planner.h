@@ -0,0 +1,67 @@
+/**
+ * @file planner.h
+ * @brief Monte Carlo rollout planner on the compact game state.
+ *
+ * Every placement of the current tetramino is tried on a clone of the state.
+ * From each result, rollouts replace the tetraminos that are not visible yet
+ * with random ones and play a few of them with the greedy policy. The
+ * placement with the best mean outcome is chosen. Rollouts run in rounds on
+ * a work-stealing pool until the time budget of the move is spent.
+ */
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "autoplay.h"
+#include "work_pool.h"
+
+#define DEFAULT_ROLLOUT_HORIZON 3
+#define DEFAULT_ROLLOUTS_PER_TASK 2
+#define DEFAULT_PLANNER_BUDGET_US 20000
+#define MAX_ROLLOUT_HORIZON 16
+#define GAME_OVER_OUTCOME -1000.0
+
+/**
+ * @brief Settings of the planner.
+ *
+ * `budget_us` is the time per move in microseconds. With a budget of `0` a
+ * single round is run, which makes the choice reproducible.
+ */
+typedef struct {
+  int threads;
+  int horizon;
+  int rollouts_per_task;
+  long long int budget_us;
+  uint64_t seed;
+} PlannerConfig_t;
+
+/**
+ * @brief Planner with its thread pool and the buffers of the current move.
+ *
+ * `sums` and `counts` hold the outcomes of the candidates, `task_sums` and
+ * `task_counts` those of the tasks of a round. `rollouts` counts all rollouts
+ * since the planner was created.
+ */
+typedef struct {
+  PlannerConfig_t config;
+  WorkPool_t pool;
+  GameState_t *candidates;
+  Placement_t placements[MAX_PLACEMENTS];
+  int count;
+  double sums[MAX_PLACEMENTS];
+  long long int counts[MAX_PLACEMENTS];
+  double task_sums[MAX_PLACEMENTS];
+  int task_counts[MAX_PLACEMENTS];
+  int base_lines;
+  uint64_t round_seed;
+  long long int deadline_us;
+  long long int rollouts;
+} Planner_t;
+
+int planner_init(Planner_t *planner, const PlannerConfig_t *config);
+void planner_free(Planner_t *planner);
+bool planner_choose(Planner_t *planner, const GameState_t *game,
+                    Placement_t *best);
+double rollout(const GameState_t *start, int horizon, uint64_t seed,
+               int base_lines);
+
+#endif
@@ -0,0 +1,341 @@
+/**
+ * @file rewind.c
+ * @brief Rewind ring of compact snapshots.
+ */
+#include "rewind.h"
+
+#include <string.h>
+
+#include "codec.h"
+
+static RewindSnapshot_t *snapshot_at(RewindRing_t *ring, int index);
+static void drop_oldest(RewindRing_t *ring);
+static size_t delta_size(const RewindRing_t *ring,
+                         const ModelInfo_t *actual_info);
+static bool reserve_delta(RewindRing_t *ring, size_t size, size_t *start);
+static void write_delta(RewindRing_t *ring, const ModelInfo_t *actual_info,
+                        uint8_t *out);
+static void apply_delta(RewindRing_t *ring, const RewindSnapshot_t *snapshot);
+static bool is_row_changed(const RewindRing_t *ring,
+                           const ModelInfo_t *actual_info, int row);
+
+/**
+ * @brief Allocates an empty rewind ring for a field size.
+ *
+ * @param[out] ring The ring.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @param window_ms How far back snapshots are kept, in milliseconds of game
+ * time.
+ * @return Error code (`0` on success).
+ */
+int rewind_create(RewindRing_t **ring, int width, int height,
+                  long long int window_ms) {
+  int error = is_valid_board_size(width, height) && window_ms > 0 ? 0 : 1;
+  *ring = NULL;
+  if (!error) {
+    size_t size = sizeof(RewindRing_t) + (size_t)width * height;
+    *ring = malloc(size);
+    if (!*ring) error++;
+    if (!error) ALLOC_COUNT(Model_site, size);
+  }
+  if (!error) {
+    (*ring)->width = width;
+    (*ring)->height = height;
+    (*ring)->window_ms = window_ms;
+    rewind_clear(*ring);
+  }
+  return error;
+}
+
+/**
+ * @brief Frees a rewind ring and sets its pointer to `NULL`.
+ *
+ * @param ring The pointer to the ring.
+ */
+void rewind_destroy(RewindRing_t **ring) {
+  if (*ring) FREE_COUNT(Model_site);
+  free(*ring);
+  *ring = NULL;
+}
+
+/**
+ * @brief Drops every snapshot of a ring.
+ *
+ * @param ring The ring.
+ */
+void rewind_clear(RewindRing_t *ring) {
+  ring->first = 0;
+  ring->count = 0;
+  ring->head = 0;
+  ring->taken = 0;
+  ring->dropped = 0;
+}
+
+/**
+ * @brief Takes a snapshot of a game about to spawn its next tetramino.
+ *
+ * The rows of the field that changed since the previous snapshot are stored
+ * as its delta, then the field becomes the base of the new snapshot.
+ *
+ * @param ring The ring.
+ * @param actual_info A pointer to the game model information.
+ * @return Error code (`0` on success, `1` if the field size differs from
+ * the ring).
+ */
+int rewind_push(RewindRing_t *ring, const ModelInfo_t *actual_info) {
+  int error = actual_info->width == ring->width &&
+                      actual_info->height == ring->height
+                  ? 0
+                  : 1;
+  if (!error && ring->count) {
+    size_t size = delta_size(ring, actual_info), start = 0;
+    RewindSnapshot_t *newest = snapshot_at(ring, ring->count - 1);
+    if (reserve_delta(ring, size, &start)) {
+      write_delta(ring, actual_info, ring->bytes + start);
+      newest->delta_offset = (uint32_t)start;
+      newest->delta_size = (uint32_t)size;
+    } else {
+      // the delta cannot be stored, so no snapshot before this one is
+      // reachable:
+      while (ring->count) drop_oldest(ring);
+    }
+  }
+  if (!error) {
+    if (ring->count == REWIND_SNAPSHOTS) drop_oldest(ring);
+    RewindSnapshot_t *snapshot = snapshot_at(ring, ring->count);
+    ring->count++;
+    ring->taken++;
+    *snapshot = (RewindSnapshot_t){0};
+    snapshot->queue = actual_info->queue;
+    snapshot->sim_time = model_time(actual_info);
+    snapshot->score = actual_info->score;
+    snapshot->level = (int16_t)actual_info->level;
+    snapshot->speed = (int16_t)actual_info->speed;
+    snapshot->next_type = (uint8_t)actual_info->next_type;
+    for (int y = 0; y < TETR_SIZE; y++)
+      for (int x = 0; x < TETR_SIZE; x++)
+        if (actual_info->next_tetramino[y][x])
+          snapshot->next_cells |= 1u << (y * TETR_SIZE + x);
+    memcpy(ring->base, actual_info->field_base[0],
+           (size_t)ring->width * ring->height);
+    long long int oldest = snapshot->sim_time - ring->window_ms;
+    while (ring->count > 1 && snapshot_at(ring, 0)->sim_time < oldest)
+      drop_oldest(ring);
+  }
+  return error;
+}
+
+/**
+ * @brief Restores a game to a snapshot and drops the snapshots after it.
+ *
+ * The game resumes with the tetramino of the snapshot about to spawn; the
+ * game time keeps running.
+ *
+ * @param ring The ring.
+ * @param actual_info A pointer to the game model information.
+ * @param pieces How many attached tetraminos to take back: `0` restarts the
+ * current tetramino, `1` the one before it, and so on.
+ * @return Error code (`0` on success, `1` if the ring holds no snapshot that
+ * far back or the field size differs).
+ */
+int rewind_restore(RewindRing_t *ring, ModelInfo_t *actual_info, int pieces) {
+  int error = pieces >= 0 && pieces < ring->count &&
+                      actual_info->width == ring->width &&
+                      actual_info->height == ring->height
+                  ? 0
+                  : 1;
+  if (!error) {
+    int target = ring->count - 1 - pieces;
+    for (int i = ring->count - 2; i >= target; i--)
+      apply_delta(ring, snapshot_at(ring, i));
+    RewindSnapshot_t *snapshot = snapshot_at(ring, target);
+    if (pieces) ring->head = snapshot->delta_offset;
+    snapshot->delta_size = 0;
+    ring->count = target + 1;
+    memcpy(actual_info->field_base[0], ring->base,
+           (size_t)ring->width * ring->height);
+    for (int y = 0; y < TETR_SIZE; y++)
+      for (int x = 0; x < TETR_SIZE; x++)
+        actual_info->next_tetramino[y][x] =
+            snapshot->next_cells >> (y * TETR_SIZE + x) & 1
+                ? snapshot->next_type
+                : 0;
+    actual_info->queue = snapshot->queue;
+    actual_info->next_type = (TetraminoType_t)snapshot->next_type;
+    actual_info->score = snapshot->score;
+    actual_info->level = snapshot->level;
+    actual_info->speed = snapshot->speed;
+    actual_info->state = Spawn;
+    actual_info->pause = 0;
+    actual_info->hold = false;
+    actual_info->timer = model_time(actual_info);
+  }
+  return error;
+}
+
+/**
+ * @brief Returns the memory the snapshots of a ring take: their fixed-size
+ * records and their deltas.
+ *
+ * @param ring The ring.
+ * @return The size in bytes.
+ */
+size_t rewind_bytes_used(const RewindRing_t *ring) {
+  size_t bytes = sizeof(RewindSnapshot_t) * ring->count;
+  for (int i = 0; i < ring->count; i++)
+    bytes += ring->snapshots[(ring->first + i) % REWIND_SNAPSHOTS].delta_size;
+  return bytes;
+}
+
+/**
+ * @brief Returns a snapshot by its age.
+ *
+ * @param ring The ring.
+ * @param index The position from the oldest snapshot (`0`).
+ * @return The snapshot.
+ */
+static RewindSnapshot_t *snapshot_at(RewindRing_t *ring, int index) {
+  return &ring->snapshots[(ring->first + index) % REWIND_SNAPSHOTS];
+}
+
+/**
+ * @brief Drops the oldest snapshot of a ring.
+ *
+ * @param ring The ring, not empty.
+ */
+static void drop_oldest(RewindRing_t *ring) {
+  ring->first = (ring->first + 1) % REWIND_SNAPSHOTS;
+  ring->count--;
+  ring->dropped++;
+}
+
+/**
+ * @brief Returns the size of the delta from the field of a game back to the
+ * base of a ring.
+ *
+ * A delta is the varint number of changed rows, then for every changed row
+ * the varint gap from the previous one and its cells packed two per byte.
+ *
+ * @param ring The ring.
+ * @param actual_info A pointer to the game model information.
+ * @return The size in bytes, at least `1`.
+ */
+static size_t delta_size(const RewindRing_t *ring,
+                         const ModelInfo_t *actual_info) {
+  uint8_t varint[VARINT_MAX_BYTES];
+  size_t row_bytes = (size_t)(ring->width + 1) / 2, size = 0;
+  int rows = 0, previous = -1;
+  for (int y = 0; y < ring->height; y++) {
+    if (is_row_changed(ring, actual_info, y)) {
+      size += varint_put(varint, (uint64_t)(y - previous - 1)) + row_bytes;
+      previous = y;
+      rows++;
+    }
+  }
+  return size + varint_put(varint, (uint64_t)rows);
+}
+
+/**
+ * @brief Finds room for a delta in the byte ring, dropping the oldest
+ * snapshots if needed.
+ *
+ * Deltas are never split: one that does not fit before the end of the bytes
+ * starts again from the beginning.
+ *
+ * @param ring The ring.
+ * @param size The size of the delta.
+ * @param[out] start The offset of the delta.
+ * @return `false` if the delta is larger than the whole byte ring.
+ */
+static bool reserve_delta(RewindRing_t *ring, size_t size, size_t *start) {
+  bool is_reserved = false;
+  while (!is_reserved && size <= REWIND_BYTES) {
+    // only the snapshots before the newest one own a delta:
+    if (ring->count < 2) {
+      *start = 0;
+      is_reserved = true;
+    } else {
+      size_t tail = snapshot_at(ring, 0)->delta_offset;
+      if (tail < ring->head && ring->head + size <= REWIND_BYTES) {
+        *start = ring->head;
+        is_reserved = true;
+      } else if (tail < ring->head && size <= tail) {
+        *start = 0;
+        is_reserved = true;
+      } else if (tail >= ring->head && ring->head + size <= tail) {
+        *start = ring->head;
+        is_reserved = true;
+      } else {
+        drop_oldest(ring);
+      }
+    }
+  }
+  if (is_reserved) ring->head = *start + size;
+  return is_reserved;
+}
+
+/**
+ * @brief Writes the delta from the field of a game back to the base of a
+ * ring.
+ *
+ * @param ring The ring.
+ * @param actual_info A pointer to the game model information.
+ * @param[out] out `delta_size()` bytes.
+ */
+static void write_delta(RewindRing_t *ring, const ModelInfo_t *actual_info,
+                        uint8_t *out) {
+  int rows = 0, previous = -1;
+  for (int y = 0; y < ring->height; y++)
+    rows += is_row_changed(ring, actual_info, y);
+  size_t length = varint_put(out, (uint64_t)rows);
+  for (int y = 0; y < ring->height; y++) {
+    if (is_row_changed(ring, actual_info, y)) {
+      const uint8_t *row = ring->base + y * ring->width;
+      length += varint_put(out + length, (uint64_t)(y - previous - 1));
+      for (int x = 0; x < ring->width; x += 2)
+        out[length++] = (uint8_t)(row[x] |
+                                  (x + 1 < ring->width ? row[x + 1] << 4 : 0));
+      previous = y;
+    }
+  }
+}
+
+/**
+ * @brief Turns the base of a ring into the field of an older snapshot.
+ *
+ * @param ring The ring.
+ * @param snapshot The snapshot just before the one the base holds.
+ */
+static void apply_delta(RewindRing_t *ring, const RewindSnapshot_t *snapshot) {
+  const uint8_t *in = ring->bytes + snapshot->delta_offset;
+  size_t size = snapshot->delta_size;
+  uint64_t rows = 0, gap = 0;
+  size_t position = varint_get(in, size, &rows);
+  int y = -1;
+  for (uint64_t r = 0; r < rows; r++) {
+    position += varint_get(in + position, size - position, &gap);
+    y += (int)gap + 1;
+    uint8_t *row = ring->base + y * ring->width;
+    for (int x = 0; x < ring->width; x += 2) {
+      row[x] = in[position] & 0x0f;
+      if (x + 1 < ring->width) row[x + 1] = in[position] >> 4;
+      position++;
+    }
+  }
+}
+
+/**
+ * @brief Checks whether a row of the field of a game differs from the base
+ * of a ring.
+ *
+ * @param ring The ring.
+ * @param actual_info A pointer to the game model information.
+ * @param row The row.
+ * @return `true` if at least one cell differs.
+ */
+static bool is_row_changed(const RewindRing_t *ring,
+                           const ModelInfo_t *actual_info, int row) {
+  return memcmp(ring->base + row * ring->width, actual_info->field_base[row],
+                (size_t)ring->width) != 0;
+}
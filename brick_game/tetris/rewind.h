@@ -0,0 +1,78 @@
+/**
+ * @file rewind.h
+ * @brief Ring of compact snapshots for rewinding a practice game.
+ *
+ * A snapshot is taken every time a tetramino attaches, at the point where
+ * the next tetramino is about to spawn. It holds the score, level, speed,
+ * preview queue and next tetramino in a fixed-size record; the field is not
+ * copied. Instead the ring keeps the field of the newest snapshot as one
+ * byte per cell, and every older snapshot keeps only the rows that differ
+ * from the snapshot after it (a reverse delta, two cells per byte). Rewinding
+ * applies the deltas from the newest snapshot back to the chosen one.
+ *
+ * The ring is allocated once as a single block, with room for
+ * `REWIND_SNAPSHOTS` records and `REWIND_BYTES` bytes of deltas; taking a
+ * snapshot or rewinding never allocates. The oldest snapshots are dropped
+ * when the ring is full or when they are older than the rewind window.
+ */
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "backend.h"
+
+#define REWIND_SNAPSHOTS 256
+#define REWIND_BYTES (32 * 1024)
+#define DEFAULT_REWIND_SECONDS 30
+
+/**
+ * @brief Fixed-size part of a snapshot.
+ *
+ * `next_cells` has bit `y * TETR_SIZE + x` set for every cell of the next
+ * tetramino. `delta_offset` and `delta_size` locate the rows of the field
+ * that differ from the following snapshot; the newest snapshot has none.
+ */
+typedef struct {
+  PieceQueue_t queue;
+  long long int sim_time;
+  uint32_t next_cells;
+  uint32_t delta_offset;
+  uint32_t delta_size;
+  int32_t score;
+  int16_t level;
+  int16_t speed;
+  uint8_t next_type;
+} RewindSnapshot_t;
+
+_Static_assert(sizeof(RewindSnapshot_t) <= 96,
+               "RewindSnapshot_t must stay compact");
+
+/**
+ * @brief Ring of snapshots of one game.
+ *
+ * Holds `count` snapshots starting at `first`. Deltas are written at `head`
+ * of `bytes` in the order of the snapshots. `base` holds the `width * height`
+ * cells of the field of the newest snapshot.
+ */
+typedef struct RewindRing_t {
+  RewindSnapshot_t snapshots[REWIND_SNAPSHOTS];
+  uint8_t bytes[REWIND_BYTES];
+  int first;
+  int count;
+  size_t head;
+  long long int window_ms;
+  int width;
+  int height;
+  long long int taken;
+  long long int dropped;
+  uint8_t base[];
+} RewindRing_t;
+
+int rewind_create(RewindRing_t **ring, int width, int height,
+                  long long int window_ms);
+void rewind_destroy(RewindRing_t **ring);
+void rewind_clear(RewindRing_t *ring);
+int rewind_push(RewindRing_t *ring, const ModelInfo_t *actual_info);
+int rewind_restore(RewindRing_t *ring, ModelInfo_t *actual_info, int pieces);
+size_t rewind_bytes_used(const RewindRing_t *ring);
+
+#endif
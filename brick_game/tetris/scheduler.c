@@ -0,0 +1,118 @@
+/**
+ * @file scheduler.c
+ * @brief Fixed-timestep simulation scheduler for Tetris.
+ */
+#include "backend.h"
+#include "metrics.h"
+
+/**
+ * @brief Initializes the scheduler.
+ *
+ * @param scheduler A pointer to the scheduler to initialize.
+ * @param tick_ms Duration of one logical tick in milliseconds.
+ */
+void scheduler_init(Scheduler_t *scheduler, int tick_ms) {
+  scheduler->last_time = 0;
+  scheduler->accumulator = 0;
+  scheduler->tick_ms = tick_ms > 0 ? tick_ms : TICK_MS;
+  scheduler->started = false;
+}
+
+/**
+ * @brief Advances the simulation up to the given wall-clock time.
+ *
+ * The elapsed time is added to the accumulator and spent in whole logical
+ * ticks. The number of ticks per call is capped by `MAX_TICKS_PER_ADVANCE`, the
+ * time that does not fit is dropped so that a long stall does not make the
+ * game fast-forward.
+ *
+ * @param scheduler A pointer to the scheduler of the model.
+ * @param actual_info A pointer to the game model information.
+ * @param now The current wall-clock time in milliseconds.
+ * @return The number of logical ticks that were run.
+ */
+int scheduler_advance(Scheduler_t *scheduler, ModelInfo_t *actual_info,
+                      long long int now) {
+  int ticks = 0;
+  if (!scheduler->started) {
+    scheduler->last_time = now;
+    scheduler->started = true;
+  }
+  if (now > scheduler->last_time)
+    scheduler->accumulator += now - scheduler->last_time;
+  scheduler->last_time = now;
+
+  long long int limit =
+      (long long int)scheduler->tick_ms * MAX_TICKS_PER_ADVANCE;
+  if (scheduler->accumulator > limit) scheduler->accumulator = limit;
+
+  while (scheduler->accumulator >= scheduler->tick_ms &&
+         actual_info->pause != EXIT_GAME) {
+    run_tick(actual_info, scheduler->tick_ms);
+    scheduler->accumulator -= scheduler->tick_ms;
+    ticks++;
+  }
+  return ticks;
+}
+
+/**
+ * @brief Runs one logical tick of the game.
+ *
+ * The simulated clock is moved forward and the finite state machine is stepped
+ * until it leaves the transient states, so a piece goes from Shifting through
+ * Attaching and Spawn back to Moving within a single tick. The user input is
+ * consumed by the tick and is not applied again by the following ones.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param tick_ms Duration of the tick in milliseconds.
+ */
+void run_tick(ModelInfo_t *actual_info, int tick_ms) {
+  long long int start_us = monotonic_us();
+  actual_info->sim_time += tick_ms;
+  int steps = 0;
+  do {
+    run_actions_by_state(actual_info);
+    actual_info->hold = false;
+    actual_info->user_action = Up;
+    steps++;
+  } while (actual_info->pause != EXIT_GAME &&
+           is_transient_state(actual_info->state) &&
+           steps < MAX_STEPS_PER_TICK);
+  if (actual_info->metrics)
+    metrics_record_tick(actual_info->metrics, monotonic_us() - start_us);
+}
+
+/**
+ * @brief Runs logical ticks back-to-back without any rendering.
+ *
+ * @param actual_info A pointer to the game model information.
+ * @param ticks The number of ticks to run.
+ * @return The number of ticks that were actually run (fewer if the game was
+ * terminated).
+ */
+long long int run_headless(ModelInfo_t *actual_info, long long int ticks) {
+  long long int done = 0;
+  int tick_ms = actual_info->scheduler.tick_ms > 0
+                    ? actual_info->scheduler.tick_ms
+                    : TICK_MS;
+  if (!actual_info->fixed_step) {
+    actual_info->fixed_step = true;
+    actual_info->timer = actual_info->sim_time;
+  }
+  while (done < ticks && actual_info->pause != EXIT_GAME) {
+    run_tick(actual_info, tick_ms);
+    done++;
+  }
+  return done;
+}
+
+/**
+ * @brief Checks whether the state is left without waiting for time or input.
+ *
+ * @param state The finite state to check.
+ * @return `true` for Spawn, Shifting, Attaching and Game_over.
+ */
+bool is_transient_state(FiniteState_t state) {
+  return state == Spawn || state == Shifting || state == Attaching ||
+         state == Game_over;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file score_store.c
+ * @brief Background writer of the high score file.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "score_store.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static pthread_mutex_t store_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t store_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t store_idle = PTHREAD_COND_INITIALIZER;
+static pthread_t store_thread;
+static char store_path[SCORE_PATH_SIZE] = SCORE_FILE;
+static int queue[SCORE_QUEUE_SIZE];
+static int queue_count = 0;
+static int cached_score = 0;
+static bool is_loaded = false;
+static bool is_running = false;
+static bool is_stopping = false;
+static bool is_urgent = false;
+static bool is_writing = false;
+static long long int batches = 0;
+
+static void load_score();
+static void *score_writer(void *data);
+static void wait_batch_window();
+
+/**
+ * @brief Returns the high score, reading the score file on the first call
+ * only.
+ *
+ * @return The cached high score.
+ */
+int read_score() {
+  pthread_mutex_lock(&store_lock);
+  load_score();
+  int score = cached_score;
+  pthread_mutex_unlock(&store_lock);
+  return score;
+}
+
+/**
+ * @brief Records a new high score and queues it for the writer thread.
+ *
+ * The cached value is updated at once. When the queue is full the newest
+ * entry keeps the best of the scores. If the writer cannot be started the
+ * score is written synchronously.
+ *
+ * @param high_score The new high score.
+ */
+void write_score(int high_score) {
+  static bool is_registered = false;
+  pthread_mutex_lock(&store_lock);
+  load_score();
+  if (high_score > cached_score) cached_score = high_score;
+  if (queue_count < SCORE_QUEUE_SIZE)
+    queue[queue_count++] = high_score;
+  else if (high_score > queue[queue_count - 1])
+    queue[queue_count - 1] = high_score;
+  if (!is_running && !pthread_create(&store_thread, NULL, score_writer, NULL))
+    is_running = true;
+  if (is_running && !is_registered) is_registered = !atexit(score_store_stop);
+  bool is_synchronous = !is_running;
+  if (is_synchronous) queue_count = 0;
+  pthread_cond_signal(&store_wake);
+  pthread_mutex_unlock(&store_lock);
+  if (is_synchronous) score_file_write(store_path, high_score);
+}
+
+/**
+ * @brief Switches to another score file.
+ *
+ * The writer is stopped after writing the queued scores, and the new file is
+ * read on the next call to `read_score()`.
+ *
+ * @param path The path of the score file.
+ * @return `false` if the path is too long.
+ */
+bool score_store_open(const char *path) {
+  bool is_ok = path && strlen(path) < SCORE_PATH_SIZE;
+  if (is_ok) {
+    score_store_stop();
+    pthread_mutex_lock(&store_lock);
+    strcpy(store_path, path);
+    is_loaded = false;
+    cached_score = 0;
+    pthread_mutex_unlock(&store_lock);
+  }
+  return is_ok;
+}
+
+/**
+ * @brief Waits until every queued score is on disk, skipping the batching
+ * delay.
+ */
+void score_store_flush() {
+  pthread_mutex_lock(&store_lock);
+  is_urgent = true;
+  pthread_cond_signal(&store_wake);
+  while (is_running && (queue_count || is_writing))
+    pthread_cond_wait(&store_idle, &store_lock);
+  is_urgent = false;
+  pthread_mutex_unlock(&store_lock);
+}
+
+/**
+ * @brief Writes the queued scores and stops the writer thread.
+ *
+ * The next `write_score()` starts it again.
+ */
+void score_store_stop() {
+  pthread_mutex_lock(&store_lock);
+  bool was_running = is_running;
+  is_stopping = true;
+  pthread_cond_signal(&store_wake);
+  pthread_mutex_unlock(&store_lock);
+  if (was_running) pthread_join(store_thread, NULL);
+  pthread_mutex_lock(&store_lock);
+  is_running = false;
+  is_stopping = false;
+  pthread_mutex_unlock(&store_lock);
+}
+
+/**
+ * @brief Returns the number of batches written by the writer thread.
+ *
+ * @return The number of synced writes of the score file.
+ */
+long long int score_store_batches() {
+  pthread_mutex_lock(&store_lock);
+  long long int result = batches;
+  pthread_mutex_unlock(&store_lock);
+  return result;
+}
+
+/**
+ * @brief Reads a score file.
+ *
+ * @param path The path of the score file.
+ * @return The score, or `0` if the file cannot be read.
+ */
+int score_file_read(const char *path) {
+  int high_score = 0;
+  FILE *file = fopen(path, "r");
+  if (file) {
+    if (fscanf(file, "%d", &high_score) != 1) high_score = 0;
+    fclose(file);
+  }
+  return high_score;
+}
+
+/**
+ * @brief Replaces a score file.
+ *
+ * The score is written and synced to a temporary file which is then renamed
+ * over the score file, so a crash never leaves a truncated file behind.
+ *
+ * @param path The path of the score file.
+ * @param score The score to write.
+ * @return Error code (`0` on success).
+ */
+int score_file_write(const char *path, int score) {
+  char temporary[SCORE_PATH_SIZE + 4];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+  int error = 0;
+  FILE *file = fopen(temporary, "w");
+  if (!file) error++;
+  if (!error && fprintf(file, "%d", score) < 0) error++;
+  if (!error && (fflush(file) || fsync(fileno(file)))) error++;
+  if (file && fclose(file)) error++;
+  if (!error && rename(temporary, path)) error++;
+  if (error) remove(temporary);
+  return error;
+}
+
+/**
+ * @brief Reads the score file into the cache unless it is loaded already.
+ *
+ * Must be called with the store locked.
+ */
+static void load_score() {
+  if (!is_loaded) {
+    cached_score = score_file_read(store_path);
+    is_loaded = true;
+  }
+}
+
+/**
+ * @brief Writes the best queued score in batches until the store stops.
+ *
+ * @param data Unused.
+ * @return `NULL`.
+ */
+static void *score_writer(void *data) {
+  (void)data;
+  char path[SCORE_PATH_SIZE];
+  pthread_mutex_lock(&store_lock);
+  while (!is_stopping || queue_count) {
+    while (!queue_count && !is_stopping)
+      pthread_cond_wait(&store_wake, &store_lock);
+    wait_batch_window();
+    if (queue_count) {
+      int best = queue[0];
+      for (int i = 1; i < queue_count; i++)
+        if (queue[i] > best) best = queue[i];
+      queue_count = 0;
+      is_writing = true;
+      strcpy(path, store_path);
+      pthread_mutex_unlock(&store_lock);
+      score_file_write(path, best);
+      pthread_mutex_lock(&store_lock);
+      is_writing = false;
+      batches++;
+    }
+    pthread_cond_broadcast(&store_idle);
+  }
+  pthread_mutex_unlock(&store_lock);
+  return NULL;
+}
+
+/**
+ * @brief Waits `SCORE_BATCH_US` for more scores unless the store is flushed
+ * or stopped.
+ *
+ * Must be called with the store locked.
+ */
+static void wait_batch_window() {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += (SCORE_BATCH_US % 1000000) * 1000L;
+  deadline.tv_sec += SCORE_BATCH_US / 1000000 + deadline.tv_nsec / 1000000000L;
+  deadline.tv_nsec %= 1000000000L;
+  int timeout = 0;
+  while (!is_stopping && !is_urgent && !timeout)
+    timeout = pthread_cond_timedwait(&store_wake, &store_lock, &deadline);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file score_store.h
+ * @brief High score cached in memory and written to disk by a background
+ * thread.
+ *
+ * The score file is read once, later reads return the cached value. New high
+ * scores are queued and a writer thread, started on the first write, waits
+ * `SCORE_BATCH_US` to collect more of them and then writes only the best one
+ * with a single `fsync()`, so the game loop never waits for the disk.
+ */
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <stdbool.h>
+
+#define SCORE_FILE "score.txt"
+#define SCORE_PATH_SIZE 256
+#define SCORE_QUEUE_SIZE 16
+#define SCORE_BATCH_US 50000
+
+int read_score();
+void write_score(int high_score);
+bool score_store_open(const char *path);
+void score_store_flush();
+void score_store_stop();
+long long int score_store_batches();
+int score_file_read(const char *path);
+int score_file_write(const char *path, int score);
+
+#endif
@@ -0,0 +1,426 @@
+/**
+ * @file soa_engine.c
+ * @brief Multi-game engine with the games in struct-of-arrays layout.
+ */
+#include "soa_engine.h"
+
+/**
+ * @brief Allocates a zeroed array aligned for vector loads.
+ *
+ * @param bytes The size of the array.
+ * @param[in,out] error The error counter, incremented on failure.
+ * @return The array.
+ */
+static void *soa_alloc(size_t bytes, int *error) {
+  size_t size = (bytes + SOA_ALIGNMENT - 1) / SOA_ALIGNMENT * SOA_ALIGNMENT;
+  void *array = aligned_alloc(SOA_ALIGNMENT, size);
+  if (array)
+    memset(array, 0, size);
+  else
+    (*error)++;
+  return array;
+}
+
+/**
+ * @brief Allocates K games and starts each of them.
+ *
+ * @param[out] games The games to initialize.
+ * @param count The number of games.
+ * @param seed The seed the seeds of the games are derived from.
+ * @return Error code (`0` on success).
+ */
+int soa_init(SoaGames_t *games, int count, uint64_t seed) {
+  int error = count > 0 ? 0 : 1;
+  memset(games, 0, sizeof(SoaGames_t));
+  if (!error) {
+    int capacity = (count + SOA_BLOCK - 1) / SOA_BLOCK * SOA_BLOCK;
+    size_t rows = (size_t)SOA_ROWS * capacity;
+    games->count = count;
+    games->capacity = capacity;
+    games->board = soa_alloc(rows * sizeof(uint16_t), &error);
+    games->piece = soa_alloc(rows * sizeof(uint16_t), &error);
+    games->left_mask = soa_alloc(capacity * sizeof(uint16_t), &error);
+    games->right_mask = soa_alloc(capacity * sizeof(uint16_t), &error);
+    games->shift_mask = soa_alloc(capacity * sizeof(uint16_t), &error);
+    games->lock_mask = soa_alloc(capacity * sizeof(uint16_t), &error);
+    games->full_mask = soa_alloc(capacity * sizeof(uint16_t), &error);
+    games->rng = soa_alloc(capacity * sizeof(uint64_t), &error);
+    games->timer = soa_alloc(capacity * sizeof(int64_t), &error);
+    games->sim_time = soa_alloc(capacity * sizeof(int64_t), &error);
+    games->score = soa_alloc(capacity * sizeof(int32_t), &error);
+    games->lines = soa_alloc(capacity * sizeof(int32_t), &error);
+    games->pieces = soa_alloc(capacity * sizeof(int32_t), &error);
+    games->x_position = soa_alloc(capacity, &error);
+    games->y_position = soa_alloc(capacity, &error);
+    games->kind = soa_alloc(capacity, &error);
+    games->rotation = soa_alloc(capacity, &error);
+    games->next_kind = soa_alloc(capacity, &error);
+    games->next_rotation = soa_alloc(capacity, &error);
+    games->level = soa_alloc(capacity, &error);
+    games->speed = soa_alloc(capacity, &error);
+    games->state = soa_alloc(capacity, &error);
+  }
+  if (error)
+    soa_free(games);
+  else
+    for (int k = 0; k < count; k++)
+      soa_reset_game(games, k, random_next(&seed));
+  return error;
+}
+
+/**
+ * @brief Frees the arrays of the games.
+ *
+ * @param games The games.
+ */
+void soa_free(SoaGames_t *games) {
+  void *arrays[] = {
+      games->board,         games->piece,         games->left_mask,
+      games->right_mask,    games->shift_mask,    games->lock_mask,
+      games->full_mask,     games->rng,           games->timer,
+      games->sim_time,      games->score,         games->lines,
+      games->pieces,        games->x_position,    games->y_position,
+      games->kind,          games->rotation,      games->next_kind,
+      games->next_rotation, games->level,         games->speed,
+      games->state};
+  for (size_t i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+    free(arrays[i]);
+  memset(games, 0, sizeof(SoaGames_t));
+}
+
+/**
+ * @brief Draws the next tetramino of a game, as `generate_next_piece()`.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ */
+static void soa_generate_next(SoaGames_t *games, int k) {
+  uint64_t random = random_next(&games->rng[k]);
+  games->next_kind[k] = (uint8_t)(1 + random % PIECE_TYPES);
+  games->next_rotation[k] =
+      (uint8_t)((random >> 32) % 4 % piece_period(games->next_kind[k]));
+}
+
+/**
+ * @brief Starts a new game in a lane.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ * @param seed The seed of the tetramino sequence.
+ */
+void soa_reset_game(SoaGames_t *games, int k, uint64_t seed) {
+  for (int r = 0; r < SOA_ROWS; r++)
+    games->board[SOA_INDEX(r, k)] = 0;
+  games->rng[k] = seed;
+  games->timer[k] = 0;
+  games->sim_time[k] = 0;
+  games->score[k] = 0;
+  games->lines[k] = 0;
+  games->pieces[k] = 0;
+  games->level[k] = 1;
+  games->speed[k] = 0;
+  soa_generate_next(games, k);
+  soa_spawn(games, k);
+}
+
+/**
+ * @brief Advances every game by one logical tick.
+ *
+ * Mirrors `state_step()` for each game: one action, then gravity. The actions
+ * and timers are handled per game, horizontal moves and the downward shift
+ * with locking and full-row detection run on all games at once.
+ *
+ * @param games The games.
+ * @param actions The `UserAction_t` of every game.
+ */
+void soa_step(SoaGames_t *games, const uint8_t *actions) {
+  for (int k = 0; k < games->count; k++) {
+    bool moving = games->state[k] == Moving;
+    UserAction_t action = moving ? (UserAction_t)actions[k] : Up;
+    bool shift = action == Down;
+    games->left_mask[k] = action == Left ? 0xffff : 0;
+    games->right_mask[k] = action == Right ? 0xffff : 0;
+    if (moving) {
+      games->sim_time[k] += TICK_MS;
+      if (action == Action) soa_rotate(games, k);
+      if (games->sim_time[k] - games->timer[k] >=
+          gravity_interval(games->speed[k])) {
+        games->timer[k] = games->sim_time[k];
+        shift = true;
+      }
+    }
+    games->shift_mask[k] = shift ? 0xffff : 0;
+  }
+  soa_move_pass(games);
+  soa_shift_pass(games);
+  for (int k = 0; k < games->count; k++) {
+    games->x_position[k] +=
+        (games->right_mask[k] & 1) - (games->left_mask[k] & 1);
+    if (games->lock_mask[k])
+      soa_finish_lock(games, k);
+    else if (games->shift_mask[k])
+      games->y_position[k]++;
+  }
+}
+
+/**
+ * @brief Moves the falling tetraminoes of the games that asked for it one
+ * column left or right, unless a wall or the field is in the way.
+ *
+ * The requests in `left_mask` and `right_mask` are replaced by the moves that
+ * were made.
+ *
+ * @param games The games.
+ */
+void soa_move_pass(SoaGames_t *games) {
+  const lanes_t zero = lanes_set(0);
+  const lanes_t one = lanes_set(1);
+  const lanes_t wall = lanes_set(SOA_WALL);
+  for (int k = 0; k < games->capacity; k += SOA_LANES) {
+    uint16_t *pieces = games->piece + SOA_INDEX(0, k);
+    const uint16_t *boards = games->board + SOA_INDEX(0, k);
+    lanes_t left_hit = zero;
+    lanes_t right_hit = zero;
+    for (int r = 0; r < SOA_ROWS; r++) {
+      lanes_t piece = lanes_load(pieces + r * SOA_BLOCK);
+      lanes_t board = lanes_load(boards + r * SOA_BLOCK);
+      left_hit = lanes_or(left_hit, lanes_or(lanes_and(piece, one),
+                                             lanes_and(lanes_shr(piece, 1),
+                                                       board)));
+      right_hit = lanes_or(right_hit, lanes_and(lanes_shl(piece, 1),
+                                                lanes_or(board, wall)));
+    }
+    lanes_t left = lanes_and(lanes_load(games->left_mask + k),
+                             lanes_eq(left_hit, zero));
+    lanes_t right = lanes_and(lanes_load(games->right_mask + k),
+                              lanes_eq(right_hit, zero));
+    lanes_store(games->left_mask + k, left);
+    lanes_store(games->right_mask + k, right);
+    for (int r = 0; r < SOA_ROWS; r++) {
+      lanes_t piece = lanes_load(pieces + r * SOA_BLOCK);
+      piece = lanes_blend(piece, lanes_shr(piece, 1), left);
+      piece = lanes_blend(piece, lanes_shl(piece, 1), right);
+      lanes_store(pieces + r * SOA_BLOCK, piece);
+    }
+  }
+}
+
+/**
+ * @brief Shifts the falling tetraminoes of the games in `shift_mask` one row
+ * down, or locks them into the field when they rest on something.
+ *
+ * Sets `lock_mask` for the games that locked and `full_mask` for those of
+ * them that completed a row.
+ *
+ * @param games The games.
+ */
+void soa_shift_pass(SoaGames_t *games) {
+  const lanes_t zero = lanes_set(0);
+  const lanes_t full_row = lanes_set(SOA_FULL_ROW);
+  for (int k = 0; k < games->capacity; k += SOA_LANES) {
+    uint16_t *pieces = games->piece + SOA_INDEX(0, k);
+    uint16_t *boards = games->board + SOA_INDEX(0, k);
+    lanes_t hit = lanes_load(pieces + (SOA_ROWS - 1) * SOA_BLOCK);
+    for (int r = 0; r < SOA_ROWS - 1; r++)
+      hit = lanes_or(hit, lanes_and(lanes_load(pieces + r * SOA_BLOCK),
+                                    lanes_load(boards + (r + 1) * SOA_BLOCK)));
+    lanes_t shift = lanes_load(games->shift_mask + k);
+    lanes_t lock = lanes_andnot(lanes_eq(hit, zero), shift);
+    lanes_t move = lanes_andnot(lock, shift);
+    lanes_t full = zero;
+    for (int r = SOA_TOP; r < SOA_ROWS; r++) {
+      lanes_t board =
+          lanes_or(lanes_load(boards + r * SOA_BLOCK),
+                   lanes_and(lock, lanes_load(pieces + r * SOA_BLOCK)));
+      lanes_store(boards + r * SOA_BLOCK, board);
+      full = lanes_or(full, lanes_eq(board, full_row));
+    }
+    for (int r = SOA_ROWS - 1; r > 0; r--)
+      lanes_store(pieces + r * SOA_BLOCK,
+                  lanes_blend(lanes_load(pieces + r * SOA_BLOCK),
+                              lanes_load(pieces + (r - 1) * SOA_BLOCK), move));
+    lanes_store(pieces, lanes_andnot(move, lanes_load(pieces)));
+    lanes_store(games->lock_mask + k, lock);
+    lanes_store(games->full_mask + k, lanes_and(lock, full));
+  }
+}
+
+/**
+ * @brief Clears the full rows of a game whose tetramino was just locked,
+ * updates its score and spawns the next tetramino.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ */
+void soa_finish_lock(SoaGames_t *games, int k) {
+  int lines_cleared = 0;
+  for (int r = SOA_TOP; games->full_mask[k] && r < SOA_ROWS; r++) {
+    if (games->board[SOA_INDEX(r, k)] == SOA_FULL_ROW) {
+      for (int above = r; above > SOA_TOP; above--)
+        games->board[SOA_INDEX(above, k)] =
+            games->board[SOA_INDEX(above - 1, k)];
+      games->board[SOA_INDEX(SOA_TOP, k)] = 0;
+      lines_cleared++;
+    }
+  }
+  if (lines_cleared) {
+    int score = games->score[k];
+    update_score(&score, lines_cleared);
+    games->score[k] = score;
+    games->lines[k] += lines_cleared;
+    games->level[k] = (uint8_t)level_for_score(score);
+    games->speed[k] = (uint8_t)(games->level[k] - 1);
+  }
+  games->pieces[k]++;
+  soa_spawn(games, k);
+}
+
+/**
+ * @brief Moves the next tetramino of a game to the spawn position.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ */
+void soa_spawn(SoaGames_t *games, int k) {
+  games->kind[k] = games->next_kind[k];
+  games->rotation[k] = games->next_rotation[k];
+  soa_generate_next(games, k);
+  games->x_position[k] = (int8_t)spawn_x_position(SOA_WIDTH);
+  games->y_position[k] = SPAWN_Y_POSITION;
+  games->state[k] = soa_collides(games, k, games->rotation[k],
+                                 games->x_position[k], games->y_position[k])
+                        ? Game_over
+                        : Moving;
+  soa_set_piece(games, k);
+}
+
+/**
+ * @brief Expands the falling tetramino of a game into its piece rows.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ */
+void soa_set_piece(SoaGames_t *games, int k) {
+  const uint8_t *shape =
+      piece_shapes[games->kind[k] - 1][games->rotation[k]];
+  int x = games->x_position[k];
+  for (int r = 0; r < SOA_ROWS; r++) games->piece[SOA_INDEX(r, k)] = 0;
+  for (int i = 0; i < TETR_SIZE; i++) {
+    int r = games->y_position[k] + SOA_TOP + i;
+    if (shape[i] && r >= 0 && r < SOA_ROWS)
+      games->piece[SOA_INDEX(r, k)] =
+          (uint16_t)(x >= 0 ? shape[i] << x : shape[i] >> -x);
+  }
+}
+
+/**
+ * @brief Reads the rows of a game under a tetramino as row masks.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ * @param y The row of the tetramino matrix.
+ * @param[out] rows The `TETR_SIZE` row masks from row `y`, empty outside the
+ * field.
+ */
+static void soa_window(const SoaGames_t *games, int k, int y,
+                       uint64_t *rows) {
+  for (int i = 0; i < TETR_SIZE; i++) {
+    int row = y + i;
+    rows[i] = row >= 0 && row < SOA_HEIGHT
+                  ? games->board[SOA_INDEX(row + SOA_TOP, k)]
+                  : 0;
+  }
+}
+
+/**
+ * @brief Checks whether the tetramino of a game collides at a position with
+ * `field_collision()`.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ * @param rotation The orientation.
+ * @param x The column of the tetramino matrix.
+ * @param y The row of the tetramino matrix.
+ * @return `true` if the tetramino is out of the field or overlaps it.
+ */
+bool soa_collides(const SoaGames_t *games, int k, int rotation, int x,
+                  int y) {
+  uint64_t rows[TETR_SIZE];
+  soa_window(games, k, y, rows);
+  return field_collision(rows, SOA_WIDTH, SOA_HEIGHT - y,
+                         piece_shape(games->kind[k], rotation), x,
+                         0) != NO_COLLISION;
+}
+
+/**
+ * @brief Finds the collision of a rotated tetramino of a game with
+ * `field_rotate_collision()`.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ * @param rotation The orientation after the rotation.
+ * @param x The column of the tetramino matrix.
+ * @return The collision code, `NO_COLLISION` if the tetramino fits.
+ */
+int soa_rotate_collision(const SoaGames_t *games, int k, int rotation,
+                         int x) {
+  int y = games->y_position[k];
+  uint64_t rows[TETR_SIZE];
+  soa_window(games, k, y, rows);
+  return field_rotate_collision(rows, SOA_WIDTH, SOA_HEIGHT - y,
+                                piece_shape(games->kind[k], rotation), x, 0);
+}
+
+/**
+ * @brief Rotates the tetramino of a game with the kicks of
+ * `field_rotation_kick()`.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ */
+void soa_rotate(SoaGames_t *games, int k) {
+  int rotation = (games->rotation[k] + 1) % piece_period(games->kind[k]);
+  int x = games->x_position[k];
+  int y = games->y_position[k];
+  uint64_t rows[TETR_SIZE];
+  soa_window(games, k, y, rows);
+  int error = field_rotation_kick(rows, SOA_WIDTH, SOA_HEIGHT - y,
+                                  piece_shape(games->kind[k], rotation), &x,
+                                  0);
+  if (!error) {
+    games->rotation[k] = (uint8_t)rotation;
+    games->x_position[k] = (int8_t)x;
+    soa_set_piece(games, k);
+  }
+}
+
+/**
+ * @brief Copies one game into a compact game state.
+ *
+ * @param games The games.
+ * @param k The index of the game.
+ * @param[out] game The compact state.
+ */
+void soa_get_state(const SoaGames_t *games, int k, GameState_t *game) {
+  memset(game, 0, sizeof(GameState_t));
+  game->width = SOA_WIDTH;
+  game->height = SOA_HEIGHT;
+  for (int y = 0; y < SOA_HEIGHT; y++)
+    game->rows[y] = games->board[SOA_INDEX(y + SOA_TOP, k)];
+  state_rehash(game);
+  game->rng = games->rng[k];
+  game->timer = games->timer[k];
+  game->sim_time = games->sim_time[k];
+  game->score = games->score[k];
+  game->lines = games->lines[k];
+  game->pieces = games->pieces[k];
+  game->x_position = games->x_position[k];
+  game->y_position = games->y_position[k];
+  game->piece = games->kind[k];
+  game->rotation = games->rotation[k];
+  game->next_piece = games->next_kind[k];
+  game->next_rotation = games->next_rotation[k];
+  game->level = games->level[k];
+  game->speed = games->speed[k];
+  game->state = games->state[k];
+}
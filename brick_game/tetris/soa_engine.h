@@ -0,0 +1,127 @@
+/**
+ * @file soa_engine.h
+ * @brief Multi-game engine with the games in struct-of-arrays layout.
+ *
+ * K games on standard 10x20 fields are stored in blocks of `SOA_BLOCK` games:
+ * within a block, row `r` of every game is a contiguous run of 16-bit masks,
+ * and so is row `r` of the falling tetramino, expanded to field rows.
+ * Moving, gravity, collision, locking and full-row detection then run on all
+ * games at once, 16 games per AVX2 vector or 8 per SSE2 vector, with a scalar
+ * fallback. Rotations, line clearing and spawning are rare and done per game;
+ * rotations and spawn checks run the `field_*()` rules of `state_step()` on
+ * the rows of one game.
+ */
+#ifndef SOA_ENGINE_H
+#define SOA_ENGINE_H
+
+#include "game_state.h"
+
+#if defined(__AVX2__) && !defined(SOA_NO_SIMD)
+#include <immintrin.h>
+typedef __m256i lanes_t;
+#define SOA_LANES 16
+#define lanes_load(p) _mm256_load_si256((const __m256i *)(p))
+#define lanes_store(p, v) _mm256_store_si256((__m256i *)(p), (v))
+#define lanes_set(x) _mm256_set1_epi16((short)(x))
+#define lanes_and(a, b) _mm256_and_si256((a), (b))
+#define lanes_or(a, b) _mm256_or_si256((a), (b))
+#define lanes_andnot(a, b) _mm256_andnot_si256((a), (b))
+#define lanes_eq(a, b) _mm256_cmpeq_epi16((a), (b))
+#define lanes_shl(v, n) _mm256_slli_epi16((v), (n))
+#define lanes_shr(v, n) _mm256_srli_epi16((v), (n))
+#elif defined(__SSE2__) && !defined(SOA_NO_SIMD)
+#include <emmintrin.h>
+typedef __m128i lanes_t;
+#define SOA_LANES 8
+#define lanes_load(p) _mm_load_si128((const __m128i *)(p))
+#define lanes_store(p, v) _mm_store_si128((__m128i *)(p), (v))
+#define lanes_set(x) _mm_set1_epi16((short)(x))
+#define lanes_and(a, b) _mm_and_si128((a), (b))
+#define lanes_or(a, b) _mm_or_si128((a), (b))
+#define lanes_andnot(a, b) _mm_andnot_si128((a), (b))
+#define lanes_eq(a, b) _mm_cmpeq_epi16((a), (b))
+#define lanes_shl(v, n) _mm_slli_epi16((v), (n))
+#define lanes_shr(v, n) _mm_srli_epi16((v), (n))
+#else
+typedef uint16_t lanes_t;
+#define SOA_LANES 1
+#define lanes_load(p) (*(p))
+#define lanes_store(p, v) (*(p) = (v))
+#define lanes_set(x) ((uint16_t)(x))
+#define lanes_and(a, b) ((uint16_t)((a) & (b)))
+#define lanes_or(a, b) ((uint16_t)((a) | (b)))
+#define lanes_andnot(a, b) ((uint16_t)(~(a) & (b)))
+#define lanes_eq(a, b) ((uint16_t)((a) == (b) ? 0xffff : 0))
+#define lanes_shl(v, n) ((uint16_t)((v) << (n)))
+#define lanes_shr(v, n) ((uint16_t)((v) >> (n)))
+#endif
+
+/** @brief Selects `b` in the lanes where `mask` is set and `a` elsewhere. */
+#define lanes_blend(a, b, mask) \
+  lanes_or(lanes_andnot((mask), (a)), lanes_and((mask), (b)))
+
+#define SOA_ALIGNMENT 32
+#define SOA_BLOCK 16
+#define SOA_WIDTH FIELD_WIDTH
+#define SOA_HEIGHT FIELD_HEIGHT
+#define SOA_TOP (-SPAWN_Y_POSITION)
+#define SOA_ROWS (SOA_TOP + SOA_HEIGHT)
+#define SOA_FULL_ROW ((1 << SOA_WIDTH) - 1)
+#define SOA_WALL ((uint16_t)~SOA_FULL_ROW)
+
+/** @brief Index of row `r` of game `k` in the `board` and `piece` arrays. */
+#define SOA_INDEX(r, k) \
+  (((k) / SOA_BLOCK * SOA_ROWS + (r)) * SOA_BLOCK + (k) % SOA_BLOCK)
+
+/**
+ * @brief K games in struct-of-arrays layout.
+ *
+ * `board` and `piece` hold `SOA_ROWS` rows per game, laid out by
+ * `SOA_INDEX()`; the first `SOA_TOP` rows are above the field, where only the
+ * falling tetramino can be. Blocks keep the rows a vector pass walks through
+ * close together in memory.
+ * `capacity` is `count` rounded up to `SOA_BLOCK`; padding games never move.
+ * The `*_mask` arrays are per-step scratch space of 0 or `0xffff` per game.
+ */
+typedef struct {
+  uint16_t *board;
+  uint16_t *piece;
+  uint16_t *left_mask;
+  uint16_t *right_mask;
+  uint16_t *shift_mask;
+  uint16_t *lock_mask;
+  uint16_t *full_mask;
+  uint64_t *rng;
+  int64_t *timer;
+  int64_t *sim_time;
+  int32_t *score;
+  int32_t *lines;
+  int32_t *pieces;
+  int8_t *x_position;
+  int8_t *y_position;
+  uint8_t *kind;
+  uint8_t *rotation;
+  uint8_t *next_kind;
+  uint8_t *next_rotation;
+  uint8_t *level;
+  uint8_t *speed;
+  uint8_t *state;
+  int count;
+  int capacity;
+} SoaGames_t;
+
+int soa_init(SoaGames_t *games, int count, uint64_t seed);
+void soa_free(SoaGames_t *games);
+void soa_reset_game(SoaGames_t *games, int k, uint64_t seed);
+void soa_step(SoaGames_t *games, const uint8_t *actions);
+void soa_get_state(const SoaGames_t *games, int k, GameState_t *game);
+bool soa_collides(const SoaGames_t *games, int k, int rotation, int x, int y);
+int soa_rotate_collision(const SoaGames_t *games, int k, int rotation, int x);
+void soa_rotate(SoaGames_t *games, int k);
+void soa_set_piece(SoaGames_t *games, int k);
+void soa_spawn(SoaGames_t *games, int k);
+void soa_finish_lock(SoaGames_t *games, int k);
+void soa_move_pass(SoaGames_t *games);
+void soa_shift_pass(SoaGames_t *games);
+
+#endif
@@ -0,0 +1,171 @@
+/**
+ * @file stats.c
+ * @brief Transition counters and latency histograms of the game engine.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "stats.h"
+
+#include <time.h>
+
+static const char *state_names[STATE_COUNT] = {
+    "Start", "Spawn", "Moving", "Shifting",
+    "Attaching", "Game_over", "Pause", "Exit"};
+
+/**
+ * @brief Returns the time of the monotonic clock in microseconds.
+ *
+ * @return The current monotonic time in microseconds.
+ */
+long long int monotonic_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long int)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/**
+ * @brief Maps a duration to its log2 histogram bucket.
+ *
+ * @param us The duration in microseconds.
+ * @return The index of the bucket.
+ */
+int histogram_bucket(long long int us) {
+  int bucket = 0;
+  if (us > 0) {
+    bucket = 64 - __builtin_clzll((unsigned long long)us);
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+  }
+  return bucket;
+}
+
+/**
+ * @brief Returns the exclusive upper bound of a histogram bucket.
+ *
+ * @param bucket The index of the bucket.
+ * @return The upper bound in microseconds.
+ */
+long long int bucket_upper_bound(int bucket) { return 1LL << bucket; }
+
+/**
+ * @brief Returns the name of a state of the finite state machine.
+ *
+ * @param state The state.
+ * @return The name, or `"?"` for an unknown state.
+ */
+const char *state_name(int state) {
+  return state >= 0 && state < STATE_COUNT ? state_names[state] : "?";
+}
+
+/**
+ * @brief Records one step of the finite state machine.
+ *
+ * Every step is counted as a transition, self-transitions included. When the
+ * state changes, the time spent in the previous state is added to its
+ * histogram.
+ *
+ * @param stats A pointer to the statistics of the engine.
+ * @param from The state before the step.
+ * @param to The state after the step.
+ * @param now The current monotonic time in microseconds.
+ */
+void stats_record_step(EngineStats_t *stats, int from, int to,
+                       long long int now) {
+  if (from < 0 || from >= STATE_COUNT || to < 0 || to >= STATE_COUNT) return;
+  stats->transitions[from][to]++;
+  if (!stats->state_entered) {
+    stats->state_entered = now;
+  } else if (from != to) {
+    stats->state_time[from][histogram_bucket(now - stats->state_entered)]++;
+    stats->state_entered = now;
+  }
+}
+
+/**
+ * @brief Remembers the time of the first input not yet shown on screen.
+ *
+ * @param stats A pointer to the statistics of the engine.
+ * @param now The current monotonic time in microseconds.
+ */
+void stats_mark_input(EngineStats_t *stats, long long int now) {
+  if (!stats->input_time) stats->input_time = now;
+}
+
+/**
+ * @brief Records the input-to-visible latency when a frame is rendered.
+ *
+ * @param stats A pointer to the statistics of the engine.
+ * @param now The current monotonic time in microseconds.
+ */
+void stats_mark_frame(EngineStats_t *stats, long long int now) {
+  if (stats->input_time) {
+    stats->input_latency[histogram_bucket(now - stats->input_time)]++;
+    stats->input_time = 0;
+  }
+}
+
+/**
+ * @brief Sums all buckets of a histogram.
+ *
+ * @param histogram The histogram of `HISTOGRAM_BUCKETS` buckets.
+ * @return The number of recorded values.
+ */
+unsigned long long histogram_total(const unsigned long long *histogram) {
+  unsigned long long total = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; i++) total += histogram[i];
+  return total;
+}
+
+/**
+ * @brief Estimates a percentile of a histogram.
+ *
+ * @param histogram The histogram of `HISTOGRAM_BUCKETS` buckets.
+ * @param quantile The quantile in the range [0, 1].
+ * @return The upper bound of the bucket holding the quantile in microseconds,
+ * or `0` if the histogram is empty.
+ */
+long long int histogram_percentile(const unsigned long long *histogram,
+                                   double quantile) {
+  unsigned long long total = histogram_total(histogram);
+  long long int result = 0;
+  if (total) {
+    unsigned long long rank = (unsigned long long)(quantile * (double)total);
+    if (rank >= total) rank = total - 1;
+    unsigned long long seen = 0;
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS && seen + histogram[bucket] <= rank)
+      seen += histogram[bucket++];
+    result = bucket_upper_bound(bucket);
+  }
+  return result;
+}
+
+/**
+ * @brief Prints the statistics in a human-readable form.
+ *
+ * @param stream The output stream.
+ * @param stats A pointer to the statistics of the engine.
+ */
+void stats_dump(FILE *stream, const EngineStats_t *stats) {
+  fprintf(stream, "# FSM transitions\n");
+  for (int from = 0; from < STATE_COUNT; from++) {
+    for (int to = 0; to < STATE_COUNT; to++) {
+      if (stats->transitions[from][to])
+        fprintf(stream, "%-10s -> %-10s %llu\n", state_names[from],
+                state_names[to], stats->transitions[from][to]);
+    }
+  }
+  fprintf(stream, "# time per state, us (count p50 p99)\n");
+  for (int state = 0; state < STATE_COUNT; state++) {
+    const unsigned long long *histogram = stats->state_time[state];
+    if (histogram_total(histogram))
+      fprintf(stream, "%-10s %llu %lld %lld\n", state_names[state],
+              histogram_total(histogram),
+              histogram_percentile(histogram, 0.5),
+              histogram_percentile(histogram, 0.99));
+  }
+  fprintf(stream, "# input-to-visible latency, us (count p50 p99)\n");
+  fprintf(stream, "input      %llu %lld %lld\n",
+          histogram_total(stats->input_latency),
+          histogram_percentile(stats->input_latency, 0.5),
+          histogram_percentile(stats->input_latency, 0.99));
+}
@@ -0,0 +1,46 @@
+/**
+ * @file stats.h
+ * @brief Cheap runtime statistics of the game engine.
+ *
+ * Every engine counts the transitions between its finite states and keeps
+ * log2-bucketed histograms of the time spent in each state and of the latency
+ * between user input and the next rendered frame.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+#define STATE_COUNT 8
+#define HISTOGRAM_BUCKETS 32
+
+/**
+ * @brief Structure containing the statistics of one engine.
+ *
+ * Histogram bucket `0` holds values below 1 us, bucket `b` holds values in
+ * the range [2^(b-1), 2^b) microseconds. Every step is recorded at the
+ * monotonic time its handler returned, so the time of a transient state is
+ * the work done by its handler, not the length of the tick.
+ */
+typedef struct {
+  unsigned long long transitions[STATE_COUNT][STATE_COUNT];
+  unsigned long long state_time[STATE_COUNT][HISTOGRAM_BUCKETS];
+  unsigned long long input_latency[HISTOGRAM_BUCKETS];
+  long long int state_entered;
+  long long int input_time;
+} EngineStats_t;
+
+long long int monotonic_us();
+int histogram_bucket(long long int us);
+long long int bucket_upper_bound(int bucket);
+const char *state_name(int state);
+void stats_record_step(EngineStats_t *stats, int from, int to,
+                       long long int now);
+void stats_mark_input(EngineStats_t *stats, long long int now);
+void stats_mark_frame(EngineStats_t *stats, long long int now);
+unsigned long long histogram_total(const unsigned long long *histogram);
+long long int histogram_percentile(const unsigned long long *histogram,
+                                   double quantile);
+void stats_dump(FILE *stream, const EngineStats_t *stats);
+
+#endif
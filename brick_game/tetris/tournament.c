@@ -0,0 +1,390 @@
+/**
+ * @file tournament.c
+ * @brief Round-robin tournament of bot policies.
+ */
+#include "tournament.h"
+
+#include <limits.h>
+#include <math.h>
+
+static void tournament_task(void *context, int task, int worker);
+static int compare_ints(const void *first, const void *second);
+
+/**
+ * @brief Sets up a tournament: draws the seeds, loads one instance of every
+ * plugin per thread and starts the pool.
+ *
+ * @param[out] tournament The tournament to set up.
+ * @param config The settings; the number of threads counts the caller.
+ * @param paths The plugin of every bot, `NULL` for the greedy policy.
+ * @param bots The number of bots (1 to `MAX_TOURNAMENT_BOTS`).
+ * @return Error code (`0` on success).
+ */
+int tournament_init(Tournament_t *tournament, const TournamentConfig_t *config,
+                    const char *const *paths, int bots) {
+  int error = bots >= 1 && bots <= MAX_TOURNAMENT_BOTS && config->games >= 1 &&
+                      config->threads >= 1 &&
+                      config->threads <= MAX_POOL_THREADS &&
+                      config->max_ticks >= 1 && config->budget_us > 0 &&
+                      is_valid_board_size(config->width, config->height) &&
+                      config->height <= STATE_MAX_HEIGHT
+                  ? 0
+                  : 1;
+  tournament->config = *config;
+  tournament->bots = error ? 0 : bots;
+  tournament->pool.threads = 0;
+  tournament->seeds = NULL;
+  tournament->scores = NULL;
+  tournament->ticks = NULL;
+  tournament->log = NULL;
+  tournament->records = NULL;
+  tournament->metrics = NULL;
+  tournament->seconds = 0;
+  atomic_init(&tournament->errors, 0);
+  tournament->plugins = NULL;
+  if (!error) {
+    size_t results = (size_t)bots * config->games;
+    tournament->plugins = calloc(config->threads, sizeof(*tournament->plugins));
+    tournament->seeds = malloc(sizeof(uint64_t) * config->games);
+    tournament->scores = calloc(results, sizeof(int));
+    tournament->ticks = calloc(results, sizeof(long long int));
+    if (!tournament->plugins || !tournament->seeds || !tournament->scores ||
+        !tournament->ticks)
+      error++;
+  }
+  if (!error) {
+    uint64_t seed = config->seed;
+    for (int g = 0; g < config->games; g++)
+      tournament->seeds[g] = random_next(&seed);
+    for (int b = 0; b < bots; b++) {
+      tournament->paths[b] = paths[b];
+      tournament->names[b] = "greedy";
+    }
+  }
+  for (int w = 0; !error && w < config->threads; w++) {
+    for (int b = 0; !error && b < bots; b++) {
+      if (paths[b])
+        error = bot_load(&tournament->plugins[w][b], paths[b],
+                         config->budget_us, config->seed + (uint64_t)w);
+      if (!error && paths[b] && tournament->plugins[w][b].api->name)
+        tournament->names[b] = tournament->plugins[w][b].api->name;
+    }
+  }
+  if (!error) error = pool_init(&tournament->pool, config->threads);
+  if (error) tournament_free(tournament);
+  return error;
+}
+
+/**
+ * @brief Stops the pool, unloads the plugins, closes the game log and frees
+ * the results.
+ *
+ * @param tournament The tournament.
+ */
+void tournament_free(Tournament_t *tournament) {
+  pool_free(&tournament->pool);
+  tournament_close_log(tournament);
+  if (tournament->plugins) {
+    for (int w = 0; w < tournament->config.threads; w++)
+      for (int b = 0; b < tournament->bots; b++)
+        bot_unload(&tournament->plugins[w][b]);
+  }
+  free(tournament->plugins);
+  free(tournament->seeds);
+  free(tournament->scores);
+  free(tournament->ticks);
+  metrics_destroy(&tournament->metrics);
+  tournament->plugins = NULL;
+  tournament->seeds = NULL;
+  tournament->scores = NULL;
+  tournament->ticks = NULL;
+}
+
+/**
+ * @brief Makes the next runs append the inputs of every game to a game-log
+ * archive as soon as the game ends.
+ *
+ * Only one record per thread is kept; the games are appended in the order
+ * they end, each with its seed and policy.
+ *
+ * @param tournament The tournament, set up.
+ * @param path The path of the archive.
+ * @return Error code (`0` on success, `1` if a log is open already or the
+ * archive cannot be opened).
+ */
+int tournament_open_log(Tournament_t *tournament, const char *path) {
+  int error = tournament->log ? 1 : 0;
+  if (!error) {
+    tournament->log = malloc(sizeof(LogWriter_t));
+    tournament->records =
+        malloc(sizeof(GameRecord_t) * tournament->config.threads);
+    if (!tournament->log || !tournament->records ||
+        pthread_mutex_init(&tournament->log_lock, NULL)) {
+      free(tournament->log);
+      free(tournament->records);
+      tournament->log = NULL;
+      tournament->records = NULL;
+      error++;
+    }
+  }
+  if (!error) {
+    for (int w = 0; w < tournament->config.threads; w++)
+      record_init(&tournament->records[w]);
+    error = log_writer_open(tournament->log, path);
+    if (error) {
+      // a writer that failed to open is released already:
+      free(tournament->log);
+      tournament->log = NULL;
+      tournament_close_log(tournament);
+    }
+  }
+  return error;
+}
+
+/**
+ * @brief Writes the index of the game log and closes it.
+ *
+ * Does nothing if no log is open.
+ *
+ * @param tournament The tournament, not running.
+ * @return Error code (`0` on success).
+ */
+int tournament_close_log(Tournament_t *tournament) {
+  int error = 0;
+  if (tournament->records) {
+    if (tournament->log) error = log_writer_close(tournament->log);
+    for (int w = 0; w < tournament->config.threads; w++)
+      record_free(&tournament->records[w]);
+    pthread_mutex_destroy(&tournament->log_lock);
+  }
+  free(tournament->log);
+  free(tournament->records);
+  tournament->log = NULL;
+  tournament->records = NULL;
+  return error;
+}
+
+/**
+ * @brief Counts the games of the next runs per thread and exports the
+ * counters to a metrics file at a fixed interval.
+ *
+ * The file is written once more when the tournament is freed.
+ *
+ * @param tournament The tournament, set up.
+ * @param path The path of the metrics file.
+ * @param interval_ms The time between two exports in milliseconds.
+ * @return Error code (`0` on success, `1` if the metrics are exported
+ * already or the exporter cannot be started).
+ */
+int tournament_export_metrics(Tournament_t *tournament, const char *path,
+                              long long int interval_ms) {
+  int error = 1;
+  if (!tournament->metrics) {
+    error = metrics_create(&tournament->metrics);
+    if (!error) error = metrics_start(tournament->metrics, path, interval_ms);
+    if (error) metrics_destroy(&tournament->metrics);
+  }
+  return error;
+}
+
+/**
+ * @brief Plays every bot on every seed.
+ *
+ * One task is one game. Tasks are numbered seed-major, so the games of all
+ * bots on a seed are queued together.
+ *
+ * @param tournament The tournament.
+ */
+void tournament_run(Tournament_t *tournament) {
+  long long int start_us = monotonic_us();
+  pool_run(&tournament->pool, tournament_task, tournament,
+           tournament->bots * tournament->config.games);
+  tournament->seconds = (double)(monotonic_us() - start_us) / 1e6;
+}
+
+/**
+ * @brief Adds up the call statistics of the instances of a plugin.
+ *
+ * @param tournament The tournament.
+ * @param bot The index of the bot.
+ * @param[out] totals The summed calls, forfeits and call times and the
+ * longest call; all zero for the greedy policy.
+ */
+void tournament_bot_totals(const Tournament_t *tournament, int bot,
+                           BotPlugin_t *totals) {
+  *totals = (BotPlugin_t){0};
+  for (int w = 0; w < tournament->config.threads; w++) {
+    const BotPlugin_t *plugin = &tournament->plugins[w][bot];
+    totals->calls += plugin->calls;
+    totals->forfeits += plugin->forfeits;
+    totals->total_us += plugin->total_us;
+    if (plugin->max_us > totals->max_us) totals->max_us = plugin->max_us;
+  }
+}
+
+/**
+ * @brief Plays one game on a seeded tetramino sequence.
+ *
+ * The model does not persist its score, so the game never touches the score
+ * file.
+ *
+ * @param config The settings of the tournament.
+ * @param seed The seed of the tetraminos.
+ * @param bot The plugin choosing the placements, `NULL` for the greedy
+ * policy. Its bot is replaced by one created from `seed`, so the game does
+ * not depend on the games the plugin played before.
+ * @param metrics The counter shard of the calling thread, `NULL` to count
+ * nothing. A game cut short by `max_ticks` counts as completed.
+ * @param[out] record The log of the game, `NULL` to keep none. Its policy is
+ * left for the caller to set.
+ * @param[out] score The final score.
+ * @param[out] ticks The ticks played.
+ * @return Error code (`0` on success).
+ */
+int play_seeded_game(const TournamentConfig_t *config, uint64_t seed,
+                     BotPlugin_t *bot, MetricsShard_t *metrics,
+                     GameRecord_t *record, int *score, long long int *ticks) {
+  ModelInfo_t model;
+  ModelDriver_t driver;
+  int error = init_model(&model, config->width, config->height);
+  *score = 0;
+  *ticks = 0;
+  if (!error && bot) error = bot_reseed(bot, seed);
+  if (!error) {
+    seed_model(&model, seed);
+    model.no_persist = true;
+    model.metrics = metrics;
+    if (record) record_start(record, seed, config->width, config->height, 0);
+    model.state = Start_state;
+    model.pause = 2;
+    model.user_action = Start;
+    model.hold = true;
+    run_tick(&model, TICK_MS);
+    driver_init(&driver);
+    driver.bot = bot;
+    while (model.pause == 0 && *ticks < config->max_ticks) {
+      driver_input(&driver, &model);
+      if (record && model.hold)
+        error += record_input(record, *ticks, model.user_action);
+      run_tick(&model, TICK_MS);
+      (*ticks)++;
+    }
+    *score = model.score;
+    if (metrics && model.pause == 0) METRIC_ADD(metrics->games, 1);
+    if (record) {
+      record->score = model.score;
+      record->level = model.level;
+      record->ticks = *ticks;
+    }
+  }
+  release_model_buffers(&model);
+  return error;
+}
+
+/**
+ * @brief Computes the distribution of a set of scores.
+ *
+ * @param scores The scores.
+ * @param count The number of scores (at least 1).
+ * @param[out] summary The distribution.
+ */
+void summarize_scores(const int *scores, int count, ScoreSummary_t *summary) {
+  double sum = 0, squares = 0;
+  summary->min = INT_MAX;
+  summary->max = INT_MIN;
+  for (int i = 0; i < count; i++) {
+    sum += scores[i];
+    if (scores[i] < summary->min) summary->min = scores[i];
+    if (scores[i] > summary->max) summary->max = scores[i];
+  }
+  summary->mean = sum / count;
+  for (int i = 0; i < count; i++)
+    squares += (scores[i] - summary->mean) * (scores[i] - summary->mean);
+  summary->stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+  double margin = CONFIDENCE_Z * summary->stddev / sqrt(count);
+  summary->low = summary->mean - margin;
+  summary->high = summary->mean + margin;
+  int *sorted = malloc(sizeof(int) * count);
+  summary->median = summary->min;
+  if (sorted) {
+    memcpy(sorted, scores, sizeof(int) * count);
+    qsort(sorted, count, sizeof(int), compare_ints);
+    summary->median = sorted[count / 2];
+    free(sorted);
+  }
+}
+
+/**
+ * @brief Compares the scores of two bots seed by seed.
+ *
+ * @param first The scores of the first bot.
+ * @param second The scores of the second bot on the same seeds.
+ * @param count The number of seeds (at least 1).
+ * @param[out] summary The comparison.
+ */
+void compare_scores(const int *first, const int *second, int count,
+                    PairSummary_t *summary) {
+  double sum = 0, squares = 0;
+  summary->wins = 0;
+  summary->ties = 0;
+  summary->losses = 0;
+  for (int i = 0; i < count; i++) {
+    summary->wins += first[i] > second[i];
+    summary->ties += first[i] == second[i];
+    summary->losses += first[i] < second[i];
+    sum += first[i] - second[i];
+  }
+  summary->mean = sum / count;
+  for (int i = 0; i < count; i++) {
+    double difference = first[i] - second[i] - summary->mean;
+    squares += difference * difference;
+  }
+  double stddev = count > 1 ? sqrt(squares / (count - 1)) : 0.0;
+  double margin = CONFIDENCE_Z * stddev / sqrt(count);
+  summary->low = summary->mean - margin;
+  summary->high = summary->mean + margin;
+}
+
+/**
+ * @brief Plays the game of one bot on one seed.
+ *
+ * @param context A pointer to the tournament.
+ * @param task The index of the game, `seed * bots + bot`.
+ * @param worker The index of the thread, which selects the plugin instance
+ * and the record.
+ */
+static void tournament_task(void *context, int task, int worker) {
+  Tournament_t *tournament = context;
+  int bot = task % tournament->bots;
+  int game = task / tournament->bots;
+  int index = bot * tournament->config.games + game;
+  BotPlugin_t *plugin = tournament->paths[bot]
+                            ? &tournament->plugins[worker][bot]
+                            : NULL;
+  GameRecord_t *record =
+      tournament->log ? &tournament->records[worker] : NULL;
+  int error = play_seeded_game(&tournament->config, tournament->seeds[game],
+                               plugin,
+                               metrics_shard(tournament->metrics, worker),
+                               record, &tournament->scores[index],
+                               &tournament->ticks[index]);
+  if (!error && record) {
+    record->policy = bot;
+    pthread_mutex_lock(&tournament->log_lock);
+    error = log_writer_append(tournament->log, record);
+    pthread_mutex_unlock(&tournament->log_lock);
+  }
+  if (error) atomic_fetch_add(&tournament->errors, 1);
+}
+
+/**
+ * @brief Orders two integers for `qsort()`.
+ *
+ * @param first A pointer to the first integer.
+ * @param second A pointer to the second integer.
+ * @return A negative, zero or positive value.
+ */
+static int compare_ints(const void *first, const void *second) {
+  int a = *(const int *)first, b = *(const int *)second;
+  return (a > b) - (a < b);
+}
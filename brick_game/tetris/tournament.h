@@ -0,0 +1,115 @@
+/**
+ * @file tournament.h
+ * @brief Round-robin tournament of bot policies on shared tetramino seeds.
+ *
+ * Every bot plays one game on each seed of the tournament, so all bots see
+ * the same tetramino sequences and the scores of two bots on a seed form a
+ * pair. Paired differences cancel most of the luck of the draw, and far
+ * fewer games are needed to tell two bots apart than with independent
+ * games. The games run as tasks on a work-stealing pool; every thread has
+ * its own instance of each plugin.
+ */
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include "bot_plugin.h"
+#include "game_log.h"
+#include "metrics.h"
+#include "work_pool.h"
+
+#define MAX_TOURNAMENT_BOTS 8
+#define CONFIDENCE_Z 1.96
+
+/**
+ * @brief Settings of a tournament.
+ *
+ * `max_ticks` ends a game that is still running after that many ticks of
+ * `TICK_MS`; the score it reached counts.
+ */
+typedef struct {
+  int games;
+  uint64_t seed;
+  int threads;
+  long long int max_ticks;
+  int width;
+  int height;
+  long long int budget_us;
+} TournamentConfig_t;
+
+/**
+ * @brief Distribution of the scores of a bot.
+ *
+ * `low` and `high` bound the 95% confidence interval of the mean (normal
+ * approximation).
+ */
+typedef struct {
+  double mean;
+  double stddev;
+  double low;
+  double high;
+  int min;
+  int median;
+  int max;
+} ScoreSummary_t;
+
+/**
+ * @brief Paired comparison of two bots over the same seeds.
+ *
+ * `mean` is the mean score difference of the first bot over the second,
+ * `low` and `high` bound its 95% confidence interval.
+ */
+typedef struct {
+  int wins;
+  int ties;
+  int losses;
+  double mean;
+  double low;
+  double high;
+} PairSummary_t;
+
+/**
+ * @brief Tournament with its pool, plugins and results.
+ *
+ * Bot `b` is the greedy policy when `paths[b]` is `NULL` and a plugin
+ * otherwise. `scores[b * games + g]` and `ticks[b * games + g]` are the
+ * results of bot `b` on seed `g`. `log`, if open, receives every game as
+ * it ends, in the order the games end, under `log_lock`; `records` holds
+ * the record each thread of the pool reuses for its games. `metrics`, if
+ * exported, holds one counter shard per thread of the pool.
+ */
+typedef struct {
+  TournamentConfig_t config;
+  int bots;
+  const char *paths[MAX_TOURNAMENT_BOTS];
+  const char *names[MAX_TOURNAMENT_BOTS];
+  BotPlugin_t (*plugins)[MAX_TOURNAMENT_BOTS];
+  WorkPool_t pool;
+  uint64_t *seeds;
+  int *scores;
+  long long int *ticks;
+  LogWriter_t *log;
+  GameRecord_t *records;
+  pthread_mutex_t log_lock;
+  MetricsRegistry_t *metrics;
+  atomic_int errors;
+  double seconds;
+} Tournament_t;
+
+int tournament_init(Tournament_t *tournament, const TournamentConfig_t *config,
+                    const char *const *paths, int bots);
+void tournament_free(Tournament_t *tournament);
+int tournament_open_log(Tournament_t *tournament, const char *path);
+int tournament_close_log(Tournament_t *tournament);
+int tournament_export_metrics(Tournament_t *tournament, const char *path,
+                              long long int interval_ms);
+void tournament_run(Tournament_t *tournament);
+void tournament_bot_totals(const Tournament_t *tournament, int bot,
+                           BotPlugin_t *totals);
+int play_seeded_game(const TournamentConfig_t *config, uint64_t seed,
+                     BotPlugin_t *bot, MetricsShard_t *metrics,
+                     GameRecord_t *record, int *score, long long int *ticks);
+void summarize_scores(const int *scores, int count, ScoreSummary_t *summary);
+void compare_scores(const int *first, const int *second, int count,
+                    PairSummary_t *summary);
+
+#endif
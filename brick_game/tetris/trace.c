@@ -0,0 +1,128 @@
+/**
+ * @file trace.c
+ * @brief Per-thread ring buffers of trace events and their JSON export.
+ */
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+#define TRACE_PATH_SIZE 256
+
+/**
+ * @brief Ring buffer of the events recorded by one thread.
+ */
+typedef struct {
+  TraceEvent_t events[TRACE_BUFFER_EVENTS];
+  unsigned long long written;
+  int tid;
+} TraceBuffer_t;
+
+atomic_bool trace_enabled = false;
+
+static char trace_path[TRACE_PATH_SIZE];
+static TraceBuffer_t *buffers[TRACE_MAX_THREADS];
+static atomic_int buffer_count;
+static _Thread_local TraceBuffer_t *thread_buffer;
+
+/**
+ * @brief Enables tracing into the given file.
+ *
+ * @param path The path of the JSON file written by `trace_stop()`.
+ * @return `true` if tracing was enabled.
+ */
+bool trace_start(const char *path) {
+  bool started = false;
+  if (path && *path && strlen(path) < TRACE_PATH_SIZE) {
+    strcpy(trace_path, path);
+    atomic_store_explicit(&trace_enabled, true, memory_order_relaxed);
+    started = true;
+  }
+  return started;
+}
+
+/**
+ * @brief Enables tracing if the `TETRIS_TRACE` environment variable is set.
+ *
+ * @return `true` if tracing was enabled.
+ */
+bool trace_start_from_env() { return trace_start(getenv(TRACE_ENV)); }
+
+/**
+ * @brief Records an event into the ring buffer of the calling thread.
+ *
+ * The buffer is allocated on the first event of the thread. When it is full
+ * the oldest events are overwritten.
+ *
+ * @param name The name of the traced phase (must be a string literal).
+ * @param phase `'B'` for the beginning and `'E'` for the end of the phase.
+ */
+void trace_event(const char *name, char phase) {
+  if (!thread_buffer) {
+    int index = atomic_fetch_add(&buffer_count, 1);
+    if (index < TRACE_MAX_THREADS) {
+      thread_buffer = calloc(1, sizeof(TraceBuffer_t));
+      if (thread_buffer) thread_buffer->tid = index + 1;
+      buffers[index] = thread_buffer;
+    }
+  }
+  if (thread_buffer) {
+    TraceEvent_t *event =
+        &thread_buffer->events[thread_buffer->written %
+                               TRACE_BUFFER_EVENTS];
+    event->name = name;
+    event->timestamp = monotonic_us();
+    event->phase = phase;
+    thread_buffer->written++;
+  }
+}
+
+/**
+ * @brief Writes the events of one buffer as JSON objects.
+ *
+ * @param file The output file.
+ * @param buffer The ring buffer to write.
+ * @param first Whether no event has been written to the file yet.
+ * @return Whether no event has been written to the file yet.
+ */
+static bool write_buffer(FILE *file, const TraceBuffer_t *buffer, bool first) {
+  unsigned long long start = 0;
+  if (buffer->written > TRACE_BUFFER_EVENTS)
+    start = buffer->written - TRACE_BUFFER_EVENTS;
+  for (unsigned long long i = start; i < buffer->written; i++) {
+    const TraceEvent_t *event = &buffer->events[i % TRACE_BUFFER_EVENTS];
+    fprintf(file,
+            "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,"
+            "\"tid\":%d}",
+            first ? "" : ",", event->name, event->phase, event->timestamp,
+            buffer->tid);
+    first = false;
+  }
+  return first;
+}
+
+/**
+ * @brief Disables tracing and writes all recorded events to the trace file.
+ *
+ * Should be called after the traced threads have finished. The buffers stay
+ * allocated until the process exits.
+ */
+void trace_stop() {
+  if (atomic_exchange_explicit(&trace_enabled, false, memory_order_relaxed)) {
+    FILE *file = fopen(trace_path, "w");
+    int count = atomic_load(&buffer_count);
+    if (count > TRACE_MAX_THREADS) count = TRACE_MAX_THREADS;
+    if (file) {
+      bool first = true;
+      fprintf(file, "{\"traceEvents\":[");
+      for (int i = 0; i < count; i++)
+        if (buffers[i]) first = write_buffer(file, buffers[i], first);
+      fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+      fclose(file);
+    }
+  }
+}
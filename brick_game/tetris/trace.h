@@ -0,0 +1,52 @@
+/**
+ * @file trace.h
+ * @brief Opt-in tracing of frame phases in Chrome trace JSON format.
+ *
+ * Tracing is enabled by the `TETRIS_TRACE` environment variable (or by
+ * `trace_start()`) which names the output file. Begin and end events are
+ * recorded into a ring buffer owned by the calling thread and written out by
+ * `trace_stop()`. The file can be opened in `chrome://tracing` or Perfetto.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define TRACE_ENV "TETRIS_TRACE"
+#define TRACE_BUFFER_EVENTS (1 << 16)
+#define TRACE_MAX_THREADS 64
+
+/**
+ * @brief One recorded trace event.
+ */
+typedef struct {
+  const char *name;
+  long long int timestamp;
+  char phase;
+} TraceEvent_t;
+
+extern atomic_bool trace_enabled;
+
+bool trace_start(const char *path);
+bool trace_start_from_env();
+void trace_stop();
+void trace_event(const char *name, char phase);
+
+/**
+ * @brief Tells whether tracing is enabled.
+ */
+#define TRACE_IS_ENABLED() \
+  atomic_load_explicit(&trace_enabled, memory_order_relaxed)
+
+#define TRACE_BEGIN(name)                           \
+  do {                                              \
+    if (TRACE_IS_ENABLED()) trace_event(name, 'B'); \
+  } while (0)
+
+#define TRACE_END(name)                             \
+  do {                                              \
+    if (TRACE_IS_ENABLED()) trace_event(name, 'E'); \
+  } while (0)
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file transposition.c
+ * @brief Lock-free transposition table.
+ */
+#include "transposition.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Returns the first entry of the bucket of a key.
+ *
+ * @param table The table.
+ * @param key The key of the position.
+ * @return A pointer to `TABLE_BUCKET_ENTRIES` entries.
+ */
+static TableEntry_t *table_bucket(const TranspositionTable_t *table,
+                                  uint64_t key) {
+  return table->entries +
+         (key & table->mask & ~(uint64_t)(TABLE_BUCKET_ENTRIES - 1));
+}
+
+/**
+ * @brief Allocates a table of `2^bits` entries and clears it.
+ *
+ * @param[out] table The table to set up.
+ * @param bits The binary logarithm of the number of entries
+ * (`MIN_TABLE_BITS` to `MAX_TABLE_BITS`).
+ * @return Error code (`0` on success).
+ */
+int table_init(TranspositionTable_t *table, int bits) {
+  int error = bits >= MIN_TABLE_BITS && bits <= MAX_TABLE_BITS ? 0 : 1;
+  table->entries = NULL;
+  table->mask = 0;
+  if (!error) {
+    table->entries = aligned_alloc(sizeof(TableEntry_t) * TABLE_BUCKET_ENTRIES,
+                                   sizeof(TableEntry_t) << bits);
+    if (!table->entries) error++;
+  }
+  if (!error) {
+    table->mask = ((uint64_t)1 << bits) - 1;
+    table_clear(table);
+  }
+  return error;
+}
+
+/**
+ * @brief Frees the entries of a table.
+ *
+ * @param table The table.
+ */
+void table_free(TranspositionTable_t *table) {
+  free(table->entries);
+  table->entries = NULL;
+  table->mask = 0;
+}
+
+/**
+ * @brief Removes every entry of a table.
+ *
+ * Must not run while other threads use the table.
+ *
+ * @param table The table.
+ */
+void table_clear(TranspositionTable_t *table) {
+  for (uint64_t i = 0; table->entries && i <= table->mask; i++) {
+    atomic_init(&table->entries[i].check, 0);
+    atomic_init(&table->entries[i].data, 0);
+  }
+}
+
+/**
+ * @brief Looks up the value stored for a key.
+ *
+ * @param table The table.
+ * @param key The key of the position.
+ * @param[out] value The stored value, set only on a hit.
+ * @return `true` if the key was found.
+ */
+bool table_probe(const TranspositionTable_t *table, uint64_t key,
+                 double *value) {
+  const TableEntry_t *bucket = table_bucket(table, key);
+  bool is_found = false;
+  for (int i = 0; !is_found && i < TABLE_BUCKET_ENTRIES; i++) {
+    uint64_t check = atomic_load_explicit(&bucket[i].check,
+                                          memory_order_relaxed);
+    uint64_t data = atomic_load_explicit(&bucket[i].data,
+                                         memory_order_relaxed);
+    if ((check ^ data) == key) {
+      memcpy(value, &data, sizeof(data));
+      is_found = true;
+    }
+  }
+  return is_found;
+}
+
+/**
+ * @brief Stores the value of a key.
+ *
+ * The entry of the same key is overwritten, otherwise an empty entry of the
+ * bucket is used, otherwise an entry picked by the key is replaced.
+ *
+ * @param table The table.
+ * @param key The key of the position.
+ * @param value The value to store.
+ */
+void table_store(TranspositionTable_t *table, uint64_t key, double value) {
+  TableEntry_t *bucket = table_bucket(table, key);
+  int slot = -1;
+  for (int i = 0; slot < 0 && i < TABLE_BUCKET_ENTRIES; i++) {
+    uint64_t check = atomic_load_explicit(&bucket[i].check,
+                                          memory_order_relaxed);
+    uint64_t data = atomic_load_explicit(&bucket[i].data,
+                                         memory_order_relaxed);
+    if ((check ^ data) == key || (!check && !data)) slot = i;
+  }
+  if (slot < 0) slot = (int)(key >> 62) % TABLE_BUCKET_ENTRIES;
+  uint64_t data;
+  memcpy(&data, &value, sizeof(data));
+  atomic_store_explicit(&bucket[slot].data, data, memory_order_relaxed);
+  atomic_store_explicit(&bucket[slot].check, key ^ data, memory_order_relaxed);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file transposition.h
+ * @brief Fixed-size, lock-free transposition table for placement search.
+ *
+ * The table maps 64-bit position keys to the values computed for them, so
+ * positions reached through different placement orders are evaluated once.
+ * Entries are grouped in buckets of one cache line. Every entry is two 64-bit
+ * atomic words, the value and the key XOR the value: a reader that sees a
+ * half-written entry computes a wrong key and treats it as a miss, so threads
+ * share one table without locks.
+ */
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TABLE_BUCKET_ENTRIES 4
+#define MIN_TABLE_BITS 2
+#define MAX_TABLE_BITS 30
+
+/**
+ * @brief Entry of the transposition table.
+ */
+typedef struct {
+  _Atomic uint64_t check;
+  _Atomic uint64_t data;
+} TableEntry_t;
+
+/**
+ * @brief Transposition table of `mask + 1` entries.
+ */
+typedef struct {
+  TableEntry_t *entries;
+  uint64_t mask;
+} TranspositionTable_t;
+
+int table_init(TranspositionTable_t *table, int bits);
+void table_free(TranspositionTable_t *table);
+void table_clear(TranspositionTable_t *table);
+bool table_probe(const TranspositionTable_t *table, uint64_t key,
+                 double *value);
+void table_store(TranspositionTable_t *table, uint64_t key, double value);
+
+#endif
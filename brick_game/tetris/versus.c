@@ -0,0 +1,194 @@
+/**
+ * @file versus.c
+ * @brief Two-player versus match of two independent engines.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "versus.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+
+static void *versus_thread(void *data);
+
+/**
+ * @brief Creates the models of a match and connects their garbage queues.
+ *
+ * Both players are bots until a frontend hands one of them to a human.
+ *
+ * @param[out] versus The match.
+ * @param width The number of columns of the fields.
+ * @param height The number of rows of the fields.
+ * @param seed The seed of the tetraminos and of the garbage holes.
+ * @return Error code (`0` on success).
+ */
+int versus_init(Versus_t *versus, int width, int height, uint64_t seed) {
+  int error = 0;
+  for (int i = 0; i < VERSUS_PLAYERS; i++) {
+    VersusPlayer_t *player = &versus->players[i];
+    error += init_model(&player->model, width, height);
+    player->model.no_persist = true;
+    if (!error) error += move_model_to_arena(&player->model, width, height);
+    garbage_init(&player->inbox);
+    player->model.garbage_in = &player->inbox;
+    player->model.garbage_out = &versus->players[1 - i].inbox;
+    player->model.garbage_rng = random_next(&seed);
+    driver_init(&player->driver);
+    player->is_bot = true;
+    atomic_init(&player->ticks, 0);
+  }
+  atomic_init(&versus->loser, VERSUS_RUNNING);
+  versus->max_ticks = LLONG_MAX;
+  versus->piece_seed = random_next(&seed);
+  if (error) versus_free(versus);
+  return error;
+}
+
+/**
+ * @brief Releases the models of a match.
+ *
+ * @param versus The match.
+ */
+void versus_free(Versus_t *versus) {
+  for (int i = 0; i < VERSUS_PLAYERS; i++)
+    run_terminate_actions(&versus->players[i].model);
+}
+
+/**
+ * @brief Starts a new round on both fields.
+ *
+ * The garbage queues are emptied, so no engine may be running. The drivers
+ * keep their policies. Both players get the same tetraminos, a new sequence
+ * every round.
+ *
+ * @param versus The match.
+ */
+void versus_start(Versus_t *versus) {
+  for (int i = 0; i < VERSUS_PLAYERS; i++) {
+    VersusPlayer_t *player = &versus->players[i];
+    ModelInfo_t *model = &player->model;
+    garbage_init(&player->inbox);
+    seed_model(model, versus->piece_seed);
+    model->garbage_sent = 0;
+    model->garbage_received = 0;
+    model->state = Start_state;
+    model->pause = 2;
+    model->user_action = Start;
+    model->hold = true;
+    run_tick(model, TICK_MS);
+    driver_reset(&player->driver);
+    atomic_store(&player->ticks, 0);
+  }
+  random_next(&versus->piece_seed);
+  atomic_store(&versus->loser, VERSUS_RUNNING);
+}
+
+/**
+ * @brief Runs one logical tick of one player.
+ *
+ * Bots get their input from the autoplay driver, humans give it through the
+ * model before the tick.
+ *
+ * @param versus The match.
+ * @param player The index of the player.
+ * @return `false` once the round is over.
+ */
+bool versus_tick(Versus_t *versus, int player) {
+  VersusPlayer_t *self = &versus->players[player];
+  bool is_running = atomic_load(&versus->loser) == VERSUS_RUNNING &&
+                    self->model.pause == 0;
+  if (is_running) {
+    if (self->is_bot) driver_input(&self->driver, &self->model);
+    run_tick(&self->model, TICK_MS);
+    is_running = versus_check(versus, player);
+  }
+  return is_running;
+}
+
+/**
+ * @brief Records the player as the loser if it topped out.
+ *
+ * Only the first player to top out loses.
+ *
+ * @param versus The match.
+ * @param player The index of the player.
+ * @return `false` once the round is over.
+ */
+bool versus_check(Versus_t *versus, int player) {
+  ModelInfo_t *model = &versus->players[player].model;
+  if (model->pause == 2 || model->pause == EXIT_GAME) {
+    int running = VERSUS_RUNNING;
+    atomic_compare_exchange_strong(&versus->loser, &running, player);
+  }
+  return atomic_load(&versus->loser) == VERSUS_RUNNING;
+}
+
+/**
+ * @brief Returns the winner of a round.
+ *
+ * @param versus The match.
+ * @return The index of the winner, or `VERSUS_RUNNING` if no one lost yet and
+ * the scores are equal.
+ */
+int versus_winner(const Versus_t *versus) {
+  int loser = atomic_load(&versus->loser);
+  int winner = VERSUS_RUNNING;
+  int first = versus->players[0].model.score;
+  int second = versus->players[1].model.score;
+  if (loser != VERSUS_RUNNING)
+    winner = 1 - loser;
+  else if (first != second)
+    winner = first > second ? 0 : 1;
+  return winner;
+}
+
+/**
+ * @brief Plays a round between the two bots, each on its own thread.
+ *
+ * A thread that gets more than `VERSUS_MAX_SKEW_TICKS` ahead of the other
+ * yields until the other catches up, so the attacks arrive at about the same
+ * simulated time as in a real-time match.
+ *
+ * @param versus The match.
+ * @param max_ticks The ticks after which the round ends in a draw or a win on
+ * score.
+ * @return Error code (`0` on success).
+ */
+int versus_run_bots(Versus_t *versus, long long int max_ticks) {
+  pthread_t thread;
+  VersusThread_t arguments[VERSUS_PLAYERS] = {{versus, 0}, {versus, 1}};
+  versus->max_ticks = max_ticks;
+  versus_start(versus);
+  int error = pthread_create(&thread, NULL, versus_thread, &arguments[1]);
+  if (!error) {
+    versus_thread(&arguments[0]);
+    pthread_join(thread, NULL);
+  }
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Plays one player of a bot round until it ends.
+ *
+ * @param data A pointer to the `VersusThread_t` of the player.
+ * @return `NULL`.
+ */
+static void *versus_thread(void *data) {
+  VersusThread_t *argument = data;
+  Versus_t *versus = argument->versus;
+  VersusPlayer_t *self = &versus->players[argument->player];
+  VersusPlayer_t *other = &versus->players[1 - argument->player];
+  long long int ticks = 0;
+  bool is_running = true;
+  while (is_running && ticks < versus->max_ticks) {
+    is_running = versus_tick(versus, argument->player);
+    atomic_store_explicit(&self->ticks, ++ticks, memory_order_release);
+    while (is_running &&
+           ticks - atomic_load_explicit(&other->ticks, memory_order_acquire) >
+               VERSUS_MAX_SKEW_TICKS &&
+           atomic_load(&versus->loser) == VERSUS_RUNNING)
+      sched_yield();
+  }
+  return NULL;
+}
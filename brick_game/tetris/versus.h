@@ -0,0 +1,66 @@
+/**
+ * @file versus.h
+ * @brief Two-player versus match of two independent engines.
+ *
+ * Every player has its own game model. Lines cleared by one player are sent
+ * as garbage rows to the other through the lock-free queue owned by the
+ * receiver, and inserted into its field when its next tetramino spawns. The
+ * first player to top out loses. Bot-versus-bot matches run each engine on
+ * its own thread at full simulation speed; the only shared state are the two
+ * garbage queues and a few atomics, so the engines never wait on a lock.
+ */
+#ifndef VERSUS_H
+#define VERSUS_H
+
+#include "autoplay.h"
+
+#define VERSUS_PLAYERS 2
+#define VERSUS_MAX_SKEW_TICKS 20
+#define VERSUS_RUNNING -1
+
+/**
+ * @brief One player of a match.
+ *
+ * `inbox` receives the attacks of the opponent. `ticks` is published by the
+ * thread of the player so that the opponent can stay within
+ * `VERSUS_MAX_SKEW_TICKS` of it.
+ */
+typedef struct {
+  ModelInfo_t model;
+  ModelDriver_t driver;
+  GarbageQueue_t inbox;
+  bool is_bot;
+  _Alignas(64) atomic_llong ticks;
+} VersusPlayer_t;
+
+/**
+ * @brief Versus match.
+ *
+ * `loser` is the index of the first player to top out, `VERSUS_RUNNING` while
+ * both are alive. `piece_seed` is the seed of the tetraminos of the next
+ * round.
+ */
+typedef struct {
+  VersusPlayer_t players[VERSUS_PLAYERS];
+  atomic_int loser;
+  long long int max_ticks;
+  uint64_t piece_seed;
+} Versus_t;
+
+/**
+ * @brief Argument of the thread running one player of a match.
+ */
+typedef struct {
+  Versus_t *versus;
+  int player;
+} VersusThread_t;
+
+int versus_init(Versus_t *versus, int width, int height, uint64_t seed);
+void versus_free(Versus_t *versus);
+void versus_start(Versus_t *versus);
+bool versus_tick(Versus_t *versus, int player);
+bool versus_check(Versus_t *versus, int player);
+int versus_winner(const Versus_t *versus);
+int versus_run_bots(Versus_t *versus, long long int max_ticks);
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * @file work_pool.c
+ * @brief Work-stealing thread pool.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "work_pool.h"
+
+#include <unistd.h>
+
+static void *pool_thread(void *data);
+static void pool_work(WorkPool_t *pool, int index);
+static bool pool_take(WorkPool_t *pool, int index, int *task);
+
+/**
+ * @brief Starts the threads of a pool.
+ *
+ * @param[out] pool The pool to set up.
+ * @param threads The number of threads, the caller included (1 to
+ * `MAX_POOL_THREADS`).
+ * @return Error code (`0` on success).
+ */
+int pool_init(WorkPool_t *pool, int threads) {
+  int error = threads >= 1 && threads <= MAX_POOL_THREADS ? 0 : 1;
+  pool->threads = 0;
+  if (!error) {
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->function = NULL;
+    pool->context = NULL;
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->steals, 0);
+    pool->generation = 0;
+    pool->is_stopping = false;
+    for (int i = 0; i < threads; i++) {
+      pthread_mutex_init(&pool->ranges[i].lock, NULL);
+      pool->ranges[i].first = 0;
+      pool->ranges[i].last = 0;
+      pool->workers[i] = (PoolThread_t){pool, i};
+    }
+    pool->threads = 1;
+    for (int i = 1; !error && i < threads; i++) {
+      if (pthread_create(&pool->ids[i], NULL, pool_thread, &pool->workers[i]))
+        error++;
+      else
+        pool->threads++;
+    }
+    if (error) pool_free(pool);
+  }
+  return error;
+}
+
+/**
+ * @brief Runs a batch of tasks on the pool and waits for it to finish.
+ *
+ * @param pool The pool.
+ * @param function The function running a task.
+ * @param context The context passed to the function.
+ * @param tasks The number of tasks.
+ */
+void pool_run(WorkPool_t *pool, PoolTask_t function, void *context,
+              int tasks) {
+  if (tasks > 0) {
+    pool->function = function;
+    pool->context = context;
+    atomic_store(&pool->pending, tasks);
+    for (int i = 0; i < pool->threads; i++) {
+      pthread_mutex_lock(&pool->ranges[i].lock);
+      pool->ranges[i].first = (int)((long long int)tasks * i / pool->threads);
+      pool->ranges[i].last =
+          (int)((long long int)tasks * (i + 1) / pool->threads);
+      pthread_mutex_unlock(&pool->ranges[i].lock);
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool_work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&pool->pending) > 0)
+      pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+  }
+}
+
+/**
+ * @brief Stops the threads of a pool and releases it.
+ *
+ * @param pool The pool.
+ */
+void pool_free(WorkPool_t *pool) {
+  if (pool->threads > 0) {
+    pthread_mutex_lock(&pool->lock);
+    pool->is_stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threads; i++) pthread_join(pool->ids[i], NULL);
+    for (int i = 0; i < pool->threads; i++)
+      pthread_mutex_destroy(&pool->ranges[i].lock);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pool->threads = 0;
+  }
+}
+
+/**
+ * @brief Returns the number of online processors, at most
+ * `MAX_POOL_THREADS`.
+ *
+ * @return The number of threads to use by default.
+ */
+int default_thread_count() {
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  return processors < 1                  ? 1
+         : processors > MAX_POOL_THREADS ? MAX_POOL_THREADS
+                                         : (int)processors;
+}
+
+/**
+ * @brief Waits for batches and works on them until the pool stops.
+ *
+ * @param data A pointer to the `PoolThread_t` of the thread.
+ * @return `NULL`.
+ */
+static void *pool_thread(void *data) {
+  PoolThread_t *worker = data;
+  WorkPool_t *pool = worker->pool;
+  long long int seen = 0;
+  bool is_running = true;
+  while (is_running) {
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->is_stopping && pool->generation == seen)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    seen = pool->generation;
+    is_running = !pool->is_stopping;
+    pthread_mutex_unlock(&pool->lock);
+    if (is_running) pool_work(pool, worker->index);
+  }
+  return NULL;
+}
+
+/**
+ * @brief Runs tasks until none is left to take.
+ *
+ * The thread that finishes the last task of the batch wakes the caller.
+ *
+ * @param pool The pool.
+ * @param index The index of the thread.
+ */
+static void pool_work(WorkPool_t *pool, int index) {
+  int task;
+  while (pool_take(pool, index, &task)) {
+    pool->function(pool->context, task, index);
+    if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+      pthread_mutex_lock(&pool->lock);
+      pthread_cond_broadcast(&pool->done);
+      pthread_mutex_unlock(&pool->lock);
+    }
+  }
+}
+
+/**
+ * @brief Takes a task from the back of the thread's own range, or steals one
+ * from the front of another range.
+ *
+ * @param pool The pool.
+ * @param index The index of the thread.
+ * @param[out] task The task taken.
+ * @return `false` if every range is empty.
+ */
+static bool pool_take(WorkPool_t *pool, int index, int *task) {
+  bool is_taken = false;
+  for (int i = 0; !is_taken && i < pool->threads; i++) {
+    TaskRange_t *range = &pool->ranges[(index + i) % pool->threads];
+    pthread_mutex_lock(&range->lock);
+    if (range->first < range->last) {
+      *task = i ? range->first++ : --range->last;
+      is_taken = true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    if (is_taken && i) atomic_fetch_add(&pool->steals, 1);
+  }
+  return is_taken;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file work_pool.h
+ * @brief Work-stealing thread pool for batches of independent tasks.
+ *
+ * A batch of tasks numbered from 0 is split into contiguous ranges, one per
+ * thread. Each thread takes tasks from the back of its own range and, once it
+ * is empty, steals from the front of the ranges of the other threads, so
+ * tasks of uneven cost keep every core busy. The thread that runs a batch
+ * works on it too and returns when all tasks are done.
+ */
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#define MAX_POOL_THREADS 64
+
+/**
+ * @brief Function running one task of a batch.
+ *
+ * @param context The context of the batch.
+ * @param task The index of the task.
+ * @param worker The index of the thread running it (0 is the caller).
+ */
+typedef void (*PoolTask_t)(void *context, int task, int worker);
+
+/**
+ * @brief Range of tasks owned by a thread, `first` to `last - 1`.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  int first;
+  int last;
+} TaskRange_t;
+
+typedef struct WorkPool_t WorkPool_t;
+
+/**
+ * @brief Argument of a pool thread.
+ */
+typedef struct {
+  WorkPool_t *pool;
+  int index;
+} PoolThread_t;
+
+/**
+ * @brief Thread pool.
+ *
+ * `threads` counts the caller, so a pool of one thread runs every batch on
+ * the calling thread. `steals` counts the tasks taken from another thread's
+ * range.
+ */
+struct WorkPool_t {
+  pthread_t ids[MAX_POOL_THREADS];
+  PoolThread_t workers[MAX_POOL_THREADS];
+  TaskRange_t ranges[MAX_POOL_THREADS];
+  int threads;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  PoolTask_t function;
+  void *context;
+  atomic_int pending;
+  long long int generation;
+  bool is_stopping;
+  atomic_llong steals;
+};
+
+int pool_init(WorkPool_t *pool, int threads);
+void pool_run(WorkPool_t *pool, PoolTask_t function, void *context,
+              int tasks);
+void pool_free(WorkPool_t *pool);
+int default_thread_count();
+
+#endif
@@ -0,0 +1,90 @@
+/**
+ * @file tetris_bot.h
+ * @brief C ABI of bot plugins loaded with `dlopen()`.
+ *
+ * A plugin is a shared library that depends on the standard headers only and
+ * exports `tetrisBotApi()`, which returns a static `TetrisBotApi_t`. The host
+ * creates one bot per game and, when a tetramino appears, calls `choose` with
+ * a read-only copy of the game and the deadline of the move. The bot answers
+ * with a placement (orientation and column); the host then rotates, moves and
+ * drops the tetramino there through the usual user input.
+ *
+ * The deadline is cooperative: a bot should check `now_us()` against
+ * `deadline_us` and return its best placement so far once it is reached. A
+ * move returned after the deadline, an error or a placement that does not fit
+ * forfeits the move: the tetramino falls straight down from where it
+ * appeared.
+ */
+#ifndef TETRIS_BOT_H
+#define TETRIS_BOT_H
+
+#include <stdint.h>
+
+#define TETRIS_BOT_ABI_VERSION 1
+#define TETRIS_BOT_ENTRY "tetrisBotApi"
+#define TETRIS_BOT_MAX_ROWS 24
+#define TETRIS_BOT_ROTATIONS 4
+#define TETRIS_BOT_SHAPE_ROWS 5
+
+/**
+ * @brief Game given to a bot.
+ *
+ * Bit `x` of `rows[y]` is set when the cell in column `x` of row `y` is
+ * occupied; row 0 is the top. Bit `j` of `shapes[r][i]` is set when the
+ * tetramino in orientation `r` covers column `x_position + j` of row
+ * `y_position + i`; orientations `0` to `rotations - 1` are distinct.
+ * Times are `CLOCK_MONOTONIC` microseconds.
+ */
+typedef struct {
+  int width;
+  int height;
+  uint64_t rows[TETRIS_BOT_MAX_ROWS];
+  int piece;
+  int rotation;
+  int x_position;
+  int y_position;
+  int rotations;
+  uint8_t shapes[TETRIS_BOT_ROTATIONS][TETRIS_BOT_SHAPE_ROWS];
+  int next_piece;
+  int next_rotations;
+  uint8_t next_shapes[TETRIS_BOT_ROTATIONS][TETRIS_BOT_SHAPE_ROWS];
+  int score;
+  int lines;
+  int level;
+  long long int deadline_us;
+  long long int (*now_us)(void);
+} TetrisBotState_t;
+
+/**
+ * @brief Placement chosen by a bot: the orientation and the column of the
+ * shape, which may be negative.
+ */
+typedef struct {
+  int rotation;
+  int x_position;
+} TetrisBotMove_t;
+
+/**
+ * @brief Functions of a plugin.
+ *
+ * `create` returns the state of a new bot (`NULL` on failure) and `destroy`
+ * releases it. `choose` returns `0` when it filled `move`. A bot is only used
+ * by one thread at a time; bots of different games may run concurrently.
+ */
+typedef struct {
+  int abi_version;
+  const char *name;
+  void *(*create)(uint64_t seed);
+  int (*choose)(void *bot, const TetrisBotState_t *state,
+                TetrisBotMove_t *move);
+  void (*destroy)(void *bot);
+} TetrisBotApi_t;
+
+/**
+ * @brief Type of the `tetrisBotApi()` entry point.
+ */
+typedef const TetrisBotApi_t *(*TetrisBotEntry_t)(void);
+
+const TetrisBotApi_t *tetrisBotApi(void);
+
+#endif
@@ -0,0 +1,41 @@
+/**
+ * @file tetris_env.h
+ * @brief Batched C ABI stepping many games in one call.
+ *
+ * This header is the interface of `libtetris.so` and depends on the standard
+ * headers only, so it can be bound from other languages (e.g. Python
+ * `ctypes`). An environment holds `count` independent games. Every call takes
+ * one action per game and writes into caller-provided buffers:
+ *
+ * - observations: `count` blocks of `tetrisEnvObservationSize()` bytes, each
+ *   the field row by row (0 empty, 1 occupied, 2 falling tetramino) followed
+ *   by the current and the next tetramino type (1 to 7);
+ * - rewards: `count` floats, the score gained by the step;
+ * - dones: `count` bytes, 1 when the game of the step ended.
+ *
+ * A finished game is restarted with a new seed within the same call, so its
+ * observation is the first one of the next game. No memory is allocated after
+ * `tetrisEnvCreate()`.
+ */
+#ifndef TETRIS_ENV_H
+#define TETRIS_ENV_H
+
+#include <stdint.h>
+
+/**
+ * @brief Opaque batch of games.
+ */
+typedef struct TetrisEnv_t TetrisEnv_t;
+
+TetrisEnv_t *tetrisEnvCreate(int count, int width, int height, uint64_t seed);
+void tetrisEnvDestroy(TetrisEnv_t *env);
+int tetrisEnvObservationSize(const TetrisEnv_t *env);
+int tetrisEnvPlacementCount(const TetrisEnv_t *env);
+void tetrisEnvReset(TetrisEnv_t *env, uint8_t *observations);
+int tetrisEnvStep(TetrisEnv_t *env, const int32_t *actions,
+                  uint8_t *observations, float *rewards, uint8_t *dones);
+int tetrisEnvStepPlacements(TetrisEnv_t *env, const int32_t *placements,
+                            uint8_t *observations, float *rewards,
+                            uint8_t *dones);
+
+#endif
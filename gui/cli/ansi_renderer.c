@@ -0,0 +1,301 @@
+/**
+ * @file ansi_renderer.c
+ * @brief Renderer writing raw ANSI escape sequences.
+ *
+ * Every frame is built in a buffer allocated once by `ansi_open()`: cursor
+ * moves, SGR colour changes and cells of the rows that changed since the
+ * previous frame, followed by the side panel. The buffer is sent to the
+ * terminal with a single `write()`.
+ */
+#include <stdarg.h>
+#include <sys/ioctl.h>
+
+#include "renderer.h"
+
+#define ANSI_ENTER "\x1b[?1049h\x1b[?25l\x1b[2J"
+#define ANSI_LEAVE "\x1b[0m\x1b[?25h\x1b[?1049l"
+#define ANSI_RESET "\x1b[0m"
+#define ANSI_CLEAR_LINE "\x1b[K"
+#define BOX_HORIZONTAL "\xe2\x94\x80"
+#define BOX_VERTICAL "\xe2\x94\x82"
+#define BOX_TOP_LEFT "\xe2\x94\x8c"
+#define BOX_TOP_RIGHT "\xe2\x94\x90"
+#define BOX_BOTTOM_LEFT "\xe2\x94\x94"
+#define BOX_BOTTOM_RIGHT "\xe2\x94\x98"
+#define FIELD_TOP 2
+#define FIELD_LEFT 2
+#define PANEL_COLUMNS 24
+
+/**
+ * @brief Background colours of the tetraminoes and of the garbage rows,
+ * matching the ncurses colour pairs.
+ */
+static const int ansi_colors[GARBAGE_CELL + 1] = {0,  43, 46, 45, 42,
+                                                  41, 44, 47, 100};
+
+/**
+ * @brief Sets up a renderer that writes ANSI escape sequences.
+ *
+ * @param[out] renderer The renderer to set up.
+ */
+void init_ansi_renderer(Renderer_t *renderer) {
+  renderer->open = ansi_open;
+  renderer->draw = ansi_draw;
+  renderer->close = ansi_close;
+  renderer->data = NULL;
+}
+
+/**
+ * @brief Allocates the frame buffer and switches the terminal to the alternate
+ * screen.
+ *
+ * Fields taller than the terminal are shown from the bottom up to the rows
+ * that fit on the screen. Fields wider than the terminal are shown around
+ * their centre, where the tetraminos spawn, leaving room for the side panel.
+ *
+ * @param renderer The renderer.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @return `false` if the buffers could not be allocated.
+ */
+bool ansi_open(Renderer_t *renderer, int width, int height) {
+  AnsiRenderer_t *ansi = calloc(1, sizeof(AnsiRenderer_t));
+  bool is_ok = ansi != NULL;
+  if (is_ok) {
+    ALLOC_COUNT(Frontend_site, sizeof(AnsiRenderer_t));
+    ansi->width = width;
+    ansi->height = height;
+    ansi->visible_rows = height;
+    ansi->visible_columns = width;
+    struct winsize size;
+    if (!ioctl(STDOUT_FILENO, TIOCGWINSZ, &size)) {
+      int columns = (size.ws_col - FIELD_LEFT - PANEL_COLUMNS - 3) / 2;
+      if (size.ws_row > 3 && ansi->visible_rows > size.ws_row - 3)
+        ansi->visible_rows = size.ws_row - 3;
+      if (columns > 0 && ansi->visible_columns > columns)
+        ansi->visible_columns = columns;
+    }
+    ansi->first_column = (width - ansi->visible_columns) / 2;
+    ansi->capacity =
+        (size_t)(ansi->visible_rows + 2) *
+            (ansi->visible_columns * 2 * ANSI_CELL_BYTES + ANSI_ROW_BYTES) +
+        ANSI_PANEL_BYTES;
+    ansi->buffer = malloc(ansi->capacity);
+    ansi->previous = calloc((size_t)width * height, sizeof(uint8_t));
+    if (ansi->buffer) ALLOC_COUNT(Frontend_site, ansi->capacity);
+    if (ansi->previous) ALLOC_COUNT(Frontend_site, (size_t)width * height);
+    is_ok = ansi->buffer && ansi->previous;
+    renderer->data = ansi;
+  }
+  if (is_ok) {
+    ansi_append(ansi, ANSI_ENTER, strlen(ANSI_ENTER));
+    ansi_flush(ansi);
+  } else if (ansi) {
+    ansi_close(renderer);
+  }
+  return is_ok;
+}
+
+/**
+ * @brief Draws a frame of the game with one `write()`.
+ *
+ * The border is drawn with the first frame. Field rows are sent only when
+ * they differ from the previous frame or the pause state has changed.
+ *
+ * @param renderer The renderer.
+ * @param gameInfo A pointer to the packed game state to draw.
+ */
+void ansi_draw(Renderer_t *renderer, const PackedGameInfo_t *gameInfo) {
+  TRACE_BEGIN("ansi_draw");
+  AnsiRenderer_t *ansi = renderer->data;
+  int first_row = ansi->height - ansi->visible_rows;
+  bool redraw = !ansi->has_frame || ansi->previous_pause != gameInfo->pause;
+  if (!ansi->has_frame) {
+    int bottom = FIELD_TOP + ansi->visible_rows + 1;
+    ansi_printf(ansi, "\x1b[%d;%dH" BOX_TOP_LEFT, FIELD_TOP, FIELD_LEFT);
+    for (int x = 0; x < ansi->visible_columns * 2; x++)
+      ansi_append(ansi, BOX_HORIZONTAL, strlen(BOX_HORIZONTAL));
+    ansi_append(ansi, BOX_TOP_RIGHT, strlen(BOX_TOP_RIGHT));
+    for (int y = FIELD_TOP + 1; y < bottom; y++) {
+      ansi_printf(ansi, "\x1b[%d;%dH" BOX_VERTICAL, y, FIELD_LEFT);
+      ansi_printf(ansi, "\x1b[%d;%dH" BOX_VERTICAL, y,
+                  FIELD_LEFT + ansi->visible_columns * 2 + 1);
+    }
+    ansi_printf(ansi, "\x1b[%d;%dH" BOX_BOTTOM_LEFT, bottom, FIELD_LEFT);
+    for (int x = 0; x < ansi->visible_columns * 2; x++)
+      ansi_append(ansi, BOX_HORIZONTAL, strlen(BOX_HORIZONTAL));
+    ansi_append(ansi, BOX_BOTTOM_RIGHT, strlen(BOX_BOTTOM_RIGHT));
+  }
+  for (int y = first_row; y < ansi->height; y++) {
+    size_t offset = (size_t)y * ansi->width + ansi->first_column;
+    const uint8_t *row = gameInfo->field + offset;
+    uint8_t *previous = ansi->previous + offset;
+    if (redraw || memcmp(row, previous, ansi->visible_columns)) {
+      ansi_draw_row(ansi, gameInfo, y);
+      memcpy(previous, row, ansi->visible_columns);
+    }
+  }
+  ansi_draw_panel(ansi, gameInfo);
+  ansi->has_frame = true;
+  ansi->previous_pause = gameInfo->pause;
+  TRACE_BEGIN("write");
+  ansi_flush(ansi);
+  TRACE_END("write");
+  TRACE_END("ansi_draw");
+}
+
+/**
+ * @brief Leaves the alternate screen and frees the buffers of the renderer.
+ *
+ * @param renderer The renderer.
+ */
+void ansi_close(Renderer_t *renderer) {
+  AnsiRenderer_t *ansi = renderer->data;
+  if (ansi) {
+    if (ansi->buffer) {
+      ansi->length = 0;
+      ansi_append(ansi, ANSI_LEAVE, strlen(ANSI_LEAVE));
+      ansi_flush(ansi);
+    }
+    if (ansi->buffer) FREE_COUNT(Frontend_site);
+    if (ansi->previous) FREE_COUNT(Frontend_site);
+    FREE_COUNT(Frontend_site);
+    free(ansi->buffer);
+    free(ansi->previous);
+    free(ansi);
+    renderer->data = NULL;
+  }
+}
+
+/**
+ * @brief Appends bytes to the frame buffer.
+ *
+ * Bytes that do not fit in the buffer are dropped.
+ *
+ * @param ansi The renderer state.
+ * @param bytes The bytes to append.
+ * @param length The number of bytes.
+ */
+void ansi_append(AnsiRenderer_t *ansi, const char *bytes, size_t length) {
+  if (ansi->length + length <= ansi->capacity) {
+    memcpy(ansi->buffer + ansi->length, bytes, length);
+    ansi->length += length;
+  }
+}
+
+/**
+ * @brief Appends formatted text to the frame buffer.
+ *
+ * @param ansi The renderer state.
+ * @param format The `printf` format string.
+ */
+void ansi_printf(AnsiRenderer_t *ansi, const char *format, ...) {
+  size_t room = ansi->capacity - ansi->length;
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(ansi->buffer + ansi->length, room, format, args);
+  va_end(args);
+  if (length > 0 && (size_t)length < room) ansi->length += length;
+}
+
+/**
+ * @brief Appends a row of the field to the frame buffer.
+ *
+ * Colour changes are emitted only between cells of different colours.
+ *
+ * @param ansi The renderer state.
+ * @param gameInfo A pointer to the packed game state.
+ * @param row The row of the field.
+ */
+void ansi_draw_row(AnsiRenderer_t *ansi, const PackedGameInfo_t *gameInfo,
+                   int row) {
+  const uint8_t *cells =
+      gameInfo->field + row * ansi->width + ansi->first_column;
+  int color = 0;
+  ansi_printf(ansi, "\x1b[%d;%dH",
+              FIELD_TOP + 1 + row - (ansi->height - ansi->visible_rows),
+              FIELD_LEFT + 1);
+  for (int x = 0; x < ansi->visible_columns; x++) {
+    int cell = gameInfo->pause ? 0 : cells[x];
+    if (cell != color) {
+      if (cell)
+        ansi_printf(ansi, "\x1b[30;%dm", ansi_colors[cell]);
+      else
+        ansi_append(ansi, ANSI_RESET, strlen(ANSI_RESET));
+      color = cell;
+    }
+    ansi_append(ansi, gameInfo->pause && cells[x] ? "[]" : "  ", 2);
+  }
+  if (color) ansi_append(ansi, ANSI_RESET, strlen(ANSI_RESET));
+}
+
+/**
+ * @brief Appends the side panel with the next tetramino, the scores and the
+ * help to the frame buffer.
+ *
+ * @param ansi The renderer state.
+ * @param gameInfo A pointer to the packed game state.
+ */
+void ansi_draw_panel(AnsiRenderer_t *ansi, const PackedGameInfo_t *gameInfo) {
+  int left = FIELD_LEFT + ansi->visible_columns * 2 + 3;
+  int line = FIELD_TOP;
+  char preview[PREVIEW_TEXT_SIZE];
+  format_preview(gameInfo, preview);
+  ansi_printf(ansi, "\x1b[%d;%dH  next  %s" ANSI_CLEAR_LINE, line++, left,
+              preview);
+  for (int y = 0; y < TETR_SIZE; y++, line++) {
+    ansi_printf(ansi, "\x1b[%d;%dH  ", line, left);
+    for (int x = 0; x < TETR_SIZE; x++) {
+      int cell = gameInfo->next[y * TETR_SIZE + x];
+      if (cell && gameInfo->pause)
+        ansi_append(ansi, "[]", 2);
+      else if (cell)
+        ansi_printf(ansi, "\x1b[30;%dm  " ANSI_RESET, ansi_colors[cell]);
+      else
+        ansi_append(ansi, "  ", 2);
+    }
+    ansi_append(ansi, ANSI_CLEAR_LINE, strlen(ANSI_CLEAR_LINE));
+  }
+  const char *lines[8] = {NULL};
+  char values[4][ANSI_PANEL_WIDTH];
+  if (gameInfo->pause == 1) {
+    lines[0] = "= PAUSE =";
+    lines[1] = "press 'P'";
+    lines[2] = "to resume";
+  } else if (gameInfo->pause == 2) {
+    lines[0] = "= TETRIS =";
+    lines[1] = "press 'ENTER'";
+    lines[2] = "to start";
+  } else {
+    snprintf(values[0], sizeof(values[0]), "high  %d", gameInfo->high_score);
+    snprintf(values[1], sizeof(values[1]), "score %d", gameInfo->score);
+    snprintf(values[2], sizeof(values[2]), "speed %3.1f x",
+             (float)gameInfo->speed * 0.3 + 1);
+    snprintf(values[3], sizeof(values[3]), "level %d", gameInfo->level);
+    for (int i = 0; i < 4; i++) lines[i] = values[i];
+  }
+  if (gameInfo->pause) {
+    lines[4] = "press 'q' to exit";
+    lines[5] = "arrows to move";
+    lines[6] = "space to rotate";
+  }
+  for (int i = 0; i < 8; i++, line++)
+    ansi_printf(ansi, "\x1b[%d;%dH  %s" ANSI_CLEAR_LINE, line + 1, left,
+                lines[i] ? lines[i] : "");
+}
+
+/**
+ * @brief Sends the frame buffer to the terminal and empties it.
+ *
+ * @param ansi The renderer state.
+ */
+void ansi_flush(AnsiRenderer_t *ansi) {
+  size_t written = 0;
+  while (written < ansi->length) {
+    ssize_t result =
+        write(STDOUT_FILENO, ansi->buffer + written, ansi->length - written);
+    if (result <= 0) break;
+    written += (size_t)result;
+  }
+  ansi->length = 0;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file dashboard.c
+ * @brief Dashboard of many concurrent autoplay games.
+ */
+#include "dashboard.h"
+
+#include "input.h"
+
+/**
+ * @brief Runs the dashboard until the user presses 'q'.
+ *
+ * The games are split between up to `MAX_DASHBOARD_THREADS` worker threads.
+ * Every `DASHBOARD_FRAME_MS` the published games are copied under the lock,
+ * the workers are asked for the next snapshot and the copy is drawn: each
+ * tile goes to the virtual screen with `wnoutrefresh()` and the terminal is
+ * updated once with `doupdate()`. Tiles that do not fit on the screen are
+ * simulated but not drawn.
+ *
+ * @param count The number of games.
+ * @param width The number of columns of each field.
+ * @param height The number of rows of each field.
+ * @return `false` if the worker threads could not be started.
+ */
+bool run_dashboard(int count, int width, int height) {
+  static Dashboard_t dashboard;
+  BoardSlot_t snapshot[MAX_DASHBOARD_GAMES];
+  long long int last_pieces[MAX_DASHBOARD_GAMES] = {0};
+  WINDOW *tiles[MAX_DASHBOARD_GAMES] = {NULL};
+  DashboardWorker_t workers[MAX_DASHBOARD_THREADS];
+  pthread_t threads[MAX_DASHBOARD_THREADS];
+
+  init_dashboard(&dashboard, count, width, height, (uint64_t)time(NULL));
+  long int cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int thread_count = cores < 1 ? 1 : (int)cores;
+  if (thread_count > MAX_DASHBOARD_THREADS)
+    thread_count = MAX_DASHBOARD_THREADS;
+  if (thread_count > count) thread_count = count;
+  int started = 0;
+  for (int i = 0; i < thread_count; i++) {
+    workers[i].dashboard = &dashboard;
+    workers[i].first = count * i / thread_count;
+    workers[i].last = count * (i + 1) / thread_count;
+    if (!pthread_create(&threads[started], NULL, dashboard_worker,
+                        &workers[i]))
+      started++;
+  }
+
+  int tile_width = width + 2;
+  if (tile_width < DASHBOARD_TILE_MIN_WIDTH)
+    tile_width = DASHBOARD_TILE_MIN_WIDTH;
+  int tile_height = height + 2 + DASHBOARD_INFO_ROWS;
+  int columns = COLS / tile_width;
+  int visible = columns * ((LINES - 1) / tile_height);
+  if (visible > count) visible = count;
+  for (int i = 0; i < visible; i++)
+    tiles[i] = newwin(tile_height, tile_width, 1 + i / columns * tile_height,
+                      i % columns * tile_width);
+  WINDOW *status = newwin(1, COLS, 0, 0);
+  InputReader_t reader;
+  KeyEvent_t event;
+  input_open(&reader);
+
+  long long int last_frame = monotonic_us() / 1000;
+  bool is_running = started == thread_count;
+  while (is_running) {
+    long long int now = monotonic_us() / 1000;
+    if (now - last_frame >= DASHBOARD_FRAME_MS) {
+      pthread_mutex_lock(&dashboard.lock);
+      memcpy(snapshot, dashboard.slots, sizeof(BoardSlot_t) * count);
+      pthread_mutex_unlock(&dashboard.lock);
+      atomic_fetch_add_explicit(&dashboard.frame, 1, memory_order_relaxed);
+      print_dashboard(snapshot, count, tiles, status, last_pieces,
+                      now - last_frame);
+      last_frame = now;
+    }
+    input_poll(&reader);
+    while (input_next(&reader, &event))
+      if (get_action(event.key) == Terminate) is_running = false;
+    napms(INPUT_POLL_MS);
+  }
+
+  input_close(&reader);
+  atomic_store(&dashboard.running, false);
+  for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&dashboard.lock);
+  for (int i = 0; i < visible; i++) delwin(tiles[i]);
+  delwin(status);
+  return started == thread_count;
+}
+
+/**
+ * @brief Checks that a dashboard of the given size can be simulated.
+ *
+ * @param count The number of games.
+ * @param width The number of columns of each field.
+ * @param height The number of rows of each field.
+ * @return `true` if the number of games and the field size are supported.
+ */
+bool is_valid_dashboard(int count, int width, int height) {
+  return count >= MIN_DASHBOARD_GAMES && count <= MAX_DASHBOARD_GAMES &&
+         is_valid_board_size(width, height) && height <= STATE_MAX_HEIGHT;
+}
+
+/**
+ * @brief Starts the games of a dashboard.
+ *
+ * @param[out] dashboard The dashboard to initialize.
+ * @param count The number of games.
+ * @param width The number of columns of each field.
+ * @param height The number of rows of each field.
+ * @param seed The seed the seeds of the games are derived from.
+ */
+void init_dashboard(Dashboard_t *dashboard, int count, int width, int height,
+                    uint64_t seed) {
+  dashboard->count = count;
+  pthread_mutex_init(&dashboard->lock, NULL);
+  atomic_init(&dashboard->running, true);
+  atomic_init(&dashboard->frame, 0);
+  for (int i = 0; i < count; i++) {
+    BoardSlot_t *slot = &dashboard->slots[i];
+    slot->seed = seed + (uint64_t)i;
+    slot->pieces = 0;
+    slot->games = 0;
+    state_init(&slot->game, width, height, random_next(&slot->seed));
+  }
+}
+
+/**
+ * @brief Simulates a range of dashboard games until the dashboard stops.
+ *
+ * Each round places one tetramino in every game of the range. The games are
+ * published after a round only if the dashboard has asked for a new frame
+ * since the last time. Finished games are restarted with a new seed.
+ *
+ * @param arg A pointer to the `DashboardWorker_t` of the thread.
+ * @return `NULL`.
+ */
+void *dashboard_worker(void *arg) {
+  DashboardWorker_t *worker = arg;
+  Dashboard_t *dashboard = worker->dashboard;
+  int count = worker->last - worker->first;
+  BoardSlot_t slots[MAX_DASHBOARD_GAMES];
+  int published = -1;
+
+  pthread_mutex_lock(&dashboard->lock);
+  memcpy(slots, &dashboard->slots[worker->first], sizeof(BoardSlot_t) * count);
+  pthread_mutex_unlock(&dashboard->lock);
+
+  while (atomic_load_explicit(&dashboard->running, memory_order_relaxed)) {
+    for (int i = 0; i < count; i++) {
+      slots[i].pieces++;
+      if (!autoplay_step(&slots[i].game)) restart_slot(&slots[i]);
+    }
+    int frame = atomic_load_explicit(&dashboard->frame, memory_order_relaxed);
+    if (frame != published) {
+      pthread_mutex_lock(&dashboard->lock);
+      memcpy(&dashboard->slots[worker->first], slots,
+             sizeof(BoardSlot_t) * count);
+      pthread_mutex_unlock(&dashboard->lock);
+      published = frame;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Starts a new game in a slot after its game is over.
+ *
+ * @param slot A pointer to the slot.
+ */
+void restart_slot(BoardSlot_t *slot) {
+  slot->games++;
+  state_init(&slot->game, slot->game.width, slot->game.height,
+             random_next(&slot->seed));
+}
+
+/**
+ * @brief Draws the dashboard and updates the terminal once.
+ *
+ * @param slots The published games.
+ * @param count The number of games.
+ * @param tiles The tile windows, `NULL` for games that are not drawn.
+ * @param status The window of the status line.
+ * @param[in,out] last_pieces The piece counters of the previous frame.
+ * @param elapsed_ms The time since the previous frame.
+ */
+void print_dashboard(const BoardSlot_t *slots, int count, WINDOW **tiles,
+                     WINDOW *status, long long int *last_pieces,
+                     long long int elapsed_ms) {
+  TRACE_BEGIN("print_dashboard");
+  double total = 0;
+  int hidden = 0;
+  for (int i = 0; i < count; i++) {
+    double pieces_per_sec =
+        (double)(slots[i].pieces - last_pieces[i]) * 1000.0 / elapsed_ms;
+    last_pieces[i] = slots[i].pieces;
+    total += pieces_per_sec;
+    if (tiles[i])
+      print_tile(tiles[i], &slots[i], pieces_per_sec);
+    else
+      hidden++;
+  }
+  werase(status);
+  mvwprintw(status, 0, 0, "%d games  %.0f pieces/s", count, total);
+  if (hidden) wprintw(status, "  (%d not shown)", hidden);
+  wprintw(status, "  press 'q' to exit");
+  wnoutrefresh(status);
+  TRACE_BEGIN("doupdate");
+  doupdate();
+  TRACE_END("doupdate");
+  TRACE_END("print_dashboard");
+}
+
+/**
+ * @brief Draws one game as a compact board with its score, level and speed.
+ *
+ * Each cell takes one column. The window is only copied to the virtual
+ * screen, the terminal is updated by the caller.
+ *
+ * @param tile The window of the game.
+ * @param slot A pointer to the game.
+ * @param pieces_per_sec The number of tetraminoes placed per second.
+ */
+void print_tile(WINDOW *tile, const BoardSlot_t *slot, double pieces_per_sec) {
+  const GameState_t *game = &slot->game;
+  werase(tile);
+  mvwaddch(tile, 0, 0, ACS_ULCORNER);
+  mvwhline(tile, 0, 1, ACS_HLINE, game->width);
+  mvwaddch(tile, 0, game->width + 1, ACS_URCORNER);
+  mvwvline(tile, 1, 0, ACS_VLINE, game->height);
+  mvwvline(tile, 1, game->width + 1, ACS_VLINE, game->height);
+  mvwaddch(tile, game->height + 1, 0, ACS_LLCORNER);
+  mvwhline(tile, game->height + 1, 1, ACS_HLINE, game->width);
+  mvwaddch(tile, game->height + 1, game->width + 1, ACS_LRCORNER);
+  for (int y = 0; y < game->height; ++y) {
+    if (game->rows[y]) {
+      for (int x = 0; x < game->width; ++x)
+        if (state_cell(game, x, y))
+          mvwaddch(tile, y + 1, x + 1, ' ' | A_REVERSE);
+    }
+  }
+  mvwprintw(tile, game->height + 2, 0, "%d", game->score);
+  mvwprintw(tile, game->height + 3, 0, "L%d %.0fp/s", game->level,
+            pieces_per_sec);
+  wnoutrefresh(tile);
+}
@@ -0,0 +1,72 @@
+/**
+ * @file dashboard.h
+ * @brief Dashboard of many concurrent autoplay games.
+ *
+ * The games are simulated by worker threads on compact game states and
+ * published to a shared snapshot once per frame. The dashboard draws the
+ * snapshot as a grid of compact boards at a capped frame rate, so drawing
+ * never slows the simulations down.
+ */
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "../../brick_game/tetris/autoplay.h"
+#include "front.h"
+
+#define MIN_DASHBOARD_GAMES 4
+#define MAX_DASHBOARD_GAMES 64
+#define MAX_DASHBOARD_THREADS 8
+#define DASHBOARD_FRAME_MS 100
+#define DASHBOARD_INFO_ROWS 2
+#define DASHBOARD_TILE_MIN_WIDTH 12
+
+/**
+ * @brief One game of the dashboard with its counters across restarts.
+ */
+typedef struct {
+  GameState_t game;
+  uint64_t seed;
+  long long int pieces;
+  int games;
+} BoardSlot_t;
+
+/**
+ * @brief Games shared between the worker threads and the dashboard.
+ *
+ * Workers step private copies of their slots. The dashboard bumps `frame`
+ * once it has read `slots`; after its next round every worker sees the new
+ * value and publishes its slots to `slots` under `lock`, so the lock is
+ * taken once per drawn frame rather than once per round.
+ */
+typedef struct {
+  BoardSlot_t slots[MAX_DASHBOARD_GAMES];
+  pthread_mutex_t lock;
+  atomic_bool running;
+  atomic_int frame;
+  int count;
+} Dashboard_t;
+
+/**
+ * @brief Range of slots simulated by one worker thread.
+ */
+typedef struct {
+  Dashboard_t *dashboard;
+  int first;
+  int last;
+} DashboardWorker_t;
+
+bool run_dashboard(int count, int width, int height);
+bool is_valid_dashboard(int count, int width, int height);
+void init_dashboard(Dashboard_t *dashboard, int count, int width, int height,
+                    uint64_t seed);
+void *dashboard_worker(void *arg);
+void restart_slot(BoardSlot_t *slot);
+void print_dashboard(const BoardSlot_t *slots, int count, WINDOW **tiles,
+                     WINDOW *status, long long int *last_pieces,
+                     long long int elapsed_ms);
+void print_tile(WINDOW *tile, const BoardSlot_t *slot, double pieces_per_sec);
+
+#endif
@@ -8,113 +8,345 @@
  */
 #include "front.h"
 
+#include "dashboard.h"
+#include "input.h"
+#include "renderer.h"
+#include "versus_screen.h"
+
 /**
  * @brief The main function to initialize the game and start the game loop.
  *
  * Initializes the ncurses screen, sets the terminal mode, and starts the game
  * loop by calling `run_game_loop`. After the loop ends, the ncurses session is
- * terminated.
+ * terminated and the engine statistics are dumped if a file is named for
+ * them.
+ *
+ * Tracing of frame phases is enabled by `--trace FILE` or by the
+ * `TETRIS_TRACE` environment variable, the statistics dump by `--stats FILE`
+ * or by `TETRIS_STATS`. The field size is set by `--width N`
+ * and `--height N`. `--dashboard N` watches N autoplay games instead of
+ * playing. `--ansi` draws with raw escape sequences instead of ncurses.
+ * `--preview N` lists N upcoming tetraminos. `--versus` splits the screen
+ * between two players and `--versus-bot` plays against the autoplay policy,
+ * or against the bot plugin given by `--bot FILE` with `--bot-budget MS` per
+ * move. `--practice N` keeps the last N seconds of play, and the rewind key
+ * takes back the last attached tetramino.
  *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
  * @return An integer exit status (0 for success).
  */
-int main() {
-  initscr();
-  cbreak();
-  noecho();
-  keypad(stdscr, TRUE);
-  curs_set(0);
-  nodelay(stdscr, TRUE);
+int main(int argc, char *argv[]) {
+  Options_t options = {NULL, FIELD_WIDTH, FIELD_HEIGHT, 0, MIN_PREVIEW_DEPTH,
+                       false, Versus_off, NULL, DEFAULT_BOT_BUDGET_US, 0,
+                       NULL};
+  if (!parse_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--trace FILE] [--width N] [--height N] "
+            "[--dashboard N] [--preview N] [--ansi] [--versus] "
+            "[--versus-bot] [--bot FILE] [--bot-budget MS] "
+            "[--practice N] [--stats FILE]\n",
+            argv[0]);
+    return 1;
+  }
+  if (options.dashboard &&
+      !is_valid_dashboard(options.dashboard, options.width, options.height)) {
+    fprintf(stderr, "dashboard needs %d to %d games of at most %d rows\n",
+            MIN_DASHBOARD_GAMES, MAX_DASHBOARD_GAMES, STATE_MAX_HEIGHT);
+    return 1;
+  }
+  if (!setBoardSize(options.width, options.height)) {
+    fprintf(stderr, "unsupported field size %dx%d\n", options.width,
+            options.height);
+    return 1;
+  }
+  if (!setPreviewDepth(options.preview)) {
+    fprintf(stderr, "preview depth must be %d to %d\n", MIN_PREVIEW_DEPTH,
+            MAX_PREVIEW_DEPTH);
+    return 1;
+  }
+  if (options.practice_seconds && !setRewindWindow(options.practice_seconds)) {
+    fprintf(stderr, "cannot start practice mode\n");
+    return 1;
+  }
+  BotPlugin_t bot = {NULL, NULL, NULL, 0, 0, 0, 0, 0};
+  if (options.bot_path &&
+      bot_load(&bot, options.bot_path, options.bot_budget_us,
+               (uint64_t)time(NULL))) {
+    fprintf(stderr, "cannot load bot plugin %s\n", options.bot_path);
+    return 1;
+  }
+  // the game keeps its heap buffers if the arena cannot be allocated:
+  useMatrixArena();
+  if (options.trace_path)
+    trace_start(options.trace_path);
+  else
+    trace_start_from_env();
+  alloc_stats_start_from_env();
 
-  run_game_loop();
+  if (options.dashboard) {
+    init_ncurses_screen();
+    run_dashboard(options.dashboard, options.width, options.height);
+    endwin();
+  } else if (options.versus != Versus_off) {
+    run_versus(options.width, options.height, options.versus == Versus_bot,
+               bot.api ? &bot : NULL);
+  } else {
+    Renderer_t renderer;
+    if (options.ansi)
+      init_ansi_renderer(&renderer);
+    else
+      init_ncurses_renderer(&renderer);
+    run_game_loop(&renderer, options.width, options.height);
+  }
 
-  endwin();
+  bot_unload(&bot);
+  trace_stop();
+  dump_stats_on_exit(options.stats_path);
   return 0;
 }
 
+/**
+ * @brief Parses the command line options.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized.
+ */
+bool parse_options(int argc, char *argv[], Options_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      options->trace_path = argv[++i];
+    else if (!strcmp(argv[i], "--width") && i + 1 < argc)
+      options->width = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--height") && i + 1 < argc)
+      options->height = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--dashboard") && i + 1 < argc)
+      options->dashboard = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--preview") && i + 1 < argc)
+      options->preview = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--ansi"))
+      options->ansi = true;
+    else if (!strcmp(argv[i], "--versus"))
+      options->versus = Versus_humans;
+    else if (!strcmp(argv[i], "--versus-bot"))
+      options->versus = Versus_bot;
+    else if (!strcmp(argv[i], "--bot") && i + 1 < argc)
+      options->bot_path = argv[++i];
+    else if (!strcmp(argv[i], "--bot-budget") && i + 1 < argc)
+      options->bot_budget_us = atoll(argv[++i]) * 1000;
+    else if (!strcmp(argv[i], "--practice") && i + 1 < argc)
+      options->practice_seconds = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--stats") && i + 1 < argc)
+      options->stats_path = argv[++i];
+    else
+      is_ok = false;
+  }
+  if (options->bot_path) options->versus = Versus_bot;
+  return is_ok && options->bot_budget_us > 0 &&
+         options->practice_seconds >= 0;
+}
+
 /**
  * @brief Runs the main game loop.
  *
  * This function manages the game loop, where it continually updates the game
  * state, renders the game field, and handles user input. It keeps the game
  * running until it is paused or terminated. The game info is updated and
- * displayed on the screen through various windows (`game_win`, `next_win`,
- * `info_win`).
+ * displayed on the screen through the renderer, which owns the terminal for
+ * the duration of the loop.
+ *
+ * The backend advances the simulation in fixed logical ticks on every
+ * update, while drawing is throttled to one frame per `FRAME_INTERVAL_MS`, so
+ * rendering never slows the game down. All pending keys are read on every
+ * iteration and queued. A key is handed to the engine, stamped with the time
+ * it was read at, only once a tick has taken the previous one, so no key
+ * overwrites another. In practice mode the rewind key takes back the last
+ * attached tetramino instead.
  *
+ * @param renderer The renderer drawing the frames and reading the keys.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
  * @return A boolean indicating if the game loop is running (`true`) or not
  * (`false`).
  */
-bool run_game_loop() {
-  UserAction_t user_action;
-  bool is_ok = true;
-  Interface_t windows;
-  windows.game_win = newwin(FIELD_WIDTH * 2 + 2, FIELD_HEIGHT + 2, 1, 1);
-  windows.next_win = newwin(7, 18, 1, FIELD_WIDTH * 2 + 3);
-  windows.info_win = newwin(15, 18, 8, FIELD_WIDTH * 2 + 3);
-
-  start_color();
-  init_pair((short)1, COLOR_BLACK, COLOR_YELLOW);
-  init_pair((short)2, COLOR_BLACK, COLOR_CYAN);
-  init_pair((short)3, COLOR_BLACK, COLOR_MAGENTA);
-  init_pair((short)4, COLOR_BLACK, COLOR_GREEN);
-  init_pair((short)5, COLOR_BLACK, COLOR_RED);
-  init_pair((short)6, COLOR_BLACK, COLOR_BLUE);
-  init_pair((short)7, COLOR_BLACK, COLOR_WHITE);
+bool run_game_loop(Renderer_t *renderer, int width, int height) {
+  InputReader_t reader;
+  KeyEvent_t event;
+  bool is_ok = renderer->open(renderer, width, height);
+  long long int last_frame = 0;
+  input_open(&reader);
 
   while (is_ok) {
-    GameInfo_t gameInfo = updateCurrentState();
+    PackedGameInfo_t gameInfo = updatePackedState();
 
     if (gameInfo.pause != EXIT_GAME) {
-      print_field(&gameInfo, &windows);
-      print_next(&gameInfo, &windows);
-      print_info(&gameInfo, &windows);
-
-      int key = getch();
-      bool hold = (key != ERR);
-      user_action = get_action(key);
-      userInput(user_action, hold);
+      long long int now = monotonic_us() / 1000;
+      if (now - last_frame >= FRAME_INTERVAL_MS) {
+        renderer->draw(renderer, &gameInfo);
+        frameRendered();
+        last_frame = now;
+      }
 
-      free_game_info(&gameInfo);
+      input_poll(&reader);
+      while (!isInputPending() && input_next(&reader, &event)) {
+        if (event.key == REWIND_KEY || event.key == 'R')
+          rewindGame(1);
+        else
+          userInputAt(get_action(event.key), true, event.time_us);
+      }
 
-      refresh();
-      napms(5);
+      napms(INPUT_POLL_MS);
     } else
       is_ok = false;
   }
 
-  delwin(windows.game_win);
-  delwin(windows.next_win);
-  delwin(windows.info_win);
+  input_close(&reader);
+  renderer->close(renderer);
 
   return 0;
 }
 
 /**
- * @brief Frees dynamically allocated memory for the `gameInfo` structure.
+ * @brief Sets up a renderer that draws through ncurses windows.
+ *
+ * @param[out] renderer The renderer to set up.
+ */
+void init_ncurses_renderer(Renderer_t *renderer) {
+  renderer->open = ncurses_open;
+  renderer->draw = ncurses_draw;
+  renderer->close = ncurses_close;
+  renderer->data = NULL;
+}
+
+/**
+ * @brief Initializes the ncurses screen.
  *
- * This function deallocates the memory for the game field and next tetramino
- * arrays in the `gameInfo` structure.
+ * Keys are read by an `InputReader_t` rather than `getch()`, so ncurses does
+ * not decode escape sequences and adds no escape delay.
+ */
+void init_ncurses_screen() {
+  initscr();
+  cbreak();
+  noecho();
+  curs_set(0);
+}
+
+/**
+ * @brief Initializes ncurses and creates the windows of the interface.
  *
- * @param gameInfo A pointer to the `GameInfo_t` structure containing the game
- * data to free.
+ * @param renderer The renderer.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @return `false` if the interface could not be allocated.
  */
-void free_game_info(GameInfo_t *gameInfo) {
-  if (gameInfo->field) {
-    for (int i = 0; i < FIELD_HEIGHT; i++) {
-      free(gameInfo->field[i]);
-      gameInfo->field[i] = NULL;
-    }
-    free(gameInfo->field);
-    gameInfo->field = NULL;
+bool ncurses_open(Renderer_t *renderer, int width, int height) {
+  Interface_t *windows = malloc(sizeof(Interface_t));
+  if (windows) {
+    ALLOC_COUNT(Frontend_site, sizeof(Interface_t));
+    init_ncurses_screen();
+    create_interface(windows, width, height);
 
-    if (gameInfo->next) {
-      for (int i = 0; i < TETR_SIZE; i++) {
-        free(gameInfo->next[i]);
-        gameInfo->next[i] = NULL;
-      }
-      free(gameInfo->next);
-      gameInfo->next = NULL;
-    }
+    init_ncurses_colors();
   }
+  renderer->data = windows;
+  return windows != NULL;
+}
+
+/**
+ * @brief Sets up the colour pairs of the tetraminoes and of the garbage rows.
+ *
+ * Garbage is grey where the terminal has bright colours and white otherwise.
+ */
+void init_ncurses_colors() {
+  start_color();
+  init_pair((short)1, COLOR_BLACK, COLOR_YELLOW);
+  init_pair((short)2, COLOR_BLACK, COLOR_CYAN);
+  init_pair((short)3, COLOR_BLACK, COLOR_MAGENTA);
+  init_pair((short)4, COLOR_BLACK, COLOR_GREEN);
+  init_pair((short)5, COLOR_BLACK, COLOR_RED);
+  init_pair((short)6, COLOR_BLACK, COLOR_BLUE);
+  init_pair((short)7, COLOR_BLACK, COLOR_WHITE);
+  init_pair((short)GARBAGE_CELL, COLOR_BLACK,
+            (short)(COLORS > 8 ? COLOR_BLACK + 8 : COLOR_WHITE));
+}
+
+/**
+ * @brief Draws a frame of the game through the ncurses windows.
+ *
+ * The windows are copied to the virtual screen and the terminal is updated
+ * once per frame with `doupdate()`.
+ *
+ * @param renderer The renderer.
+ * @param gameInfo A pointer to the packed game state to draw.
+ */
+void ncurses_draw(Renderer_t *renderer, const PackedGameInfo_t *gameInfo) {
+  Interface_t *windows = renderer->data;
+  print_field(gameInfo, windows);
+  print_next(gameInfo, windows);
+  print_info(gameInfo, windows);
+  TRACE_BEGIN("doupdate");
+  doupdate();
+  TRACE_END("doupdate");
+}
+
+/**
+ * @brief Deletes the windows of the interface and ends ncurses.
+ *
+ * @param renderer The renderer.
+ */
+void ncurses_close(Renderer_t *renderer) {
+  Interface_t *windows = renderer->data;
+  if (windows) {
+    delwin(windows->game_win);
+    delwin(windows->next_win);
+    delwin(windows->info_win);
+    FREE_COUNT(Frontend_site);
+    free(windows);
+    renderer->data = NULL;
+    endwin();
+  }
+}
+
+/**
+ * @brief Creates the windows of the interface for a field of the given size.
+ *
+ * Fields taller than the terminal are shown from the bottom up to the rows
+ * that fit on the screen, fields wider than it from the left up to the
+ * columns that fit next to the side panels.
+ *
+ * @param[out] windows The interface windows to create.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ */
+void create_interface(Interface_t *windows, int width, int height) {
+  create_interface_at(windows, width, height, 1);
+}
+
+/**
+ * @brief Creates the windows of the interface starting at a screen column.
+ *
+ * @param[out] windows The interface windows to create.
+ * @param width The number of columns of the field.
+ * @param height The number of rows of the field.
+ * @param column The screen column of the left border of the field.
+ */
+void create_interface_at(Interface_t *windows, int width, int height,
+                         int column) {
+  windows->visible_rows = height;
+  if (LINES > 3 && windows->visible_rows > LINES - 3)
+    windows->visible_rows = LINES - 3;
+  int room = (COLS - column - 2 - 18) / 2;
+  windows->visible_columns = width;
+  if (room > 0 && windows->visible_columns > room)
+    windows->visible_columns = room;
+  int panel_column = column + windows->visible_columns * 2 + 2;
+  windows->game_win = newwin(windows->visible_rows + 2,
+                             windows->visible_columns * 2 + 2, 1, column);
+  windows->next_win = newwin(7, 18, 1, panel_column);
+  windows->info_win = newwin(15, 18, 8, panel_column);
 }
 
 /**
@@ -122,27 +354,31 @@ void free_game_info(GameInfo_t *gameInfo) {
  *
  * This function displays the current game field in the `game_win` window. It
  * handles rendering of the tetraminoes and empty spaces, adjusting the display
- * based on whether the game is paused or not.
+ * based on whether the game is paused or not. Only the bottom
+ * `visible_rows` rows and the left `visible_columns` columns are drawn.
  *
- * @param gameInfo A pointer to the `GameInfo_t` structure containing the game
- * field data.
+ * @param gameInfo A pointer to the `PackedGameInfo_t` structure containing
+ * the game field data.
  * @param windows A pointer to the `Interface_t` structure containing the
  * ncurses window pointers.
  */
-void print_field(const GameInfo_t *gameInfo, Interface_t *windows) {
+void print_field(const PackedGameInfo_t *gameInfo, Interface_t *windows) {
+  TRACE_BEGIN("print_field");
   werase(windows->game_win);
   box(windows->game_win, 0, 0);
-  for (int y = 0; y < FIELD_HEIGHT; ++y) {
-    for (int x = 0; x < FIELD_WIDTH; ++x) {
-      if (gameInfo->field[y][x]) {
+  int first_row = gameInfo->height - windows->visible_rows;
+  for (int y = 0; y < windows->visible_rows; ++y) {
+    const uint8_t *row = gameInfo->field + (first_row + y) * gameInfo->width;
+    for (int x = 0; x < windows->visible_columns; ++x) {
+      if (row[x]) {
         if (gameInfo->pause) {
           mvwaddch(windows->game_win, y + 1, x * 2 + 1, '[');
           mvwaddch(windows->game_win, y + 1, x * 2 + 2, ']');
         } else {
-          wattron(windows->game_win, COLOR_PAIR(gameInfo->field[y][x]));
+          wattron(windows->game_win, COLOR_PAIR(row[x]));
           mvwaddch(windows->game_win, y + 1, x * 2 + 1, ' ');
           mvwaddch(windows->game_win, y + 1, x * 2 + 2, ' ');
-          wattroff(windows->game_win, COLOR_PAIR(gameInfo->field[y][x]));
+          wattroff(windows->game_win, COLOR_PAIR(row[x]));
         }
       } else {
         mvwaddch(windows->game_win, y + 1, x * 2 + 1, ' ');
@@ -150,7 +386,8 @@ void print_field(const GameInfo_t *gameInfo, Interface_t *windows) {
       }
     }
   }
-  wrefresh(windows->game_win);
+  wnoutrefresh(windows->game_win);
+  TRACE_END("print_field");
 }
 
 /**
@@ -158,27 +395,30 @@ void print_field(const GameInfo_t *gameInfo, Interface_t *windows) {
  *
  * This function displays the next tetramino that will fall in the `next_win`
  * window. It visualizes the upcoming tetramino and adjusts the display based on
- * whether the game is paused.
+ * whether the game is paused. The tetraminos that follow it are listed on the
+ * bottom border.
  *
- * @param gameInfo A pointer to the `GameInfo_t` structure containing the next
- * tetramino data.
+ * @param gameInfo A pointer to the `PackedGameInfo_t` structure containing
+ * the next tetramino data.
  * @param windows A pointer to the `Interface_t` structure containing the
  * ncurses window pointers.
  */
-void print_next(const GameInfo_t *gameInfo, Interface_t *windows) {
+void print_next(const PackedGameInfo_t *gameInfo, Interface_t *windows) {
+  TRACE_BEGIN("print_next");
   werase(windows->next_win);
   box(windows->next_win, 0, 0);
   for (int y = 0; y < TETR_SIZE; ++y) {
+    const uint8_t *row = gameInfo->next + y * TETR_SIZE;
     for (int x = 0; x < TETR_SIZE; ++x) {
-      if (gameInfo->next[y][x]) {
+      if (row[x]) {
         if (gameInfo->pause) {
           mvwaddch(windows->next_win, y + 1, x * 2 + 4, '[');
           mvwaddch(windows->next_win, y + 1, x * 2 + 5, ']');
         } else {
-          wattron(windows->next_win, COLOR_PAIR(gameInfo->next[y][x]));
+          wattron(windows->next_win, COLOR_PAIR(row[x]));
           mvwaddch(windows->next_win, y + 1, x * 2 + 4, ' ');
           mvwaddch(windows->next_win, y + 1, x * 2 + 5, ' ');
-          wattroff(windows->next_win, COLOR_PAIR(gameInfo->next[y][x]));
+          wattroff(windows->next_win, COLOR_PAIR(row[x]));
         }
       } else {
         mvwaddch(windows->next_win, y + 1, x * 2 + 4, ' ');
@@ -187,7 +427,29 @@ void print_next(const GameInfo_t *gameInfo, Interface_t *windows) {
     }
   }
 
-  wrefresh(windows->next_win);
+  char preview[PREVIEW_TEXT_SIZE];
+  format_preview(gameInfo, preview);
+  if (*preview) mvwprintw(windows->next_win, TETR_SIZE + 1, 2, " %s ", preview);
+
+  wnoutrefresh(windows->next_win);
+  TRACE_END("print_next");
+}
+
+/**
+ * @brief Formats the tetraminos after the next one as letters.
+ *
+ * @param gameInfo A pointer to the packed game state.
+ * @param[out] text A buffer of `PREVIEW_TEXT_SIZE` characters, for example
+ * `"T S Z"`; empty if only the next tetramino is previewed.
+ */
+void format_preview(const PackedGameInfo_t *gameInfo, char *text) {
+  static const char letters[] = " OITSZJL";
+  int length = 0;
+  for (int i = 1; i < gameInfo->preview_depth; i++) {
+    if (length) text[length++] = ' ';
+    text[length++] = letters[gameInfo->preview[i] & 7];
+  }
+  text[length] = '\0';
 }
 
 /**
@@ -197,12 +459,13 @@ void print_next(const GameInfo_t *gameInfo, Interface_t *windows) {
  * current score, high score, game level, and speed, in the `info_win` window.
  * The display changes depending on whether the game is paused.
  *
- * @param gameInfo A pointer to the `GameInfo_t` structure containing the game
- * data.
+ * @param gameInfo A pointer to the `PackedGameInfo_t` structure containing
+ * the game data.
  * @param windows A pointer to the `Interface_t` structure containing the
  * ncurses window pointers.
  */
-void print_info(const GameInfo_t *gameInfo, Interface_t *windows) {
+void print_info(const PackedGameInfo_t *gameInfo, Interface_t *windows) {
+  TRACE_BEGIN("print_info");
   int offset_high = offset_counter(gameInfo->high_score);
   int offset = offset_counter(gameInfo->score);
   werase(windows->info_win);
@@ -236,7 +499,8 @@ void print_info(const GameInfo_t *gameInfo, Interface_t *windows) {
     mvwprintw(windows->info_win, 11, 6, "level");
     mvwprintw(windows->info_win, 12, 4, "%5d", gameInfo->level);
   }
-  wrefresh(windows->info_win);
+  wnoutrefresh(windows->info_win);
+  TRACE_END("print_info");
 }
 
 /**
@@ -251,7 +515,7 @@ void print_info(const GameInfo_t *gameInfo, Interface_t *windows) {
  * @return The corresponding user action based on the key pressed.
  */
 UserAction_t get_action(int key) {
-  UserAction_t action;
+  UserAction_t action = Up;
   switch (key) {
     case ENTER_KEY:
       action = Start;
@@ -306,3 +570,28 @@ int offset_counter(int number) {
 
   return count / 2;
 }
+
+/**
+ * @brief Writes the engine statistics when the game exits, if asked to.
+ *
+ * The statistics are written to the given file or, without one, to the file
+ * named by the `TETRIS_STATS` environment variable. With `TETRIS_ALLOC_STATS`
+ * set the allocation report follows them, in `STATS_FILE` if no file is
+ * named. Otherwise nothing is written.
+ *
+ * @param path The path given on the command line, `NULL` for none.
+ */
+void dump_stats_on_exit(const char *path) {
+  if (!path || !*path) path = getenv(STATS_ENV);
+  if ((!path || !*path) && ALLOC_STATS_IS_ENABLED()) path = STATS_FILE;
+  FILE *file = path && *path ? fopen(path, "w") : NULL;
+  if (file) {
+    dumpStats(file);
+    if (ALLOC_STATS_IS_ENABLED()) {
+      AllocReport_t report;
+      alloc_stats_read(&report);
+      alloc_stats_dump(file, &report);
+    }
+    fclose(file);
+  }
+}
@@ -14,39 +14,82 @@
 #ifndef FRONT_H
 #define FRONT_H
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <ncurses.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "../../brick_game/brick_game.h"
+#include "../../brick_game/tetris/alloc_stats.h"
+#include "../../brick_game/tetris/stats.h"
+#include "../../brick_game/tetris/trace.h"
 
-#define FIELD_WIDTH 10
-#define FIELD_HEIGHT 20
-#define TETR_SIZE 5
 #define SPACE_KEY ' '
 #define ENTER_KEY 10
+#define REWIND_KEY 'r'
 #define EXIT_GAME -1
+#define FRAME_INTERVAL_MS 16
+#define INPUT_POLL_MS 5
+#define STATS_FILE "stats.txt"
+#define STATS_ENV "TETRIS_STATS"
+#define PREVIEW_TEXT_SIZE (MAX_PREVIEW_DEPTH * 2 + 1)
 
 /**
  * @brief Represents the interface windows for the game.
  *
  * This structure contains the ncurses windows that are used for displaying
- * various parts of the game UI.
+ * various parts of the game UI. Only the bottom `visible_rows` rows and the
+ * left `visible_columns` columns of the field fit on the screen.
  */
 typedef struct {
   WINDOW *game_win;
   WINDOW *next_win;
   WINDOW *info_win;
+  int visible_rows;
+  int visible_columns;
 } Interface_t;
 
-bool run_game_loop();
-void print_field(const GameInfo_t *gameInfo, Interface_t *windows);
-void print_next(const GameInfo_t *gameInfo, Interface_t *windows);
-void print_info(const GameInfo_t *gameInfo, Interface_t *windows);
-void free_game_info(GameInfo_t *gameInfo);
+/**
+ * @brief Versus mode selected on the command line.
+ */
+typedef enum { Versus_off, Versus_humans, Versus_bot } VersusMode_t;
+
+/**
+ * @brief Command line options of the game.
+ */
+typedef struct {
+  const char *trace_path;
+  int width;
+  int height;
+  int dashboard;
+  int preview;
+  bool ansi;
+  VersusMode_t versus;
+  const char *bot_path;
+  long long int bot_budget_us;
+  int practice_seconds;
+  const char *stats_path;
+} Options_t;
+
+struct Renderer_t;
+
+bool parse_options(int argc, char *argv[], Options_t *options);
+bool run_game_loop(struct Renderer_t *renderer, int width, int height);
+void create_interface(Interface_t *windows, int width, int height);
+void create_interface_at(Interface_t *windows, int width, int height,
+                         int column);
+void print_field(const PackedGameInfo_t *gameInfo, Interface_t *windows);
+void print_next(const PackedGameInfo_t *gameInfo, Interface_t *windows);
+void print_info(const PackedGameInfo_t *gameInfo, Interface_t *windows);
+void format_preview(const PackedGameInfo_t *gameInfo, char *text);
 UserAction_t get_action(int key);
 int offset_counter(int number);
+void dump_stats_on_exit(const char *path);
 
 #endif
@@ -0,0 +1,172 @@
+/**
+ * @file input.c
+ * @brief Raw non-blocking keyboard input.
+ */
+#include "input.h"
+
+/**
+ * @brief Switches the terminal to non-canonical mode without echo.
+ *
+ * Reads return at once with whatever bytes are pending. Nothing is changed
+ * when the standard input is not a terminal.
+ *
+ * @param[out] reader The reader to initialize.
+ */
+void input_open(InputReader_t *reader) {
+  reader->pending_length = 0;
+  reader->head = 0;
+  reader->count = 0;
+  reader->has_termios = !tcgetattr(STDIN_FILENO, &reader->saved_termios);
+  if (reader->has_termios) {
+    struct termios raw = reader->saved_termios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+  }
+}
+
+/**
+ * @brief Reads all pending bytes and queues the keys they encode.
+ *
+ * @param reader The reader.
+ * @return The number of keys queued.
+ */
+int input_poll(InputReader_t *reader) {
+  int queued = 0;
+  bool has_bytes = true;
+  while (has_bytes) {
+    int room = INPUT_BUFFER_SIZE - reader->pending_length;
+    ssize_t length =
+        read(STDIN_FILENO, reader->pending + reader->pending_length, room);
+    has_bytes = length > 0;
+    if (has_bytes) {
+      reader->pending_length += (int)length;
+      queued += parse_keys(reader, monotonic_us());
+      has_bytes = length == room;
+    }
+  }
+  return queued;
+}
+
+/**
+ * @brief Reads the oldest queued key without taking it.
+ *
+ * @param reader The reader.
+ * @param[out] event The key.
+ * @return `false` if no key is queued.
+ */
+bool input_peek(const InputReader_t *reader, KeyEvent_t *event) {
+  bool has_event = reader->count > 0;
+  if (has_event) *event = reader->queue[reader->head];
+  return has_event;
+}
+
+/**
+ * @brief Takes the oldest queued key.
+ *
+ * @param reader The reader.
+ * @param[out] event The key.
+ * @return `false` if no key is queued.
+ */
+bool input_next(InputReader_t *reader, KeyEvent_t *event) {
+  bool has_event = reader->count > 0;
+  if (has_event) {
+    *event = reader->queue[reader->head];
+    reader->head = (reader->head + 1) % KEY_QUEUE_SIZE;
+    reader->count--;
+  }
+  return has_event;
+}
+
+/**
+ * @brief Restores the terminal mode saved by `input_open()`.
+ *
+ * @param reader The reader.
+ */
+void input_close(InputReader_t *reader) {
+  if (reader->has_termios)
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &reader->saved_termios);
+  reader->has_termios = false;
+}
+
+/**
+ * @brief Decodes the pending bytes into queued keys.
+ *
+ * An escape sequence cut by the end of the bytes stays pending until the
+ * next read. Keys that do not fit in the queue are dropped.
+ *
+ * @param reader The reader.
+ * @param time_us The time the bytes were read at.
+ * @return The number of keys queued.
+ */
+int parse_keys(InputReader_t *reader, long long int time_us) {
+  int queued = 0;
+  int offset = 0;
+  int used = 1;
+  while (offset < reader->pending_length && used) {
+    int key = parse_key(reader->pending + offset,
+                        reader->pending_length - offset, &used);
+    offset += used;
+    if (used && key != ERR && reader->count < KEY_QUEUE_SIZE) {
+      int tail = (reader->head + reader->count) % KEY_QUEUE_SIZE;
+      reader->queue[tail].key = key;
+      reader->queue[tail].time_us = time_us;
+      reader->count++;
+      queued++;
+    }
+  }
+  reader->pending_length -= offset;
+  memmove(reader->pending, reader->pending + offset, reader->pending_length);
+  return queued;
+}
+
+/**
+ * @brief Decodes the first key of the bytes read from the terminal.
+ *
+ * The CSI (`ESC [`) and SS3 (`ESC O`) sequences of the arrow keys are decoded
+ * to the ncurses key codes, modifier parameters are ignored and other
+ * sequences are skipped. An escape byte that is the last of the bytes is a
+ * lone escape key.
+ *
+ * @param bytes The bytes read from the terminal.
+ * @param length The number of bytes.
+ * @param[out] used The number of bytes of the key, 0 if the bytes end in the
+ * middle of an escape sequence.
+ * @return The key code, or `ERR` for a skipped sequence.
+ */
+int parse_key(const unsigned char *bytes, int length, int *used) {
+  int key = bytes[0];
+  *used = 1;
+  if (key == ESCAPE_KEY && length > 1 &&
+      (bytes[1] == '[' || bytes[1] == 'O')) {
+    int end = 2;
+    while (end < length && bytes[end] >= 0x20 && bytes[end] < 0x40) end++;
+    if (end == length) {
+      *used = length < INPUT_BUFFER_SIZE ? 0 : length;
+      key = ERR;
+    } else {
+      *used = end + 1;
+      switch (bytes[end]) {
+        case 'A':
+          key = KEY_UP;
+          break;
+        case 'B':
+          key = KEY_DOWN;
+          break;
+        case 'C':
+          key = KEY_RIGHT;
+          break;
+        case 'D':
+          key = KEY_LEFT;
+          break;
+        default:
+          key = ERR;
+          break;
+      }
+    }
+  } else if (key == '\r') {
+    key = ENTER_KEY;
+  }
+  return key;
+}
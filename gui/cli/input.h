@@ -0,0 +1,54 @@
+/**
+ * @file input.h
+ * @brief Raw non-blocking keyboard input.
+ *
+ * The terminal is switched to non-canonical mode without echo and every poll
+ * reads all pending bytes at once. Escape sequences are decoded from the bytes
+ * of the same read, so the arrow keys need no escape timeout. Each key is
+ * stamped with the monotonic time it was read at and waits in a queue until
+ * the game takes it, so keys read faster than the engine ticks are not lost.
+ */
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <termios.h>
+
+#include "front.h"
+
+#define INPUT_BUFFER_SIZE 256
+#define KEY_QUEUE_SIZE 64
+#define ESCAPE_KEY 27
+
+/**
+ * @brief A key read from the terminal.
+ */
+typedef struct {
+  int key;
+  long long int time_us;
+} KeyEvent_t;
+
+/**
+ * @brief State of the keyboard reader.
+ *
+ * `pending` holds the bytes of an escape sequence that was cut by the end of
+ * a read. Decoded keys wait in the ring buffer `queue`.
+ */
+typedef struct {
+  unsigned char pending[INPUT_BUFFER_SIZE];
+  int pending_length;
+  KeyEvent_t queue[KEY_QUEUE_SIZE];
+  int head;
+  int count;
+  struct termios saved_termios;
+  bool has_termios;
+} InputReader_t;
+
+void input_open(InputReader_t *reader);
+int input_poll(InputReader_t *reader);
+bool input_peek(const InputReader_t *reader, KeyEvent_t *event);
+bool input_next(InputReader_t *reader, KeyEvent_t *event);
+void input_close(InputReader_t *reader);
+int parse_keys(InputReader_t *reader, long long int time_us);
+int parse_key(const unsigned char *bytes, int length, int *used);
+
+#endif
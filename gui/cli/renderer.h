@@ -0,0 +1,70 @@
+/**
+ * @file renderer.h
+ * @brief Interchangeable output backends of the game loop.
+ *
+ * A renderer owns the terminal between `open` and `close`: it sets the
+ * terminal up and draws whole frames of the game. Keys are read by the
+ * `InputReader_t` of the game loop for both renderers. The ncurses renderer
+ * draws through windows, the ANSI renderer writes escape sequences to a
+ * preallocated buffer and flushes every frame with one `write()`.
+ */
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "front.h"
+
+#define ANSI_CELL_BYTES 8
+#define ANSI_ROW_BYTES 32
+#define ANSI_PANEL_BYTES 2048
+#define ANSI_PANEL_WIDTH 18
+
+/**
+ * @brief Output backend of the game loop.
+ */
+typedef struct Renderer_t {
+  bool (*open)(struct Renderer_t *renderer, int width, int height);
+  void (*draw)(struct Renderer_t *renderer, const PackedGameInfo_t *gameInfo);
+  void (*close)(struct Renderer_t *renderer);
+  void *data;
+} Renderer_t;
+
+/**
+ * @brief State of the ANSI renderer.
+ *
+ * `previous` holds the field of the last frame, so that only the rows that
+ * changed are sent to the terminal. `first_column` and `visible_columns`
+ * select the part of each row that fits on the screen.
+ */
+typedef struct {
+  char *buffer;
+  size_t length;
+  size_t capacity;
+  uint8_t *previous;
+  int previous_pause;
+  int width;
+  int height;
+  int visible_rows;
+  int first_column;
+  int visible_columns;
+  bool has_frame;
+} AnsiRenderer_t;
+
+void init_ncurses_renderer(Renderer_t *renderer);
+bool ncurses_open(Renderer_t *renderer, int width, int height);
+void ncurses_draw(Renderer_t *renderer, const PackedGameInfo_t *gameInfo);
+void ncurses_close(Renderer_t *renderer);
+void init_ncurses_screen();
+void init_ncurses_colors();
+
+void init_ansi_renderer(Renderer_t *renderer);
+bool ansi_open(Renderer_t *renderer, int width, int height);
+void ansi_draw(Renderer_t *renderer, const PackedGameInfo_t *gameInfo);
+void ansi_close(Renderer_t *renderer);
+void ansi_append(AnsiRenderer_t *ansi, const char *bytes, size_t length);
+void ansi_printf(AnsiRenderer_t *ansi, const char *format, ...);
+void ansi_draw_row(AnsiRenderer_t *ansi, const PackedGameInfo_t *gameInfo,
+                   int row);
+void ansi_draw_panel(AnsiRenderer_t *ansi, const PackedGameInfo_t *gameInfo);
+void ansi_flush(AnsiRenderer_t *ansi);
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file versus_screen.c
+ * @brief Split-screen versus mode of the terminal game.
+ */
+#include "versus_screen.h"
+
+#include "input.h"
+#include "renderer.h"
+
+/**
+ * @brief Runs versus rounds until the user presses 'Q'.
+ *
+ * Both engines are advanced on the calling thread by their fixed-timestep
+ * schedulers. When a player tops out the other field is stopped too and the
+ * round goes to the survivor.
+ *
+ * @param width The number of columns of each field.
+ * @param height The number of rows of each field.
+ * @param against_bot `true` to let the autoplay policy play the right field.
+ * @param bot The bot plugin playing the right field against the user, or
+ * `NULL` for the greedy policy.
+ * @return `false` if the match could not be set up.
+ */
+bool run_versus(int width, int height, bool against_bot, BotPlugin_t *bot) {
+  Versus_t *versus = malloc(sizeof(Versus_t));
+  bool is_ok =
+      versus && !versus_init(versus, width, height, (uint64_t)time(NULL));
+  Interface_t windows[VERSUS_PLAYERS];
+  InputReader_t reader;
+  KeyEvent_t event;
+  int wins[VERSUS_PLAYERS] = {0};
+  bool is_started = false;
+  long long int last_frame = 0;
+
+  if (is_ok) {
+    versus->players[0].is_bot = false;
+    versus->players[1].is_bot = against_bot;
+    versus->players[1].driver.bot = bot;
+    init_ncurses_screen();
+    init_ncurses_colors();
+    for (int i = 0, column = 1; i < VERSUS_PLAYERS; i++) {
+      create_interface_at(&windows[i], width, height, column);
+      column += windows[i].visible_columns * 2 + VERSUS_PANEL_WIDTH + 3;
+    }
+    input_open(&reader);
+  }
+  bool is_running = is_ok;
+  while (is_running) {
+    long long int now = update_timer();
+    for (int i = 0; i < VERSUS_PLAYERS; i++) {
+      VersusPlayer_t *player = &versus->players[i];
+      if (is_started && player->is_bot)
+        driver_input(&player->driver, &player->model);
+      scheduler_advance(&player->model.scheduler, &player->model, now);
+      if (is_started && !versus_check(versus, i)) {
+        int loser = atomic_load(&versus->loser);
+        game_over_actions(&versus->players[1 - loser].model);
+        wins[1 - loser]++;
+        is_started = false;
+      }
+    }
+
+    if (monotonic_us() / 1000 - last_frame >= FRAME_INTERVAL_MS) {
+      for (int i = 0; i < VERSUS_PLAYERS; i++) {
+        PackedGameInfo_t gameInfo = pack_model(&versus->players[i].model);
+        print_field(&gameInfo, &windows[i]);
+        print_next(&gameInfo, &windows[i]);
+        print_versus_info(versus, i, is_started, wins, &windows[i]);
+      }
+      doupdate();
+      last_frame = monotonic_us() / 1000;
+    }
+
+    input_poll(&reader);
+    while (is_running && input_peek(&reader, &event) &&
+           !is_key_waiting(versus, event.key, against_bot, is_started)) {
+      int target;
+      input_next(&reader, &event);
+      UserAction_t action = versus_action(event.key, &target, against_bot);
+      if (action == Terminate) {
+        is_running = false;
+      } else if (action == Start) {
+        if (!is_started) versus_start(versus);
+        is_started = true;
+      } else if (is_started) {
+        for (int i = 0; i < VERSUS_PLAYERS; i++) {
+          if (target == VERSUS_BOTH || target == i) {
+            versus->players[i].model.user_action = action;
+            versus->players[i].model.hold = true;
+          }
+        }
+      }
+    }
+    napms(INPUT_POLL_MS);
+  }
+
+  if (is_ok) {
+    input_close(&reader);
+    for (int i = 0; i < VERSUS_PLAYERS; i++) {
+      delwin(windows[i].game_win);
+      delwin(windows[i].next_win);
+      delwin(windows[i].info_win);
+    }
+    endwin();
+    versus_free(versus);
+  }
+  free(versus);
+  return is_ok;
+}
+
+/**
+ * @brief Tells whether a key has to wait because a field it controls has not
+ * taken the previous key yet.
+ *
+ * Only the fields of human players are waited for; the autoplay drivers
+ * replace their input every tick.
+ *
+ * @param versus The match.
+ * @param key The key pressed by the user.
+ * @param against_bot `true` if both key sets control the left field.
+ * @param is_started `true` while a round is being played.
+ * @return `true` if the key must stay queued.
+ */
+bool is_key_waiting(const Versus_t *versus, int key, bool against_bot,
+                    bool is_started) {
+  int target;
+  versus_action(key, &target, against_bot);
+  bool is_waiting = false;
+  for (int i = 0; is_started && i < VERSUS_PLAYERS; i++)
+    if ((target == VERSUS_BOTH || target == i) &&
+        !versus->players[i].is_bot && versus->players[i].model.hold)
+      is_waiting = true;
+  return is_waiting;
+}
+
+/**
+ * @brief Maps a key to the action and the field it controls.
+ *
+ * @param key The key pressed by the user.
+ * @param[out] player The index of the field, or `VERSUS_BOTH`.
+ * @param against_bot `true` if both key sets control the left field.
+ * @return The user action; `Up` for keys without an action.
+ */
+UserAction_t versus_action(int key, int *player, bool against_bot) {
+  UserAction_t action = Up;
+  *player = VERSUS_BOTH;
+  switch (key) {
+    case 'a':
+    case 'A':
+      action = Left;
+      *player = 0;
+      break;
+    case 'd':
+    case 'D':
+      action = Right;
+      *player = 0;
+      break;
+    case 's':
+    case 'S':
+      action = Down;
+      *player = 0;
+      break;
+    case 'w':
+    case 'W':
+      action = Action;
+      *player = 0;
+      break;
+    case KEY_UP:
+      action = Action;
+      *player = 1;
+      break;
+    default:
+      action = get_action(key);
+      if (action == Left || action == Right || action == Down ||
+          action == Action)
+        *player = 1;
+      break;
+  }
+  if (against_bot && *player == 1) *player = 0;
+  return action;
+}
+
+/**
+ * @brief Prints the score, the garbage exchanged and the round status of one
+ * field.
+ *
+ * @param versus The match.
+ * @param player The index of the field.
+ * @param is_started `true` while a round is being played.
+ * @param wins The rounds won by each player.
+ * @param windows The interface windows of the field.
+ */
+void print_versus_info(const Versus_t *versus, int player, bool is_started,
+                       const int *wins, Interface_t *windows) {
+  const VersusPlayer_t *self = &versus->players[player];
+  WINDOW *window = windows->info_win;
+  werase(window);
+  box(window, 0, 0);
+  if (self->is_bot)
+    mvwprintw(window, 1, 5, "=  BOT  =");
+  else
+    mvwprintw(window, 1, 3, "= PLAYER %d =", player + 1);
+  mvwprintw(window, 3, 2, "score %9d", self->model.score);
+  mvwprintw(window, 4, 2, "level %9d", self->model.level);
+  mvwprintw(window, 5, 2, "sent  %9d", self->model.garbage_sent);
+  mvwprintw(window, 6, 2, "taken %9d", self->model.garbage_received);
+  mvwprintw(window, 7, 2, "wins  %9d", wins[player]);
+  if (!is_started) {
+    int loser = atomic_load(&versus->loser);
+    if (loser != VERSUS_RUNNING && wins[0] + wins[1])
+      mvwprintw(window, 9, 4, loser == player ? "topped out" : "= WINNER =");
+    mvwprintw(window, 11, 3, "press 'ENTER'");
+    mvwprintw(window, 12, 5, "to start");
+  } else if (self->model.pause == 1) {
+    mvwprintw(window, 9, 4, "= PAUSE =");
+  }
+  if (!self->is_bot)
+    mvwprintw(window, 13, 2, player ? "arrows, up=rot" : "WASD, W=rot");
+  wnoutrefresh(window);
+}
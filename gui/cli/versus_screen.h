@@ -0,0 +1,27 @@
+/**
+ * @file versus_screen.h
+ * @brief Split-screen versus mode of the terminal game.
+ *
+ * Two fields are drawn side by side, each with its own engine. The left
+ * player steers with W A S D (W rotates), the right one with the arrow keys
+ * (up rotates). Against the bot the human plays the left field with either
+ * set of keys. ENTER starts a round, 'P' pauses both fields and 'Q' exits.
+ */
+#ifndef VERSUS_SCREEN_H
+#define VERSUS_SCREEN_H
+
+#include "../../brick_game/tetris/bot_plugin.h"
+#include "../../brick_game/tetris/versus.h"
+#include "front.h"
+
+#define VERSUS_BOTH -1
+#define VERSUS_PANEL_WIDTH 18
+
+bool run_versus(int width, int height, bool against_bot, BotPlugin_t *bot);
+bool is_key_waiting(const Versus_t *versus, int key, bool against_bot,
+                    bool is_started);
+UserAction_t versus_action(int key, int *player, bool against_bot);
+void print_versus_info(const Versus_t *versus, int player, bool is_started,
+                       const int *wins, Interface_t *windows);
+
+#endif
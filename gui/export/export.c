@@ -0,0 +1,242 @@
+/**
+ * @file export.c
+ * @brief Offline exporter of gameplay frames.
+ */
+#include "export.h"
+
+/**
+ * @brief Colours of the palette indices, matching the colours of the
+ * tetraminoes and of the garbage rows in the terminal. The unused indices are
+ * black.
+ */
+const uint8_t export_palette[PALETTE_SIZE][3] = {
+    {0, 0, 0},     {255, 215, 0}, {0, 205, 205},  {205, 0, 205},
+    {0, 205, 0},   {205, 0, 0},   {30, 80, 238},  {229, 229, 229},
+    {127, 127, 127}};
+
+/**
+ * @brief Writes the frames of a seeded game to the standard output.
+ *
+ * Options: `--seed N`, `--frames N`, `--scale N` (pixels per cell),
+ * `--ticks N` (logical ticks per frame), `--width N`, `--height N`,
+ * `--format gif|ppm|raw` and `--alloc-check`. The export rate is reported on
+ * the standard error, and with `--alloc-check` the allocations per frame and
+ * per piece too.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  ExportOptions_t options = {1,           DEFAULT_FRAMES, DEFAULT_SCALE,
+                             DEFAULT_TICKS_PER_FRAME, FIELD_WIDTH,
+                             FIELD_HEIGHT, Format_gif, false};
+  if (!parse_export_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--frames N] [--scale N] [--ticks N] "
+            "[--width N] [--height N] [--format gif|ppm|raw] "
+            "[--alloc-check] > output\n",
+            argv[0]);
+    return 1;
+  }
+
+  int width = options.width * options.scale;
+  int height = options.height * options.scale;
+  ExportGame_t *game = calloc(1, sizeof(ExportGame_t));
+  uint8_t *pixels = malloc((size_t)width * height);
+  uint8_t *rgb = malloc((size_t)width * height * 3);
+  GifWriter_t *gif = calloc(1, sizeof(GifWriter_t));
+  int error = !game || !pixels || !rgb || !gif;
+  if (!error) error = start_export_game(game, &options);
+
+  if (!error) {
+    setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+    int delay_cs = (options.ticks_per_frame * TICK_MS + 5) / 10;
+    if (options.format == Format_gif) gif_begin(gif, stdout, width, height);
+    if (options.alloc_check) alloc_stats_start();
+    long long int start = monotonic_us();
+    int frames = 0;
+    bool is_running = true;
+    while (is_running && frames < options.frames) {
+      render_frame(&game->model, options.scale, pixels);
+      if (options.format == Format_gif)
+        gif_frame(gif, pixels, delay_cs < 2 ? 2 : delay_cs);
+      else if (options.format == Format_ppm)
+        write_ppm_frame(stdout, pixels, width, height, rgb);
+      else
+        fwrite(pixels, 1, (size_t)width * height, stdout);
+      frames++;
+      alloc_stats_mark_frame();
+      is_running = advance_export_game(game, options.ticks_per_frame);
+    }
+    if (options.format == Format_gif) gif_end(gif);
+    fflush(stdout);
+    double elapsed = (double)(monotonic_us() - start) / 1000.0;
+    fprintf(stderr, "%d frames in %.1f ms (%.0f frames/s)\n", frames, elapsed,
+            elapsed > 0 ? frames * 1000.0 / elapsed : 0.0);
+    if (options.alloc_check) error = check_allocations(stderr);
+  }
+
+  if (game) run_terminate_actions(&game->model);
+  free(game);
+  free(pixels);
+  free(rgb);
+  free(gif);
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the exporter.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and are in range.
+ */
+bool parse_export_options(int argc, char *argv[], ExportOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--alloc-check"))
+      options->alloc_check = true;
+    else if (i + 1 >= argc)
+      is_ok = false;
+    else if (!strcmp(argv[i], "--seed"))
+      options->seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--frames"))
+      options->frames = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--scale"))
+      options->scale = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--ticks"))
+      options->ticks_per_frame = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--width"))
+      options->width = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--height"))
+      options->height = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--format")) {
+      i++;
+      if (!strcmp(argv[i], "gif"))
+        options->format = Format_gif;
+      else if (!strcmp(argv[i], "ppm"))
+        options->format = Format_ppm;
+      else if (!strcmp(argv[i], "raw"))
+        options->format = Format_raw;
+      else
+        is_ok = false;
+    } else
+      is_ok = false;
+  }
+  return is_ok && options->frames > 0 && options->scale > 0 &&
+         options->scale <= MAX_SCALE && options->ticks_per_frame > 0 &&
+         is_valid_board_size(options->width, options->height) &&
+         options->height <= STATE_MAX_HEIGHT;
+}
+
+/**
+ * @brief Reports the allocations counted since the game started and stops
+ * counting.
+ *
+ * Once a game runs, neither frames nor tetraminos should allocate.
+ *
+ * @param stream The output stream of the report.
+ * @return Error code (`0` if nothing was allocated).
+ */
+int check_allocations(FILE *stream) {
+  AllocReport_t report;
+  alloc_stats_read(&report);
+  alloc_stats_stop();
+  alloc_stats_dump(stream, &report);
+  unsigned long long total = alloc_report_total(&report);
+  if (total) fprintf(stream, "%llu steady-state allocations\n", total);
+  return total ? 1 : 0;
+}
+
+/**
+ * @brief Starts a seeded game on a headless model.
+ *
+ * The model does not persist its score, so the exporter never touches the
+ * score file.
+ *
+ * @param[out] game The game to start.
+ * @param options The options of the exporter.
+ * @return Error code (`0` on success).
+ */
+int start_export_game(ExportGame_t *game, const ExportOptions_t *options) {
+  int error = init_model(&game->model, options->width, options->height);
+  if (!error)
+    error = move_model_to_arena(&game->model, options->width, options->height);
+  if (!error) {
+    seed_model(&game->model, options->seed);
+    game->model.no_persist = true;
+    game->model.state = Start_state;
+    game->model.pause = 2;
+    game->model.user_action = Start;
+    game->model.hold = true;
+    run_tick(&game->model, TICK_MS);
+    driver_init(&game->driver);
+  }
+  return error;
+}
+
+/**
+ * @brief Plays a game for a number of logical ticks.
+ *
+ * Before every tick in which a tetramino is falling, the autoplay policy gives
+ * one input through `driver_input()`.
+ *
+ * @param game The game.
+ * @param ticks The number of ticks.
+ * @return `false` once the game is over.
+ */
+bool advance_export_game(ExportGame_t *game, int ticks) {
+  ModelInfo_t *model = &game->model;
+  bool is_running = model->pause == 0;
+  for (int tick = 0; is_running && tick < ticks; tick++) {
+    driver_input(&game->driver, model);
+    run_tick(model, TICK_MS);
+    is_running = model->pause == 0;
+  }
+  return is_running;
+}
+
+/**
+ * @brief Renders the field with the falling tetramino into palette indices.
+ *
+ * Each cell becomes a `scale`×`scale` square: a row of cells is expanded once
+ * and copied to the other pixel rows of the cell.
+ *
+ * @param model The game model.
+ * @param scale The number of pixels per cell side.
+ * @param[out] pixels The pixels, `width * scale` by `height * scale`.
+ */
+void render_frame(ModelInfo_t *model, int scale, uint8_t *pixels) {
+  TRACE_BEGIN("render_frame");
+  pack_frame(model);
+  int stride = model->width * scale;
+  for (int y = 0; y < model->height; y++) {
+    const uint8_t *cells = model->frame_cells + y * model->width;
+    uint8_t *row = pixels + (size_t)y * scale * stride;
+    for (int x = 0; x < model->width; x++)
+      memset(row + x * scale, cells[x], scale);
+    for (int copy = 1; copy < scale; copy++)
+      memcpy(row + copy * stride, row, stride);
+  }
+  TRACE_END("render_frame");
+}
+
+/**
+ * @brief Writes one frame as a binary PPM image.
+ *
+ * @param stream The output stream.
+ * @param pixels The palette indices of the frame.
+ * @param width The width of the frame in pixels.
+ * @param height The height of the frame in pixels.
+ * @param rgb A buffer of `width * height * 3` bytes.
+ */
+void write_ppm_frame(FILE *stream, const uint8_t *pixels, int width,
+                     int height, uint8_t *rgb) {
+  size_t count = (size_t)width * height;
+  for (size_t i = 0; i < count; i++)
+    memcpy(rgb + i * 3, export_palette[pixels[i]], 3);
+  fprintf(stream, "P6\n%d %d\n255\n", width, height);
+  fwrite(rgb, 3, count, stream);
+}
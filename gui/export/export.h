@@ -0,0 +1,97 @@
+/**
+ * @file export.h
+ * @brief Offline exporter of gameplay frames.
+ *
+ * A seeded game played by the autoplay policy is run headless on the game
+ * model and every few ticks the field is rendered into indexed-colour pixels
+ * with a fixed number of pixels per cell. The frames are written to the
+ * standard output as an animated GIF, as a stream of PPM images or as raw
+ * palette indices. No terminal is involved.
+ */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../brick_game/tetris/autoplay.h"
+
+#define PALETTE_SIZE 16
+#define PALETTE_BITS 4
+#define DEFAULT_FRAMES 600
+#define DEFAULT_SCALE 8
+#define DEFAULT_TICKS_PER_FRAME 4
+#define MAX_SCALE 64
+#define GIF_MAX_CODES 4096
+#define GIF_BLOCK_SIZE 255
+
+/**
+ * @brief Output format of the frames.
+ */
+typedef enum { Format_gif, Format_ppm, Format_raw } ExportFormat_t;
+
+/**
+ * @brief Command line options of the exporter.
+ *
+ * With `alloc_check` the allocations made after the game has started are
+ * counted, and the export fails if there are any.
+ */
+typedef struct {
+  uint64_t seed;
+  int frames;
+  int scale;
+  int ticks_per_frame;
+  int width;
+  int height;
+  ExportFormat_t format;
+  bool alloc_check;
+} ExportOptions_t;
+
+/**
+ * @brief A game played by the autoplay policy through user input.
+ */
+typedef struct {
+  ModelInfo_t model;
+  ModelDriver_t driver;
+} ExportGame_t;
+
+/**
+ * @brief Streaming encoder of an animated GIF.
+ *
+ * `children[code][index]` is the LZW code of the string `code` followed by
+ * the palette index, 0 if it is not in the table yet.
+ */
+typedef struct {
+  FILE *stream;
+  int width;
+  int height;
+  uint16_t children[GIF_MAX_CODES][PALETTE_SIZE];
+  uint8_t block[GIF_BLOCK_SIZE];
+  int block_length;
+  uint32_t bits;
+  int bit_count;
+} GifWriter_t;
+
+extern const uint8_t export_palette[PALETTE_SIZE][3];
+
+bool parse_export_options(int argc, char *argv[], ExportOptions_t *options);
+int check_allocations(FILE *stream);
+int start_export_game(ExportGame_t *game, const ExportOptions_t *options);
+bool advance_export_game(ExportGame_t *game, int ticks);
+void render_frame(ModelInfo_t *model, int scale, uint8_t *pixels);
+void write_ppm_frame(FILE *stream, const uint8_t *pixels, int width,
+                     int height, uint8_t *rgb);
+
+void gif_begin(GifWriter_t *gif, FILE *stream, int width, int height);
+void gif_frame(GifWriter_t *gif, const uint8_t *pixels, int delay_cs);
+void gif_end(GifWriter_t *gif);
+void gif_put_code(GifWriter_t *gif, int code, int size);
+void gif_flush_bits(GifWriter_t *gif);
+
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file gif.c
+ * @brief Streaming encoder of animated GIF images with a 16-colour palette.
+ */
+#include "export.h"
+
+#define GIF_CLEAR_CODE PALETTE_SIZE
+#define GIF_END_CODE (PALETTE_SIZE + 1)
+#define GIF_FIRST_CODE (PALETTE_SIZE + 2)
+
+/**
+ * @brief Writes a 16-bit little-endian number.
+ *
+ * @param stream The output stream.
+ * @param value The number.
+ */
+static void put_u16(FILE *stream, int value) {
+  fputc(value & 0xff, stream);
+  fputc(value >> 8 & 0xff, stream);
+}
+
+/**
+ * @brief Writes the header, the global palette and the looping extension.
+ *
+ * @param[out] gif The encoder to start.
+ * @param stream The output stream.
+ * @param width The width of the frames in pixels.
+ * @param height The height of the frames in pixels.
+ */
+void gif_begin(GifWriter_t *gif, FILE *stream, int width, int height) {
+  gif->stream = stream;
+  gif->width = width;
+  gif->height = height;
+  gif->block_length = 0;
+  gif->bits = 0;
+  gif->bit_count = 0;
+  fwrite("GIF89a", 1, 6, stream);
+  put_u16(stream, width);
+  put_u16(stream, height);
+  fputc(0x80 | (PALETTE_BITS - 1) << 4 | (PALETTE_BITS - 1), stream);
+  fputc(0, stream);
+  fputc(0, stream);
+  fwrite(export_palette, 3, PALETTE_SIZE, stream);
+  fwrite("\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, stream);
+}
+
+/**
+ * @brief Compresses one frame with LZW and writes it.
+ *
+ * The code table is a trie indexed by code and palette index. When it is full
+ * a clear code is sent and the table starts over.
+ *
+ * @param gif The encoder.
+ * @param pixels The palette indices of the frame.
+ * @param delay_cs The time the frame is shown, in hundredths of a second.
+ */
+void gif_frame(GifWriter_t *gif, const uint8_t *pixels, int delay_cs) {
+  FILE *stream = gif->stream;
+  fwrite("\x21\xf9\x04\x04", 1, 4, stream);
+  put_u16(stream, delay_cs);
+  fwrite("\x00\x00\x2c\x00\x00\x00\x00", 1, 7, stream);
+  put_u16(stream, gif->width);
+  put_u16(stream, gif->height);
+  fputc(0, stream);
+  fputc(PALETTE_BITS, stream);
+
+  int size = PALETTE_BITS + 1;
+  int next_code = GIF_FIRST_CODE;
+  memset(gif->children, 0, sizeof(gif->children));
+  gif_put_code(gif, GIF_CLEAR_CODE, size);
+  size_t count = (size_t)gif->width * gif->height;
+  int code = pixels[0];
+  for (size_t i = 1; i < count; i++) {
+    uint8_t index = pixels[i];
+    uint16_t child = gif->children[code][index];
+    if (child) {
+      code = child;
+    } else {
+      gif_put_code(gif, code, size);
+      if (next_code < GIF_MAX_CODES) {
+        if (next_code == 1 << size) size++;
+        gif->children[code][index] = (uint16_t)next_code++;
+      } else {
+        gif_put_code(gif, GIF_CLEAR_CODE, size);
+        memset(gif->children, 0, sizeof(gif->children));
+        size = PALETTE_BITS + 1;
+        next_code = GIF_FIRST_CODE;
+      }
+      code = index;
+    }
+  }
+  gif_put_code(gif, code, size);
+  gif_put_code(gif, GIF_END_CODE, size);
+  gif_flush_bits(gif);
+  fputc(0, stream);
+}
+
+/**
+ * @brief Writes the trailer of the GIF image.
+ *
+ * @param gif The encoder.
+ */
+void gif_end(GifWriter_t *gif) { fputc(0x3b, gif->stream); }
+
+/**
+ * @brief Appends an LZW code to the data sub-blocks of the frame.
+ *
+ * @param gif The encoder.
+ * @param code The code.
+ * @param size The number of bits of the code.
+ */
+void gif_put_code(GifWriter_t *gif, int code, int size) {
+  gif->bits |= (uint32_t)code << gif->bit_count;
+  gif->bit_count += size;
+  while (gif->bit_count >= 8) {
+    gif->block[gif->block_length++] = (uint8_t)gif->bits;
+    gif->bits >>= 8;
+    gif->bit_count -= 8;
+    if (gif->block_length == GIF_BLOCK_SIZE) {
+      fputc(GIF_BLOCK_SIZE, gif->stream);
+      fwrite(gif->block, 1, GIF_BLOCK_SIZE, gif->stream);
+      gif->block_length = 0;
+    }
+  }
+}
+
+/**
+ * @brief Writes the remaining bits and the last data sub-block of the frame.
+ *
+ * @param gif The encoder.
+ */
+void gif_flush_bits(GifWriter_t *gif) {
+  if (gif->bit_count) gif_put_code(gif, 0, 8 - gif->bit_count);
+  if (gif->block_length) {
+    fputc(gif->block_length, gif->stream);
+    fwrite(gif->block, 1, gif->block_length, gif->stream);
+  }
+  gif->block_length = 0;
+  gif->bits = 0;
+  gif->bit_count = 0;
+}
@@ -2,11 +2,29 @@
 #define TEST_H
 
 #include <check.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../brick_game/brick_game.h"
 #include "../brick_game/tetris/backend.h"
+#include "../brick_game/tetris/autoplay.h"
+#include "../brick_game/tetris/bot_plugin.h"
+#include "../brick_game/tetris/game_state.h"
+#include "../brick_game/tetris/metrics.h"
+#include "../brick_game/tetris/perft.h"
+#include "../brick_game/tetris/planner.h"
+#include "../brick_game/tetris/rewind.h"
+#include "../brick_game/tetris/soa_engine.h"
+#include "../brick_game/tetris/tournament.h"
+#include "../brick_game/tetris/transposition.h"
+#include "../brick_game/tetris/versus.h"
+#include "../brick_game/tetris/work_pool.h"
+#include "../brick_game/tetris_env.h"
+#include "../gui/cli/input.h"
 
 #define SUCCESS 1
 #define FAILURE 0
@@ -2,7 +2,7 @@
 
 START_TEST(update_state)
 {
-  GameInfo_t test = {NULL, NULL, 0, 0, 0, 0, 0};
+  GameInfo_t test = {NULL, NULL, 0, 0, 0, 0, 0, 0, 0, {0}, 0};
   ck_assert_ptr_eq(test.field, NULL);
   ck_assert_ptr_eq(test.next, NULL);
   test = updateCurrentState();
@@ -43,7 +43,7 @@ START_TEST(get_model_info)
   ck_assert_int_eq(actual_info.speed, 0);
   ck_assert_int_eq(actual_info.pause, 0);
 
-  remove_matrix(&actual_info.field_base, FIELD_HEIGHT);
+  remove_byte_matrix(&actual_info.field_base);
   remove_matrix(&actual_info.current_tetramino, TETR_SIZE);
   remove_matrix(&actual_info.next_tetramino, TETR_SIZE);
   remove_matrix(&actual_info.collision_test_tetramino, TETR_SIZE);
@@ -52,9 +52,11 @@ END_TEST
 
 START_TEST(spawn)
 {
-  ModelInfo_t *actual_info = (ModelInfo_t *)malloc(sizeof(ModelInfo_t));
+  ModelInfo_t *actual_info = (ModelInfo_t *)calloc(1, sizeof(ModelInfo_t));
+  actual_info->width = FIELD_WIDTH;
+  actual_info->height = FIELD_HEIGHT;
 
-  create_matrix(&actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
+  create_byte_matrix(&actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
   create_matrix(&actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
   create_matrix(&actual_info->current_tetramino, TETR_SIZE, TETR_SIZE);
   create_matrix(&actual_info->collision_test_tetramino, TETR_SIZE, TETR_SIZE);
@@ -84,7 +86,7 @@ START_TEST(spawn)
 
   ck_assert_int_eq(actual_info->state, Moving);
 
-  remove_matrix(&(actual_info)->field_base, FIELD_HEIGHT);
+  remove_byte_matrix(&(actual_info)->field_base);
   remove_matrix(&(actual_info)->current_tetramino, TETR_SIZE);
   remove_matrix(&(actual_info)->next_tetramino, TETR_SIZE);
   remove_matrix(&(actual_info)->collision_test_tetramino, TETR_SIZE);
@@ -121,7 +123,7 @@ START_TEST(initialize)
   actual_info->high_score = -1;
   actual_info->state = Pause_state;
 
-  create_matrix(&(actual_info)->field_base, FIELD_HEIGHT, FIELD_WIDTH);
+  create_byte_matrix(&(actual_info)->field_base, FIELD_HEIGHT, FIELD_WIDTH);
   initialize_game(actual_info);
 
   ck_assert_int_eq(actual_info->score, 0);
@@ -192,8 +194,8 @@ END_TEST
 
 START_TEST(clear_lines)
 {
-  int **temp_field;
-  create_matrix(&temp_field, FIELD_HEIGHT, FIELD_WIDTH);
+  uint8_t **temp_field;
+  create_byte_matrix(&temp_field, FIELD_HEIGHT, FIELD_WIDTH);
   for (int i = FIELD_HEIGHT / 2; i < FIELD_HEIGHT; i++)
   {
     for (int j = 0; j < FIELD_WIDTH; j++)
@@ -202,7 +204,7 @@ START_TEST(clear_lines)
     }
   }
 
-  clear_line(temp_field, 14);
+  clear_line(temp_field, 14, FIELD_WIDTH);
   for (int i = 0; i < (FIELD_HEIGHT / 2) + 1; i++)
   {
     for (int j = 0; j < FIELD_WIDTH; j++)
@@ -211,7 +213,7 @@ START_TEST(clear_lines)
     }
   }
 
-  clear_line(temp_field, 14);
+  clear_line(temp_field, 14, FIELD_WIDTH);
   for (int i = 0; i < (FIELD_HEIGHT / 2) + 2; i++)
   {
     for (int j = 0; j < FIELD_WIDTH; j++)
@@ -220,7 +222,16 @@ START_TEST(clear_lines)
     }
   }
 
-  remove_matrix(&temp_field, FIELD_HEIGHT);
+  // the top row comes in empty, also when it was the cleared one:
+  temp_field[0][3] = 1;
+  clear_line(temp_field, 1, FIELD_WIDTH);
+  ck_assert_int_eq(temp_field[1][3], 1);
+  ck_assert_int_eq(temp_field[0][3], 0);
+  temp_field[0][3] = 1;
+  clear_line(temp_field, 0, FIELD_WIDTH);
+  ck_assert_int_eq(temp_field[0][3], 0);
+
+  remove_byte_matrix(&temp_field);
 }
 END_TEST
 
@@ -266,15 +277,18 @@ END_TEST
 
 START_TEST(fsm)
 {
-  GameInfo_t test = {NULL, NULL, 0, 0, 1, 0, 0};
+  GameInfo_t test = {NULL, NULL, 0, 0, 1, 0, 0, FIELD_WIDTH, FIELD_HEIGHT,
+                     {0}, 0};
   if (!test.field)
     create_matrix(&test.field, FIELD_HEIGHT, FIELD_WIDTH);
   if (!test.next)
     create_matrix(&test.next, TETR_SIZE, TETR_SIZE);
-  ModelInfo_t *actual_info = (ModelInfo_t *)malloc(sizeof(ModelInfo_t));
+  ModelInfo_t *actual_info = (ModelInfo_t *)calloc(1, sizeof(ModelInfo_t));
   actual_info->state = Start_state;
   actual_info->user_action = Start;
   actual_info->hold = true;
+  actual_info->width = FIELD_WIDTH;
+  actual_info->height = FIELD_HEIGHT;
   actual_info->field_base = NULL;
   actual_info->next_tetramino = NULL;
   actual_info->next_type = O_tetramino;
@@ -289,7 +303,7 @@ START_TEST(fsm)
   actual_info->speed = 0;
   actual_info->pause = 0;
   actual_info->timer = 1;
-  create_matrix(&actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
+  create_byte_matrix(&actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
   create_matrix(&actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
   create_matrix(&actual_info->current_tetramino, TETR_SIZE, TETR_SIZE);
   create_matrix(&actual_info->collision_test_tetramino, TETR_SIZE, TETR_SIZE);
@@ -356,6 +370,1484 @@ START_TEST(fsm)
 }
 END_TEST
 
+START_TEST(scheduler)
+{
+  ModelInfo_t *actual_info = (ModelInfo_t *)calloc(1, sizeof(ModelInfo_t));
+  actual_info->state = Start_state;
+  actual_info->fixed_step = true;
+  scheduler_init(&actual_info->scheduler, TICK_MS);
+
+  ck_assert_int_eq(scheduler_advance(&actual_info->scheduler, actual_info, 1000),
+                   0);
+  ck_assert_int_eq(scheduler_advance(&actual_info->scheduler, actual_info, 1012),
+                   2);
+  ck_assert_int_eq(actual_info->sim_time, 2 * TICK_MS);
+  ck_assert_int_eq(scheduler_advance(&actual_info->scheduler, actual_info, 1015),
+                   1);
+  ck_assert_int_eq(actual_info->scheduler.accumulator, 0);
+
+  ck_assert_int_eq(
+      scheduler_advance(&actual_info->scheduler, actual_info, 1000000),
+      MAX_TICKS_PER_ADVANCE);
+  ck_assert_int_eq(actual_info->scheduler.accumulator, 0);
+  free(actual_info);
+}
+END_TEST
+
+START_TEST(headless)
+{
+  ModelInfo_t *actual_info = (ModelInfo_t *)calloc(1, sizeof(ModelInfo_t));
+  actual_info->width = FIELD_WIDTH;
+  actual_info->height = FIELD_HEIGHT;
+  create_byte_matrix(&actual_info->field_base, FIELD_HEIGHT, FIELD_WIDTH);
+  create_matrix(&actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
+  create_matrix(&actual_info->current_tetramino, TETR_SIZE, TETR_SIZE);
+  create_matrix(&actual_info->collision_test_tetramino, TETR_SIZE, TETR_SIZE);
+  fill_tetramino(actual_info->next_tetramino, O_tetramino);
+  actual_info->next_type = O_tetramino;
+  actual_info->level = 1;
+  scheduler_init(&actual_info->scheduler, TICK_MS);
+
+  actual_info->state = Start_state;
+  actual_info->user_action = Start;
+  actual_info->hold = true;
+  run_headless(actual_info, 1);
+  ck_assert_int_eq(actual_info->state, Moving);
+  ck_assert_int_eq(actual_info->hold, false);
+
+  long long int ticks = 0;
+  int cells = 0;
+  while (!cells && ticks < 10000) {
+    ticks += run_headless(actual_info, 1);
+    for (int i = 0; i < FIELD_HEIGHT; i++)
+      for (int j = 0; j < FIELD_WIDTH; j++)
+        if (actual_info->field_base[i][j]) cells++;
+  }
+  ck_assert_int_eq(cells, 4);
+  ck_assert_int_eq(actual_info->state, Moving);
+  ck_assert_int_eq(actual_info->sim_time, (ticks + 1) * TICK_MS);
+
+  run_terminate_actions(actual_info);
+  free(actual_info);
+}
+END_TEST
+
+START_TEST(engine_stats)
+{
+  ModelInfo_t *actual_info = (ModelInfo_t *)calloc(1, sizeof(ModelInfo_t));
+  actual_info->state = Pause_state;
+  actual_info->user_action = Up;
+  run_actions_by_state(actual_info);
+  run_actions_by_state(actual_info);
+  actual_info->user_action = Terminate;
+  run_actions_by_state(actual_info);
+
+  const EngineStats_t *stats = get_engine_stats(actual_info);
+  ck_assert_uint_eq(stats->transitions[Pause_state][Pause_state], 2);
+  ck_assert_uint_eq(stats->transitions[Pause_state][Exit_state], 1);
+  ck_assert_uint_eq(histogram_total(stats->state_time[Pause_state]), 1);
+
+  EngineStats_t steps = {0};
+  stats_record_step(&steps, Spawn, Spawn, 100);
+  stats_record_step(&steps, Spawn, Moving, 150);
+  stats_record_step(&steps, Moving, Shifting, 1150);
+  ck_assert_uint_eq(steps.state_time[Spawn][histogram_bucket(50)], 1);
+  ck_assert_uint_eq(steps.state_time[Moving][histogram_bucket(1000)], 1);
+
+  ck_assert_int_eq(histogram_bucket(0), 0);
+  ck_assert_int_eq(histogram_bucket(1), 1);
+  ck_assert_int_eq(histogram_bucket(1000), 10);
+  ck_assert_int_eq(histogram_bucket(1LL << 40), HISTOGRAM_BUCKETS - 1);
+
+  EngineStats_t latency = {0};
+  stats_mark_input(&latency, 100);
+  stats_mark_input(&latency, 200);
+  stats_mark_frame(&latency, 1100);
+  stats_mark_frame(&latency, 5000);
+  ck_assert_uint_eq(latency.input_latency[histogram_bucket(1000)], 1);
+  ck_assert_uint_eq(histogram_total(latency.input_latency), 1);
+  ck_assert_int_eq(histogram_percentile(latency.input_latency, 0.99), 1024);
+  free(actual_info);
+
+  ModelInfo_t *game = get_info();
+  game->stats.input_time = 0;
+  userInputAt(Left, true, monotonic_us() - 5000);
+  ck_assert_int_eq(game->user_action, Left);
+  frameRendered();
+  ck_assert_int_ge(histogram_percentile(game->stats.input_latency, 1.0), 5000);
+  game->user_action = Up;
+  game->hold = false;
+}
+END_TEST
+
+START_TEST(chrome_trace)
+{
+  ck_assert_int_eq(trace_start(NULL), false);
+  ck_assert_int_eq(trace_start("trace_test.json"), true);
+  TRACE_BEGIN("updateCurrentState");
+  TRACE_END("updateCurrentState");
+  trace_stop();
+  ck_assert_int_eq(TRACE_IS_ENABLED(), false);
+  TRACE_BEGIN("ignored");
+
+  char buffer[512] = {0};
+  FILE *file = fopen("trace_test.json", "r");
+  ck_assert_ptr_nonnull(file);
+  size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  remove("trace_test.json");
+  ck_assert_int_gt(size, 0);
+  ck_assert_ptr_nonnull(strstr(buffer, "\"traceEvents\""));
+  ck_assert_ptr_nonnull(strstr(buffer, "\"ph\":\"B\""));
+  ck_assert_ptr_nonnull(strstr(buffer, "\"ph\":\"E\""));
+  ck_assert_ptr_null(strstr(buffer, "ignored"));
+}
+END_TEST
+
+START_TEST(board_size)
+{
+  ck_assert_int_eq(is_valid_board_size(FIELD_WIDTH, FIELD_HEIGHT), true);
+  ck_assert_int_eq(is_valid_board_size(MAX_FIELD_WIDTH + 1, FIELD_HEIGHT),
+                   false);
+  ck_assert_int_eq(is_valid_board_size(FIELD_WIDTH, MIN_FIELD_HEIGHT - 1),
+                   false);
+  ck_assert_int_eq(spawn_x_position(FIELD_WIDTH), SPAWN_X_POSITION);
+
+  ModelInfo_t actual_info = {0};
+  ck_assert_int_eq(init_model(&actual_info, MAX_FIELD_WIDTH, 40), 0);
+  ck_assert_int_eq(actual_info.width, MAX_FIELD_WIDTH);
+  ck_assert_int_eq(actual_info.height, 40);
+
+  fill_tetramino(actual_info.current_tetramino, I_tetramino);
+  actual_info.y_position = 37;
+  actual_info.x_position = MAX_FIELD_WIDTH - 4;
+  ck_assert_int_eq(is_move_collision(&actual_info), NO_COLLISION);
+  actual_info.x_position++;
+  ck_assert_int_eq(is_move_collision(&actual_info), BASE_COLLISION);
+  actual_info.x_position--;
+  actual_info.y_position++;
+  ck_assert_int_eq(is_move_collision(&actual_info), FLOOR_COLLISION);
+
+  for (int x = 0; x < MAX_FIELD_WIDTH; x++) {
+    actual_info.field_base[39][x] = 1;
+    actual_info.field_base[38][x] = x % 2;
+  }
+  uint64_t rows[3];
+  field_row_masks(&actual_info, 38, 3, rows);
+  ck_assert_uint_eq(rows[0], 0xaaaaaaaaaaaaaaaaull);
+  ck_assert_uint_eq(rows[1], UINT64_MAX);
+  ck_assert_uint_eq(rows[2], 0);
+  actual_info.y_position = 34;
+  ck_assert_int_eq(is_move_collision(&actual_info), NO_COLLISION);
+  actual_info.y_position = 36;
+  ck_assert_int_eq(is_move_collision(&actual_info), BASE_COLLISION);
+  calculate_lines(&actual_info);
+  ck_assert_int_eq(actual_info.score, 100);
+  for (int x = 0; x < MAX_FIELD_WIDTH; x++)
+    ck_assert_int_eq(actual_info.field_base[39][x], x % 2);
+
+  ck_assert_int_ne(resize_model(&actual_info, 3, 3), 0);
+  ck_assert_int_eq(actual_info.width, MAX_FIELD_WIDTH);
+  ck_assert_int_eq(resize_model(&actual_info, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_int_eq(actual_info.x_position, SPAWN_X_POSITION);
+  actual_info.high_score = actual_info.score;
+  run_terminate_actions(&actual_info);
+  ck_assert_ptr_null(actual_info.field_base);
+}
+END_TEST
+
+START_TEST(compact_state)
+{
+  for (TetraminoType_t type = O_tetramino; type <= L_tetramino; type++)
+  {
+    int **temp;
+    create_matrix(&temp, TETR_SIZE, TETR_SIZE);
+    fill_tetramino(temp, type);
+    for (int rotation = 0; rotation < PIECE_ROTATIONS; rotation++)
+    {
+      ck_assert_int_eq(find_rotation(type, temp),
+                       rotation % piece_period(type));
+      rotate(type, &temp);
+    }
+    remove_matrix(&temp, TETR_SIZE);
+  }
+
+  ModelInfo_t actual_info = {0};
+  init_model(&actual_info, FIELD_WIDTH, FIELD_HEIGHT);
+  actual_info.state = Spawn;
+  run_tick(&actual_info, TICK_MS);
+  GameState_t game;
+  ck_assert_int_eq(state_from_model(&game, &actual_info), 0);
+  uint64_t rng = game.rng;
+  ck_assert_int_gt(actual_info.queue.count, 0);
+  for (int i = 0; i < actual_info.queue.count; i++)
+    ck_assert_int_eq(1 + (int)(random_next(&rng) % 7),
+                     queue_peek(&actual_info.queue, i));
+
+  srand(21);
+  int resyncs = 0;
+  for (int tick = 0; tick < 20000 && actual_info.state == Moving; tick++)
+  {
+    UserAction_t action = (UserAction_t)(Left + rand() % 5);
+    int pieces = game.pieces;
+    actual_info.user_action = action;
+    actual_info.hold = true;
+    run_tick(&actual_info, TICK_MS);
+    state_step(&game, action);
+    if (actual_info.state != Moving)
+      break;
+    ck_assert_int_eq(game.x_position, actual_info.x_position);
+    ck_assert_int_eq(game.y_position, actual_info.y_position);
+    ck_assert_int_eq(game.score, actual_info.score);
+    for (int y = 0; y < FIELD_HEIGHT; y++)
+      for (int x = 0; x < FIELD_WIDTH; x++)
+        ck_assert_int_eq(state_cell(&game, x, y),
+                         actual_info.field_base[y][x] != 0);
+    if (game.pieces != pieces)
+    {
+      ck_assert_int_eq(game.piece, actual_info.current_type);
+      ck_assert_int_eq(game.next_piece, actual_info.next_type);
+      state_from_model(&game, &actual_info);
+      resyncs++;
+    }
+    else
+    {
+      ck_assert_int_eq(game.rotation,
+                       find_rotation(actual_info.current_type,
+                                     actual_info.current_tetramino));
+    }
+  }
+  ck_assert_int_gt(resyncs, 10);
+
+  GameState_t copy;
+  ck_assert_int_eq(state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 5), 0);
+  state_clone(&copy, &game);
+  state_drop(&game);
+  ck_assert_int_ne(memcmp(&copy, &game, sizeof(GameState_t)), 0);
+  state_clone(&game, &copy);
+  ck_assert_int_eq(memcmp(&copy, &game, sizeof(GameState_t)), 0);
+
+  ck_assert_int_ne(state_init(&game, FIELD_WIDTH, STATE_MAX_HEIGHT + 1, 1), 0);
+  ck_assert_int_eq(state_init(&game, 4, 4, 7), 0);
+  while (!state_is_over(&game))
+    state_drop(&game);
+  ck_assert_int_gt(game.pieces, 0);
+
+  actual_info.high_score = actual_info.score;
+  run_terminate_actions(&actual_info);
+}
+END_TEST
+
+START_TEST(packed_state)
+{
+  ModelInfo_t *actual_info = get_info();
+  ck_assert_int_eq(resize_model(actual_info, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_ptr_nonnull(actual_info->frame_cells);
+  ck_assert_ptr_eq(actual_info->field_base[FIELD_HEIGHT - 1],
+                   actual_info->field_base[0] +
+                       (FIELD_HEIGHT - 1) * FIELD_WIDTH);
+  ck_assert_uint_eq(byte_matrix_size(FIELD_HEIGHT, FIELD_WIDTH),
+                    FIELD_HEIGHT * (sizeof(uint8_t *) + FIELD_WIDTH));
+  create_matrix(&actual_info->current_tetramino, TETR_SIZE, TETR_SIZE);
+  create_matrix(&actual_info->next_tetramino, TETR_SIZE, TETR_SIZE);
+  fill_tetramino(actual_info->current_tetramino, T_tetramino);
+  fill_tetramino(actual_info->next_tetramino, I_tetramino);
+  actual_info->field_base[FIELD_HEIGHT - 1][0] = S_tetramino;
+  actual_info->x_position = 0;
+  actual_info->y_position = 0;
+  actual_info->state = Start_state;
+  actual_info->hold = false;
+  actual_info->pause = 0;
+
+  PackedGameInfo_t packed = updatePackedState();
+  ck_assert_ptr_nonnull(packed.field);
+  ck_assert_ptr_nonnull(packed.next);
+  ck_assert_int_eq(packed.width, FIELD_WIDTH);
+  ck_assert_int_eq(packed.height, FIELD_HEIGHT);
+  ck_assert_int_eq(packed.field[(FIELD_HEIGHT - 1) * FIELD_WIDTH], S_tetramino);
+  ck_assert_int_eq(packed.field[1 * FIELD_WIDTH + 2], T_tetramino);
+  ck_assert_int_eq(packed.field[2 * FIELD_WIDTH + 1], T_tetramino);
+  ck_assert_int_eq(packed.field[0], 0);
+  for (int i = 0; i < TETR_SIZE; i++)
+    for (int j = 0; j < TETR_SIZE; j++)
+      ck_assert_int_eq(packed.next[i * TETR_SIZE + j],
+                       actual_info->next_tetramino[i][j]);
+  actual_info->field_base[FIELD_HEIGHT - 1][0] = 0;
+  remove_matrix(&actual_info->current_tetramino, TETR_SIZE);
+  remove_matrix(&actual_info->next_tetramino, TETR_SIZE);
+}
+END_TEST
+
+START_TEST(autoplay)
+{
+  GameState_t game;
+  BoardFeatures_t features;
+  state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 7);
+  game.rows[FIELD_HEIGHT - 1] = 0x1fb;
+  game.rows[FIELD_HEIGHT - 2] = 0x005;
+  board_features(&game, &features);
+  ck_assert_int_eq(features.holes, 1);
+  ck_assert_int_eq(features.max_height, 2);
+  ck_assert_int_eq(features.aggregate_height, 11);
+  ck_assert_int_eq(features.bumpiness, 4);
+
+  Placement_t placements[MAX_PLACEMENTS];
+  int count = enumerate_placements(&game, placements);
+  ck_assert_int_gt(count, 0);
+  for (int i = 0; i < count; i++)
+    ck_assert(!state_collides(&game, placements[i].rotation,
+                              placements[i].x_position, game.y_position));
+
+  state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 7);
+  while (autoplay_step(&game) && game.pieces < 200) continue;
+  ck_assert_int_ge(game.pieces, 200);
+  ck_assert_int_gt(game.lines, 50);
+  game.state = Game_over;
+  ck_assert(!choose_placement(&game, &(Placement_t){0, 0}));
+
+  game.rotation = 0;
+  game.x_position = 3;
+  ck_assert_int_eq(autoplay_action(&game, &(Placement_t){1, 3}), Action);
+  ck_assert_int_eq(autoplay_action(&game, &(Placement_t){0, 1}), Left);
+  ck_assert_int_eq(autoplay_action(&game, &(Placement_t){0, 5}), Right);
+  ck_assert_int_eq(autoplay_action(&game, &(Placement_t){0, 3}), Down);
+}
+END_TEST
+
+START_TEST(batched_env)
+{
+  ck_assert_ptr_null(tetrisEnvCreate(4, FIELD_WIDTH, STATE_MAX_HEIGHT + 1, 1));
+  TetrisEnv_t *env = tetrisEnvCreate(4, FIELD_WIDTH, FIELD_HEIGHT, 3);
+  ck_assert_ptr_nonnull(env);
+  int size = tetrisEnvObservationSize(env);
+  ck_assert_int_eq(size, FIELD_WIDTH * FIELD_HEIGHT + 2);
+  ck_assert_int_eq(tetrisEnvPlacementCount(env), 4 * (FIELD_WIDTH + 4));
+  uint8_t observations[4 * (FIELD_WIDTH * FIELD_HEIGHT + 2)];
+  float rewards[4];
+  uint8_t dones[4];
+  int32_t actions[4] = {Down, Down, Down, Down};
+
+  uint64_t seed = 3;
+  for (int i = 0; i < 4; i++) random_next(&seed);
+  GameState_t expected;
+  state_init(&expected, FIELD_WIDTH, FIELD_HEIGHT, random_next(&seed));
+  tetrisEnvReset(env, observations);
+  for (int i = 0; i < 4; i++) {
+    ck_assert_int_ge(observations[i * size + size - 2], 1);
+    ck_assert_int_le(observations[i * size + size - 1], 7);
+  }
+  int finished = 0;
+  bool in_sync = true;
+  for (int step = 0; step < 4000 && finished < 8; step++) {
+    for (int i = 0; i < 4; i++) actions[i] = rand() % 56;
+    finished += tetrisEnvStepPlacements(env, actions, observations, rewards,
+                                        dones);
+    if (in_sync) {
+      int score = expected.score;
+      if (!state_place(&expected, actions[0] / 14 % 4, actions[0] % 14 - 4))
+        state_drop(&expected);
+      ck_assert_float_eq(rewards[0], (float)(expected.score - score));
+      in_sync = !dones[0];
+      for (int y = 0; in_sync && y < FIELD_HEIGHT; y++)
+        for (int x = 0; x < FIELD_WIDTH; x++)
+          ck_assert_int_eq(observations[y * FIELD_WIDTH + x] == 1,
+                           state_cell(&expected, x, y));
+      if (in_sync) ck_assert_int_eq(observations[size - 2], expected.piece);
+    }
+    for (int i = 0; i < 4 * size; i++) ck_assert_int_le(observations[i], 7);
+  }
+  ck_assert_int_ge(finished, 8);
+
+  finished = 0;
+  for (int step = 0; step < 20000 && !finished; step++) {
+    for (int i = 0; i < 4; i++) actions[i] = Down;
+    finished = tetrisEnvStep(env, actions, observations, rewards, dones);
+  }
+  ck_assert_int_gt(finished, 0);
+  tetrisEnvDestroy(env);
+}
+END_TEST
+
+START_TEST(soa_engine)
+{
+  enum { GAMES = 37 };
+  SoaGames_t games;
+  GameState_t expected[GAMES];
+  GameState_t actual;
+  uint8_t actions[GAMES];
+  uint64_t seed = 11;
+  ck_assert_int_eq(soa_init(&games, GAMES, seed), 0);
+  ck_assert_int_eq(games.capacity % SOA_BLOCK, 0);
+  for (int k = 0; k < GAMES; k++)
+    state_init(&expected[k], FIELD_WIDTH, FIELD_HEIGHT, random_next(&seed));
+
+  int locked = 0;
+  for (int tick = 0; tick < 3000; tick++) {
+    for (int k = 0; k < GAMES; k++) {
+      actions[k] = (uint8_t)(Left + rand() % 5);
+      state_step(&expected[k], (UserAction_t)actions[k]);
+    }
+    soa_step(&games, actions);
+    for (int k = 0; k < GAMES; k++) {
+      soa_get_state(&games, k, &actual);
+      ck_assert_mem_eq(actual.rows, expected[k].rows, sizeof(actual.rows));
+      ck_assert_int_eq(actual.x_position, expected[k].x_position);
+      ck_assert_int_eq(actual.y_position, expected[k].y_position);
+      ck_assert_int_eq(actual.rotation, expected[k].rotation);
+      ck_assert_int_eq(actual.piece, expected[k].piece);
+      ck_assert_int_eq(actual.next_piece, expected[k].next_piece);
+      ck_assert_int_eq(actual.score, expected[k].score);
+      ck_assert_int_eq(actual.pieces, expected[k].pieces);
+      ck_assert_int_eq(actual.state, expected[k].state);
+      ck_assert_int_eq(actual.timer, expected[k].timer);
+      if (state_is_over(&expected[k])) {
+        uint64_t restart = random_next(&seed);
+        state_init(&expected[k], FIELD_WIDTH, FIELD_HEIGHT, restart);
+        soa_reset_game(&games, k, restart);
+      }
+    }
+  }
+  for (int k = 0; k < GAMES; k++) locked += games.pieces[k];
+  ck_assert_int_gt(locked, GAMES);
+  soa_free(&games);
+  ck_assert_ptr_null(games.board);
+}
+END_TEST
+
+START_TEST(preview_queue)
+{
+  ModelInfo_t actual_info;
+  ck_assert_int_eq(init_model(&actual_info, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_int_eq(actual_info.preview_depth, MIN_PREVIEW_DEPTH);
+  ck_assert_int_ne(set_preview_depth(&actual_info, 0), 0);
+  ck_assert_int_ne(set_preview_depth(&actual_info, MAX_PREVIEW_DEPTH + 1), 0);
+  ck_assert_int_eq(set_preview_depth(&actual_info, MAX_PREVIEW_DEPTH), 0);
+
+  int preview[MAX_PREVIEW_DEPTH];
+  int previous[MAX_PREVIEW_DEPTH];
+  ck_assert_int_eq(fill_preview(&actual_info, previous), MAX_PREVIEW_DEPTH);
+  ck_assert_int_eq(previous[0], actual_info.next_type);
+  for (int spawned = 0; spawned < 3 * PIECE_QUEUE_SIZE; spawned++) {
+    memset(actual_info.field_base[0], 0, FIELD_HEIGHT * FIELD_WIDTH);
+    spawn_tetramino(&actual_info);
+    ck_assert_int_eq(actual_info.current_type, previous[0]);
+    fill_preview(&actual_info, preview);
+    for (int i = 0; i < MAX_PREVIEW_DEPTH; i++) {
+      ck_assert_int_ge(preview[i], O_tetramino);
+      ck_assert_int_le(preview[i], L_tetramino);
+      if (i + 1 < MAX_PREVIEW_DEPTH)
+        ck_assert_int_eq(preview[i], previous[i + 1]);
+    }
+    int cells = 0;
+    for (int i = 0; i < TETR_SIZE; i++)
+      for (int j = 0; j < TETR_SIZE; j++)
+        if (actual_info.next_tetramino[i][j]) {
+          ck_assert_int_eq(actual_info.next_tetramino[i][j], preview[0]);
+          cells++;
+        }
+    ck_assert_int_eq(cells, 4);
+    memcpy(previous, preview, sizeof(preview));
+  }
+
+  ck_assert_int_eq(set_preview_depth(&actual_info, 2), 0);
+  ck_assert_int_eq(fill_preview(&actual_info, preview), 2);
+  ck_assert_int_eq(preview[1], previous[1]);
+  ck_assert_int_eq(preview[2], 0);
+
+  actual_info.high_score = actual_info.score;
+  run_terminate_actions(&actual_info);
+}
+END_TEST
+
+START_TEST(zobrist_hash)
+{
+  GameState_t game;
+  state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 3);
+  ck_assert_uint_eq(game.hash, 0);
+  uint64_t spawned = state_hash(&game);
+  state_move_left(&game);
+  ck_assert_uint_ne(state_hash(&game), spawned);
+  state_move_right(&game);
+  ck_assert_uint_eq(state_hash(&game), spawned);
+
+  for (int i = 0; i < 300 && autoplay_step(&game); i++)
+    ck_assert_uint_eq(game.hash, rows_hash(&game, 0, FIELD_HEIGHT - 1));
+  ck_assert_int_gt(game.lines, 0);
+  uint64_t hash = game.hash;
+  state_rehash(&game);
+  ck_assert_uint_eq(game.hash, hash);
+  ck_assert_uint_ne(zobrist_key(ZOBRIST_CELL(0, 1)),
+                    zobrist_key(ZOBRIST_CELL(1, 0)));
+}
+END_TEST
+
+#define TABLE_THREADS 4
+#define TABLE_KEYS 20000
+
+static void *table_worker(void *data)
+{
+  TranspositionTable_t *table = data;
+  long long int errors = 0;
+  for (uint64_t i = 0; i < TABLE_KEYS; i++) {
+    uint64_t key = zobrist_key(i % (TABLE_KEYS / 4));
+    double value = 0;
+    if (table_probe(table, key, &value) && value != (double)(key >> 11))
+      errors++;
+    table_store(table, key, (double)(key >> 11));
+  }
+  return (void *)errors;
+}
+
+START_TEST(transposition_table)
+{
+  TranspositionTable_t table;
+  ck_assert_int_ne(table_init(&table, MAX_TABLE_BITS + 1), 0);
+  ck_assert_ptr_null(table.entries);
+  ck_assert_int_eq(table_init(&table, 8), 0);
+  double value = 0;
+  ck_assert(!table_probe(&table, 42, &value));
+  table_store(&table, 42, 1.5);
+  table_store(&table, 43, -2.0);
+  ck_assert(table_probe(&table, 42, &value));
+  ck_assert_float_eq(value, 1.5);
+  table_store(&table, 42, 3.0);
+  ck_assert(table_probe(&table, 42, &value));
+  ck_assert_float_eq(value, 3.0);
+  ck_assert(table_probe(&table, 43, &value));
+  ck_assert_float_eq(value, -2.0);
+  for (uint64_t i = 1; i <= TABLE_BUCKET_ENTRIES; i++)
+    table_store(&table, 42 + (i << 32), (double)i);
+  ck_assert(table_probe(&table, 42 + ((uint64_t)TABLE_BUCKET_ENTRIES << 32),
+                        &value));
+  table_clear(&table);
+  ck_assert(!table_probe(&table, 43, &value));
+
+  pthread_t threads[TABLE_THREADS];
+  for (int i = 0; i < TABLE_THREADS; i++)
+    pthread_create(&threads[i], NULL, table_worker, &table);
+  for (int i = 0; i < TABLE_THREADS; i++) {
+    void *errors = NULL;
+    pthread_join(threads[i], &errors);
+    ck_assert_ptr_null(errors);
+  }
+  table_free(&table);
+
+  GameState_t game;
+  Placement_t best;
+  Placement_t cached;
+  ck_assert_int_eq(table_init(&table, 16), 0);
+  state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 5);
+  for (int i = 0; i < 10; i++) {
+    ck_assert(search_placement(&game, 2, NULL, &best));
+    ck_assert(search_placement(&game, 2, &table, &cached));
+    ck_assert_int_eq(best.rotation, cached.rotation);
+    ck_assert_int_eq(best.x_position, cached.x_position);
+    ck_assert_float_eq(search_value(&game, 2, &table),
+                       search_value(&game, 2, NULL));
+    state_place(&game, best.rotation, best.x_position);
+  }
+  ck_assert_int_eq(game.pieces, 10);
+  table_free(&table);
+}
+END_TEST
+
+START_TEST(perft)
+{
+  PerftResult_t result;
+  ck_assert_int_ne(perft_run(FIELD_WIDTH, FIELD_HEIGHT, 1, 0, 1, &result), 0);
+  ck_assert_int_ne(perft_run(FIELD_WIDTH, FIELD_HEIGHT, 1, 1, 0, &result), 0);
+
+  ck_assert_int_eq(perft_run(FIELD_WIDTH, FIELD_HEIGHT, 1, 1, 1, &result), 0);
+  ck_assert_int_eq(result.leaves, 34);
+  ck_assert_int_eq(perft_run(FIELD_WIDTH, FIELD_HEIGHT, 1, 3, 1, &result), 0);
+  ck_assert_int_eq(result.leaves, 5352);
+  ck_assert_int_eq(result.distinct, 5352);
+  ck_assert_int_eq(result.nodes, 34 + 306 + 5352);
+  ck_assert_int_eq(perft_run(FIELD_WIDTH, FIELD_HEIGHT, 7, 3, 3, &result), 0);
+  ck_assert_int_eq(result.leaves, 5435);
+  ck_assert_int_eq(result.distinct, 5431);
+  ck_assert_int_eq(result.nodes, 34 + 589 + 5435);
+}
+END_TEST
+
+#define POOL_TASKS 1000
+
+static void pool_task(void *context, int task, int worker)
+{
+  atomic_int *runs = context;
+  (void)worker;
+  atomic_fetch_add(&runs[task], task % 7 ? 1 : 1 + (task % 3));
+}
+
+START_TEST(work_pool)
+{
+  WorkPool_t pool;
+  ck_assert_int_ne(pool_init(&pool, 0), 0);
+  ck_assert_int_ne(pool_init(&pool, MAX_POOL_THREADS + 1), 0);
+  ck_assert_int_ge(default_thread_count(), 1);
+
+  static atomic_int runs[POOL_TASKS];
+  for (int threads = 1; threads <= 4; threads += 3) {
+    ck_assert_int_eq(pool_init(&pool, threads), 0);
+    ck_assert_int_eq(pool.threads, threads);
+    for (int batch = 0; batch < 3; batch++) {
+      for (int i = 0; i < POOL_TASKS; i++) atomic_init(&runs[i], 0);
+      pool_run(&pool, pool_task, runs, POOL_TASKS - batch);
+      for (int i = 0; i < POOL_TASKS; i++)
+        ck_assert_int_eq(atomic_load(&runs[i]),
+                         i >= POOL_TASKS - batch ? 0
+                         : i % 7                 ? 1
+                                                 : 1 + i % 3);
+    }
+    pool_run(&pool, pool_task, runs, 0);
+    pool_free(&pool);
+    ck_assert_int_eq(pool.threads, 0);
+  }
+}
+END_TEST
+
+START_TEST(planner)
+{
+  PlannerConfig_t config = {1, 0, 1, 0, 5};
+  Planner_t one, two;
+  ck_assert_int_ne(planner_init(&one, &config), 0);
+  config.horizon = 2;
+  ck_assert_int_eq(planner_init(&one, &config), 0);
+  config.threads = 2;
+  ck_assert_int_eq(planner_init(&two, &config), 0);
+
+  GameState_t game;
+  ck_assert_int_eq(state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 9), 0);
+  for (int i = 0; i < 20; i++) {
+    Placement_t first, second;
+    ck_assert(planner_choose(&one, &game, &first));
+    ck_assert(planner_choose(&two, &game, &second));
+    ck_assert_int_eq(first.rotation, second.rotation);
+    ck_assert_int_eq(first.x_position, second.x_position);
+    ck_assert(state_place(&game, first.rotation, first.x_position));
+  }
+  ck_assert(!state_is_over(&game));
+  ck_assert_int_eq(one.rollouts, two.rollouts);
+  ck_assert_int_gt(one.rollouts, 0);
+
+  GameState_t over;
+  state_clone(&over, &game);
+  over.state = Game_over;
+  ck_assert(rollout(&over, 2, 1, 0) == GAME_OVER_OUTCOME);
+  ck_assert(rollout(&game, 2, 1, game.lines) > GAME_OVER_OUTCOME);
+  planner_free(&one);
+  planner_free(&two);
+}
+END_TEST
+
+START_TEST(matrix_arena)
+{
+  int **matrix = NULL;
+  ck_assert_int_ne(create_matrix(&matrix, 0, 3), 0);
+  ck_assert_ptr_null(matrix);
+  ck_assert_int_eq(create_matrix(&matrix, 5, 3), 0);
+  for (int i = 0; i < 5; i++)
+  {
+    ck_assert_ptr_eq(matrix[i], (int *)(matrix + 5) + i * 3);
+    for (int j = 0; j < 3; j++) ck_assert_int_eq(matrix[i][j], 0);
+  }
+  remove_matrix(&matrix, 5);
+  ck_assert_ptr_null(matrix);
+
+  MatrixArena_t arena;
+  ck_assert_int_eq(arena_init(&arena, matrix_size(4, 4) + 8), 0);
+  ck_assert_int_eq(arena_matrix(&arena, &matrix, 4, 4), 0);
+  ck_assert(arena_owns(&arena, matrix));
+  ck_assert(arena_owns(&arena, matrix[3] + 3));
+  ck_assert_uint_eq((uintptr_t)matrix % _Alignof(max_align_t), 0);
+  int **heap = NULL;
+  ck_assert_ptr_null(arena_alloc(&arena, matrix_size(1, 1)));
+  ck_assert_int_eq(arena_matrix(&arena, &heap, 4, 4), 0);
+  ck_assert(!arena_owns(&arena, heap));
+  remove_matrix(&heap, 4);
+  arena_free(&arena);
+  ck_assert_ptr_null(arena.block);
+  ck_assert_ptr_null(arena_alloc(&arena, 1));
+
+  ModelInfo_t actual_info;
+  ck_assert_int_eq(init_model(&actual_info, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_ptr_null(actual_info.arena.block);
+  actual_info.field_base[FIELD_HEIGHT - 1][2] = 1;
+  actual_info.next_tetramino[1][1] = 1;
+  ck_assert_int_ne(move_model_to_arena(&actual_info, 3, 3), 0);
+  ck_assert_int_eq(
+      move_model_to_arena(&actual_info, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_uint_eq(actual_info.arena.used, actual_info.arena.capacity);
+  ck_assert(arena_owns(&actual_info.arena, actual_info.field_base));
+  ck_assert(arena_owns(&actual_info.arena, actual_info.frame_cells));
+  ck_assert(arena_owns(&actual_info.arena, actual_info.next_tetramino));
+  ck_assert(arena_owns(&actual_info.arena, actual_info.current_tetramino));
+  ck_assert(
+      arena_owns(&actual_info.arena, actual_info.collision_test_tetramino));
+  ck_assert_int_eq(actual_info.field_base[FIELD_HEIGHT - 1][2], 1);
+  ck_assert_int_eq(actual_info.next_tetramino[1][1], 1);
+  ck_assert_int_eq(resize_model(&actual_info, 12, 30), 0);
+  ck_assert(arena_owns(&actual_info.arena, actual_info.field_base));
+  ck_assert_int_eq(actual_info.field_base[29][2], 0);
+  ck_assert_int_eq(actual_info.next_tetramino[1][1], 1);
+  actual_info.field_base[29][11] = 1;
+  actual_info.score = 0;
+  actual_info.high_score = 0;
+  run_terminate_actions(&actual_info);
+  ck_assert_ptr_null(actual_info.field_base);
+  ck_assert_ptr_null(actual_info.frame_cells);
+  ck_assert_ptr_null(actual_info.current_tetramino);
+  ck_assert_ptr_null(actual_info.arena.block);
+}
+END_TEST
+
+START_TEST(score_store)
+{
+  const char *path = "score_test.txt";
+  remove(path);
+  ck_assert(score_store_open(path));
+  ck_assert_int_eq(read_score(), 0);
+  long long int batches = score_store_batches();
+  write_score(300);
+  write_score(100);
+  write_score(200);
+  ck_assert_int_eq(read_score(), 300);
+  score_store_flush();
+  ck_assert_int_eq(score_file_read(path), 300);
+  ck_assert_int_eq(score_store_batches(), batches + 1);
+
+  for (int i = 1; i <= 3 * SCORE_QUEUE_SIZE; i++) write_score(1000 + i);
+  score_store_stop();
+  ck_assert_int_eq(score_file_read(path), 1000 + 3 * SCORE_QUEUE_SIZE);
+  ck_assert_int_le(score_store_batches(), batches + 1 + 3 * SCORE_QUEUE_SIZE);
+
+  ck_assert_int_eq(score_file_write(path, 7), 0);
+  ck_assert(score_store_open(path));
+  ck_assert_int_eq(read_score(), 7);
+  ck_assert_int_eq(score_file_write("missing_dir/score.txt", 1), 1);
+  remove(path);
+  ck_assert(score_store_open(SCORE_FILE));
+}
+END_TEST
+
+#define GARBAGE_ATTACKS 100000
+
+static void *garbage_producer(void *data)
+{
+  GarbageQueue_t *queue = data;
+  for (int i = 0; i < GARBAGE_ATTACKS; i++)
+    while (!garbage_send(queue, 1 + i % MAX_GARBAGE_ROWS, i % FIELD_WIDTH))
+      ;
+  return NULL;
+}
+
+START_TEST(garbage_exchange)
+{
+  static GarbageQueue_t queue;
+  garbage_init(&queue);
+  int rows = 0, hole = 0;
+  ck_assert(!garbage_receive(&queue, &rows, &hole));
+  for (int i = 0; i < GARBAGE_QUEUE_SIZE; i++)
+    ck_assert(garbage_send(&queue, 2, 3));
+  ck_assert(!garbage_send(&queue, 2, 3));
+  ck_assert(garbage_receive(&queue, &rows, &hole));
+  ck_assert_int_eq(rows, 2);
+  ck_assert_int_eq(hole, 3);
+
+  garbage_init(&queue);
+  pthread_t producer;
+  ck_assert_int_eq(pthread_create(&producer, NULL, garbage_producer, &queue),
+                   0);
+  for (int i = 0; i < GARBAGE_ATTACKS; i++)
+  {
+    while (!garbage_receive(&queue, &rows, &hole))
+      ;
+    ck_assert_int_eq(rows, 1 + i % MAX_GARBAGE_ROWS);
+    ck_assert_int_eq(hole, i % FIELD_WIDTH);
+  }
+  pthread_join(producer, NULL);
+  ck_assert(!garbage_receive(&queue, &rows, &hole));
+
+  ck_assert_int_eq(garbage_for_lines(1), 0);
+  ck_assert_int_eq(garbage_for_lines(2), 1);
+  ck_assert_int_eq(garbage_for_lines(4), MAX_GARBAGE_ROWS);
+  ck_assert_int_gt(GARBAGE_CELL, L_tetramino);
+
+  uint8_t **field;
+  create_byte_matrix(&field, 4, 3);
+  field[3][0] = 1;
+  ck_assert_int_eq(insert_garbage(field, 3, 4, 2, 1), 0);
+  ck_assert_int_eq(field[1][0], 1);
+  ck_assert_int_eq(field[2][0], GARBAGE_CELL);
+  ck_assert_int_eq(field[2][1], 0);
+  ck_assert_int_eq(field[3][2], GARBAGE_CELL);
+  ck_assert_int_eq(insert_garbage(field, 3, 4, 3, 0), 3);
+  // an attack as tall as the field replaces every row:
+  ck_assert_int_eq(insert_garbage(field, 3, 4, MAX_GARBAGE_ROWS, 2), 8);
+  for (int y = 0; y < 4; y++)
+  {
+    ck_assert_int_eq(field[y][0], GARBAGE_CELL);
+    ck_assert_int_eq(field[y][2], 0);
+  }
+  remove_byte_matrix(&field);
+}
+END_TEST
+
+START_TEST(versus_match)
+{
+  static Versus_t versus;
+  ck_assert_int_eq(versus_init(&versus, FIELD_WIDTH, FIELD_HEIGHT, 3), 0);
+  ck_assert_ptr_eq(versus.players[0].model.garbage_out,
+                   &versus.players[1].inbox);
+
+  versus_start(&versus);
+  ck_assert_int_eq(versus.players[0].model.next_type,
+                   versus.players[1].model.next_type);
+  ModelInfo_t *first = &versus.players[0].model;
+  for (int y = FIELD_HEIGHT - 2; y < FIELD_HEIGHT; y++)
+    for (int x = 0; x < FIELD_WIDTH; x++) first->field_base[y][x] = 1;
+  calculate_lines(first);
+  ck_assert_int_eq(first->garbage_sent, 1);
+  ModelInfo_t *second = &versus.players[1].model;
+  spawn_tetramino(second);
+  ck_assert_int_eq(second->garbage_received, 1);
+  int holes = 0;
+  for (int x = 0; x < FIELD_WIDTH; x++)
+  {
+    ck_assert(second->field_base[FIELD_HEIGHT - 1][x] == 0 ||
+              second->field_base[FIELD_HEIGHT - 1][x] == GARBAGE_CELL);
+    holes += second->field_base[FIELD_HEIGHT - 1][x] == 0;
+  }
+  ck_assert_int_eq(holes, 1);
+
+  ck_assert_int_eq(versus_run_bots(&versus, 200000), 0);
+  int loser = atomic_load(&versus.loser);
+  ck_assert(loser == 0 || loser == 1);
+  ck_assert_int_eq(versus_winner(&versus), 1 - loser);
+  ck_assert(!versus_tick(&versus, 1 - loser));
+  for (int i = 0; i < VERSUS_PLAYERS; i++)
+    ck_assert_int_le(versus.players[i].model.garbage_received,
+                     versus.players[1 - i].model.garbage_sent);
+  versus_free(&versus);
+  ck_assert_ptr_null(versus.players[0].model.field_base);
+}
+END_TEST
+
+static int test_bot_instance;
+
+static void *test_bot_create(uint64_t seed)
+{
+  return seed ? &test_bot_instance : NULL;
+}
+
+static void test_bot_destroy(void *bot) { (void)bot; }
+
+static int test_bot_choose(void *bot, const TetrisBotState_t *state,
+                           TetrisBotMove_t *move)
+{
+  *(int *)bot = state->piece;
+  move->rotation = 0;
+  move->x_position = state->x_position;
+  return 0;
+}
+
+static int test_bot_invalid(void *bot, const TetrisBotState_t *state,
+                            TetrisBotMove_t *move)
+{
+  (void)bot;
+  move->rotation = 0;
+  move->x_position = state->width;
+  return 0;
+}
+
+static int test_bot_slow(void *bot, const TetrisBotState_t *state,
+                         TetrisBotMove_t *move)
+{
+  (void)bot;
+  while (state->now_us() <= state->deadline_us)
+    ;
+  move->rotation = 0;
+  move->x_position = state->x_position;
+  return 0;
+}
+
+START_TEST(bot_plugin)
+{
+  BotPlugin_t plugin;
+  ck_assert_int_ne(bot_load(&plugin, "/nonexistent/bot.so", 1000, 1), 0);
+  ck_assert_ptr_null(plugin.api);
+  bot_unload(&plugin);
+
+  TetrisBotApi_t api = {TETRIS_BOT_ABI_VERSION + 1, "test", test_bot_create,
+                        test_bot_choose, test_bot_destroy};
+  ck_assert_int_ne(bot_attach(&plugin, &api, 1000, 1), 0);
+  api.abi_version = TETRIS_BOT_ABI_VERSION;
+  ck_assert_int_ne(bot_attach(&plugin, &api, 1000, 0), 0);
+  ck_assert_int_eq(bot_attach(&plugin, &api, 1000000, 1), 0);
+
+  GameState_t game;
+  ck_assert_int_eq(state_init(&game, FIELD_WIDTH, FIELD_HEIGHT, 5), 0);
+  TetrisBotState_t state;
+  bot_fill_state(&game, 42, &state);
+  ck_assert_int_eq(state.deadline_us, 42);
+  ck_assert_int_eq(state.rotations, piece_period(game.piece));
+  ck_assert_int_eq(memcmp(state.shapes, piece_shapes[game.piece - 1],
+                          sizeof(state.shapes)),
+                   0);
+
+  Placement_t move = {-1, -1};
+  ck_assert(bot_choose(&plugin, &game, &move));
+  ck_assert_int_eq(test_bot_instance, game.piece);
+  ck_assert_int_eq(move.rotation, 0);
+  ck_assert_int_eq(move.x_position, game.x_position);
+
+  api.choose = test_bot_invalid;
+  ck_assert(!bot_choose(&plugin, &game, &move));
+  ck_assert_int_eq(move.x_position, game.x_position);
+  plugin.budget_us = 2000;
+  api.choose = test_bot_slow;
+  ck_assert(!bot_choose(&plugin, &game, &move));
+  ck_assert_int_eq(plugin.calls, 3);
+  ck_assert_int_eq(plugin.forfeits, 2);
+  ck_assert_int_gt(plugin.max_us, plugin.budget_us);
+
+  ModelInfo_t model;
+  ck_assert_int_eq(init_model(&model, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  model.state = Start_state;
+  model.pause = 2;
+  model.user_action = Start;
+  model.hold = true;
+  run_tick(&model, TICK_MS);
+  ModelDriver_t driver;
+  driver_init(&driver);
+  driver.bot = &plugin;
+  api.choose = test_bot_invalid;
+  driver_input(&driver, &model);
+  ck_assert(driver.planned);
+  ck_assert_int_eq(model.user_action, Down);
+  ck_assert_int_eq(plugin.forfeits, 3);
+  driver_reset(&driver);
+  ck_assert_ptr_eq(driver.bot, &plugin);
+  ck_assert(!driver.planned);
+  run_terminate_actions(&model);
+  ck_assert_int_eq(bot_reseed(&plugin, 3), 0);
+  ck_assert_ptr_eq(plugin.bot, &test_bot_instance);
+  ck_assert_int_eq(plugin.forfeits, 3);
+  ck_assert_int_ne(bot_reseed(&plugin, 0), 0);
+  ck_assert_ptr_null(plugin.api);
+  ck_assert_int_ne(bot_reseed(&plugin, 3), 0);
+  bot_unload(&plugin);
+  ck_assert_ptr_null(plugin.api);
+}
+END_TEST
+
+START_TEST(tournament)
+{
+  ModelInfo_t first, second;
+  ck_assert_int_eq(init_model(&first, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_int_eq(init_model(&second, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  seed_model(&first, 11);
+  seed_model(&second, 11);
+  ck_assert_int_eq(first.next_type, second.next_type);
+  for (int i = 0; i < PIECE_QUEUE_BATCH; i++)
+    ck_assert_int_eq(queue_peek(&first.queue, i), queue_peek(&second.queue, i));
+  release_model_buffers(&first);
+  release_model_buffers(&second);
+
+  int scores[] = {5, 1, 4, 2, 3};
+  int others[] = {4, 1, 5, 0, 3};
+  ScoreSummary_t summary;
+  summarize_scores(scores, 5, &summary);
+  ck_assert_double_eq_tol(summary.mean, 3.0, 1e-9);
+  ck_assert_double_eq_tol(summary.stddev, sqrt(2.5), 1e-9);
+  ck_assert_double_eq_tol(summary.high - summary.mean,
+                          CONFIDENCE_Z * sqrt(2.5) / sqrt(5), 1e-9);
+  ck_assert_int_eq(summary.median, 3);
+  ck_assert_int_eq(summary.min, 1);
+  ck_assert_int_eq(summary.max, 5);
+  PairSummary_t pair;
+  compare_scores(scores, others, 5, &pair);
+  ck_assert_int_eq(pair.wins, 2);
+  ck_assert_int_eq(pair.ties, 2);
+  ck_assert_int_eq(pair.losses, 1);
+  ck_assert_double_eq_tol(pair.mean, 0.4, 1e-9);
+  ck_assert(pair.low < pair.mean && pair.high > pair.mean);
+
+  TournamentConfig_t config = {3, 7, 2, 4000, FIELD_WIDTH, FIELD_HEIGHT,
+                               DEFAULT_BOT_BUDGET_US};
+  const char *paths[] = {NULL, NULL};
+  static Tournament_t tournament;
+  ck_assert_int_ne(tournament_init(&tournament, &config, paths, 0), 0);
+  ck_assert_int_eq(tournament_init(&tournament, &config, paths, 2), 0);
+  tournament_run(&tournament);
+  ck_assert_int_eq(atomic_load(&tournament.errors), 0);
+  compare_scores(&tournament.scores[0], &tournament.scores[config.games],
+                 config.games, &pair);
+  ck_assert_int_eq(pair.ties, config.games);
+  for (int g = 0; g < config.games; g++)
+  {
+    int score;
+    long long int ticks;
+    ck_assert_int_eq(play_seeded_game(&config, tournament.seeds[g], NULL,
+                                      NULL, NULL, &score, &ticks),
+                     0);
+    ck_assert_int_eq(score, tournament.scores[g]);
+    ck_assert_int_eq(ticks, tournament.ticks[g]);
+    ck_assert_int_le(ticks, config.max_ticks);
+  }
+  ck_assert_str_eq(tournament.names[1], "greedy");
+  tournament_free(&tournament);
+  ck_assert_ptr_null(tournament.scores);
+}
+END_TEST
+
+START_TEST(codec)
+{
+  uint8_t buffer[4 * VARINT_MAX_BYTES];
+  uint64_t values[] = {0, 127, 128, 300, UINT64_MAX};
+  for (int i = 0; i < 5; i++) {
+    uint64_t value;
+    size_t length = varint_put(buffer, values[i]);
+    ck_assert_uint_eq(varint_get(buffer, length, &value), length);
+    ck_assert(value == values[i]);
+    ck_assert_uint_eq(varint_get(buffer, length - 1, &value), 0);
+  }
+  ck_assert_uint_eq(varint_put(buffer, 300), 2);
+  int64_t signs[] = {0, -1, 1, -2, INT64_MIN, INT64_MAX};
+  for (int i = 0; i < 6; i++)
+    ck_assert(zigzag_decode(zigzag_encode(signs[i])) == signs[i]);
+  ck_assert(zigzag_encode(-1) == 1);
+  put_u64(buffer, 0x0102030405060708ull);
+  ck_assert_uint_eq(buffer[0], 8);
+  ck_assert(get_u64(buffer) == 0x0102030405060708ull);
+
+  enum { SIZE = 4096 };
+  static uint8_t text[SIZE], packed[SIZE], unpacked[SIZE];
+  for (int i = 0; i < SIZE; i++)
+    text[i] = (uint8_t)("tetris "[i % 7] + i / 1000);
+  size_t size = lz_compress(text, SIZE, packed, SIZE);
+  ck_assert_uint_gt(size, 0);
+  ck_assert_uint_lt(size, SIZE / 10);
+  size_t length;
+  ck_assert_int_eq(lz_decompress(packed, size, unpacked, SIZE, &length), 0);
+  ck_assert_uint_eq(length, SIZE);
+  ck_assert_int_eq(memcmp(text, unpacked, SIZE), 0);
+  ck_assert_int_ne(lz_decompress(packed, size, unpacked, SIZE / 2, &length), 0);
+  uint64_t noise = 5;
+  for (int i = 0; i < SIZE; i++) text[i] = (uint8_t)random_next(&noise);
+  ck_assert_uint_eq(lz_compress(text, SIZE, packed, SIZE), 0);
+}
+END_TEST
+
+START_TEST(game_log)
+{
+  const char *path = "test_games.bgl";
+  TournamentConfig_t config = {2, 3, 2, 3000, FIELD_WIDTH, FIELD_HEIGHT,
+                               DEFAULT_BOT_BUDGET_US};
+  const char *paths[] = {NULL};
+  static Tournament_t tournament;
+  ck_assert_int_eq(tournament_init(&tournament, &config, paths, 1), 0);
+  remove(path);
+  ck_assert_int_eq(tournament_open_log(&tournament, path), 0);
+  ck_assert_int_ne(tournament_open_log(&tournament, path), 0);
+  tournament_run(&tournament);
+  ck_assert_int_eq(atomic_load(&tournament.errors), 0);
+  ck_assert(tournament.log->games == (uint64_t)config.games);
+  ck_assert_int_gt(tournament.records[0].run_count +
+                       tournament.records[1].run_count,
+                   0);
+  ck_assert_int_eq(tournament_close_log(&tournament), 0);
+  ck_assert_ptr_null(tournament.log);
+  ck_assert_int_eq(tournament_close_log(&tournament), 0);
+
+  // a second session continues the archive:
+  GameRecord_t record;
+  record_init(&record);
+  LogWriter_t writer;
+  ck_assert_int_eq(log_writer_open(&writer, path), 0);
+  ck_assert(writer.games == (uint64_t)config.games);
+  for (int i = 0; i < 2500; i++) {
+    record_start(&record, 1000 + i, FIELD_WIDTH, FIELD_HEIGHT, 1);
+    ck_assert_int_eq(record_input(&record, 2, Left), 0);
+    ck_assert_int_eq(record_input(&record, 3, Left), 0);
+    ck_assert_int_eq(record_input(&record, 7, Action), 0);
+    record.score = 1000000 + i;
+    record.ticks = 10;
+    ck_assert_int_eq(log_writer_append(&writer, &record), 0);
+  }
+  ck_assert_int_eq(record.run_count, 2);
+  ck_assert_int_eq(log_writer_close(&writer), 0);
+
+  LogReader_t reader;
+  ck_assert_int_ne(log_reader_open(&reader, "no_such_archive.bgl"), 0);
+  ck_assert_int_eq(log_reader_open(&reader, path), 0);
+  ck_assert(reader.games == (uint64_t)config.games + 2500);
+  ck_assert_int_eq(reader.block_count, 4);
+  ck_assert_int_eq(log_reader_game(&reader, config.games + 500, &record), 0);
+  ck_assert(record.seed == 1500);
+  ck_assert_int_eq(record.score, 1000500);
+  ck_assert_int_eq(record.run_count, 2);
+  ck_assert(record.runs[0].tick == 2 && record.runs[0].length == 2);
+  ck_assert(record.runs[1].tick == 7 && record.runs[1].action == Action);
+  ck_assert_int_ne(log_reader_game(&reader, reader.games, &record), 0);
+
+  reader.blocks_decoded = 0;
+  ck_assert_int_eq(log_reader_filter(&reader, 1002000, 1002099, NULL, NULL),
+                   100);
+  ck_assert_int_eq(reader.blocks_decoded, 2);
+  ck_assert_int_eq(log_reader_filter(&reader, INT_MIN, 999999, NULL, NULL),
+                   config.games);
+
+  // the games are logged in the order they end:
+  for (int i = 0; i < config.games; i++) {
+    int score, g = 0;
+    ck_assert_int_eq(log_reader_game(&reader, i, &record), 0);
+    while (g < config.games && record.seed != tournament.seeds[g]) g++;
+    ck_assert_int_lt(g, config.games);
+    ck_assert_int_eq(record.score, tournament.scores[g]);
+    ck_assert_int_eq(replay_record(&record, &score), 0);
+    ck_assert_int_eq(score, tournament.scores[g]);
+  }
+  log_reader_close(&reader);
+  ck_assert_ptr_null(reader.data);
+  record_free(&record);
+  tournament_free(&tournament);
+  remove(path);
+}
+END_TEST
+
+START_TEST(key_parser)
+{
+  const unsigned char up[] = {ESCAPE_KEY, '[', 'A'};
+  const unsigned char right[] = {ESCAPE_KEY, 'O', 'C'};
+  const unsigned char ctrl_left[] = {ESCAPE_KEY, '[', '1', ';', '5', 'D'};
+  const unsigned char insert[] = {ESCAPE_KEY, '[', '2', '~'};
+  const unsigned char cut[] = {ESCAPE_KEY, '[', '1'};
+  const unsigned char escape[] = {ESCAPE_KEY};
+  const unsigned char enter[] = {'\r'};
+  int used = -1;
+  ck_assert_int_eq(parse_key(up, 3, &used), KEY_UP);
+  ck_assert_int_eq(used, 3);
+  ck_assert_int_eq(parse_key(right, 3, &used), KEY_RIGHT);
+  ck_assert_int_eq(parse_key(ctrl_left, 6, &used), KEY_LEFT);
+  ck_assert_int_eq(used, 6);
+  ck_assert_int_eq(parse_key(insert, 4, &used), ERR);
+  ck_assert_int_eq(used, 4);
+  ck_assert_int_eq(parse_key(cut, 3, &used), ERR);
+  ck_assert_int_eq(used, 0);
+  ck_assert_int_eq(parse_key(escape, 1, &used), ESCAPE_KEY);
+  ck_assert_int_eq(used, 1);
+  ck_assert_int_eq(parse_key(enter, 1, &used), ENTER_KEY);
+
+  InputReader_t reader = {0};
+  KeyEvent_t event;
+  memcpy(reader.pending, "a\033[Bq\033[", 7);
+  reader.pending_length = 7;
+  ck_assert_int_eq(parse_keys(&reader, 7), 3);
+  ck_assert_int_eq(reader.pending_length, 2);
+  ck_assert(input_peek(&reader, &event));
+  ck_assert_int_eq(event.key, 'a');
+  ck_assert_int_eq(reader.count, 3);
+  ck_assert(input_next(&reader, &event));
+  ck_assert_int_eq(event.key, 'a');
+  ck_assert_int_eq(event.time_us, 7);
+  ck_assert(input_next(&reader, &event));
+  ck_assert_int_eq(event.key, KEY_DOWN);
+  ck_assert(input_next(&reader, &event));
+  ck_assert_int_eq(event.key, 'q');
+  ck_assert(!input_next(&reader, &event));
+  // the cut sequence is completed by the next read:
+  reader.pending[reader.pending_length++] = 'C';
+  ck_assert_int_eq(parse_keys(&reader, 9), 1);
+  ck_assert(input_next(&reader, &event));
+  ck_assert_int_eq(event.key, KEY_RIGHT);
+  ck_assert_int_eq(event.time_us, 9);
+
+  memset(reader.pending, 'x', KEY_QUEUE_SIZE + 5);
+  reader.pending_length = KEY_QUEUE_SIZE + 5;
+  ck_assert_int_eq(parse_keys(&reader, 11), KEY_QUEUE_SIZE);
+  ck_assert_int_eq(reader.count, KEY_QUEUE_SIZE);
+  ck_assert_int_eq(reader.pending_length, 0);
+
+  ModelInfo_t *actual_info = get_info();
+  FiniteState_t state = actual_info->state;
+  actual_info->state = Pause_state;
+  userInput(Up, true);
+  ck_assert(isInputPending());
+  run_tick(actual_info, TICK_MS);
+  ck_assert(!isInputPending());
+  actual_info->state = state;
+}
+END_TEST
+
+START_TEST(rewind_ring)
+{
+  enum { PUSHES = 400, HEIGHT = 64 };
+  static uint8_t fields[PUSHES][HEIGHT][FIELD_WIDTH];
+  ModelInfo_t model;
+  RewindRing_t *ring = NULL;
+  ck_assert_int_ne(rewind_create(&ring, 2, HEIGHT, 1000), 0);
+  ck_assert_ptr_null(ring);
+  ck_assert_int_eq(init_model(&model, FIELD_WIDTH, HEIGHT), 0);
+  ck_assert_int_eq(rewind_create(&ring, FIELD_WIDTH, HEIGHT, 1000000), 0);
+  uint64_t noise = 3;
+  for (int i = 0; i < PUSHES; i++) {
+    // every other push rewrites the whole field, so the deltas wrap around:
+    for (int y = 0; y < HEIGHT; y++)
+      for (int x = 0; x < FIELD_WIDTH; x++)
+        if (i % 2 || y == i % HEIGHT)
+          model.field_base[y][x] = (uint8_t)(random_next(&noise) % 8);
+    memcpy(fields[i], model.field_base[0], sizeof(fields[i]));
+    model.score = i;
+    model.sim_time = i;
+    ck_assert_int_eq(rewind_push(ring, &model), 0);
+  }
+  ck_assert_int_eq(ring->taken, PUSHES);
+  ck_assert_int_gt(ring->count, 1);
+  ck_assert_int_lt(ring->count, REWIND_SNAPSHOTS);
+  ck_assert_uint_le(rewind_bytes_used(ring), sizeof(ring->snapshots) +
+                                                 sizeof(ring->bytes));
+  int count = ring->count;
+  ck_assert_int_ne(rewind_restore(ring, &model, count), 0);
+  ck_assert_int_eq(rewind_restore(ring, &model, 5), 0);
+  ck_assert_int_eq(ring->count, count - 5);
+  ck_assert_int_eq(model.score, PUSHES - 6);
+  ck_assert_int_eq(memcmp(fields[PUSHES - 6], model.field_base[0],
+                          sizeof(fields[0])),
+                   0);
+  ck_assert_int_eq(model.state, Spawn);
+  ck_assert_int_eq(rewind_restore(ring, &model, ring->count - 1), 0);
+  ck_assert_int_eq(ring->count, 1);
+  ck_assert_int_eq(model.score, PUSHES - count);
+  ck_assert_int_eq(memcmp(fields[PUSHES - count], model.field_base[0],
+                          sizeof(fields[0])),
+                   0);
+
+  // the ring goes on after a rewind:
+  for (int i = 0; i < 3; i++) {
+    model.field_base[i][i] = 1 + i;
+    memcpy(fields[i], model.field_base[0], sizeof(fields[i]));
+    ck_assert_int_eq(rewind_push(ring, &model), 0);
+  }
+  ck_assert_int_eq(rewind_restore(ring, &model, 2), 0);
+  ck_assert_int_eq(memcmp(fields[0], model.field_base[0], sizeof(fields[0])),
+                   0);
+  rewind_destroy(&ring);
+
+  ck_assert_int_eq(rewind_create(&ring, FIELD_WIDTH, HEIGHT, 10), 0);
+  for (int i = 0; i < 20; i++) {
+    model.sim_time = i * 5;
+    ck_assert_int_eq(rewind_push(ring, &model), 0);
+  }
+  ck_assert_int_eq(ring->count, 3);
+  rewind_destroy(&ring);
+  release_model_buffers(&model);
+
+  ModelInfo_t game;
+  ModelDriver_t driver;
+  static uint8_t saved[FIELD_HEIGHT][FIELD_WIDTH];
+  int saved_score = -1;
+  ck_assert_int_eq(init_model(&game, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  ck_assert_int_eq(rewind_create(&game.rewind, FIELD_WIDTH, FIELD_HEIGHT,
+                                 DEFAULT_REWIND_SECONDS * 1000),
+                   0);
+  seed_model(&game, 5);
+  game.no_persist = true;
+  game.state = Start_state;
+  game.pause = 2;
+  game.user_action = Start;
+  game.hold = true;
+  run_tick(&game, TICK_MS);
+  ck_assert_int_eq(game.rewind->count, 1);
+  driver_init(&driver);
+  while (game.rewind->taken < 8 && game.pause == 0) {
+    driver_input(&driver, &game);
+    run_tick(&game, TICK_MS);
+    if (game.rewind->taken == 4 && saved_score < 0) {
+      memcpy(saved, game.field_base[0], sizeof(saved));
+      saved_score = game.score;
+    }
+  }
+  ck_assert_int_eq(game.rewind->taken, 8);
+  // a snapshot of a real game is its record and a row or two of delta:
+  ck_assert_uint_lt(rewind_bytes_used(game.rewind),
+                    game.rewind->count * (sizeof(RewindSnapshot_t) + 32));
+  ck_assert_int_eq(rewind_restore(game.rewind, &game, 4), 0);
+  ck_assert_int_eq(game.score, saved_score);
+  ck_assert_int_eq(memcmp(saved, game.field_base[0], sizeof(saved)), 0);
+  driver_reset(&driver);
+  for (int i = 0; i < 200; i++) {
+    driver_input(&driver, &game);
+    run_tick(&game, TICK_MS);
+  }
+  ck_assert_int_eq(game.pause, 0);
+  ck_assert_int_gt(game.rewind->taken, 8);
+  rewind_destroy(&game.rewind);
+  release_model_buffers(&game);
+}
+END_TEST
+
+START_TEST(metrics)
+{
+  const char *path = "test_metrics.prom";
+  TournamentConfig_t config = {1, 3, 1, 3000, FIELD_WIDTH, FIELD_HEIGHT,
+                               DEFAULT_BOT_BUDGET_US};
+  MetricsRegistry_t *registry = NULL;
+  MetricsSnapshot_t snapshot;
+  int scores[2];
+  long long int ticks[2];
+  ck_assert_int_eq(metrics_create(&registry), 0);
+  ck_assert_ptr_null(metrics_shard(registry, MAX_METRICS_SHARDS));
+  MetricsShard_t *first = metrics_shard(registry, 0);
+  MetricsShard_t *second = metrics_shard(registry, 1);
+  // every shard has its own cache lines:
+  ck_assert_uint_ge((uintptr_t)second - (uintptr_t)first, 64);
+  ck_assert_uint_eq((uintptr_t)second % 64, 0);
+  ck_assert_int_eq(play_seeded_game(&config, 11, NULL, first, NULL,
+                                    &scores[0], &ticks[0]),
+                   0);
+  ck_assert_int_eq(play_seeded_game(&config, 12, NULL, second, NULL,
+                                    &scores[1], &ticks[1]),
+                   0);
+  metrics_collect(registry, &snapshot);
+  ck_assert_uint_eq(snapshot.games, 2);
+  // the tick starting each game counts too:
+  ck_assert_int_eq(snapshot.ticks, ticks[0] + ticks[1] + 2);
+  ck_assert_uint_eq(histogram_total(snapshot.step_latency), snapshot.ticks);
+  ck_assert_uint_eq(snapshot.state_steps[Start_state], 2);
+  ck_assert_uint_eq(snapshot.state_steps[Spawn], snapshot.pieces + 2);
+  ck_assert_uint_gt(snapshot.pieces, 0);
+  int score = 0;
+  for (int size = 1; size <= MAX_LINES_AT_ONCE; size++)
+    for (unsigned long long i = 0; i < snapshot.line_clears[size]; i++)
+      update_score(&score, size);
+  ck_assert_int_eq(score, scores[0] + scores[1]);
+
+  ck_assert_int_eq(metrics_start(registry, path, 10), 0);
+  ck_assert_int_ne(metrics_start(registry, path, 10), 0);
+  metrics_stop(registry);
+  ck_assert_int_ge(registry->exports, 1);
+  ck_assert_int_eq(registry->errors, 0);
+  char text[8192] = {0};
+  FILE *file = fopen(path, "r");
+  ck_assert_ptr_nonnull(file);
+  ck_assert_uint_gt(fread(text, 1, sizeof(text) - 1, file), 0);
+  fclose(file);
+  ck_assert_ptr_nonnull(strstr(text, "\ntetris_games_total 2\n"));
+  ck_assert_ptr_nonnull(
+      strstr(text, "# TYPE tetris_step_latency_seconds summary\n"));
+  ck_assert_ptr_nonnull(
+      strstr(text, "tetris_step_latency_seconds{quantile=\"0.99\"} "));
+  ck_assert_ptr_nonnull(
+      strstr(text, "tetris_state_steps_total{state=\"Moving\"} "));
+  ck_assert_ptr_nonnull(
+      strstr(text, "tetris_lines_cleared_total{size=\"4\"} "));
+  file = fopen("test_metrics.prom.tmp", "r");
+  ck_assert_ptr_null(file);
+  remove(path);
+  metrics_destroy(&registry);
+  ck_assert_ptr_null(registry);
+}
+END_TEST
+
+START_TEST(alloc_accounting)
+{
+  ModelInfo_t model;
+  ModelDriver_t driver;
+  AllocReport_t report;
+  int **matrix = NULL;
+  alloc_stats_start();
+  ck_assert_int_eq(init_model(&model, FIELD_WIDTH, FIELD_HEIGHT), 0);
+  alloc_stats_read(&report);
+  // the field, three tetramino matrices and the frame cells:
+  ck_assert_uint_eq(report.sites[Model_site].allocations, 5);
+  ck_assert_uint_eq(report.sites[Matrix_site].allocations, 0);
+  seed_model(&model, 9);
+  model.no_persist = true;
+  model.state = Start_state;
+  model.pause = 2;
+  model.user_action = Start;
+  model.hold = true;
+  run_tick(&model, TICK_MS);
+  driver_init(&driver);
+
+  alloc_stats_start();
+  int cells[TETR_SIZE][TETR_SIZE];
+  for (int y = 0; y < TETR_SIZE; y++)
+    memcpy(cells[y], model.current_tetramino[y], sizeof(cells[y]));
+  for (int i = 0; i < 4; i++) rotate_left(&model.current_tetramino);
+  for (int i = 0; i < 4; i++) rotate_right(&model.current_tetramino);
+  for (int y = 0; y < TETR_SIZE; y++)
+    ck_assert_mem_eq(cells[y], model.current_tetramino[y], sizeof(cells[y]));
+  for (int i = 0; i < 3000 && model.pause == 0; i++) {
+    driver_input(&driver, &model);
+    run_tick(&model, TICK_MS);
+  }
+  alloc_stats_read(&report);
+  ck_assert_uint_gt(report.pieces, 10);
+  ck_assert_uint_eq(alloc_report_total(&report), 0);
+
+  ck_assert_int_eq(create_matrix_at(&matrix, 3, 4, Snapshot_site), 0);
+  remove_matrix_at(&matrix, Snapshot_site);
+  ck_assert_ptr_null(matrix);
+  release_model_buffers(&model);
+  alloc_stats_read(&report);
+  ck_assert_uint_eq(report.sites[Snapshot_site].allocations, 1);
+  ck_assert_uint_eq(report.sites[Snapshot_site].frees, 1);
+  ck_assert_uint_eq(report.sites[Snapshot_site].bytes, matrix_size(3, 4));
+  ck_assert_uint_eq(report.sites[Model_site].frees, 5);
+  alloc_stats_stop();
+  ck_assert_int_eq(create_matrix(&matrix, 2, 2), 0);
+  remove_matrix(&matrix, 2);
+  alloc_stats_read(&report);
+  ck_assert_uint_eq(report.sites[Matrix_site].allocations, 0);
+}
+END_TEST
+
+START_TEST(shared_rules)
+{
+  uint64_t rows[100] = {0};
+  const uint8_t *flat = piece_shape(I_tetramino, 0);
+  rows[98] = 0x200;
+  rows[99] = FULL_ROW_MASK(FIELD_WIDTH);
+  ck_assert_int_eq(field_collision(rows, FIELD_WIDTH, 100, flat, 3, 96),
+                   NO_COLLISION);
+  ck_assert_int_eq(field_collision(rows, FIELD_WIDTH, 100, flat, 3, 97),
+                   BASE_COLLISION);
+  ck_assert_int_eq(field_collision(rows, FIELD_WIDTH, 98, flat, 3, 96),
+                   FLOOR_COLLISION);
+  ck_assert_int_eq(field_collision(rows, FIELD_WIDTH, 100, flat, 7, 0),
+                   BASE_COLLISION);
+
+  int x = -3;
+  ck_assert_int_eq(field_rotation_kick(rows, FIELD_WIDTH, 100,
+                                       piece_shape(I_tetramino, 1), &x, 10),
+                   NO_COLLISION);
+  ck_assert_int_eq(x, -2);
+
+  field_place(rows, 100, flat, 3, 96);
+  ck_assert_int_eq(field_clear_lines(rows, FIELD_WIDTH, 100, NULL), 1);
+  ck_assert_uint_eq(rows[99], 0x278);
+  ck_assert_uint_eq(rows[98], 0);
+
+  ModelInfo_t model = {0};
+  ck_assert_int_eq(init_model(&model, FIELD_WIDTH, 100), 0);
+  model.current_type = I_tetramino;
+  fill_tetramino(model.current_tetramino, I_tetramino);
+  model.field_base[99][3] = 1;
+  model.x_position = 3;
+  model.y_position = 96;
+  ck_assert_int_eq(is_move_collision(&model), NO_COLLISION);
+  model.y_position = 97;
+  ck_assert_int_eq(is_move_collision(&model), BASE_COLLISION);
+  model.field_base[99][3] = 0;
+  ck_assert_int_eq(is_move_collision(&model), NO_COLLISION);
+  model.y_position = 98;
+  ck_assert_int_eq(is_move_collision(&model), FLOOR_COLLISION);
+  release_model_buffers(&model);
+}
+END_TEST
+
 Suite *tetris(void)
 {
   Suite *suite = suite_create("tetris");
@@ -370,6 +1862,35 @@ Suite *tetris(void)
   tcase_add_test(tc_core, clear_lines);
   tcase_add_test(tc_core, update_score_speed_level);
   tcase_add_test(tc_core, fsm);
+  tcase_add_test(tc_core, scheduler);
+  tcase_add_test(tc_core, headless);
+  tcase_add_test(tc_core, engine_stats);
+  tcase_add_test(tc_core, chrome_trace);
+  tcase_add_test(tc_core, board_size);
+  tcase_add_test(tc_core, compact_state);
+  tcase_add_test(tc_core, packed_state);
+  tcase_add_test(tc_core, autoplay);
+  tcase_add_test(tc_core, batched_env);
+  tcase_add_test(tc_core, soa_engine);
+  tcase_add_test(tc_core, preview_queue);
+  tcase_add_test(tc_core, zobrist_hash);
+  tcase_add_test(tc_core, transposition_table);
+  tcase_add_test(tc_core, perft);
+  tcase_add_test(tc_core, work_pool);
+  tcase_add_test(tc_core, planner);
+  tcase_add_test(tc_core, matrix_arena);
+  tcase_add_test(tc_core, score_store);
+  tcase_add_test(tc_core, garbage_exchange);
+  tcase_add_test(tc_core, versus_match);
+  tcase_add_test(tc_core, bot_plugin);
+  tcase_add_test(tc_core, tournament);
+  tcase_add_test(tc_core, codec);
+  tcase_add_test(tc_core, game_log);
+  tcase_add_test(tc_core, rewind_ring);
+  tcase_add_test(tc_core, metrics);
+  tcase_add_test(tc_core, alloc_accounting);
+  tcase_add_test(tc_core, shared_rules);
+  tcase_add_test(tc_core, key_parser);
 
   suite_add_tcase(suite, tc_core);
 
@@ -0,0 +1,172 @@
+/**
+ * @file example_bot.c
+ * @brief Example bot plugin.
+ *
+ * Built as a shared library against `tetris_bot.h` only. Every placement is
+ * dropped on a copy of the field and scored by the cleared lines, the holes
+ * and the height of the stack. The search stops early at the deadline of the
+ * move and returns the best placement found so far.
+ */
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../brick_game/tetris_bot.h"
+
+#define LINE_REWARD 8
+#define HOLE_PENALTY 6
+#define HEIGHT_PENALTY 1
+
+/**
+ * @brief State of one bot; this bot keeps nothing but its seed.
+ */
+typedef struct {
+  uint64_t seed;
+} ExampleBot_t;
+
+static void *example_create(uint64_t seed);
+static int example_choose(void *bot, const TetrisBotState_t *state,
+                          TetrisBotMove_t *move);
+static void example_destroy(void *bot);
+
+static const TetrisBotApi_t example_api = {
+    TETRIS_BOT_ABI_VERSION, "example", example_create, example_choose,
+    example_destroy};
+
+/**
+ * @brief Entry point of the plugin.
+ *
+ * @return The functions of the plugin.
+ */
+const TetrisBotApi_t *tetrisBotApi(void) { return &example_api; }
+
+/**
+ * @brief Creates a bot.
+ *
+ * @param seed The seed given by the host.
+ * @return The bot, `NULL` if it cannot be allocated.
+ */
+static void *example_create(uint64_t seed) {
+  ExampleBot_t *bot = malloc(sizeof(ExampleBot_t));
+  if (bot) bot->seed = seed;
+  return bot;
+}
+
+/**
+ * @brief Destroys a bot.
+ *
+ * @param bot The bot.
+ */
+static void example_destroy(void *bot) { free(bot); }
+
+/**
+ * @brief Returns the cells of a shape row in field columns.
+ *
+ * @param mask The row of the shape.
+ * @param x The column of the shape.
+ * @param width The number of columns of the field.
+ * @return The cells, or `UINT64_MAX` if a cell is outside the field.
+ */
+static uint64_t shape_cells(uint8_t mask, int x, int width) {
+  uint64_t cells = UINT64_MAX;
+  uint64_t outside = width >= 64 ? 0 : ~(((uint64_t)1 << width) - 1);
+  if (x >= 0 && !(((uint64_t)mask << x) & outside))
+    cells = (uint64_t)mask << x;
+  else if (x < 0 && !(mask & (((uint64_t)1 << -x) - 1)))
+    cells = (uint64_t)mask >> -x;
+  return cells;
+}
+
+/**
+ * @brief Checks whether a shape overlaps the field or leaves it.
+ *
+ * @param state The game.
+ * @param rows The field.
+ * @param shape The rows of the shape.
+ * @param x The column of the shape.
+ * @param y The row of the shape.
+ * @return `true` on a collision.
+ */
+static bool collides(const TetrisBotState_t *state, const uint64_t *rows,
+                     const uint8_t *shape, int x, int y) {
+  bool is_colliding = false;
+  for (int i = 0; !is_colliding && i < TETRIS_BOT_SHAPE_ROWS; i++) {
+    if (shape[i]) {
+      uint64_t cells = shape_cells(shape[i], x, state->width);
+      is_colliding = cells == UINT64_MAX || y + i >= state->height ||
+                     (y + i >= 0 && (rows[y + i] & cells));
+    }
+  }
+  return is_colliding;
+}
+
+/**
+ * @brief Drops a shape straight down and scores the resulting field.
+ *
+ * @param state The game.
+ * @param shape The rows of the shape.
+ * @param x The column of the shape.
+ * @param[out] score The score, higher is better.
+ * @return `false` if the shape does not fit at the spawn row.
+ */
+static bool score_drop(const TetrisBotState_t *state, const uint8_t *shape,
+                       int x, int *score) {
+  bool is_valid = !collides(state, state->rows, shape, x, state->y_position);
+  if (is_valid) {
+    uint64_t rows[TETRIS_BOT_MAX_ROWS];
+    memcpy(rows, state->rows, sizeof(rows));
+    int y = state->y_position;
+    while (!collides(state, rows, shape, x, y + 1)) y++;
+    for (int i = 0; i < TETRIS_BOT_SHAPE_ROWS; i++)
+      if (shape[i] && y + i >= 0)
+        rows[y + i] |= shape_cells(shape[i], x, state->width);
+    uint64_t full = state->width >= 64 ? UINT64_MAX
+                                       : ((uint64_t)1 << state->width) - 1;
+    int lines = 0, holes = 0, height = 0;
+    uint64_t seen = 0;
+    for (int row = 0; row < state->height; row++) {
+      if (rows[row] == full) {
+        lines++;
+      } else {
+        holes += __builtin_popcountll(seen & ~rows[row]);
+        seen |= rows[row];
+        if (seen && !height) height = state->height - row;
+      }
+    }
+    *score = LINE_REWARD * lines - HOLE_PENALTY * holes -
+             HEIGHT_PENALTY * (height - lines);
+  }
+  return is_valid;
+}
+
+/**
+ * @brief Chooses the placement with the best score, stopping at the
+ * deadline.
+ *
+ * @param bot The bot.
+ * @param state The game.
+ * @param[out] move The chosen placement.
+ * @return `0` if a placement was found.
+ */
+static int example_choose(void *bot, const TetrisBotState_t *state,
+                          TetrisBotMove_t *move) {
+  (void)bot;
+  bool is_found = false;
+  bool is_late = false;
+  int best = 0;
+  for (int rotation = 0; !is_late && rotation < state->rotations;
+       rotation++) {
+    for (int x = 1 - TETRIS_BOT_SHAPE_ROWS; x < state->width; x++) {
+      int score;
+      if (score_drop(state, state->shapes[rotation], x, &score) &&
+          (!is_found || score > best)) {
+        best = score;
+        move->rotation = rotation;
+        move->x_position = x;
+        is_found = true;
+      }
+    }
+    is_late = is_found && state->now_us() >= state->deadline_us;
+  }
+  return is_found ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file gamelog.c
+ * @brief Command line reader of game-log archives.
+ *
+ * Prints the size of an archive, one game with a check of its replay, or
+ * the games whose score lies in a range.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../brick_game/tetris/game_log.h"
+
+/**
+ * @brief Command line options of the game-log reader.
+ */
+typedef struct {
+  const char *path;
+  long long int game;
+  int min_score;
+  int max_score;
+  bool has_filter;
+} GameLogOptions_t;
+
+bool parse_gamelog_options(int argc, char *argv[], GameLogOptions_t *options);
+void print_archive(const LogReader_t *reader);
+int print_game(LogReader_t *reader, uint64_t game);
+bool print_match(void *context, uint64_t game, const GameRecord_t *record);
+
+/**
+ * @brief Reads a game-log archive.
+ *
+ * Usage: `gamelog FILE [--game N] [--min-score N] [--max-score N]`. Without
+ * options the number of games, blocks and bytes is printed.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  GameLogOptions_t options = {NULL, -1, INT_MIN, INT_MAX, false};
+  if (!parse_gamelog_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s FILE [--game N] [--min-score N] [--max-score N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  LogReader_t reader;
+  int error = log_reader_open(&reader, options.path);
+  if (!error) {
+    if (options.game >= 0) {
+      error = print_game(&reader, (uint64_t)options.game);
+    } else if (options.has_filter) {
+      long long int count = log_reader_filter(
+          &reader, options.min_score, options.max_score, print_match, NULL);
+      error = count < 0;
+      if (!error)
+        printf("%lld games, %lld of %d blocks decoded\n", count,
+               reader.blocks_decoded, reader.block_count);
+    } else {
+      print_archive(&reader);
+    }
+    log_reader_close(&reader);
+  }
+  if (error) fprintf(stderr, "%s: cannot read the archive\n", options.path);
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the game-log reader.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and a file is given.
+ */
+bool parse_gamelog_options(int argc, char *argv[], GameLogOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--game") && i + 1 < argc) {
+      options->game = atoll(argv[++i]);
+    } else if (!strcmp(argv[i], "--min-score") && i + 1 < argc) {
+      options->min_score = atoi(argv[++i]);
+      options->has_filter = true;
+    } else if (!strcmp(argv[i], "--max-score") && i + 1 < argc) {
+      options->max_score = atoi(argv[++i]);
+      options->has_filter = true;
+    } else if (argv[i][0] != '-' && !options->path) {
+      options->path = argv[i];
+    } else {
+      is_ok = false;
+    }
+  }
+  return is_ok && options->path;
+}
+
+/**
+ * @brief Prints the number of games, blocks and bytes of an archive.
+ *
+ * @param reader The reader.
+ */
+void print_archive(const LogReader_t *reader) {
+  printf("%llu games in %d blocks, %zu bytes",
+         (unsigned long long)reader->games, reader->block_count, reader->size);
+  if (reader->games)
+    printf(" (%.1f bytes/game)", (double)reader->size / reader->games);
+  printf("\n");
+}
+
+/**
+ * @brief Prints one game and checks that its replay reaches the logged
+ * score.
+ *
+ * @param reader The reader.
+ * @param game The number of the game.
+ * @return Error code (`0` on success, `1` if the game cannot be read or its
+ * replay differs).
+ */
+int print_game(LogReader_t *reader, uint64_t game) {
+  GameRecord_t record;
+  record_init(&record);
+  int score = 0;
+  int error = log_reader_game(reader, game, &record);
+  if (!error) {
+    print_match(NULL, game, &record);
+    error = replay_record(&record, &score);
+  }
+  if (!error) {
+    printf("replay: score %d (%s)\n", score,
+           score == record.score ? "matches" : "differs");
+    error = score != record.score;
+  }
+  record_free(&record);
+  return error;
+}
+
+/**
+ * @brief Prints a game found by a filter.
+ *
+ * @param context Unused.
+ * @param game The number of the game.
+ * @param record The game.
+ * @return `true` to go on.
+ */
+bool print_match(void *context, uint64_t game, const GameRecord_t *record) {
+  (void)context;
+  printf("game %llu: seed %llu, %dx%d, policy %d, score %d, level %d, "
+         "%lld ticks, %d input runs\n",
+         (unsigned long long)game, (unsigned long long)record->seed,
+         record->width, record->height, record->policy, record->score,
+         record->level, record->ticks, record->run_count);
+  return true;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file perft.c
+ * @brief Command line perft counter and move generation benchmark.
+ *
+ * For every depth from 1 to `--depth N` the positions reachable by placing
+ * that many tetraminos of a seeded sequence are counted and the counting rate
+ * is reported. The counts are a regression oracle for the movement and
+ * collision code: they only change when the rules change.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../brick_game/tetris/perft.h"
+
+#define DEFAULT_PERFT_DEPTH 3
+
+/**
+ * @brief Command line options of the perft tool.
+ */
+typedef struct {
+  uint64_t seed;
+  int depth;
+  int threads;
+  int width;
+  int height;
+} PerftOptions_t;
+
+bool parse_perft_options(int argc, char *argv[], PerftOptions_t *options);
+
+/**
+ * @brief Prints the perft counts of a seeded tetramino sequence.
+ *
+ * Options: `--seed N`, `--depth N` (1 to `MAX_PERFT_DEPTH`), `--threads N`
+ * (the number of processors by default), `--width N` and `--height N`.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  PerftOptions_t options = {
+      1, DEFAULT_PERFT_DEPTH,
+      processors < 1                   ? 1
+      : processors > MAX_PERFT_THREADS ? MAX_PERFT_THREADS
+                                       : (int)processors,
+      FIELD_WIDTH, FIELD_HEIGHT};
+  if (!parse_perft_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--depth N] [--threads N] [--width N] "
+            "[--height N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  int error = 0;
+  printf("seed %llu, %dx%d field, %d threads\n",
+         (unsigned long long)options.seed, options.width, options.height,
+         options.threads);
+  for (int depth = 1; !error && depth <= options.depth; depth++) {
+    PerftResult_t result;
+    error = perft_run(options.width, options.height, options.seed, depth,
+                      options.threads, &result);
+    if (error) {
+      fprintf(stderr, "perft failed at depth %d\n", depth);
+    } else {
+      printf("depth %d: %lld placements, %lld distinct fields, %lld nodes in "
+             "%.3f s (%.0f nodes/s)\n",
+             depth, result.leaves, result.distinct, result.nodes,
+             result.seconds,
+             result.seconds > 0 ? result.nodes / result.seconds : 0.0);
+    }
+  }
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the perft tool.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and are in range.
+ */
+bool parse_perft_options(int argc, char *argv[], PerftOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      options->seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+      options->depth = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      options->threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--width") && i + 1 < argc)
+      options->width = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--height") && i + 1 < argc)
+      options->height = atoi(argv[++i]);
+    else
+      is_ok = false;
+  }
+  return is_ok && options->depth >= 1 && options->depth <= MAX_PERFT_DEPTH &&
+         options->threads >= 1 && options->threads <= MAX_PERFT_THREADS &&
+         is_valid_board_size(options->width, options->height);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file planner.c
+ * @brief Command line benchmark of the Monte Carlo planner.
+ *
+ * Plays a seeded game with the planner and the same game with the greedy
+ * policy, then reports the pieces placed, the lines cleared, the level
+ * reached and the rollout rate of the planner.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../brick_game/tetris/planner.h"
+
+#define DEFAULT_PLANNER_PIECES 200
+
+/**
+ * @brief Command line options of the planner tool.
+ */
+typedef struct {
+  PlannerConfig_t config;
+  int pieces;
+} PlannerOptions_t;
+
+bool parse_planner_options(int argc, char *argv[], PlannerOptions_t *options);
+long long int play_planner(Planner_t *planner, GameState_t *game, int pieces);
+void play_greedy(GameState_t *game, int pieces);
+
+/**
+ * @brief Compares the planner with the greedy policy on a seeded game.
+ *
+ * Options: `--seed N`, `--pieces N`, `--threads N` (the number of processors
+ * by default), `--budget MS` (time per move, `0` for a single round),
+ * `--horizon N` and `--rollouts N` (rollouts per task).
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  PlannerOptions_t options = {{default_thread_count(), DEFAULT_ROLLOUT_HORIZON,
+                               DEFAULT_ROLLOUTS_PER_TASK,
+                               DEFAULT_PLANNER_BUDGET_US, 1},
+                              DEFAULT_PLANNER_PIECES};
+  if (!parse_planner_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--pieces N] [--threads N] [--budget MS] "
+            "[--horizon N] [--rollouts N]\n",
+            argv[0]);
+    return 1;
+  }
+
+  Planner_t planner;
+  GameState_t game, greedy;
+  int error = planner_init(&planner, &options.config);
+  if (!error) error = state_init(&game, FIELD_WIDTH, FIELD_HEIGHT,
+                                 options.config.seed);
+  if (!error) {
+    state_clone(&greedy, &game);
+    long long int elapsed_us = play_planner(&planner, &game, options.pieces);
+    play_greedy(&greedy, options.pieces);
+    double seconds = elapsed_us / 1e6;
+    printf("planner: %d pieces, %d lines, level %d, %lld rollouts in %.2f s "
+           "(%.0f rollouts/s, %d threads, %lld steals)\n",
+           game.pieces, game.lines, game.level, planner.rollouts, seconds,
+           seconds > 0 ? planner.rollouts / seconds : 0.0,
+           planner.pool.threads, atomic_load(&planner.pool.steals));
+    printf("greedy:  %d pieces, %d lines, level %d\n", greedy.pieces,
+           greedy.lines, greedy.level);
+    planner_free(&planner);
+  } else {
+    fprintf(stderr, "planner setup failed\n");
+  }
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the planner tool.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and are in range.
+ */
+bool parse_planner_options(int argc, char *argv[], PlannerOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      options->config.seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--pieces") && i + 1 < argc)
+      options->pieces = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      options->config.threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      options->config.budget_us = atoll(argv[++i]) * 1000;
+    else if (!strcmp(argv[i], "--horizon") && i + 1 < argc)
+      options->config.horizon = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--rollouts") && i + 1 < argc)
+      options->config.rollouts_per_task = atoi(argv[++i]);
+    else
+      is_ok = false;
+  }
+  return is_ok && options->pieces >= 1 && options->config.threads >= 1 &&
+         options->config.threads <= MAX_POOL_THREADS &&
+         options->config.budget_us >= 0 && options->config.horizon >= 1 &&
+         options->config.horizon <= MAX_ROLLOUT_HORIZON &&
+         options->config.rollouts_per_task >= 1;
+}
+
+/**
+ * @brief Places tetraminos chosen by the planner until the game is over.
+ *
+ * @param planner The planner.
+ * @param game The game to play.
+ * @param pieces The maximum number of tetraminos to place.
+ * @return The time spent in microseconds.
+ */
+long long int play_planner(Planner_t *planner, GameState_t *game, int pieces) {
+  long long int start_us = monotonic_us();
+  Placement_t best;
+  for (int i = 0; i < pieces && !state_is_over(game); i++) {
+    if (planner_choose(planner, game, &best))
+      state_place(game, best.rotation, best.x_position);
+    else
+      game->state = Game_over;
+  }
+  return monotonic_us() - start_us;
+}
+
+/**
+ * @brief Places tetraminos chosen by the greedy policy until the game is over.
+ *
+ * @param game The game to play.
+ * @param pieces The maximum number of tetraminos to place.
+ */
+void play_greedy(GameState_t *game, int pieces) {
+  for (int i = 0; i < pieces && !state_is_over(game); i++) autoplay_step(game);
+}
@@ -0,0 +1,207 @@
+/**
+ * @file tournament.c
+ * @brief Command line runner of round-robin bot tournaments.
+ *
+ * Plays the greedy policy and any number of bot plugins on the same seeded
+ * tetramino sequences, then reports the score distribution of every bot, the
+ * paired comparison of every two bots and the throughput.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../brick_game/tetris/tournament.h"
+
+#define DEFAULT_TOURNAMENT_GAMES 64
+#define DEFAULT_TOURNAMENT_TICKS (5 * 60 * 1000 / TICK_MS)
+
+/**
+ * @brief Command line options of the tournament runner.
+ */
+typedef struct {
+  TournamentConfig_t config;
+  const char *paths[MAX_TOURNAMENT_BOTS];
+  int bots;
+  bool has_greedy;
+  const char *log_path;
+  const char *metrics_path;
+  long long int metrics_interval_ms;
+} TournamentOptions_t;
+
+bool parse_tournament_options(int argc, char *argv[],
+                              TournamentOptions_t *options);
+void print_tournament(const Tournament_t *tournament);
+int close_game_log(Tournament_t *tournament, const char *path);
+
+/**
+ * @brief Runs a tournament and prints its results.
+ *
+ * Options: `--games N` (number of seeds), `--seed N`, `--threads N` (the
+ * number of processors by default), `--ticks N` (ticks of 5 ms after which a
+ * game ends), `--width N`, `--height N`, `--bot FILE` (a plugin, may be
+ * repeated), `--no-greedy` (leave the greedy policy out), `--budget MS`
+ * (time per move of the plugins), `--log FILE` (append every game to a
+ * game-log archive), `--metrics FILE` (keep a Prometheus metrics file up to
+ * date while the games run) and `--metrics-interval MS`.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  TournamentOptions_t options = {
+      {DEFAULT_TOURNAMENT_GAMES, 1, default_thread_count(),
+       DEFAULT_TOURNAMENT_TICKS, FIELD_WIDTH, FIELD_HEIGHT,
+       DEFAULT_BOT_BUDGET_US},
+      {NULL},
+      0,
+      true,
+      NULL,
+      NULL,
+      DEFAULT_METRICS_INTERVAL_MS};
+  if (!parse_tournament_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--games N] [--seed N] [--threads N] [--ticks N] "
+            "[--width N] [--height N] [--bot FILE]... [--no-greedy] "
+            "[--budget MS] [--log FILE] [--metrics FILE] "
+            "[--metrics-interval MS]\n",
+            argv[0]);
+    return 1;
+  }
+
+  Tournament_t *tournament = malloc(sizeof(Tournament_t));
+  int error = tournament ? 0 : 1;
+  if (!error)
+    error = tournament_init(tournament, &options.config, options.paths,
+                            options.bots);
+  if (!error && options.log_path) {
+    error = tournament_open_log(tournament, options.log_path);
+    if (error) tournament_free(tournament);
+  }
+  if (!error && options.metrics_path) {
+    error = tournament_export_metrics(tournament, options.metrics_path,
+                                      options.metrics_interval_ms);
+    if (error) tournament_free(tournament);
+  }
+  if (!error) {
+    tournament_run(tournament);
+    error = atomic_load(&tournament->errors);
+    if (!error) print_tournament(tournament);
+    if (!error && options.log_path)
+      error = close_game_log(tournament, options.log_path);
+    tournament_free(tournament);
+  }
+  if (error) fprintf(stderr, "tournament failed\n");
+  free(tournament);
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the tournament runner.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and at least one bot is
+ * left. The greedy policy, unless left out, is the first bot.
+ */
+bool parse_tournament_options(int argc, char *argv[],
+                              TournamentOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--games") && i + 1 < argc)
+      options->config.games = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      options->config.seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      options->config.threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--ticks") && i + 1 < argc)
+      options->config.max_ticks = atoll(argv[++i]);
+    else if (!strcmp(argv[i], "--width") && i + 1 < argc)
+      options->config.width = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--height") && i + 1 < argc)
+      options->config.height = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      options->config.budget_us = atoll(argv[++i]) * 1000;
+    else if (!strcmp(argv[i], "--log") && i + 1 < argc)
+      options->log_path = argv[++i];
+    else if (!strcmp(argv[i], "--metrics") && i + 1 < argc)
+      options->metrics_path = argv[++i];
+    else if (!strcmp(argv[i], "--metrics-interval") && i + 1 < argc)
+      options->metrics_interval_ms = atoll(argv[++i]);
+    else if (!strcmp(argv[i], "--no-greedy"))
+      options->has_greedy = false;
+    else if (!strcmp(argv[i], "--bot") && i + 1 < argc &&
+             options->bots < MAX_TOURNAMENT_BOTS)
+      options->paths[options->bots++] = argv[++i];
+    else
+      is_ok = false;
+  }
+  if (options->has_greedy && options->bots == MAX_TOURNAMENT_BOTS)
+    is_ok = false;
+  else if (options->has_greedy) {
+    memmove(&options->paths[1], &options->paths[0],
+            sizeof(const char *) * options->bots);
+    options->paths[0] = NULL;
+    options->bots++;
+  }
+  return is_ok && options->bots >= 1;
+}
+
+/**
+ * @brief Prints the score distributions, the paired comparisons and the
+ * throughput of a finished tournament.
+ *
+ * @param tournament The tournament.
+ */
+void print_tournament(const Tournament_t *tournament) {
+  int games = tournament->config.games;
+  long long int ticks = 0;
+  printf("%d bots, %d seeds, %d threads\n", tournament->bots, games,
+         tournament->pool.threads);
+  printf("%-12s %9s %21s %9s %7s %7s %7s %9s\n", "bot", "mean", "95% CI",
+         "stddev", "median", "min", "max", "forfeits");
+  for (int b = 0; b < tournament->bots; b++) {
+    ScoreSummary_t summary;
+    BotPlugin_t totals;
+    summarize_scores(&tournament->scores[b * games], games, &summary);
+    tournament_bot_totals(tournament, b, &totals);
+    printf("%-12s %9.1f [%9.1f, %9.1f] %9.1f %7d %7d %7d %9lld\n",
+           tournament->names[b], summary.mean, summary.low, summary.high,
+           summary.stddev, summary.median, summary.min, summary.max,
+           totals.forfeits);
+    for (int g = 0; g < games; g++) ticks += tournament->ticks[b * games + g];
+  }
+  for (int a = 0; a < tournament->bots; a++) {
+    for (int b = a + 1; b < tournament->bots; b++) {
+      PairSummary_t pair;
+      compare_scores(&tournament->scores[a * games],
+                     &tournament->scores[b * games], games, &pair);
+      printf("%s - %s: %+.1f [%+.1f, %+.1f], %d wins, %d ties, %d losses\n",
+             tournament->names[a], tournament->names[b], pair.mean, pair.low,
+             pair.high, pair.wins, pair.ties, pair.losses);
+    }
+  }
+  double seconds = tournament->seconds;
+  int total = tournament->bots * games;
+  printf("%d games, %lld ticks in %.2f s (%.1f games/s, %.0f ticks/s)\n",
+         total, ticks, seconds, seconds > 0 ? total / seconds : 0.0,
+         seconds > 0 ? ticks / seconds : 0.0);
+}
+
+/**
+ * @brief Closes the game-log archive the games of a finished tournament were
+ * appended to and prints its size.
+ *
+ * @param tournament The tournament, run with its log open.
+ * @param path The path of the archive.
+ * @return Error code (`0` on success).
+ */
+int close_game_log(Tournament_t *tournament, const char *path) {
+  uint64_t games = tournament->log->games;
+  int error = tournament_close_log(tournament);
+  if (!error) printf("%s: %llu games\n", path, (unsigned long long)games);
+  return error;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file versus.c
+ * @brief Command line runner of bot-versus-bot matches.
+ *
+ * Plays a number of seeded rounds between two autoplay bots, each engine on
+ * its own thread, and reports the wins, the garbage exchanged and the
+ * simulation rate. Either player may be a bot plugin instead of the greedy
+ * policy.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../brick_game/tetris/bot_plugin.h"
+#include "../brick_game/tetris/versus.h"
+
+#define DEFAULT_VERSUS_ROUNDS 10
+#define DEFAULT_VERSUS_TICKS (10 * 60 * 1000 / TICK_MS)
+
+/**
+ * @brief Command line options of the versus runner.
+ */
+typedef struct {
+  uint64_t seed;
+  int rounds;
+  long long int ticks;
+  int width;
+  int height;
+  const char *bot_paths[VERSUS_PLAYERS];
+  long long int budget_us;
+} VersusOptions_t;
+
+bool parse_versus_options(int argc, char *argv[], VersusOptions_t *options);
+int load_versus_bots(const VersusOptions_t *options, BotPlugin_t *bots);
+void print_bot_stats(const BotPlugin_t *bots);
+
+/**
+ * @brief Plays bot-versus-bot rounds and prints the results.
+ *
+ * Options: `--seed N`, `--rounds N`, `--ticks N` (simulated ticks of 5 ms
+ * after which a round is decided on score), `--width N`, `--height N`,
+ * `--bot1 FILE` and `--bot2 FILE` (bot plugins of the players) and
+ * `--budget MS` (time per move of the plugins).
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @return An integer exit status (0 for success).
+ */
+int main(int argc, char *argv[]) {
+  VersusOptions_t options = {1,           DEFAULT_VERSUS_ROUNDS,
+                             DEFAULT_VERSUS_TICKS, FIELD_WIDTH,
+                             FIELD_HEIGHT, {NULL, NULL},
+                             DEFAULT_BOT_BUDGET_US};
+  if (!parse_versus_options(argc, argv, &options)) {
+    fprintf(stderr,
+            "usage: %s [--seed N] [--rounds N] [--ticks N] [--width N] "
+            "[--height N] [--bot1 FILE] [--bot2 FILE] [--budget MS]\n",
+            argv[0]);
+    return 1;
+  }
+
+  BotPlugin_t bots[VERSUS_PLAYERS];
+  if (load_versus_bots(&options, bots)) return 1;
+  Versus_t *versus = malloc(sizeof(Versus_t));
+  int error = versus ? 0 : 1;
+  int wins[VERSUS_PLAYERS] = {0}, draws = 0;
+  long long int garbage = 0, ticks = 0;
+  long long int start_us = monotonic_us();
+  for (int round = 0; !error && round < options.rounds; round++) {
+    error = versus_init(versus, options.width, options.height,
+                        options.seed + (uint64_t)round);
+    for (int i = 0; !error && i < VERSUS_PLAYERS; i++)
+      if (bots[i].api) versus->players[i].driver.bot = &bots[i];
+    if (!error) error = versus_run_bots(versus, options.ticks);
+    if (!error) {
+      int winner = versus_winner(versus);
+      if (winner == VERSUS_RUNNING)
+        draws++;
+      else
+        wins[winner]++;
+      for (int i = 0; i < VERSUS_PLAYERS; i++) {
+        garbage += versus->players[i].model.garbage_sent;
+        ticks += atomic_load(&versus->players[i].ticks);
+      }
+      if (winner == VERSUS_RUNNING)
+        printf("round %d: draw, ", round + 1);
+      else
+        printf("round %d: winner %d, ", round + 1, winner + 1);
+      printf("scores %d / %d, garbage %d / %d\n",
+             versus->players[0].model.score,
+             versus->players[1].model.score,
+             versus->players[0].model.garbage_sent,
+             versus->players[1].model.garbage_sent);
+      versus_free(versus);
+    }
+  }
+  double seconds = (double)(monotonic_us() - start_us) / 1e6;
+  if (error) {
+    fprintf(stderr, "versus setup failed\n");
+  } else {
+    printf("wins %d / %d, %d draws, %lld garbage rows, %lld ticks in %.2f s "
+           "(%.0f ticks/s)\n",
+           wins[0], wins[1], draws, garbage, ticks, seconds,
+           seconds > 0 ? ticks / seconds : 0.0);
+    print_bot_stats(bots);
+  }
+  for (int i = 0; i < VERSUS_PLAYERS; i++) bot_unload(&bots[i]);
+  free(versus);
+  return error ? 1 : 0;
+}
+
+/**
+ * @brief Parses the command line options of the versus runner.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param[out] options The parsed options.
+ * @return `true` if all arguments were recognized and are in range.
+ */
+bool parse_versus_options(int argc, char *argv[], VersusOptions_t *options) {
+  bool is_ok = true;
+  for (int i = 1; is_ok && i < argc; i++) {
+    if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      options->seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--rounds") && i + 1 < argc)
+      options->rounds = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--ticks") && i + 1 < argc)
+      options->ticks = atoll(argv[++i]);
+    else if (!strcmp(argv[i], "--width") && i + 1 < argc)
+      options->width = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--height") && i + 1 < argc)
+      options->height = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--bot1") && i + 1 < argc)
+      options->bot_paths[0] = argv[++i];
+    else if (!strcmp(argv[i], "--bot2") && i + 1 < argc)
+      options->bot_paths[1] = argv[++i];
+    else if (!strcmp(argv[i], "--budget") && i + 1 < argc)
+      options->budget_us = atoll(argv[++i]) * 1000;
+    else
+      is_ok = false;
+  }
+  return is_ok && options->rounds >= 1 && options->ticks >= 1 &&
+         options->budget_us > 0 &&
+         is_valid_board_size(options->width, options->height) &&
+         options->height <= STATE_MAX_HEIGHT;
+}
+
+/**
+ * @brief Loads the bot plugins given on the command line.
+ *
+ * The same library may be given to both players; each gets its own bot.
+ *
+ * @param options The options of the runner.
+ * @param[out] bots The plugins, not loaded for players without one.
+ * @return Error code (`0` on success).
+ */
+int load_versus_bots(const VersusOptions_t *options, BotPlugin_t *bots) {
+  int error = 0;
+  for (int i = 0; i < VERSUS_PLAYERS; i++) {
+    bots[i].library = NULL;
+    bots[i].api = NULL;
+    bots[i].bot = NULL;
+  }
+  for (int i = 0; !error && i < VERSUS_PLAYERS; i++) {
+    if (options->bot_paths[i]) {
+      error = bot_load(&bots[i], options->bot_paths[i], options->budget_us,
+                       options->seed + (uint64_t)i);
+      if (error)
+        fprintf(stderr, "cannot load bot plugin %s\n", options->bot_paths[i]);
+    }
+  }
+  if (error)
+    for (int i = 0; i < VERSUS_PLAYERS; i++) bot_unload(&bots[i]);
+  return error;
+}
+
+/**
+ * @brief Prints the move times and forfeits of the loaded plugins.
+ *
+ * @param bots The plugins of the players.
+ */
+void print_bot_stats(const BotPlugin_t *bots) {
+  for (int i = 0; i < VERSUS_PLAYERS; i++) {
+    if (bots[i].api) {
+      printf("bot %d (%s): %lld moves, %lld forfeited, mean %.0f us, max "
+             "%lld us\n",
+             i + 1, bots[i].api->name ? bots[i].api->name : "?",
+             bots[i].calls, bots[i].forfeits,
+             bots[i].calls ? (double)bots[i].total_us / bots[i].calls : 0.0,
+             bots[i].max_us);
+    }
+  }
+}